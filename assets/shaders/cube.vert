@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) in vec3 aPos; layout (location = 1) in vec3 aNormal; layout (location = 2) in vec2 aUV;
+layout (location = 3) in vec4 aTangent;   // xyz, w = bitangent sign (mesh_tangents.h), for normal maps
+out vec3 FragPos; out vec3 Normal; out vec2 TexCoord;
+uniform mat4 model, view, projection;
+void main() {
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    TexCoord = vec2(aUV.x, 1.0 - aUV.y);   // images are uploaded top row first
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
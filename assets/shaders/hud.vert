@@ -0,0 +1,8 @@
+#version 330 core
+layout (location = 0) in vec2 aPos; layout (location = 1) in vec2 aUV; layout (location = 2) in vec4 aColor;
+uniform vec2 screenSize;
+out vec2 UV; out vec4 Color;
+void main() {
+    gl_Position = vec4(aPos / screenSize * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+    UV = aUV; Color = aColor;
+}
@@ -0,0 +1,10 @@
+#version 330 core
+out vec4 FragColor; in vec3 vWorldPos; in vec3 vNormal; in float vHeat;
+uniform vec3 lightPos;
+void main() {
+    vec3 albedo = vHeat < -1.5 ? vec3(1.0)                 // picked
+                : vHeat < 0.0 ? vec3(1.0, 0.12, 0.1)   // in contact
+                : mix(vec3(0.35, 0.55, 1.0), vec3(1.0, 0.55, 0.25), clamp(vHeat, 0.0, 1.0));
+    float diff = max(dot(normalize(vNormal), normalize(lightPos - vWorldPos)), 0.0);
+    FragColor = vec4((0.2 + diff) * albedo, 1.0);
+}
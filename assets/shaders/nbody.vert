@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) in vec3 aPos; layout (location = 1) in vec3 aNormal;
+layout (location = 4) in vec4 iPosHeat;   // per instance: position, speed relative to the inner orbit (-1: in contact, -2: picked)
+out vec3 vWorldPos; out vec3 vNormal; out float vHeat;
+uniform mat4 viewProj; uniform float scale;
+void main() {
+    vWorldPos = iPosHeat.xyz + aPos * scale;
+    vNormal = aNormal;
+    vHeat = iPosHeat.w;
+    gl_Position = viewProj * vec4(vWorldPos, 1.0);
+}
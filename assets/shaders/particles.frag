@@ -0,0 +1,7 @@
+#version 330 core
+in vec3 vColor; out vec4 FragColor;
+void main() {
+    vec2 d = gl_PointCoord * 2.0 - 1.0;
+    float falloff = max(0.0, 1.0 - dot(d, d));
+    FragColor = vec4(vColor * falloff * falloff, 1.0);   // added, not blended: order doesn't matter
+}
@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec4 aPosAge; layout (location = 1) in vec4 aVelLife;
+out vec3 vColor;
+uniform mat4 viewProj; uniform vec3 center; uniform float pixelsPerUnit; uniform float size; uniform float intensity;
+void main() {
+    if (aPosAge.w >= aVelLife.w) { gl_Position = vec4(2.0, 2.0, 2.0, 1.0); gl_PointSize = 1.0; vColor = vec3(0.0); return; }   // dead: clipped
+    // White-hot at launch, through the sun's yellow to a dull red as it fades.
+    float t = clamp(aPosAge.w / aVelLife.w, 0.0, 1.0);
+    vec3 hot = vec3(1.0, 0.95, 0.8), warm = vec3(1.0, 0.7, 0.25), cool = vec3(0.6, 0.12, 0.05);
+    vec3 c = t < 0.3 ? mix(hot, warm, t / 0.3) : mix(warm, cool, (t - 0.3) / 0.7);
+    vColor = c * intensity * (1.0 - t);
+    gl_Position = viewProj * vec4(center + aPosAge.xyz, 1.0);
+    gl_PointSize = clamp(size * pixelsPerUnit / max(gl_Position.w, 0.1), 1.0, 32.0);
+}
@@ -0,0 +1,4 @@
+#version 330 core
+// Never runs (the update pass discards rasterization); here so the update
+// program is a .vert/.frag pair like every other one.
+void main() {}
@@ -0,0 +1,42 @@
+#version 330 core
+// Transform feedback pass, rasterizer off: one vertex per particle slot, read
+// from one buffer and captured into the other. Dead slots respawn on the
+// planet's surface here, so emission is GPU work too. Positions are relative
+// to the planet: its scripted orbit isn't a free fall the debris could share.
+layout (location = 0) in vec4 aPosAge;    // position, age (s)
+layout (location = 1) in vec4 aVelLife;   // velocity, lifetime (s)
+out vec4 outPosAge; out vec4 outVelLife;
+uniform float radius;                     // the planet's
+uniform float dt; uniform float gm;       // step, the planet's G * M
+uniform uint seed;                        // new every frame
+uniform bool reset;                       // first update: every slot spawns somewhere in its life
+
+uint hash(uint x) { x ^= x >> 16; x *= 0x7feb352du; x ^= x >> 15; x *= 0x846ca68bu; x ^= x >> 16; return x; }
+float rand(inout uint s) { s = hash(s); return float(s >> 8) * (1.0 / 16777216.0); }
+
+void main() {
+    vec3 p = aPosAge.xyz, v = aVelLife.xyz;
+    float age = aPosAge.w, life = aVelLife.w;
+    if (reset || age >= life) {
+        uint s = hash(uint(gl_VertexID) ^ hash(seed));
+        float z = 2.0 * rand(s) - 1.0, a = 6.2831853 * rand(s), ring = sqrt(1.0 - z * z);
+        vec3 n = vec3(ring * cos(a), z, ring * sin(a));
+        // Mostly outward, below escape speed so most arc back, with some swirl
+        // around the spin axis.
+        float escape = sqrt(2.0 * gm / radius);
+        vec3 swirl = cross(vec3(0.0, 1.0, 0.0), n);
+        vec3 jitter = vec3(rand(s), rand(s), rand(s)) - 0.5;
+        v = (n * mix(0.35, 0.95, rand(s)) + swirl * 0.25 + jitter * 0.3) * escape;
+        p = n * radius * 1.01;
+        life = mix(1.5, 5.0, rand(s));
+        age = reset ? life * rand(s) : 0.0;
+    } else {
+        float d2 = max(dot(p, p), radius * radius);
+        v -= p * (gm * inversesqrt(d2) / d2) * dt;   // semi-implicit Euler
+        p += v * dt;
+        age += dt;
+        if (dot(p, p) < radius * radius) age = life;   // fell back in
+    }
+    outPosAge = vec4(p, age);
+    outVelLife = vec4(v, life);
+}
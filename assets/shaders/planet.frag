@@ -0,0 +1,4 @@
+#version 330 core
+out vec4 FragColor;
+uniform vec3 color;   // the unlit material's colour
+void main() { FragColor = vec4(color, 1.0); }
@@ -0,0 +1,10 @@
+#version 330 core
+out vec4 FragColor; in vec3 FragPos; in vec3 Normal; in vec2 TexCoord;
+uniform sampler2D tex0; uniform vec3 lightPos; uniform vec4 flatColor;   // flatColor.a = 1: unlit (the planet)
+void main() {
+    vec3 albedo = texture(tex0, TexCoord).rgb;
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    FragColor = vec4(mix((0.2 + diff) * albedo, flatColor.rgb, flatColor.a), 1.0);
+}
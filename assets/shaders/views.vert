@@ -0,0 +1,12 @@
+#version 330 core
+layout (location = 0) in vec3 aPos; layout (location = 1) in vec3 aNormal; layout (location = 2) in vec2 aUV;
+layout (location = 3) in vec4 aTangent;   // xyz, w = bitangent sign (mesh_tangents.h), for normal maps
+layout (location = 4) in mat4 iModel; layout (location = 8) in uint iViewMask;   // per instance
+out vec3 vWorldPos; out vec3 vNormal; out vec2 vUV; flat out uint vViewMask;
+void main() {
+    vWorldPos = vec3(iModel * vec4(aPos, 1.0));
+    vNormal = mat3(transpose(inverse(iModel))) * aNormal;
+    vUV = vec2(aUV.x, 1.0 - aUV.y);
+    vViewMask = iViewMask;
+    gl_Position = vec4(vWorldPos, 1.0);
+}
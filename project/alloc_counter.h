@@ -0,0 +1,63 @@
+#pragma once
+// ---------------- Allocation Counter ----------------
+// Build with -DTRACK_ALLOCS to replace the global operator new/delete with
+// counting versions; allocCounts() deltas then show how many heap allocations a
+// piece of code made. Each block also carries a small header with its size and
+// the MemTagScope tag it was made under, so mem_tracker.h can report live heap
+// bytes per category. Without the define everything reads as zero and costs nothing.
+// The replacements are real (non-inline) definitions: include this header from
+// exactly one translation unit of a program (project/main.cpp, a tool's main.cpp).
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include "mem_tracker.h"
+
+struct AllocCounts {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+inline std::atomic<uint64_t>& allocCountRef() { static std::atomic<uint64_t> v{0}; return v; }
+inline std::atomic<uint64_t>& allocBytesRef() { static std::atomic<uint64_t> v{0}; return v; }
+
+inline AllocCounts allocCounts() {
+    return { allocCountRef().load(std::memory_order_relaxed), allocBytesRef().load(std::memory_order_relaxed) };
+}
+
+inline AllocCounts operator-(const AllocCounts& a, const AllocCounts& b) { return { a.count - b.count, a.bytes - b.bytes }; }
+
+#ifdef TRACK_ALLOCS
+static const bool kTrackAllocs = true;
+
+// 16 bytes keeps the default new alignment.
+struct alignas(16) AllocHeader { uint64_t size; int32_t tag; };
+
+static void* countedAlloc(std::size_t n) {
+    allocCountRef().fetch_add(1, std::memory_order_relaxed);
+    allocBytesRef().fetch_add(n, std::memory_order_relaxed);
+    AllocHeader* h = (AllocHeader*)std::malloc(sizeof(AllocHeader) + n);
+    if (!h) throw std::bad_alloc();
+    h->size = n;
+    h->tag = memCurrentTag();
+    memTrackAlloc(h->tag, n);
+    return h + 1;
+}
+
+static void countedFree(void* p) {
+    if (!p) return;
+    AllocHeader* h = (AllocHeader*)p - 1;
+    memTrackFree(h->tag, h->size);
+    std::free(h);
+}
+
+void* operator new(std::size_t n) { return countedAlloc(n); }
+void* operator new[](std::size_t n) { return countedAlloc(n); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedFree(p); }
+#else
+static const bool kTrackAllocs = false;
+#endif
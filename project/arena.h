@@ -0,0 +1,101 @@
+#pragma once
+// ---------------- Arenas ----------------
+// Bump allocation for scratch memory whose lifetime is "until this load / frame
+// is over". Allocating is a pointer bump, freeing is a no-op, and reset() hands
+// every byte back at once while keeping the chunks for the next round.
+//   Arena        - chunked bump allocator, grows by doubling, never shrinks.
+//   ArenaResource- std::pmr adapter so pmr containers can live in an Arena.
+//   frameArena() - the per-frame arena; main() resets it at the top of every frame.
+// Chunk memory is charged to the arena's MemCategory.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <vector>
+#include "mem_tracker.h"
+
+class Arena {
+public:
+    explicit Arena(size_t firstChunkBytes = 64u << 10, int category = kMemOther)
+        : nextChunk_(firstChunkBytes), category_(category) {}
+    ~Arena() { for (Chunk& c : chunks_) { memTrackFree(category_, c.size); std::free(c.base); } }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* alloc(size_t size, size_t align = alignof(std::max_align_t)) {
+        if (cur_ < chunks_.size()) {
+            Chunk& c = chunks_[cur_];
+            uintptr_t p = ((uintptr_t)c.base + c.used + (align - 1)) & ~(uintptr_t)(align - 1);
+            if (p + size <= (uintptr_t)c.base + c.size) {
+                c.used = p + size - (uintptr_t)c.base;
+                bytesUsed_ += size;
+                peakBytes_ = std::max(peakBytes_, bytesUsed_);
+                return (void*)p;
+            }
+        }
+        return allocSlow(size, align);
+    }
+
+    template <typename T>
+    T* allocArray(size_t n) { return static_cast<T*>(alloc(n * sizeof(T), alignof(T))); }
+
+    // Everything allocated since the matching mark() is released by rewind().
+    struct Marker { size_t chunk, used, bytes; };
+    Marker mark() const { return { cur_, cur_ < chunks_.size() ? chunks_[cur_].used : 0, bytesUsed_ }; }
+    void rewind(const Marker& m) {
+        for (size_t i = m.chunk + 1; i < chunks_.size() && i <= cur_; ++i) chunks_[i].used = 0;
+        cur_ = m.chunk;
+        if (cur_ < chunks_.size()) chunks_[cur_].used = m.used;
+        bytesUsed_ = m.bytes;
+    }
+    void reset() { rewind(Marker{ 0, 0, 0 }); }
+
+    size_t bytesUsed() const { return bytesUsed_; }
+    size_t peakBytes() const { return peakBytes_; }
+    size_t capacity() const { size_t n = 0; for (const Chunk& c : chunks_) n += c.size; return n; }
+
+private:
+    struct Chunk { char* base; size_t size; size_t used; };
+
+    void* allocSlow(size_t size, size_t align) {
+        // Reuse a later chunk kept from a previous round before asking for a new one.
+        while (++cur_ < chunks_.size()) {
+            Chunk& c = chunks_[cur_];
+            c.used = 0;
+            if (size + align <= c.size) return alloc(size, align);
+        }
+        size_t bytes = std::max(nextChunk_, size + align);
+        nextChunk_ = std::max(nextChunk_, bytes) * 2;
+        char* base = (char*)std::malloc(bytes);
+        if (!base) throw std::bad_alloc();
+        memTrackAlloc(category_, bytes);
+        chunks_.push_back({ base, bytes, 0 });
+        cur_ = chunks_.size() - 1;
+        return alloc(size, align);
+    }
+
+    std::vector<Chunk> chunks_;
+    size_t cur_ = 0;
+    size_t nextChunk_;
+    int category_;
+    size_t bytesUsed_ = 0;
+    size_t peakBytes_ = 0;
+};
+
+class ArenaResource : public std::pmr::memory_resource {
+public:
+    explicit ArenaResource(Arena& arena) : arena_(arena) {}
+    Arena& arena() { return arena_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t align) override { return arena_.alloc(bytes, align); }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+
+    Arena& arena_;
+};
+
+inline Arena& frameArena() { static Arena arena(256u << 10, kMemScene); return arena; }
+inline std::pmr::memory_resource* frameResource() { static ArenaResource r(frameArena()); return &r; }
@@ -0,0 +1,185 @@
+#pragma once
+// ---------------- Asset Manager ----------------
+// Splits every load into a CPU half (read, parse, decode) that runs on a small
+// worker pool and a GL half that runs on the render thread. Finished CPU work
+// queues up; drainUploads() runs the GL halves once per frame until the frame's
+// upload byte budget is spent (always at least one, so big assets still land).
+//
+//   AssetHandle<GLuint> tex = assets.submit<GLuint>("tex", placeholderTex,
+//       [] { return decodeSomething(); },                 // worker: returns a payload P
+//       [](P& p) { return uploadSomething(p); });         // render thread: P -> T
+//
+// A payload P needs `bool ok` and `size_t uploadBytes() const`. Until the GL
+// half has run, handle.get() returns the placeholder, so the scene can render
+// from the first frame and pick assets up as they arrive.
+// With setUploadThread() the GL half runs on the shared-context upload thread
+// instead (no per-frame budget needed), and the optional `finish(T&)` step runs
+// on the render thread once its fence signals - that is where VAOs get made.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "gl_upload_thread.h"
+#include "mem_tracker.h"
+
+enum AssetState { kAssetPending = 0, kAssetReady, kAssetFailed };
+
+template <typename T>
+struct AssetSlot {
+    std::atomic<int> state{ kAssetPending };
+    T value{};
+    T placeholder{};
+    std::string name;
+};
+
+template <typename T>
+class AssetHandle {
+public:
+    AssetHandle() = default;
+    explicit AssetHandle(std::shared_ptr<AssetSlot<T>> slot) : slot_(std::move(slot)) {}
+
+    bool valid() const { return slot_ != nullptr; }
+    bool ready() const { return slot_ && slot_->state.load(std::memory_order_acquire) == kAssetReady; }
+    bool failed() const { return slot_ && slot_->state.load(std::memory_order_acquire) == kAssetFailed; }
+    // The loaded value once ready, the placeholder before that (and after a failure).
+    const T& get() const { return ready() ? slot_->value : slot_->placeholder; }
+    const std::string& name() const { return slot_->name; }
+
+private:
+    std::shared_ptr<AssetSlot<T>> slot_;
+};
+
+struct AssetLoadProgress {
+    int total = 0;
+    int done = 0;       // ready + failed
+    int failed = 0;
+    bool finished() const { return done == total; }
+};
+
+class AssetManager {
+public:
+    AssetManager(unsigned threads, size_t uploadBytesPerFrame) : uploadBudget_(uploadBytesPerFrame) {
+        for (unsigned i = 0; i < std::max(1u, threads); ++i) workers_.emplace_back([this] { workerLoop(); });
+    }
+
+    ~AssetManager() {
+        { std::lock_guard<std::mutex> lock(mutex_); quit_ = true; }
+        cv_.notify_all();
+        for (std::thread& t : workers_) t.join();
+    }
+
+    // Set before the first submit(); the thread must outlive this manager's jobs.
+    void setUploadThread(GLUploadThread* uploader) { uploader_ = uploader; }
+
+    template <typename T, typename Cpu, typename Gpu>
+    AssetHandle<T> submit(const std::string& name, T placeholder, Cpu cpu, Gpu gpu) {
+        return submit<T>(name, placeholder, cpu, gpu, [](T&) {});
+    }
+
+    template <typename T, typename Cpu, typename Gpu, typename Finish>
+    AssetHandle<T> submit(const std::string& name, T placeholder, Cpu cpu, Gpu gpu, Finish finish) {
+        using Payload = std::invoke_result_t<Cpu>;
+        auto slot = std::make_shared<AssetSlot<T>>();
+        slot->name = name;
+        slot->placeholder = placeholder;
+        total_++;
+
+        // std::function needs copyable callables, hence the shared payload.
+        std::function<void()> job = [this, slot, cpu, gpu, finish]() {
+            auto payload = std::make_shared<Payload>(cpu());
+            if (!payload->ok) { complete(slot->state, kAssetFailed); return; }
+            if (uploader_) {
+                uploader_->post([slot, payload, gpu]() { slot->value = gpu(*payload); },
+                                [this, slot, finish]() { finish(slot->value); complete(slot->state, kAssetReady); });
+                return;
+            }
+            Upload up;
+            up.bytes = payload->uploadBytes();
+            up.run = [this, slot, payload, gpu, finish]() {
+                slot->value = gpu(*payload);
+                finish(slot->value);
+                complete(slot->state, kAssetReady);
+            };
+            std::lock_guard<std::mutex> lock(mutex_);
+            uploads_.push_back(std::move(up));
+        };
+        { std::lock_guard<std::mutex> lock(mutex_); jobs_.push_back(std::move(job)); }
+        cv_.notify_one();
+        return AssetHandle<T>(slot);
+    }
+
+    // Render thread, once per frame. Returns the number of GL uploads performed.
+    int drainUploads() {
+        if (uploader_) return uploader_->poll();
+        int count = 0;
+        size_t bytes = 0;
+        for (;;) {
+            Upload up;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (uploads_.empty()) break;
+                if (count > 0 && bytes + uploads_.front().bytes > uploadBudget_) break;
+                up = std::move(uploads_.front());
+                uploads_.pop_front();
+            }
+            up.run();
+            bytes += up.bytes;
+            ++count;
+        }
+        return count;
+    }
+
+    AssetLoadProgress progress() const {
+        AssetLoadProgress p;
+        p.total = total_;
+        p.done = done_.load(std::memory_order_acquire);
+        p.failed = failed_.load(std::memory_order_acquire);
+        return p;
+    }
+
+private:
+    struct Upload {
+        size_t bytes = 0;
+        std::function<void()> run;
+    };
+
+    void complete(std::atomic<int>& state, int result) {
+        state.store(result, std::memory_order_release);
+        if (result == kAssetFailed) failed_++;
+        done_++;
+    }
+
+    void workerLoop() {
+        MemTagScope tag(kMemLoader);
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return quit_ || !jobs_.empty(); });
+                if (quit_) return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    size_t uploadBudget_;
+    GLUploadThread* uploader_ = nullptr;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::deque<Upload> uploads_;
+    bool quit_ = false;
+    int total_ = 0;                 // render thread only
+    std::atomic<int> done_{ 0 };
+    std::atomic<int> failed_{ 0 };
+};
@@ -0,0 +1,215 @@
+#pragma once
+// ---------------- Asset Pack ----------------
+// One archive file: header | entry table (sorted by name hash) | name table | blobs.
+// Every blob starts on a kPackAlign boundary, so a single mmap hands out
+// zero-copy, suitably aligned spans to the mesh/texture/shader loaders.
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mem_tracker.h"
+
+static const uint32_t kPackVersion = 1;
+static const uint64_t kPackAlign = 64;
+
+struct PackHeader {
+    char     magic[4];      // "GPAK"
+    uint32_t version;
+    uint32_t count;
+    uint32_t namesSize;
+    uint64_t namesOffset;
+    uint64_t dataOffset;
+};
+
+struct PackEntry {
+    uint64_t hash;
+    uint64_t offset;        // absolute file offset, kPackAlign aligned
+    uint64_t size;
+    uint32_t nameOffset;    // into the name table
+    uint32_t nameLen;
+};
+
+struct AssetSpan {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    explicit operator bool() const { return data != nullptr; }
+};
+
+inline uint64_t fnv1a64(const void* p, size_t n, uint64_t h = 1469598103934665603ull) {
+    const unsigned char* b = (const unsigned char*)p;
+    for (size_t i = 0; i < n; ++i) { h ^= b[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+inline uint64_t hashAssetName(const std::string& name) { return fnv1a64(name.data(), name.size()); }
+
+class AssetPack {
+public:
+    AssetPack() = default;
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+    ~AssetPack() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PackHeader)) { ::close(fd); return false; }
+        size_t size = (size_t)st.st_size;
+        // MAP_POPULATE turns startup into one sequential read-ahead of the whole file.
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base_ = (const unsigned char*)p; size_ = size;
+        memTrackAlloc(kMemLoader, size_);
+
+        const PackHeader* h = header();
+        size_t tableEnd = sizeof(PackHeader) + (size_t)h->count * sizeof(PackEntry);
+        if (std::memcmp(h->magic, "GPAK", 4) != 0 || h->version != kPackVersion || tableEnd > size_ ||
+            h->namesOffset > size_ || h->namesSize > size_ - h->namesOffset) { close(); return false; }
+        // Every entry checked once, by subtraction so nothing wraps; find() then trusts the table.
+        for (const PackEntry* e = entries(); e != entries() + h->count; ++e)
+            if (e->nameOffset > h->namesSize || e->nameLen > h->namesSize - e->nameOffset ||
+                e->offset > size_ || e->size > size_ - e->offset) { close(); return false; }
+        return true;
+    }
+
+    void close() {
+        if (base_) { munmap((void*)base_, size_); memTrackFree(kMemLoader, size_); }
+        base_ = nullptr; size_ = 0;
+    }
+
+    bool isOpen() const { return base_ != nullptr; }
+    size_t sizeBytes() const { return size_; }
+    uint32_t count() const { return base_ ? header()->count : 0; }
+
+    AssetSpan find(const std::string& name) const {
+        if (!base_) return {};
+        uint64_t h = hashAssetName(name);
+        const PackEntry* first = entries();
+        const PackEntry* last = first + header()->count;
+        const PackEntry* it = std::lower_bound(first, last, h,
+            [](const PackEntry& e, uint64_t v) { return e.hash < v; });
+        for (; it != last && it->hash == h; ++it) {
+            const char* n = (const char*)base_ + header()->namesOffset + it->nameOffset;
+            if (it->nameLen == name.size() && std::memcmp(n, name.data(), name.size()) == 0)
+                return { base_ + it->offset, (size_t)it->size };
+        }
+        return {};
+    }
+
+private:
+    const PackHeader* header() const { return (const PackHeader*)base_; }
+    const PackEntry* entries() const { return (const PackEntry*)(base_ + sizeof(PackHeader)); }
+
+    const unsigned char* base_ = nullptr;
+    size_t size_ = 0;
+};
+
+// One loose file mapped read-only, for loaders that read in place (.glb) when
+// the asset isn't in the pack. Move-only; unmaps on destruction.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) noexcept : base_(o.base_), size_(o.size_) { o.base_ = nullptr; o.size_ = 0; }
+    MappedFile& operator=(MappedFile&& o) noexcept {
+        if (this != &o) { close(); base_ = o.base_; size_ = o.size_; o.base_ = nullptr; o.size_ = 0; }
+        return *this;
+    }
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); return false; }
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base_ = (const unsigned char*)p; size_ = (size_t)st.st_size;
+        memTrackAlloc(kMemLoader, size_);
+        return true;
+    }
+
+    void close() {
+        if (base_) { munmap((void*)base_, size_); memTrackFree(kMemLoader, size_); }
+        base_ = nullptr; size_ = 0;
+    }
+
+    AssetSpan span() const { return { base_, size_ }; }
+
+private:
+    const unsigned char* base_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Bundles (name, file path) pairs into one archive. Names are what the runtime looks up.
+inline bool writeAssetPack(const std::string& outPath,
+                           const std::vector<std::pair<std::string, std::string>>& files,
+                           std::string* err = nullptr) {
+    struct Item { std::string name; std::vector<char> bytes; };
+    std::vector<Item> items;
+    items.reserve(files.size());
+    for (const auto& f : files) {
+        std::ifstream in(f.second, std::ios::binary);
+        if (!in) { if (err) *err = "cannot open " + f.second; return false; }
+        Item it; it.name = f.first;
+        it.bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        items.push_back(std::move(it));
+    }
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+        return hashAssetName(a.name) < hashAssetName(b.name);
+    });
+
+    auto alignUp = [](uint64_t v) { return (v + kPackAlign - 1) & ~(kPackAlign - 1); };
+
+    std::string names;
+    std::vector<PackEntry> table(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        table[i].hash = hashAssetName(items[i].name);
+        table[i].nameOffset = (uint32_t)names.size();
+        table[i].nameLen = (uint32_t)items[i].name.size();
+        names += items[i].name;
+    }
+
+    PackHeader h;
+    std::memcpy(h.magic, "GPAK", 4);
+    h.version = kPackVersion;
+    h.count = (uint32_t)items.size();
+    h.namesSize = (uint32_t)names.size();
+    h.namesOffset = sizeof(PackHeader) + table.size() * sizeof(PackEntry);
+    h.dataOffset = alignUp(h.namesOffset + names.size());
+
+    uint64_t cursor = h.dataOffset;
+    for (size_t i = 0; i < items.size(); ++i) {
+        table[i].offset = cursor;
+        table[i].size = items[i].bytes.size();
+        cursor = alignUp(cursor + items[i].bytes.size());
+    }
+
+    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+    if (!out) { if (err) *err = "cannot write " + outPath; return false; }
+    out.write((const char*)&h, sizeof(h));
+    out.write((const char*)table.data(), table.size() * sizeof(PackEntry));
+    out.write(names.data(), names.size());
+    static const char zeros[kPackAlign] = {};
+    uint64_t pos = h.namesOffset + names.size();
+    out.write(zeros, h.dataOffset - pos);
+    for (size_t i = 0; i < items.size(); ++i) {
+        out.write(items[i].bytes.data(), items[i].bytes.size());
+        pos = table[i].offset + items[i].bytes.size();
+        uint64_t next = alignUp(pos);
+        out.write(zeros, next - pos);
+    }
+    return (bool)out;
+}
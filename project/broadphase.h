@@ -0,0 +1,270 @@
+#pragma once
+// ---------------- Broad Phase ----------------
+// Which objects are close to which: a uniform spatial hash grid, rebuilt from
+// scratch every frame, and a contact list of overlapping AABB pairs.
+//   build()      puts each object in the cell holding its centre. Cells hash
+//                into a power-of-two table and the (bucket, object) pairs are
+//                radix sorted (radix_sort.h), so every bucket is a contiguous
+//                run; centres, radii and cells are gathered into that order.
+//                The hash steps by one along x, so a row of neighbouring cells
+//                is one contiguous run of slots too.
+//   findPairs()  has every object scan the 27 cells around its own, as 9 rows
+//                (cells are at least one contact distance wide, so nothing it
+//                can touch is further out), and report neighbours later in
+//                sorted order whose real cell matches (cells can share a
+//                bucket) and whose boxes, each grown by margin/2, overlap.
+//                Objects sharing a cell share the row lookups.
+// Objects much larger than the rest (the planet among satellites) stay out of
+// the grid, so they don't blow up the cell size; they query the cells their
+// box covers instead. The pair list comes out in the same order whatever the
+// thread count: grid pairs by the first object's sorted position, then the
+// oversized objects' pairs.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "radix_sort.h"
+#include "worker_pool.h"
+
+struct ContactPair { uint32_t a, b; };   // object indices, a < b
+
+struct BroadphaseStats {
+    double buildMs = 0.0, pairsMs = 0.0;
+    size_t objects = 0, oversize = 0, pairs = 0;
+    float cellSize = 0.0f;
+    uint32_t buckets = 0;
+};
+
+class SpatialHashGrid {
+public:
+    float margin = 0.0f;     // objects whose surfaces are closer than this are in contact
+    float cellSize = 0.0f;   // raised to twice the largest in-grid radius plus margin, the least that finds every pair
+
+    // Objects are spheres at (x, y, z)[i] with radius[i], or all of
+    // uniformRadius when `radius` is null. The arrays must stay valid until
+    // the next build(). With radii given, objects over twice the mean radius
+    // count as oversized.
+    void build(WorkerPool& pool, const float* x, const float* y, const float* z, const float* radius, float uniformRadius, size_t n) {
+        auto t0 = Clock::now();
+        stats_ = BroadphaseStats();
+        stats_.objects = n;
+        srcX_ = x; srcY_ = y; srcZ_ = z; srcR_ = radius;
+        oversize_.clear();
+
+        // One pass for the bounds, and for the mean and largest radius when they vary.
+        const unsigned chunks = pool.size();
+        const size_t per = (n + chunks - 1) / chunks;
+        chunkSums_.assign(chunks * 8, 0.0);
+        pool.parallelFor(chunks, 1, [&](size_t c0, size_t c1, unsigned) {
+            for (size_t c = c0; c < c1; ++c) {
+                double* out = &chunkSums_[c * 8];
+                double sum = 0.0, mx = 0.0;
+                float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+                for (size_t i = c * per; i < std::min(n, (c + 1) * per); ++i) {
+                    lo[0] = std::min(lo[0], x[i]); hi[0] = std::max(hi[0], x[i]);
+                    lo[1] = std::min(lo[1], y[i]); hi[1] = std::max(hi[1], y[i]);
+                    lo[2] = std::min(lo[2], z[i]); hi[2] = std::max(hi[2], z[i]);
+                    if (radius) { sum += radius[i]; mx = std::max(mx, (double)radius[i]); }
+                }
+                out[0] = sum; out[1] = mx;
+                for (int a = 0; a < 3; ++a) { out[2 + a] = lo[a]; out[5 + a] = hi[a]; }
+            }
+        });
+        double sum = 0.0, mx = 0.0, lo[3] = { 1e30, 1e30, 1e30 }, hi[3] = { -1e30, -1e30, -1e30 };
+        for (unsigned c = 0; c < chunks; ++c) {
+            const double* in = &chunkSums_[c * 8];
+            sum += in[0]; mx = std::max(mx, in[1]);
+            for (int a = 0; a < 3; ++a) { lo[a] = std::min(lo[a], in[2 + a]); hi[a] = std::max(hi[a], in[5 + a]); }
+        }
+        float gridMaxR = uniformRadius;
+        if (radius && n) {
+            const float limit = 2.0f * (float)(sum / n);
+            gridMaxR = (float)mx;
+            if (mx > limit) {
+                gridMaxR = 0.0f;
+                for (size_t i = 0; i < n; ++i) {
+                    if (radius[i] > limit) oversize_.push_back((uint32_t)i);
+                    else gridMaxR = std::max(gridMaxR, radius[i]);
+                }
+            }
+        }
+        gridMaxR_ = gridMaxR;
+        cell_ = std::max(cellSize, std::max(2.0f * gridMaxR + margin, 1e-6f));
+        invCell_ = 1.0f / cell_;
+        stats_.cellSize = cell_;
+        stats_.oversize = oversize_.size();
+
+        // Cells are numbered x first, then y, then z over the bounds (padded by
+        // one so neighbours of edge cells don't alias), modulo the table size.
+        // While the grid fits in the table no two cells share a bucket, and in
+        // any case neighbouring rows sit close together in slot order.
+        for (int a = 0; a < 3; ++a) origin_[a] = n ? (float)lo[a] : 0.0f;
+        const uint32_t dimX = (uint32_t)cellOf(n ? (float)hi[0] : 0.0f, 0) + 1;
+        const uint32_t dimY = (uint32_t)cellOf(n ? (float)hi[1] : 0.0f, 1) + 1;
+        const uint32_t dimZ = (uint32_t)cellOf(n ? (float)hi[2] : 0.0f, 2) + 1;
+        strideY_ = dimX + 2;
+        strideZ_ = strideY_ * (dimY + 2);
+        const size_t gridCount = n - oversize_.size();
+        const double cells = (double)strideZ_ * (dimZ + 2);
+        tableBits_ = 10;
+        while (tableBits_ < 26 && (double)((size_t)1 << tableBits_) < std::min(cells, 4.0 * gridCount)) ++tableBits_;
+        const uint32_t mask = (1u << tableBits_) - 1, sentinel = 1u << tableBits_;
+        stats_.buckets = mask + 1;
+
+        keys_.resize(n); order_.resize(n);
+        const bool anyOversize = !oversize_.empty();
+        const float limit = gridMaxR;
+        pool.parallelFor(n, 16384, [&](size_t b, size_t e, unsigned) {
+            for (size_t i = b; i < e; ++i) {
+                order_[i] = (uint32_t)i;
+                if (anyOversize && radius[i] > limit) { keys_[i] = sentinel; continue; }   // sorts after every bucket
+                keys_[i] = hashCell(cellOf(x[i], 0), cellOf(y[i], 1), cellOf(z[i], 2)) & mask;
+            }
+        });
+        sorter_.sort(pool, keys_, order_, anyOversize ? tableBits_ + 1 : tableBits_);
+
+        // bucketStart_[h]: first slot of bucket h or later, so bucket h is [start[h], start[h + 1]).
+        bucketStart_.resize((size_t)mask + 2);
+        sx_.resize(gridCount); sy_.resize(gridCount); sz_.resize(gridCount); sr_.resize(gridCount);
+        cx_.resize(gridCount); cy_.resize(gridCount); cz_.resize(gridCount);
+        pool.parallelFor(gridCount, 16384, [&](size_t b, size_t e, unsigned) {
+            for (size_t s = b; s < e; ++s) {
+                const uint32_t key = keys_[s], prev = s ? keys_[s - 1] + 1 : 0;
+                for (uint32_t h = prev; h <= key; ++h) bucketStart_[h] = (uint32_t)s;
+                uint32_t i = order_[s];
+                sx_[s] = x[i]; sy_[s] = y[i]; sz_[s] = z[i]; sr_[s] = radius ? radius[i] : uniformRadius;
+                cx_[s] = cellOf(x[i], 0); cy_[s] = cellOf(y[i], 1); cz_[s] = cellOf(z[i], 2);
+            }
+        });
+        for (uint32_t h = gridCount ? keys_[gridCount - 1] + 1 : 0; h <= mask + 1; ++h) bucketStart_[h] = (uint32_t)gridCount;
+        stats_.buildMs = ms(t0, Clock::now());
+    }
+
+    // Every pair of objects in contact, replacing `out`.
+    void findPairs(WorkerPool& pool, std::vector<ContactPair>& out) {
+        auto t0 = Clock::now();
+        const size_t gridCount = sx_.size();
+        const size_t grain = 4096, chunks = (gridCount + grain - 1) / grain;
+        if (chunkPairs_.size() < chunks) chunkPairs_.resize(chunks);
+        pool.parallelFor(gridCount, grain, [&](size_t b, size_t e, unsigned) {
+            std::vector<ContactPair>& pairs = chunkPairs_[b / grain];
+            pairs.clear();
+            uint32_t rows[9][4];   // per row: up to two slot ranges (the row can wrap around the table)
+            for (size_t s = b; s < e; ++s) {
+                const int32_t ox = cx_[s], oy = cy_[s], oz = cz_[s];
+                if (s == b || ox != cx_[s - 1] || oy != cy_[s - 1] || oz != cz_[s - 1])
+                    for (int r = 0; r < 9; ++r) rowRanges(ox - 1, ox + 1, oy + r % 3 - 1, oz + r / 3 - 1, rows[r]);
+                for (int r = 0; r < 9; ++r) {
+                    const int32_t ny = oy + r % 3 - 1, nz = oz + r / 3 - 1;
+                    for (int k = 0; k < 4; k += 2)
+                        for (uint32_t t = std::max(rows[r][k], (uint32_t)s + 1); t < rows[r][k + 1]; ++t) {
+                            if (cy_[t] != ny || cz_[t] != nz || (uint32_t)(cx_[t] - ox + 1) > 2u) continue;
+                            if (!boxesTouch(sx_[s], sy_[s], sz_[s], sr_[s], sx_[t], sy_[t], sz_[t], sr_[t])) continue;
+                            pairs.push_back(orderedPair(order_[s], order_[t]));
+                        }
+                }
+            }
+        });
+        size_t total = 0;
+        for (size_t c = 0; c < chunks; ++c) total += chunkPairs_[c].size();
+        out.resize(total);
+        size_t at = 0;
+        for (size_t c = 0; c < chunks; ++c) {
+            std::copy(chunkPairs_[c].begin(), chunkPairs_[c].end(), out.begin() + at);
+            at += chunkPairs_[c].size();
+        }
+
+        for (size_t k = 0; k < oversize_.size(); ++k) {
+            const uint32_t o = oversize_[k];
+            const float ox = srcX_[o], oy = srcY_[o], oz = srcZ_[o], orad = srcR_[o];
+            forGridObjectsNear(ox, oy, oz, orad, [&](uint32_t s) {
+                if (boxesTouch(ox, oy, oz, orad, sx_[s], sy_[s], sz_[s], sr_[s])) out.push_back(orderedPair(o, order_[s]));
+            });
+            for (size_t k2 = k + 1; k2 < oversize_.size(); ++k2) {
+                const uint32_t p = oversize_[k2];
+                if (boxesTouch(ox, oy, oz, orad, srcX_[p], srcY_[p], srcZ_[p], srcR_[p])) out.push_back(orderedPair(o, p));
+            }
+        }
+        stats_.pairs = out.size();
+        stats_.pairsMs = ms(t0, Clock::now());
+    }
+
+    // Objects in contact with the sphere (cx, cy, cz, r), appended to `out`.
+    void querySphere(float cx, float cy, float cz, float r, std::vector<uint32_t>& out) const {
+        forGridObjectsNear(cx, cy, cz, r, [&](uint32_t s) {
+            if (boxesTouch(cx, cy, cz, r, sx_[s], sy_[s], sz_[s], sr_[s])) out.push_back(order_[s]);
+        });
+        for (uint32_t o : oversize_)
+            if (boxesTouch(cx, cy, cz, r, srcX_[o], srcY_[o], srcZ_[o], srcR_[o])) out.push_back(o);
+    }
+
+    const BroadphaseStats& stats() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static double ms(Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); }
+
+    int32_t cellOf(float v, int axis) const {
+        float c = std::floor((v - origin_[axis]) * invCell_);
+        return (int32_t)std::max(-1073741824.0f, std::min(1073741824.0f, c));
+    }
+
+    // Linear in x, so cells x, x + 1, ... land in consecutive buckets.
+    uint32_t hashCell(int32_t x, int32_t y, int32_t z) const {
+        return (uint32_t)x + (uint32_t)y * strideY_ + (uint32_t)z * strideZ_;
+    }
+
+    // Slots of the buckets holding cells x0..x1 of row (y, z), as [r[0], r[1]) and [r[2], r[3]).
+    void rowRanges(int32_t x0, int32_t x1, int32_t y, int32_t z, uint32_t r[4]) const {
+        const uint32_t mask = (1u << tableBits_) - 1;
+        const uint32_t first = hashCell(x0, y, z) & mask, count = std::min((uint32_t)(x1 - x0) + 1, mask + 1);
+        const uint32_t last = first + count;   // one past, may run off the end of the table
+        r[0] = bucketStart_[first]; r[1] = bucketStart_[std::min(last, mask + 1)];
+        r[2] = 0; r[3] = last > mask + 1 ? bucketStart_[last - (mask + 1)] : 0;
+    }
+
+    bool boxesTouch(float ax, float ay, float az, float ar, float bx, float by, float bz, float br) const {
+        const float reach = ar + br + margin;
+        return std::fabs(ax - bx) <= reach && std::fabs(ay - by) <= reach && std::fabs(az - bz) <= reach;
+    }
+
+    static ContactPair orderedPair(uint32_t a, uint32_t b) { return a < b ? ContactPair{ a, b } : ContactPair{ b, a }; }
+
+    // fn(slot) for every grid object whose cell lies within reach of a sphere
+    // of radius r at (x, y, z). Walks the covered cells, or every object when
+    // that would be fewer.
+    template <typename Fn>
+    void forGridObjectsNear(float x, float y, float z, float r, Fn&& fn) const {
+        const size_t gridCount = sx_.size();
+        const float reach = r + gridMaxR_ + margin;
+        const int32_t x0 = cellOf(x - reach, 0), x1 = cellOf(x + reach, 0);
+        const int32_t y0 = cellOf(y - reach, 1), y1 = cellOf(y + reach, 1);
+        const int32_t z0 = cellOf(z - reach, 2), z1 = cellOf(z + reach, 2);
+        const double cells = (double)(x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1);
+        if (cells > (double)gridCount) {
+            for (uint32_t s = 0; s < gridCount; ++s) fn(s);
+            return;
+        }
+        uint32_t row[4];
+        for (int32_t cz = z0; cz <= z1; ++cz)
+            for (int32_t cy = y0; cy <= y1; ++cy) {
+                rowRanges(x0, x1, cy, cz, row);
+                for (int k = 0; k < 4; k += 2)
+                    for (uint32_t s = row[k]; s < row[k + 1]; ++s)
+                        if (cy_[s] == cy && cz_[s] == cz && cx_[s] >= x0 && cx_[s] <= x1) fn(s);
+            }
+    }
+
+    const float *srcX_ = nullptr, *srcY_ = nullptr, *srcZ_ = nullptr, *srcR_ = nullptr;
+    float gridMaxR_ = 0.0f, cell_ = 1.0f, invCell_ = 1.0f, origin_[3] = {};
+    uint32_t strideY_ = 1, strideZ_ = 1;
+    int tableBits_ = 10;
+    std::vector<uint32_t> keys_, order_, bucketStart_, oversize_;
+    std::vector<float> sx_, sy_, sz_, sr_;          // in sorted (bucket) order
+    std::vector<int32_t> cx_, cy_, cz_;
+    std::vector<double> chunkSums_;
+    std::vector<std::vector<ContactPair>> chunkPairs_;
+    RadixSorter sorter_;
+    BroadphaseStats stats_;
+};
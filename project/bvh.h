@@ -0,0 +1,429 @@
+#pragma once
+// ---------------- Instance BVH ----------------
+// Bounding volume hierarchy over instance bounding spheres, for ray casts
+// (mouse picking), line-of-sight checks and nearest-object queries.
+//   build()  binned SAH, top down: at each node the primitives' centroids are
+//            binned along every axis (kBins bins) and the cheapest split by
+//            surface area heuristic is taken, or a leaf when splitting costs
+//            more than testing everything. The top of the tree is built
+//            serially until subtrees are small enough to hand out, then the
+//            subtrees are built on the pool and spliced in, links rebased.
+//   refit()  keeps the topology and recomputes every box bottom up from the
+//            objects' new positions, a fraction of a build. Objects drifting
+//            apart make the boxes overlap more; needsRebuild() says when the
+//            tree's SAH cost has grown enough that a fresh build pays.
+// Nodes are 32 bytes, children side by side, and the primitives are stored in
+// leaf order, so a query walks mostly contiguous memory. Queries don't
+// allocate and may run from any number of threads at once.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "worker_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BVH_SSE 1
+#else
+#define BVH_SSE 0
+#endif
+
+static const uint32_t kBvhNone = 0xffffffffu;
+
+struct BvhHit {
+    uint32_t object = kBvhNone;   // kBvhNone: nothing hit / in range
+    float t = 0.0f;               // ray casts: distance along the ray in units of dir; nearest(): distance to the surface, 0 inside
+};
+
+struct BvhStats {
+    double buildMs = 0.0, refitMs = 0.0;
+    size_t nodes = 0, leaves = 0;
+    int depth = 0;
+    float sahCost = 0.0f, builtSahCost = 0.0f;   // now, and right after the last build
+};
+
+class InstanceBVH {
+public:
+    // Objects are spheres at (x, y, z)[i] with radius[i], or all of
+    // uniformRadius when `radius` is null.
+    void build(WorkerPool& pool, const float* x, const float* y, const float* z, const float* radius, float uniformRadius, size_t n) {
+        auto t0 = Clock::now();
+        prims_.resize(n);
+        pool.parallelFor(n, 16384, [&](size_t b, size_t e, unsigned) {
+            for (size_t i = b; i < e; ++i) prims_[i] = { { x[i], y[i], z[i] }, radius ? radius[i] : uniformRadius, (uint32_t)i };
+        });
+        nodes_.clear();
+        tasks_.clear();
+        nodes_.push_back(BvhNode());
+        if (n) {
+            // Subtrees below this size go to the pool; a few per thread so uneven ones even out.
+            const size_t taskSize = pool.size() > 1 ? std::max<size_t>(1024, n / (pool.size() * 8)) : n + 1;
+            int depth = 0;
+            buildNode(nodes_, 0, 0, (uint32_t)n, 0, taskSize, depth);
+            if (taskNodes_.size() < tasks_.size()) taskNodes_.resize(tasks_.size());
+            std::vector<int> taskDepth(tasks_.size(), 0);
+            pool.parallelFor(tasks_.size(), 1, [&](size_t b, size_t e, unsigned) {
+                for (size_t t = b; t < e; ++t) {
+                    std::vector<BvhNode>& sub = taskNodes_[t];
+                    sub.assign(1, BvhNode());
+                    buildNode(sub, 0, tasks_[t].begin, tasks_[t].end, tasks_[t].depth, 0, taskDepth[t]);
+                }
+            });
+            // Splice: a task's root replaces its placeholder, the rest goes on the end.
+            topCount_ = (uint32_t)nodes_.size();
+            for (size_t t = 0; t < tasks_.size(); ++t) {
+                const std::vector<BvhNode>& sub = taskNodes_[t];
+                const uint32_t base = (uint32_t)nodes_.size() - 1;   // local index k >= 1 lands at base + k
+                for (size_t k = 0; k < sub.size(); ++k) {
+                    BvhNode nd = sub[k];
+                    if (!nd.count) nd.first += base;
+                    if (k == 0) nodes_[tasks_[t].node] = nd;
+                    else nodes_.push_back(nd);
+                }
+                tasks_[t].nodeBegin = base + 1;
+                tasks_[t].nodeEnd = (uint32_t)nodes_.size();
+                depth = std::max(depth, taskDepth[t]);
+            }
+            stats_.depth = depth;
+        } else {
+            topCount_ = 1;
+            stats_.depth = 0;
+        }
+        stats_.nodes = nodes_.size();
+        stats_.leaves = 0;
+        for (const BvhNode& nd : nodes_) stats_.leaves += nd.count ? 1 : 0;
+        stats_.sahCost = stats_.builtSahCost = sahCost(0, (uint32_t)nodes_.size());
+        stats_.buildMs = ms(t0, Clock::now());
+    }
+
+    // Same objects (same n), new positions and radii; keeps the topology.
+    void refit(WorkerPool& pool, const float* x, const float* y, const float* z, const float* radius, float uniformRadius) {
+        auto t0 = Clock::now();
+        const size_t n = prims_.size();
+        pool.parallelFor(n, 16384, [&](size_t b, size_t e, unsigned) {
+            for (size_t s = b; s < e; ++s) {
+                Prim& p = prims_[s];
+                p.c[0] = x[p.id]; p.c[1] = y[p.id]; p.c[2] = z[p.id];
+                p.r = radius ? radius[p.id] : uniformRadius;
+            }
+        });
+        // Children always sit after their parent, so walking back refits bottom up:
+        // each task's nodes on the pool, then the serial top.
+        taskCost_.assign(tasks_.size(), 0.0f);
+        pool.parallelFor(tasks_.size(), 1, [&](size_t b, size_t e, unsigned) {
+            for (size_t t = b; t < e; ++t) {
+                for (uint32_t i = tasks_[t].nodeEnd; i-- > tasks_[t].nodeBegin;) refitNode(i);
+                taskCost_[t] = sahCost(tasks_[t].nodeBegin, tasks_[t].nodeEnd);
+            }
+        });
+        for (uint32_t i = topCount_; i-- > 0;) refitNode(i);
+        float cost = sahCost(0, topCount_);
+        for (float c : taskCost_) cost += c;
+        stats_.sahCost = cost;
+        stats_.refitMs = ms(t0, Clock::now());
+    }
+
+    // True once refits have made the tree noticeably worse than a fresh build.
+    bool needsRebuild(float ratio = 1.5f) const { return stats_.sahCost > ratio * stats_.builtSahCost; }
+
+    size_t size() const { return prims_.size(); }
+
+    // Closest sphere hit by the ray origin + t * dir, 0 <= t <= tMax, skipping `ignore`.
+    BvhHit raycast(float ox, float oy, float oz, float dx, float dy, float dz, float tMax = 1e30f, uint32_t ignore = kBvhNone) const {
+        return traverseRay(ox, oy, oz, dx, dy, dz, tMax, ignore, kBvhNone, false);
+    }
+
+    // Whether anything but `ignoreA` / `ignoreB` blocks the segment a..b (line of sight).
+    bool occluded(float ax, float ay, float az, float bx, float by, float bz, uint32_t ignoreA = kBvhNone, uint32_t ignoreB = kBvhNone) const {
+        return traverseRay(ax, ay, az, bx - ax, by - ay, bz - az, 1.0f, ignoreA, ignoreB, true).object != kBvhNone;
+    }
+
+    // Object whose surface is closest to (px, py, pz) and within maxDist, skipping `ignore`.
+    BvhHit nearest(float px, float py, float pz, float maxDist = 1e30f, uint32_t ignore = kBvhNone) const {
+        BvhHit best;
+        best.t = maxDist;
+        if (prims_.empty()) return best;
+        uint32_t stack[kStackSize];
+        int sp = 0;
+        stack[sp++] = 0;
+        while (sp) {
+            const BvhNode& nd = nodes_[stack[--sp]];
+            if (boxDistance(nd, px, py, pz) > best.t) continue;
+            if (nd.count) {
+                for (uint32_t s = nd.first; s < nd.first + nd.count; ++s) {
+                    const Prim& p = prims_[s];
+                    if (p.id == ignore) continue;
+                    float ddx = px - p.c[0], ddy = py - p.c[1], ddz = pz - p.c[2];
+                    float d = std::max(0.0f, std::sqrt(ddx * ddx + ddy * ddy + ddz * ddz) - p.r);
+                    if (d < best.t) { best.t = d; best.object = p.id; }
+                }
+                continue;
+            }
+            // Nearer child last, so it is popped first.
+            const BvhNode& a = nodes_[nd.first];
+            const BvhNode& b = nodes_[nd.first + 1];
+            bool aFirst = boxDistance(a, px, py, pz) <= boxDistance(b, px, py, pz);
+            stack[sp++] = aFirst ? nd.first + 1 : nd.first;
+            stack[sp++] = aFirst ? nd.first : nd.first + 1;
+        }
+        return best;
+    }
+
+    const BvhStats& stats() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static double ms(Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); }
+
+    struct BvhNode {
+        float lo[3]; uint32_t first;   // leaf: first primitive slot; inner: left child, right child at first + 1
+        float hi[3]; uint32_t count;   // primitives in a leaf, 0 for an inner node
+    };
+    struct Prim { float c[3]; float r; uint32_t id; };
+    struct Task { uint32_t node, begin, end; int depth; uint32_t nodeBegin, nodeEnd; };   // prims [begin, end), spliced nodes [nodeBegin, nodeEnd)
+
+    static const int kBins = 12, kMaxLeaf = 8;
+    static const int kMaxDepth = 60, kStackSize = kMaxDepth + 2;   // a depth-first walk holds at most one node per level, plus one
+    static constexpr float kTraversalCost = 1.0f;   // relative to one sphere test
+
+    static float area(const float lo[3], const float hi[3]) {
+        float dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+        return dx < 0.0f ? 0.0f : 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+
+    struct alignas(16) Bin { float lo[4], hi[4]; uint32_t count; };
+
+    // Box around the spheres of [begin, end); with clo/chi also the box around their centres.
+    void primBounds(uint32_t begin, uint32_t end, float lo[3], float hi[3], float* clo = nullptr, float* chi = nullptr) const {
+#if BVH_SSE
+        __m128 vlo = _mm_set1_ps(1e30f), vhi = _mm_set1_ps(-1e30f), vclo = vlo, vchi = vhi;
+        for (uint32_t s = begin; s < end; ++s) {
+            const __m128 c = _mm_loadu_ps(prims_[s].c);   // x, y, z, r
+            const __m128 r = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3));
+            vlo = _mm_min_ps(vlo, _mm_sub_ps(c, r)); vhi = _mm_max_ps(vhi, _mm_add_ps(c, r));
+            vclo = _mm_min_ps(vclo, c); vchi = _mm_max_ps(vchi, c);
+        }
+        alignas(16) float out[4][4];
+        _mm_store_ps(out[0], vlo); _mm_store_ps(out[1], vhi); _mm_store_ps(out[2], vclo); _mm_store_ps(out[3], vchi);
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = out[0][a]; hi[a] = out[1][a];
+            if (clo) { clo[a] = out[2][a]; chi[a] = out[3][a]; }
+        }
+#else
+        for (int a = 0; a < 3; ++a) { lo[a] = 1e30f; hi[a] = -1e30f; }
+        if (clo) for (int a = 0; a < 3; ++a) { clo[a] = 1e30f; chi[a] = -1e30f; }
+        for (uint32_t s = begin; s < end; ++s) {
+            const Prim& p = prims_[s];
+            for (int a = 0; a < 3; ++a) { lo[a] = std::min(lo[a], p.c[a] - p.r); hi[a] = std::max(hi[a], p.c[a] + p.r); }
+            if (clo) for (int a = 0; a < 3; ++a) { clo[a] = std::min(clo[a], p.c[a]); chi[a] = std::max(chi[a], p.c[a]); }
+        }
+#endif
+    }
+
+    // Counts and sphere boxes of [begin, end) binned by centre along all three axes in one pass.
+    void binPrims(uint32_t begin, uint32_t end, const float clo[3], const float scale[3], Bin bins[3][kBins]) const {
+        for (int a = 0; a < 3; ++a)
+            for (int b = 0; b < kBins; ++b) {
+                Bin& bin = bins[a][b];
+                for (int k = 0; k < 4; ++k) { bin.lo[k] = 1e30f; bin.hi[k] = -1e30f; }
+                bin.count = 0;
+            }
+        for (uint32_t s = begin; s < end; ++s) {
+            const Prim& p = prims_[s];
+            int idx[3];
+            for (int a = 0; a < 3; ++a) idx[a] = std::min(kBins - 1, (int)((p.c[a] - clo[a]) * scale[a]));   // as the partition computes it
+#if BVH_SSE
+            const __m128 c = _mm_loadu_ps(p.c);
+            const __m128 r = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3));
+            const __m128 plo = _mm_sub_ps(c, r), phi = _mm_add_ps(c, r);
+            for (int a = 0; a < 3; ++a) {
+                Bin& bin = bins[a][idx[a]];
+                _mm_store_ps(bin.lo, _mm_min_ps(_mm_load_ps(bin.lo), plo));
+                _mm_store_ps(bin.hi, _mm_max_ps(_mm_load_ps(bin.hi), phi));
+                bin.count++;
+            }
+#else
+            for (int a = 0; a < 3; ++a) {
+                Bin& bin = bins[a][idx[a]];
+                for (int k = 0; k < 3; ++k) { bin.lo[k] = std::min(bin.lo[k], p.c[k] - p.r); bin.hi[k] = std::max(bin.hi[k], p.c[k] + p.r); }
+                bin.count++;
+            }
+#endif
+        }
+    }
+
+    // Fills nodes[self] for primitives [begin, end) and recurses. With taskSize > 0
+    // (the serial top), ranges no bigger than that become tasks instead.
+    void buildNode(std::vector<BvhNode>& nodes, uint32_t self, uint32_t begin, uint32_t end, int depth, size_t taskSize, int& maxDepth) {
+        maxDepth = std::max(maxDepth, depth);
+        const uint32_t count = end - begin;
+        if (taskSize && count <= taskSize) { tasks_.push_back({ self, begin, end, depth, 0, 0 }); return; }
+        float lo[3], hi[3], clo[3], chi[3];
+        primBounds(begin, end, lo, hi, clo, chi);
+        BvhNode& nd = nodes[self];
+        for (int a = 0; a < 3; ++a) { nd.lo[a] = lo[a]; nd.hi[a] = hi[a]; }
+        nd.first = begin; nd.count = count;
+        if (count <= 2 || depth >= kMaxDepth) return;
+
+        // Cheapest bin boundary over all three axes.
+        float scale[3];
+        for (int a = 0; a < 3; ++a) scale[a] = chi[a] > clo[a] ? kBins / (chi[a] - clo[a]) : 0.0f;
+        Bin bins[3][kBins];
+        binPrims(begin, end, clo, scale, bins);
+        float bestCost = 1e30f;
+        int bestAxis = -1, bestSplit = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (scale[axis] == 0.0f) continue;
+            const Bin* bin = bins[axis];
+            // Sweep from the right for the right-hand areas, then from the left.
+            float rightArea[kBins];
+            uint32_t rightCount[kBins];
+            float rlo[3] = { 1e30f, 1e30f, 1e30f }, rhi[3] = { -1e30f, -1e30f, -1e30f };
+            uint32_t rc = 0;
+            for (int b = kBins - 1; b > 0; --b) {
+                rc += bin[b].count;
+                for (int a = 0; a < 3; ++a) { rlo[a] = std::min(rlo[a], bin[b].lo[a]); rhi[a] = std::max(rhi[a], bin[b].hi[a]); }
+                rightArea[b] = area(rlo, rhi); rightCount[b] = rc;
+            }
+            float llo[3] = { 1e30f, 1e30f, 1e30f }, lhi[3] = { -1e30f, -1e30f, -1e30f };
+            uint32_t lc = 0;
+            for (int b = 0; b < kBins - 1; ++b) {
+                lc += bin[b].count;
+                for (int a = 0; a < 3; ++a) { llo[a] = std::min(llo[a], bin[b].lo[a]); lhi[a] = std::max(lhi[a], bin[b].hi[a]); }
+                if (!lc || !rightCount[b + 1]) continue;
+                float cost = area(llo, lhi) * lc + rightArea[b + 1] * rightCount[b + 1];
+                if (cost < bestCost) { bestCost = cost; bestAxis = axis; bestSplit = b + 1; }
+            }
+        }
+
+        uint32_t mid;
+        const float parentArea = area(lo, hi);
+        if (bestAxis < 0) {
+            // Every centroid in one spot: only worth splitting to bound leaf size.
+            if (count <= (uint32_t)kMaxLeaf) return;
+            mid = begin + count / 2;
+        } else {
+            const float splitCost = kTraversalCost + (parentArea > 0.0f ? bestCost / parentArea : 0.0f);
+            if (count <= (uint32_t)kMaxLeaf && splitCost >= (float)count) return;
+            const float axisScale = scale[bestAxis], base = clo[bestAxis];
+            const int axis = bestAxis, split = bestSplit;
+            mid = (uint32_t)(std::partition(prims_.begin() + begin, prims_.begin() + end, [&](const Prim& p) {
+                return std::min(kBins - 1, (int)((p.c[axis] - base) * axisScale)) < split;
+            }) - prims_.begin());
+        }
+        const uint32_t left = (uint32_t)nodes.size();
+        nodes.resize(nodes.size() + 2);   // may move `nd`
+        nodes[self].first = left;
+        nodes[self].count = 0;
+        buildNode(nodes, left, begin, mid, depth + 1, taskSize, maxDepth);
+        buildNode(nodes, left + 1, mid, end, depth + 1, taskSize, maxDepth);
+    }
+
+    void refitNode(uint32_t i) {
+        BvhNode& nd = nodes_[i];
+        if (nd.count) { primBounds(nd.first, nd.first + nd.count, nd.lo, nd.hi); return; }
+        const BvhNode& a = nodes_[nd.first];
+        const BvhNode& b = nodes_[nd.first + 1];
+        for (int k = 0; k < 3; ++k) { nd.lo[k] = std::min(a.lo[k], b.lo[k]); nd.hi[k] = std::max(a.hi[k], b.hi[k]); }
+    }
+
+    // SAH cost of nodes [begin, end) relative to the root's area.
+    float sahCost(uint32_t begin, uint32_t end) const {
+        const float rootArea = area(nodes_[0].lo, nodes_[0].hi);
+        if (rootArea <= 0.0f) return 0.0f;
+        double cost = 0.0;
+        for (uint32_t i = begin; i < end; ++i) {
+            const BvhNode& nd = nodes_[i];
+            cost += area(nd.lo, nd.hi) * (nd.count ? (float)nd.count : kTraversalCost);
+        }
+        return (float)(cost / rootArea);
+    }
+
+    static float boxDistance(const BvhNode& nd, float px, float py, float pz) {
+        float dx = std::max(0.0f, std::max(nd.lo[0] - px, px - nd.hi[0]));
+        float dy = std::max(0.0f, std::max(nd.lo[1] - py, py - nd.hi[1]));
+        float dz = std::max(0.0f, std::max(nd.lo[2] - pz, pz - nd.hi[2]));
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    // Where a ray with d = (dx, dy, dz), dd = |d|^2, starting at `oc` from a
+    // sphere's centre, first touches it (0 if it starts inside). The
+    // discriminant comes from the ray's closest approach rather than
+    // b^2 - dd * c, which cancels to noise for small spheres far away.
+    static bool raySphere(float ocx, float ocy, float ocz, float dx, float dy, float dz, float dd, float r, float& t) {
+        const float b = ocx * dx + ocy * dy + ocz * dz;
+        const float k = b / dd;
+        const float fx = ocx - k * dx, fy = ocy - k * dy, fz = ocz - k * dz;
+        const float disc = r * r - (fx * fx + fy * fy + fz * fz);
+        if (disc < 0.0f) return false;
+        const float root = std::sqrt(dd * disc);
+        if (-b + root < 0.0f) return false;   // behind the origin
+        t = std::max(0.0f, (-b - root) / dd);
+        return true;
+    }
+
+    // Whether the ray enters the box within [0, tMax], and where.
+    static bool slab(const BvhNode& nd, const float o[3], const float inv[3], float tMax, float& tEntry) {
+        float t0 = 0.0f, t1 = tMax;
+        for (int a = 0; a < 3; ++a) {
+            float ta = (nd.lo[a] - o[a]) * inv[a], tb = (nd.hi[a] - o[a]) * inv[a];
+            if (ta > tb) std::swap(ta, tb);
+            t0 = ta > t0 ? ta : t0;   // written so a NaN (ray in the slab's plane) keeps the old bound
+            t1 = tb < t1 ? tb : t1;
+        }
+        tEntry = t0;
+        return t0 <= t1;
+    }
+
+    // Nearest sphere hit with t <= tMax, nearer boxes first; with anyHit the first one found.
+    BvhHit traverseRay(float ox, float oy, float oz, float dx, float dy, float dz, float tMax, uint32_t ignoreA, uint32_t ignoreB, bool anyHit) const {
+        BvhHit hit;
+        hit.t = tMax;
+        const float dd = dx * dx + dy * dy + dz * dz;
+        if (prims_.empty() || dd <= 0.0f) return hit;
+        const float o[3] = { ox, oy, oz };
+        const float inv[3] = { 1.0f / dx, 1.0f / dy, 1.0f / dz };
+        struct Entry { uint32_t node; float t; };   // t: where the ray enters the node
+        Entry stack[kStackSize];
+        int sp = 0;
+        float t0;
+        if (!slab(nodes_[0], o, inv, tMax, t0)) return hit;
+        stack[sp++] = { 0, t0 };
+        while (sp) {
+            const Entry top = stack[--sp];
+            if (top.t > tMax) continue;   // a hit since it was pushed is nearer
+            const BvhNode& nd = nodes_[top.node];
+            if (nd.count) {
+                for (uint32_t s = nd.first; s < nd.first + nd.count; ++s) {
+                    const Prim& p = prims_[s];
+                    if (p.id == ignoreA || p.id == ignoreB) continue;
+                    float t;
+                    if (!raySphere(ox - p.c[0], oy - p.c[1], oz - p.c[2], dx, dy, dz, dd, p.r, t)) continue;
+                    if (t > tMax) continue;
+                    hit.object = p.id; hit.t = tMax = t;
+                    if (anyHit) return hit;
+                }
+                continue;
+            }
+            // Nearer child last, so it is popped first.
+            const uint32_t l = nd.first, r = nd.first + 1;
+            float tl, tr;
+            const bool hitL = slab(nodes_[l], o, inv, tMax, tl), hitR = slab(nodes_[r], o, inv, tMax, tr);
+            if (hitL && hitR) {
+                stack[sp++] = tl <= tr ? Entry{ r, tr } : Entry{ l, tl };
+                stack[sp++] = tl <= tr ? Entry{ l, tl } : Entry{ r, tr };
+            } else if (hitL) stack[sp++] = { l, tl };
+            else if (hitR) stack[sp++] = { r, tr };
+        }
+        return hit;
+    }
+
+    std::vector<BvhNode> nodes_;
+    std::vector<Prim> prims_;                    // in leaf order
+    std::vector<Task> tasks_;
+    std::vector<std::vector<BvhNode>> taskNodes_;
+    std::vector<float> taskCost_;
+    uint32_t topCount_ = 1;                      // nodes_[0, topCount_) were built serially
+    BvhStats stats_;
+};
@@ -0,0 +1,41 @@
+#pragma once
+// ---------------- Frame Pacing ----------------
+// Holds the loop to a target frame rate without vsync. Sleeps until just short
+// of the deadline (OS sleeps overshoot by up to a scheduler tick), then yields
+// the last stretch so frames land within a few microseconds of the period.
+// Deadlines advance by exactly one period, so the average rate stays on target;
+// after a long stall the schedule restarts from "now" instead of bursting.
+#include <chrono>
+#include <thread>
+
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FramePacer(double targetFps = 0.0) { setTarget(targetFps); }
+
+    void setTarget(double fps) {
+        period_ = fps > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps))
+                            : Clock::duration::zero();
+        reset();
+    }
+    bool active() const { return period_ > Clock::duration::zero(); }
+
+    // Restart the schedule, e.g. after the loop idled waiting for events.
+    void reset() { next_ = Clock::now() + period_; }
+
+    // Call once per frame after SwapBuffers.
+    void wait() {
+        if (!active()) return;
+        Clock::time_point now = Clock::now();
+        if (now > next_ + period_) { next_ = now + period_; return; }   // far behind: don't try to catch up
+        if (next_ - now > kSpinWindow) std::this_thread::sleep_until(next_ - kSpinWindow);
+        while (Clock::now() < next_) std::this_thread::yield();
+        next_ += period_;
+    }
+
+private:
+    static constexpr std::chrono::microseconds kSpinWindow{ 500 };
+    Clock::duration period_{};
+    Clock::time_point next_;
+};
@@ -0,0 +1,212 @@
+#pragma once
+// ---------------- Frame Readback ----------------
+// Offscreen rendering to files without stalling the GPU:
+//   OffscreenTarget - FBO with RGBA8 colour + depth textures, resized on demand.
+//   PixelReadback   - two pixel-pack buffers used in turn. read() queues
+//                     glReadPixels into one PBO and maps the other, whose
+//                     transfer was queued a frame earlier and has had a whole
+//                     frame of GPU time to land, so the map rarely waits.
+//   ImageWriter     - a thread that encodes and writes the images (binary PPM),
+//                     so disk I/O overlaps the next renders. Pixel buffers are
+//                     recycled, and the queue is bounded so a slow disk pushes
+//                     back on the renderer instead of growing memory.
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gl_memory.h"
+
+class OffscreenTarget {
+public:
+    // GL_SRGB8_ALPHA8 when rendering with GL_FRAMEBUFFER_SRGB, so the files match the window.
+    explicit OffscreenTarget(GLenum colorFormat = GL_RGBA8) : colorFormat_(colorFormat) {}
+    ~OffscreenTarget() { release(); }
+
+    // Binds the FBO as the draw and read target, (re)allocating it for w x h.
+    bool bind(int w, int h) {
+        if (!fbo_ || w != w_ || h != h_) {
+            release();
+            w_ = w; h_ = h;
+            glGenTextures(1, &color_);
+            glBindTexture(GL_TEXTURE_2D, color_);
+            trackedTexImage2D(GL_TEXTURE_2D, color_, 0, (GLint)colorFormat_, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glGenTextures(1, &depth_);
+            glBindTexture(GL_TEXTURE_2D, depth_);
+            trackedTexImage2D(GL_TEXTURE_2D, depth_, 0, GL_DEPTH_COMPONENT24, w, h, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glGenFramebuffers(1, &fbo_);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_, 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) { release(); return false; }
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+        glViewport(0, 0, w_, h_);
+        return true;
+    }
+
+    void release() {
+        if (fbo_) glDeleteFramebuffers(1, &fbo_);
+        if (color_) trackedDeleteTextures(1, &color_);
+        if (depth_) trackedDeleteTextures(1, &depth_);
+        fbo_ = color_ = depth_ = 0;
+    }
+
+private:
+    GLenum colorFormat_;
+    GLuint fbo_ = 0, color_ = 0, depth_ = 0;
+    int w_ = 0, h_ = 0;
+};
+
+struct ReadbackImage {
+    std::string path;
+    int w = 0, h = 0;
+    std::vector<unsigned char> rgba;   // bottom row first, as GL returns it
+};
+
+class PixelReadback {
+public:
+    using Sink = std::function<void(ReadbackImage&&)>;
+
+    ~PixelReadback() {
+        for (Slot& s : slots_) if (s.pbo) trackedDeleteBuffers(1, &s.pbo);
+    }
+
+    // Queues a read of the bound read framebuffer and hands the previous read
+    // (if any) to `sink`. `img` carries the path and a buffer to fill.
+    void read(ReadbackImage img, const Sink& sink) {
+        Slot& s = slots_[next_];
+        next_ ^= 1;
+        size_t bytes = (size_t)img.w * img.h * 4;
+        if (!s.pbo) glGenBuffers(1, &s.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        if (bytes > s.capacity) {
+            trackedBufferData(GL_PIXEL_PACK_BUFFER, s.pbo, (GLsizeiptr)bytes, nullptr, GL_STREAM_READ);
+            s.capacity = bytes;
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, img.w, img.h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        s.img = std::move(img);
+        s.pending = true;
+        collect(slots_[next_], sink);   // the other slot: queued one read() ago
+    }
+
+    // Hands every outstanding read to `sink`, oldest first.
+    void flush(const Sink& sink) {
+        collect(slots_[next_], sink);
+        collect(slots_[next_ ^ 1], sink);
+    }
+
+private:
+    struct Slot { GLuint pbo = 0; size_t capacity = 0; bool pending = false; ReadbackImage img; };
+
+    static void collect(Slot& s, const Sink& sink) {
+        if (!s.pending) return;
+        s.pending = false;
+        size_t bytes = (size_t)s.img.w * s.img.h * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        const void* p = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+        s.img.rgba.resize(bytes);
+        if (p) {
+            memcpy(s.img.rgba.data(), p, bytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (p) sink(std::move(s.img));
+        else fprintf(stderr, "Cannot map the readback of %s\n", s.img.path.c_str());
+        s.img = ReadbackImage();
+    }
+
+    Slot slots_[2];
+    int next_ = 0;
+};
+
+// Binary PPM (P6), flipped to top row first; alpha is dropped.
+inline bool writePPM(const std::string& path, int w, int h, const unsigned char* rgbaBottomUp, std::vector<unsigned char>& rowScratch) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    fprintf(f, "P6\n%d %d\n255\n", w, h);
+    rowScratch.resize((size_t)w * 3);
+    bool ok = true;
+    for (int y = h - 1; y >= 0 && ok; --y) {
+        const unsigned char* src = rgbaBottomUp + (size_t)y * w * 4;
+        for (int x = 0; x < w; ++x) {
+            rowScratch[x * 3 + 0] = src[x * 4 + 0];
+            rowScratch[x * 3 + 1] = src[x * 4 + 1];
+            rowScratch[x * 3 + 2] = src[x * 4 + 2];
+        }
+        ok = fwrite(rowScratch.data(), 1, rowScratch.size(), f) == rowScratch.size();
+    }
+    return fclose(f) == 0 && ok;
+}
+
+class ImageWriter {
+public:
+    explicit ImageWriter(size_t maxQueued = 4) : maxQueued_(maxQueued) { thread_ = std::thread([this] { run(); }); }
+    ~ImageWriter() { finish(); }
+
+    // Render thread. Blocks while the queue is full.
+    void push(ReadbackImage&& img) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [this] { return queue_.size() < maxQueued_; });
+        queue_.push_back(std::move(img));
+        ready_.notify_one();
+    }
+
+    // A buffer from a written image, so steady-state batches stop allocating.
+    std::vector<unsigned char> recycledBuffer() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.empty()) return {};
+        std::vector<unsigned char> b = std::move(free_.back());
+        free_.pop_back();
+        return b;
+    }
+
+    // Waits for every queued image to be written and stops the thread.
+    void finish() {
+        if (!thread_.joinable()) return;
+        { std::lock_guard<std::mutex> lock(mutex_); quit_ = true; }
+        ready_.notify_all();
+        thread_.join();
+    }
+
+    int written() const { return written_; }
+    int failed() const { return failed_; }
+
+private:
+    void run() {
+        std::vector<unsigned char> row;
+        for (;;) {
+            ReadbackImage img;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return quit_ || !queue_.empty(); });
+                if (queue_.empty()) return;   // quit, and everything is written
+                img = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            space_.notify_one();
+            if (writePPM(img.path, img.w, img.h, img.rgba.data(), row)) written_++;
+            else { failed_++; fprintf(stderr, "Cannot write %s\n", img.path.c_str()); }
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(std::move(img.rgba));
+        }
+    }
+
+    size_t maxQueued_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable ready_, space_;
+    std::deque<ReadbackImage> queue_;
+    std::vector<std::vector<unsigned char>> free_;
+    bool quit_ = false;
+    int written_ = 0, failed_ = 0;    // read after finish()
+};
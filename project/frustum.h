@@ -0,0 +1,28 @@
+#pragma once
+// ---------------- View Frustum ----------------
+// Six planes pulled straight out of a projection*view matrix (Gribb/Hartmann),
+// normalized so sphere tests compare against real distances.
+#include <glm/glm.hpp>
+
+struct Frustum {
+    glm::vec4 planes[6];   // xyz = inward normal, w = distance
+
+    static Frustum fromMatrix(const glm::mat4& m) {
+        Frustum f;
+        glm::vec4 r0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 r1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 r2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 r3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        f.planes[0] = r3 + r0; f.planes[1] = r3 - r0;   // left, right
+        f.planes[2] = r3 + r1; f.planes[3] = r3 - r1;   // bottom, top
+        f.planes[4] = r3 + r2; f.planes[5] = r3 - r2;   // near, far
+        for (glm::vec4& p : f.planes) p /= glm::length(glm::vec3(p));
+        return f;
+    }
+
+    bool sphereVisible(const glm::vec3& c, float radius) const {
+        for (const glm::vec4& p : planes)
+            if (glm::dot(glm::vec3(p), c) + p.w < -radius) return false;
+        return true;
+    }
+};
@@ -0,0 +1,128 @@
+#pragma once
+// ---------------- GL Memory Accounting ----------------
+// Thin wrappers over the GL calls that allocate storage. Each one records the
+// estimated size of what it defined (per buffer, per texture level) and feeds
+// the difference into mem_tracker.h's gpu_buffers / gpu_textures categories,
+// so redefining or deleting an object gives its bytes back.
+// Sizes are what the data needs, not what the driver actually reserves.
+// Callable from any thread with a current context (the render thread and the
+// optional shared-context upload thread); the bookkeeping is behind a mutex.
+#include <glad/glad.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "mem_tracker.h"
+
+struct GLMemoryState {
+    struct Level { GLsizei w = 0, h = 0; size_t bytes = 0; };
+    struct Texture { std::vector<Level> levels; size_t bytesPerTexel = 4; };
+    std::unordered_map<GLuint, size_t> buffers;
+    std::unordered_map<GLuint, Texture> textures;
+    std::mutex mutex;
+};
+
+inline GLMemoryState& glMemoryState() { static GLMemoryState s; return s; }
+
+inline size_t glTexelBytes(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_RED: case GL_R8: return 1;
+        case GL_RG: case GL_RG8: case GL_R16F: return 2;
+        case GL_RGB: case GL_RGB8: case GL_SRGB8: return 3;
+        case GL_RGBA16F: case GL_RG32F: return 8;
+        case GL_RGB32F: return 12;
+        case GL_RGBA32F: return 16;
+        default: return 4;   // RGBA8, SRGB8_ALPHA8, DEPTH24_STENCIL8, R32F, ...
+    }
+}
+
+// Callers hold glMemoryState().mutex.
+inline GLMemoryState::Level& glMemoryLevel(GLuint tex, GLint level) {
+    GLMemoryState::Texture& t = glMemoryState().textures[tex];
+    if ((size_t)level >= t.levels.size()) t.levels.resize(level + 1);
+    return t.levels[level];
+}
+
+inline void glMemorySetLevel(GLuint tex, GLint level, GLsizei w, GLsizei h, size_t bytes) {
+    GLMemoryState::Level& l = glMemoryLevel(tex, level);
+    memTrackFree(kMemGpuTextures, l.bytes);
+    memTrackAlloc(kMemGpuTextures, bytes);
+    l.w = w; l.h = h; l.bytes = bytes;
+}
+
+// `buffer` must be the name currently bound to `target`.
+inline void trackedBufferData(GLenum target, GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) {
+    glBufferData(target, size, data, usage);
+    std::lock_guard<std::mutex> lock(glMemoryState().mutex);
+    size_t& bytes = glMemoryState().buffers[buffer];
+    memTrackFree(kMemGpuBuffers, bytes);
+    memTrackAlloc(kMemGpuBuffers, (size_t)size);
+    bytes = (size_t)size;
+}
+
+// `tex` must be the name currently bound to `target`.
+inline void trackedTexImage2D(GLenum target, GLuint tex, GLint level, GLint internalFormat, GLsizei w, GLsizei h,
+                              GLenum format, GLenum type, const void* data) {
+    glTexImage2D(target, level, internalFormat, w, h, 0, format, type, data);
+    size_t texel = glTexelBytes((GLenum)internalFormat);
+    std::lock_guard<std::mutex> lock(glMemoryState().mutex);
+    glMemoryState().textures[tex].bytesPerTexel = texel;
+    glMemorySetLevel(tex, level, w, h, (size_t)w * h * texel);
+}
+
+// Array textures: level bytes cover every layer.
+inline void trackedTexImage3D(GLenum target, GLuint tex, GLint level, GLint internalFormat, GLsizei w, GLsizei h, GLsizei depth,
+                              GLenum format, GLenum type, const void* data) {
+    glTexImage3D(target, level, internalFormat, w, h, depth, 0, format, type, data);
+    size_t texel = glTexelBytes((GLenum)internalFormat);
+    std::lock_guard<std::mutex> lock(glMemoryState().mutex);
+    glMemoryState().textures[tex].bytesPerTexel = texel;
+    glMemorySetLevel(tex, level, w, h, (size_t)w * h * depth * texel);
+}
+
+inline void trackedCompressedTexImage2D(GLenum target, GLuint tex, GLint level, GLenum internalFormat,
+                                        GLsizei w, GLsizei h, GLsizei imageSize, const void* data) {
+    glCompressedTexImage2D(target, level, internalFormat, w, h, 0, imageSize, data);
+    std::lock_guard<std::mutex> lock(glMemoryState().mutex);
+    glMemorySetLevel(tex, level, w, h, (size_t)imageSize);
+}
+
+// Accounts for the full chain below level 0 of an uncompressed texture.
+inline void trackedGenerateMipmap(GLenum target, GLuint tex) {
+    glGenerateMipmap(target);
+    std::lock_guard<std::mutex> lock(glMemoryState().mutex);
+    GLMemoryState::Texture& t = glMemoryState().textures[tex];
+    if (t.levels.empty()) return;
+    GLsizei w = t.levels[0].w, h = t.levels[0].h;
+    size_t texel = t.bytesPerTexel;
+    for (GLint level = 1; w > 1 || h > 1; ++level) {
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+        glMemorySetLevel(tex, level, w, h, (size_t)w * h * texel);
+    }
+}
+
+inline void trackedDeleteBuffers(GLsizei n, const GLuint* names) {
+    GLMemoryState& s = glMemoryState();
+    std::unique_lock<std::mutex> lock(s.mutex);
+    for (GLsizei i = 0; i < n; ++i) {
+        auto it = s.buffers.find(names[i]);
+        if (it == s.buffers.end()) continue;
+        memTrackFree(kMemGpuBuffers, it->second);
+        s.buffers.erase(it);
+    }
+    lock.unlock();
+    glDeleteBuffers(n, names);
+}
+
+inline void trackedDeleteTextures(GLsizei n, const GLuint* names) {
+    GLMemoryState& s = glMemoryState();
+    std::unique_lock<std::mutex> lock(s.mutex);
+    for (GLsizei i = 0; i < n; ++i) {
+        auto it = s.textures.find(names[i]);
+        if (it == s.textures.end()) continue;
+        for (const GLMemoryState::Level& l : it->second.levels) memTrackFree(kMemGpuTextures, l.bytes);
+        s.textures.erase(it);
+    }
+    lock.unlock();
+    glDeleteTextures(n, names);
+}
@@ -0,0 +1,103 @@
+#pragma once
+// ---------------- GL Upload Thread ----------------
+// A hidden 1x1 GLFW window whose context shares objects with the main one,
+// current on a dedicated thread. GL work posted here (glBufferData,
+// glTexImage2D, shader compiles) runs off the render thread; each job is
+// followed by a glFenceSync + glFlush, and the render thread's poll() runs the
+// job's completion callback only once that fence has signalled, so the new
+// objects are complete by the time the frame binds them.
+// Container objects (VAOs, FBOs) are not shared between contexts: completion
+// callbacks are where those get built.
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "mem_tracker.h"
+
+class GLUploadThread {
+public:
+    // Main thread only (GLFW creates windows there). Returns null if the shared
+    // context can't be made; callers then keep uploading on the render thread.
+    static std::unique_ptr<GLUploadThread> create(GLFWwindow* shareWith) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        GLFWwindow* hidden = glfwCreateWindow(1, 1, "uploader", nullptr, shareWith);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (!hidden) return nullptr;
+        return std::unique_ptr<GLUploadThread>(new GLUploadThread(hidden));
+    }
+
+    ~GLUploadThread() {
+        { std::lock_guard<std::mutex> lock(mutex_); quit_ = true; }
+        cv_.notify_all();
+        thread_.join();
+        for (Done& d : done_) glDeleteSync(d.fence);
+        glfwDestroyWindow(window_);
+    }
+
+    // Any thread. `work` runs on the upload thread, `onComplete` later on the render thread.
+    void post(std::function<void()> work, std::function<void()> onComplete) {
+        { std::lock_guard<std::mutex> lock(mutex_); jobs_.push_back({ std::move(work), std::move(onComplete) }); }
+        cv_.notify_one();
+    }
+
+    // Render thread, once per frame: finishes jobs whose fences have signalled, in order.
+    int poll() {
+        int finished = 0;
+        for (;;) {
+            Done d;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (done_.empty()) break;
+                GLenum r = glClientWaitSync(done_.front().fence, 0, 0);
+                if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) break;
+                d = std::move(done_.front());
+                done_.pop_front();
+            }
+            glDeleteSync(d.fence);
+            if (d.onComplete) d.onComplete();
+            ++finished;
+        }
+        return finished;
+    }
+
+private:
+    struct Job { std::function<void()> work, onComplete; };
+    struct Done { GLsync fence = nullptr; std::function<void()> onComplete; };
+
+    explicit GLUploadThread(GLFWwindow* window) : window_(window) {
+        thread_ = std::thread([this] { run(); });
+    }
+
+    void run() {
+        glfwMakeContextCurrent(window_);
+        MemTagScope tag(kMemLoader);
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return quit_ || !jobs_.empty(); });
+                if (quit_) break;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job.work();
+            GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();   // the fence must reach the GPU before another context can wait on it
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.push_back({ fence, std::move(job.onComplete) });
+        }
+        glfwMakeContextCurrent(nullptr);
+    }
+
+    GLFWwindow* window_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    std::deque<Done> done_;
+    bool quit_ = false;
+};
@@ -0,0 +1,372 @@
+#pragma once
+// ---------------- Binary glTF Loader ----------------
+// Reads .glb (glTF 2.0, one JSON chunk + one BIN chunk) two ways:
+//   - loadGLB_from_memory() expands every triangle primitive of every mesh
+//     into interleaved pos(3) normal(3) uv(2) triangles, exactly what
+//     loadOBJ_from_memory() produces, so everything downstream is shared,
+//   - parseGlbDirect() handles the common single-primitive case without
+//     touching the vertex data: positions, normals and indices are drawn
+//     straight out of the BIN chunk, and only uvs (and tangents, whose sign
+//     depends on them) are converted into a small side array.
+// glTF puts the uv origin at the image's top left and OBJ at its bottom left;
+// uvs are converted to the OBJ convention the shaders expect (v' = 1 - v).
+// Node transforms are not applied: like an OBJ, a mesh is used in its own space.
+// Sparse accessors and external buffers are not supported.
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mesh_normals.h"
+
+namespace gltf {
+
+// Just enough JSON for a glTF document.
+struct Json {
+    enum Kind { Null, Bool, Number, String, Array, Object } kind = Null;
+    double number = 0.0;
+    std::string string;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+
+    const Json* get(const char* key) const {
+        for (const auto& m : members) if (m.first == key) return &m.second;
+        return nullptr;
+    }
+    const Json* at(size_t i) const { return kind == Array && i < items.size() ? &items[i] : nullptr; }
+    double num(const char* key, double fallback) const { const Json* v = get(key); return v && v->kind == Number ? v->number : fallback; }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char* text, size_t size) : p_(text), end_(text + size) {}
+    bool parse(Json& out) { return value(out, 0) && (ws(), p_ == end_); }
+
+private:
+    void ws() { while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_; }
+    bool literal(const char* s) {
+        const size_t n = std::strlen(s);
+        if ((size_t)(end_ - p_) < n || std::memcmp(p_, s, n) != 0) return false;
+        p_ += n;
+        return true;
+    }
+    bool str(std::string& out) {
+        if (p_ >= end_ || *p_ != '"') return false;
+        ++p_;
+        out.clear();
+        while (p_ < end_ && *p_ != '"') {
+            char c = *p_++;
+            if (c != '\\') { out += c; continue; }
+            if (p_ >= end_) return false;
+            c = *p_++;
+            switch (c) {
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    if (end_ - p_ < 4) return false;
+                    const unsigned cp = (unsigned)std::strtoul(std::string(p_, 4).c_str(), nullptr, 16);
+                    p_ += 4;
+                    if (cp < 0x80) out += (char)cp;
+                    else if (cp < 0x800) { out += (char)(0xC0 | (cp >> 6)); out += (char)(0x80 | (cp & 0x3F)); }
+                    else { out += (char)(0xE0 | (cp >> 12)); out += (char)(0x80 | ((cp >> 6) & 0x3F)); out += (char)(0x80 | (cp & 0x3F)); }
+                    break;
+                }
+                default: out += c; break;
+            }
+        }
+        if (p_ >= end_) return false;
+        ++p_;
+        return true;
+    }
+    bool value(Json& out, int depth) {
+        if (depth > 64) return false;
+        ws();
+        if (p_ >= end_) return false;
+        const char c = *p_;
+        if (c == '{') {
+            out.kind = Json::Object;
+            ++p_; ws();
+            if (p_ < end_ && *p_ == '}') { ++p_; return true; }
+            for (;;) {
+                ws();
+                out.members.emplace_back();
+                if (!str(out.members.back().first)) return false;
+                ws();
+                if (p_ >= end_ || *p_++ != ':') return false;
+                if (!value(out.members.back().second, depth + 1)) return false;
+                ws();
+                if (p_ < end_ && *p_ == ',') { ++p_; continue; }
+                if (p_ < end_ && *p_ == '}') { ++p_; return true; }
+                return false;
+            }
+        }
+        if (c == '[') {
+            out.kind = Json::Array;
+            ++p_; ws();
+            if (p_ < end_ && *p_ == ']') { ++p_; return true; }
+            for (;;) {
+                out.items.emplace_back();
+                if (!value(out.items.back(), depth + 1)) return false;
+                ws();
+                if (p_ < end_ && *p_ == ',') { ++p_; continue; }
+                if (p_ < end_ && *p_ == ']') { ++p_; return true; }
+                return false;
+            }
+        }
+        if (c == '"') { out.kind = Json::String; return str(out.string); }
+        if (literal("true")) { out.kind = Json::Bool; out.number = 1.0; return true; }
+        if (literal("false")) { out.kind = Json::Bool; return true; }
+        if (literal("null")) return true;
+        // Numbers: strtod needs a terminator, so copy the token out.
+        const char* s = p_;
+        while (p_ < end_ && (std::strchr("+-.eE", *p_) || (*p_ >= '0' && *p_ <= '9'))) ++p_;
+        if (p_ == s) return false;
+        out.kind = Json::Number;
+        out.number = std::strtod(std::string(s, p_).c_str(), nullptr);
+        return true;
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+enum : uint32_t { kGlbMagic = 0x46546C67, kChunkJson = 0x4E4F534A, kChunkBin = 0x004E4942 };
+enum : uint32_t { kByte = 5120, kUnsignedByte = 5121, kShort = 5122, kUnsignedShort = 5123, kUnsignedInt = 5125, kFloat = 5126 };
+
+struct Document {
+    Json json;
+    const unsigned char* bin = nullptr;
+    size_t binSize = 0;
+};
+
+inline bool parseGlb(const unsigned char* data, size_t size, Document& doc) {
+    uint32_t h[3];
+    if (size < 20) return false;
+    std::memcpy(h, data, sizeof(h));
+    if (h[0] != kGlbMagic || h[1] != 2 || h[2] > size) return false;
+    size = h[2];
+    for (size_t at = 12; at + 8 <= size;) {
+        uint32_t chunk[2];
+        std::memcpy(chunk, data + at, sizeof(chunk));
+        const size_t body = at + 8;
+        if (chunk[0] > size - body) return false;
+        if (chunk[1] == kChunkJson && doc.json.kind == Json::Null) {
+            JsonParser parser((const char*)data + body, chunk[0]);
+            if (!parser.parse(doc.json) || doc.json.kind != Json::Object) return false;
+        } else if (chunk[1] == kChunkBin && !doc.bin) {
+            doc.bin = data + body;
+            doc.binSize = chunk[0];
+        }
+        at = body + ((chunk[0] + 3) & ~3u);
+    }
+    return doc.json.kind == Json::Object;
+}
+
+inline uint32_t componentBytes(uint32_t type) {
+    switch (type) {
+        case kByte: case kUnsignedByte: return 1;
+        case kShort: case kUnsignedShort: return 2;
+        case kUnsignedInt: case kFloat: return 4;
+        default: return 0;
+    }
+}
+
+inline uint32_t componentCount(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0;
+}
+
+// An accessor resolved to bytes in the BIN chunk.
+struct Accessor {
+    const unsigned char* data = nullptr;   // first element
+    size_t binOffset = 0;                  // of the first element, within the BIN chunk
+    uint32_t count = 0, components = 0, componentType = 0, stride = 0;
+    bool normalized = false;
+
+    size_t elementBytes() const { return (size_t)components * componentBytes(componentType); }
+    size_t span() const { return count ? (size_t)(count - 1) * stride + elementBytes() : 0; }
+
+    // Component c of element i, normalized integers mapped to [0, 1] / [-1, 1].
+    float read(uint32_t i, uint32_t c) const {
+        const unsigned char* p = data + (size_t)i * stride + (size_t)c * componentBytes(componentType);
+        switch (componentType) {
+            case kFloat: { float f; std::memcpy(&f, p, 4); return f; }
+            case kUnsignedByte: return normalized ? *p / 255.0f : (float)*p;
+            case kByte: { const float f = (float)(int8_t)*p; return normalized ? std::max(f / 127.0f, -1.0f) : f; }
+            case kUnsignedShort: { uint16_t v; std::memcpy(&v, p, 2); return normalized ? v / 65535.0f : (float)v; }
+            case kShort: { int16_t v; std::memcpy(&v, p, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : (float)v; }
+            case kUnsignedInt: { uint32_t v; std::memcpy(&v, p, 4); return (float)v; }
+        }
+        return 0.0f;
+    }
+    uint32_t index(uint32_t i) const {
+        const unsigned char* p = data + (size_t)i * stride;
+        if (componentType == kUnsignedByte) return *p;
+        if (componentType == kUnsignedShort) { uint16_t v; std::memcpy(&v, p, 2); return v; }
+        uint32_t v; std::memcpy(&v, p, 4); return v;
+    }
+};
+
+// A JSON number used as an index, count or byte size: a whole number in
+// [0, limit]. Anything else (negative, fractional, NaN, huge) would make the
+// cast to an integer undefined or the bounds checks below wrap.
+inline bool wholeNumber(double v, double limit, size_t& out) {
+    if (!(v >= 0.0 && v <= limit) || v != (double)(uint64_t)v) return false;
+    out = (size_t)v;
+    return true;
+}
+
+inline bool resolveAccessor(const Document& doc, const Json* ref, Accessor& a) {
+    const double kMax32 = 4294967295.0;
+    size_t accIndex, viewIndex;
+    if (!ref || ref->kind != Json::Number || !wholeNumber(ref->number, kMax32, accIndex)) return false;
+    const Json* accessors = doc.json.get("accessors");
+    const Json* acc = accessors ? accessors->at(accIndex) : nullptr;
+    if (!acc || acc->get("sparse") || !wholeNumber(acc->num("bufferView", -1), kMax32, viewIndex)) return false;
+    const Json* type = acc->get("type");
+    const Json* views = doc.json.get("bufferViews");
+    const Json* view = views ? views->at(viewIndex) : nullptr;
+    if (!type || !view || view->num("buffer", 0) != 0 || !doc.bin) return false;
+    size_t count, componentType, stride, viewOffset, viewLength, accOffset;
+    if (!wholeNumber(acc->num("count", 0), kMax32, count) ||
+        !wholeNumber(acc->num("componentType", 0), kMax32, componentType)) return false;
+    a.count = (uint32_t)count;
+    a.componentType = (uint32_t)componentType;
+    a.components = componentCount(type->string);
+    const Json* norm = acc->get("normalized");
+    a.normalized = norm && norm->number != 0.0;
+    if (!a.components || !componentBytes(a.componentType)) return false;
+    const double kMaxBytes = 9007199254740992.0;   // 2^53: every such double is exact
+    if (!wholeNumber(view->num("byteOffset", 0), kMaxBytes, viewOffset) ||
+        !wholeNumber(view->num("byteLength", 0), kMaxBytes, viewLength) ||
+        !wholeNumber(view->num("byteStride", (double)a.elementBytes()), kMax32, stride) ||
+        !wholeNumber(acc->num("byteOffset", 0), kMaxBytes, accOffset)) return false;
+    a.stride = (uint32_t)stride;
+    // By subtraction, so nothing can wrap.
+    if (viewOffset > doc.binSize || viewLength > doc.binSize - viewOffset || accOffset > viewLength) return false;
+    if (a.count > 1 && a.stride > (SIZE_MAX - a.elementBytes()) / (a.count - 1)) return false;
+    if (a.span() > viewLength - accOffset) return false;
+    a.binOffset = viewOffset + accOffset;
+    a.data = doc.bin + a.binOffset;
+    return true;
+}
+
+// Triangle primitives only (mode 4, the default).
+inline bool isTriangles(const Json& prim) { return prim.num("mode", 4) == 4; }
+
+} // namespace gltf
+
+inline bool loadGLB_from_memory(const unsigned char* data, size_t size, std::vector<float>& out) {
+    using namespace gltf;
+    Document doc;
+    if (!parseGlb(data, size, doc)) return false;
+    const Json* meshes = doc.json.get("meshes");
+    if (!meshes || meshes->kind != Json::Array) return false;
+    const size_t outStart = out.size();
+    std::vector<uint32_t> cornerPos;   // for smooth normals where a primitive has none
+    bool missingNormals = false;
+    uint32_t baseVertex = 0;
+    for (const Json& mesh : meshes->items) {
+        const Json* prims = mesh.get("primitives");
+        if (!prims) continue;
+        for (const Json& prim : prims->items) {
+            const Json* attrs = prim.get("attributes");
+            Accessor pos, nrm, uv, idx;
+            if (!isTriangles(prim) || !attrs || !resolveAccessor(doc, attrs->get("POSITION"), pos) || pos.components != 3) continue;
+            const bool hasN = resolveAccessor(doc, attrs->get("NORMAL"), nrm) && nrm.components == 3 && nrm.count == pos.count;
+            const bool hasUV = resolveAccessor(doc, attrs->get("TEXCOORD_0"), uv) && uv.components == 2 && uv.count == pos.count;
+            const bool indexed = prim.get("indices") != nullptr;
+            // Index types per the spec; index() reads nothing else within the accessor's span.
+            if (indexed && (!resolveAccessor(doc, prim.get("indices"), idx) || idx.components != 1 ||
+                            (idx.componentType != kUnsignedByte && idx.componentType != kUnsignedShort &&
+                             idx.componentType != kUnsignedInt))) return false;
+            const uint32_t corners = (indexed ? idx.count : pos.count) / 3 * 3;
+            missingNormals |= !hasN;
+            for (uint32_t c = 0; c < corners; ++c) {
+                const uint32_t v = indexed ? idx.index(c) : c;
+                if (v >= pos.count) return false;
+                out.push_back(pos.read(v, 0)); out.push_back(pos.read(v, 1)); out.push_back(pos.read(v, 2));
+                if (hasN) { out.push_back(nrm.read(v, 0)); out.push_back(nrm.read(v, 1)); out.push_back(nrm.read(v, 2)); }
+                else { out.push_back(0); out.push_back(0); out.push_back(0); }
+                if (hasUV) { out.push_back(uv.read(v, 0)); out.push_back(1.0f - uv.read(v, 1)); }
+                else { out.push_back(0); out.push_back(0); }
+                cornerPos.push_back(baseVertex + v);
+            }
+            baseVertex += pos.count;
+        }
+    }
+    if (missingNormals)
+        generateSmoothNormals(out.data() + outStart, cornerPos.size() / 3, cornerPos.data(), baseVertex);
+    return out.size() > outStart;
+}
+
+// Where a directly drawn .glb's attributes sit: positions and normals in the
+// uploaded BIN range, uv(2) and maybe tangent(4) per vertex in the side array.
+struct GlbLayout { uint32_t positionOffset = 0, positionStride = 0, normalOffset = 0, normalStride = 0, sideFloats = 0; };
+
+// A .glb that can be drawn without re-interleaving: one triangle primitive,
+// float positions and normals whose bytes sit close together in the BIN chunk,
+// 16- or 32-bit indices or none.
+struct GlbDirectMesh {
+    const unsigned char* vertexData = nullptr;   // BIN range holding POSITION and NORMAL; upload as is
+    size_t vertexBytes = 0;
+    const unsigned char* indexData = nullptr;    // tightly packed, upload as is
+    uint32_t indexCount = 0, indexSize = 0;      // indexSize 2 or 4; 0 = unindexed
+    uint32_t vertexCount = 0;
+    GlbLayout layout;
+    // uv converted to OBJ's v-up, then the tangent when the file has one,
+    // its w negated to match the flipped v: layout.sideFloats (2 or 6) per vertex.
+    std::vector<float> side;
+};
+
+inline bool parseGlbDirect(const unsigned char* data, size_t size, GlbDirectMesh& m) {
+    using namespace gltf;
+    Document doc;
+    if (!parseGlb(data, size, doc)) return false;
+    const Json* meshes = doc.json.get("meshes");
+    if (!meshes || meshes->items.size() != 1) return false;
+    const Json* prims = meshes->items[0].get("primitives");
+    if (!prims || prims->items.size() != 1 || !isTriangles(prims->items[0])) return false;
+    const Json& prim = prims->items[0];
+    const Json* attrs = prim.get("attributes");
+    Accessor pos, nrm, uv, tan, idx;
+    if (!attrs || !resolveAccessor(doc, attrs->get("POSITION"), pos) || !resolveAccessor(doc, attrs->get("NORMAL"), nrm)) return false;
+    if (pos.componentType != kFloat || pos.components != 3 || nrm.componentType != kFloat || nrm.components != 3 || nrm.count != pos.count) return false;
+    if (pos.stride % 4 || nrm.stride % 4 || pos.binOffset % 4 || nrm.binOffset % 4) return false;
+    // One buffer for both, unless that would drag in much else (say, an embedded image).
+    const size_t lo = std::min(pos.binOffset, nrm.binOffset), hi = std::max(pos.binOffset + pos.span(), nrm.binOffset + nrm.span());
+    if (hi - lo > 2 * (pos.span() + nrm.span())) return false;
+    if (prim.get("indices")) {
+        if (!resolveAccessor(doc, prim.get("indices"), idx) || idx.components != 1) return false;
+        if ((idx.componentType != kUnsignedShort && idx.componentType != kUnsignedInt) || idx.stride != componentBytes(idx.componentType)) return false;
+        if (idx.binOffset % idx.stride) return false;
+        for (uint32_t i = 0; i < idx.count; ++i) if (idx.index(i) >= pos.count) return false;   // GL would read past the buffer
+        m.indexData = idx.data;
+        m.indexCount = idx.count / 3 * 3;
+        m.indexSize = idx.stride;
+    }
+    m.vertexData = doc.bin + lo;
+    m.vertexBytes = hi - lo;
+    m.layout.positionOffset = (uint32_t)(pos.binOffset - lo); m.layout.positionStride = pos.stride;
+    m.layout.normalOffset = (uint32_t)(nrm.binOffset - lo); m.layout.normalStride = nrm.stride;
+    m.vertexCount = pos.count;
+
+    const bool hasUV = resolveAccessor(doc, attrs->get("TEXCOORD_0"), uv) && uv.components == 2 && uv.count == pos.count;
+    const bool hasT = resolveAccessor(doc, attrs->get("TANGENT"), tan) && tan.components == 4 && tan.count == pos.count;
+    const uint32_t sideFloats = m.layout.sideFloats = hasT ? 6 : 2;
+    m.side.assign((size_t)pos.count * sideFloats, 0.0f);
+    for (uint32_t v = 0; v < pos.count; ++v) {
+        float* s = m.side.data() + (size_t)v * sideFloats;
+        if (hasUV) { s[0] = uv.read(v, 0); s[1] = 1.0f - uv.read(v, 1); }
+        if (hasT) { s[2] = tan.read(v, 0); s[3] = tan.read(v, 1); s[4] = tan.read(v, 2); s[5] = -tan.read(v, 3); }
+    }
+    return true;
+}
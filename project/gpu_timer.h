@@ -0,0 +1,52 @@
+#pragma once
+// ---------------- GPU Timer ----------------
+// GPU time of one span of GL commands per frame. Two GL_TIME_ELAPSED queries
+// take turns and are read a frame or more late, so reading never stalls; while
+// both are still in flight a frame simply goes untimed. Results are smoothed.
+#include <glad/glad.h>
+
+class GpuTimer {
+public:
+    void init() { glGenQueries(2, queries_); }
+    void shutdown() {
+        if (queries_[0]) glDeleteQueries(2, queries_);
+        queries_[0] = queries_[1] = 0;
+        pending_[0] = pending_[1] = false;
+    }
+
+    void begin() {
+        timing_ = queries_[0] && !pending_[index_];
+        if (timing_) glBeginQuery(GL_TIME_ELAPSED, queries_[index_]);
+    }
+    void end() {
+        if (!timing_) return;
+        glEndQuery(GL_TIME_ELAPSED);
+        pending_[index_] = true;
+        index_ ^= 1;
+        timing_ = false;
+    }
+
+    // Folds in whichever results have arrived; returns the smoothed time.
+    float read() {
+        for (int i = 0; i < 2; ++i) {
+            if (!pending_[i]) continue;
+            GLint ready = 0;
+            glGetQueryObjectiv(queries_[i], GL_QUERY_RESULT_AVAILABLE, &ready);
+            if (!ready) continue;
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(queries_[i], GL_QUERY_RESULT, &ns);
+            pending_[i] = false;
+            float ms = (float)(ns / 1e6);
+            ms_ = ms_ == 0.0f ? ms : ms_ * 0.95f + ms * 0.05f;
+        }
+        return ms_;
+    }
+    float ms() const { return ms_; }
+
+private:
+    GLuint queries_[2] = { 0, 0 };
+    bool pending_[2] = { false, false };
+    int index_ = 0;
+    bool timing_ = false;
+    float ms_ = 0.0f;
+};
@@ -0,0 +1,241 @@
+#pragma once
+// ---------------- HUD ----------------
+// Screen-space text and bars for frame stats. The font is a 5x7 bitmap baked
+// into a 96x48 GL_R8 atlas at init (ASCII 32..127, lower case drawn as upper
+// case, glyph 127 is a solid block used for bars). Everything queued during a
+// frame goes into one vertex array, which is uploaded into a single orphaned
+// VBO and drawn with one glDrawArrays. The HUD times itself (CPU build + GPU
+// time via GL_TIME_ELAPSED, read a frame late so it never stalls) and does no
+// work at all while disabled.
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "gl_memory.h"
+#include "gpu_timer.h"
+
+struct HudGlyph { char c; uint8_t rows[7]; };   // bit 4 = leftmost column
+
+static const HudGlyph kHudFont[] = {
+    { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+    { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+    { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+    { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+    { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+    { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+    { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+    { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+    { 'A', { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+    { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+    { 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+    { 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+    { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+    { 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+    { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+    { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+    { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+    { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+    { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+    { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+    { 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+    { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+    { 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+    { 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+    { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+    { 'Y', { 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04 } },
+    { 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+    { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+    { ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+    { '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+    { '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+    { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+    { '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+    { '=', { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 } },
+    { '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+    { ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+    { '|', { 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+    { ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+    { '_', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F } },
+    { '?', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 } },
+};
+
+inline uint32_t hudColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+    return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+class Hud {
+public:
+    static const int kCellW = 6, kCellH = 8, kCols = 16, kRows = 6;
+    static const int kAtlasW = kCellW * kCols, kAtlasH = kCellH * kRows;
+    static const int kGraphFrames = 120;
+
+    struct Vertex { float x, y, u, v; uint32_t color; };
+
+    bool init(GLuint program) {
+        program_ = program;
+        if (!program_) return false;
+        screenLoc_ = glGetUniformLocation(program_, "screenSize");
+
+        std::vector<uint8_t> atlas(kAtlasW * kAtlasH, 0);
+        auto bake = [&](int code, const uint8_t rows[7]) {
+            int cx = (code - 32) % kCols * kCellW, cy = (code - 32) / kCols * kCellH;
+            for (int y = 0; y < 7; ++y)
+                for (int x = 0; x < 5; ++x)
+                    if (rows[y] & (0x10 >> x)) atlas[(cy + y) * kAtlasW + cx + x] = 255;
+        };
+        for (const HudGlyph& g : kHudFont) { bake((unsigned char)g.c, g.rows); hasGlyph_[(unsigned char)g.c - 32] = true; }
+        const uint8_t solid[7] = { 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F };
+        bake(127, solid);
+        hasGlyph_[' ' - 32] = hasGlyph_[127 - 32] = true;
+
+        glGenTextures(1, &atlas_);
+        glBindTexture(GL_TEXTURE_2D, atlas_);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        trackedTexImage2D(GL_TEXTURE_2D, atlas_, 0, GL_R8, kAtlasW, kAtlasH, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+        glGenVertexArrays(1, &vao_);
+        glGenBuffers(1, &vbo_);
+        glBindVertexArray(vao_);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+        glEnableVertexAttribArray(2);
+
+        gpuTimer_.init();
+        verts_.reserve(6 * 1024);
+        return true;
+    }
+
+    void shutdown() {
+        if (atlas_) trackedDeleteTextures(1, &atlas_);
+        if (vbo_) trackedDeleteBuffers(1, &vbo_);
+        if (vao_) glDeleteVertexArrays(1, &vao_);
+        gpuTimer_.shutdown();
+        if (program_) glDeleteProgram(program_);
+        atlas_ = vbo_ = vao_ = program_ = 0;
+    }
+
+    bool enabled() const { return enabled_ && program_; }
+    void setEnabled(bool on) { enabled_ = on; }
+    void toggle() { enabled_ = !enabled_; }
+
+    // Frame-time history for the graph; cheap enough to keep recording while hidden.
+    void recordFrame(float ms) { graph_[graphHead_] = ms; graphHead_ = (graphHead_ + 1) % kGraphFrames; }
+    float averageFrameMs() const {
+        float sum = 0.0f; for (float ms : graph_) sum += ms;
+        return sum / kGraphFrames;
+    }
+    float cpuMs() const { return cpuMs_; }
+    float gpuMs() const { return gpuTimer_.ms(); }
+
+    void begin(int screenW, int screenH) {
+        buildStart_ = std::chrono::steady_clock::now();
+        screenW_ = screenW; screenH_ = screenH;
+        verts_.clear();
+    }
+
+    // Top-left anchored, in pixels; returns the x after the last glyph.
+    float text(float x, float y, const char* s, uint32_t color, float scale = 2.0f) {
+        for (; *s; ++s) {
+            int c = (unsigned char)*s;
+            if (c >= 'a' && c <= 'z') c -= 32;
+            if (c < 32 || c > 127 || !hasGlyph_[c - 32]) c = '?';
+            if (c != ' ') {
+                float u0 = (float)((c - 32) % kCols * kCellW) / kAtlasW, v0 = (float)((c - 32) / kCols * kCellH) / kAtlasH;
+                quad(x, y, 5 * scale, 7 * scale, u0, v0, u0 + 5.0f / kAtlasW, v0 + 7.0f / kAtlasH, color);
+            }
+            x += kCellW * scale;
+        }
+        return x;
+    }
+
+    void rect(float x, float y, float w, float h, uint32_t color) {
+        // Sample the middle of the solid glyph so filtering never reaches an edge.
+        float u = ((127 - 32) % kCols * kCellW + 2.5f) / kAtlasW, v = ((127 - 32) / kCols * kCellH + 3.5f) / kAtlasH;
+        quad(x, y, w, h, u, v, u, v, color);
+    }
+
+    // Bars of the last kGraphFrames frame times; full height = maxMs.
+    void frameGraph(float x, float y, float w, float h, float maxMs) {
+        rect(x, y, w, h, hudColor(0, 0, 0, 140));
+        float barW = w / kGraphFrames;
+        for (int i = 0; i < kGraphFrames; ++i) {
+            float ms = graph_[(graphHead_ + i) % kGraphFrames];
+            float bh = std::min(1.0f, ms / maxMs) * h;
+            uint32_t c = ms <= 1000.0f / 60.0f ? hudColor(80, 220, 90) : ms <= 1000.0f / 30.0f ? hudColor(230, 200, 60) : hudColor(230, 70, 60);
+            rect(x + i * barW, y + h - bh, std::max(1.0f, barW - 1.0f), bh, c);
+        }
+        float line = y + h - std::min(1.0f, (1000.0f / 60.0f) / maxMs) * h;
+        rect(x, line, w, 1.0f, hudColor(255, 255, 255, 120));
+    }
+
+    // One upload, one draw. Leaves depth testing on and blending off, as the scene expects.
+    void draw() {
+        gpuTimer_.read();
+        if (!verts_.empty()) {
+            gpuTimer_.begin();
+
+            glDisable(GL_DEPTH_TEST);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glUseProgram(program_);
+            glUniform2f(screenLoc_, (float)screenW_, (float)screenH_);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, atlas_);
+            glBindVertexArray(vao_);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+            size_t bytes = verts_.size() * sizeof(Vertex);
+            if (bytes > vboBytes_) vboBytes_ = std::max(bytes, vboBytes_ * 2);
+            // Orphan, then fill: the driver hands back fresh storage instead of syncing with last frame's draw.
+            trackedBufferData(GL_ARRAY_BUFFER, vbo_, (GLsizeiptr)vboBytes_, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, verts_.data());
+            glDrawArrays(GL_TRIANGLES, 0, (GLsizei)verts_.size());
+            glDisable(GL_BLEND);
+            glEnable(GL_DEPTH_TEST);
+
+            gpuTimer_.end();
+        }
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - buildStart_).count();
+        cpuMs_ = cpuMs_ == 0.0f ? ms : cpuMs_ * 0.95f + ms * 0.05f;
+    }
+
+private:
+    void quad(float x, float y, float w, float h, float u0, float v0, float u1, float v1, uint32_t color) {
+        Vertex a{ x, y, u0, v0, color }, b{ x + w, y, u1, v0, color };
+        Vertex c{ x + w, y + h, u1, v1, color }, d{ x, y + h, u0, v1, color };
+        verts_.push_back(a); verts_.push_back(b); verts_.push_back(c);
+        verts_.push_back(a); verts_.push_back(c); verts_.push_back(d);
+    }
+
+    GLuint program_ = 0, atlas_ = 0, vao_ = 0, vbo_ = 0;
+    GpuTimer gpuTimer_;
+    GLint screenLoc_ = -1;
+    size_t vboBytes_ = 0;
+    int screenW_ = 1, screenH_ = 1;
+    bool enabled_ = true;
+    bool hasGlyph_[96] = {};
+    std::vector<Vertex> verts_;
+    float graph_[kGraphFrames] = {};
+    int graphHead_ = 0;
+    float cpuMs_ = 0.0f;
+    std::chrono::steady_clock::time_point buildStart_;
+};
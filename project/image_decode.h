@@ -0,0 +1,178 @@
+#pragma once
+// ---------------- Image Decoding ----------------
+// stb_image already runs the JPEG IDCT and YCbCr->RGB on SSE2/NEON, but it only
+// ever uses one core per image. Baseline JPEGs written with restart markers
+// (DRI) are split here at restart boundaries into independent band bitstreams,
+// decoded concurrently by stb and stitched together; the vertical flip happens
+// during the stitch. Anything else goes through stbi_load_from_memory as before.
+// Each band also decodes one restart unit beyond its edges and discards it, so
+// stb's chroma upsampler sees real neighbours and the result is bit-identical.
+#include "staging_pool.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Images below this size decode faster on one thread than the split costs.
+static const int kParallelDecodeMinPixels = 1 << 20;
+
+struct JpegLayout {
+    int width = 0, height = 0, comps = 0;
+    int mcuW = 8, mcuH = 8;
+    int restartInterval = 0;        // MCUs per restart segment
+    size_t sofHeightPos = 0;        // byte offset of the 16-bit height in SOF
+    size_t entropyBegin = 0;        // first byte after the SOS header
+    std::vector<size_t> segBegin;   // entropy byte offset of every restart segment
+    std::vector<size_t> segEnd;     // one past the segment's last byte (before RSTn/EOI)
+};
+
+// Accepts only single-scan baseline/extended Huffman JPEGs with a restart interval.
+inline bool parseJpegLayout(const unsigned char* d, size_t size, JpegLayout& L) {
+    if (size < 4 || d[0] != 0xFF || d[1] != 0xD8) return false;
+    size_t p = 2;
+    int hmax = 1, vmax = 1;
+    while (p + 4 <= size) {
+        if (d[p] != 0xFF) return false;
+        unsigned char m = d[p + 1];
+        if (m == 0xFF) { ++p; continue; }
+        size_t len = ((size_t)d[p + 2] << 8) | d[p + 3];
+        if (p + 2 + len > size) return false;
+        const unsigned char* s = d + p + 4;
+        if (m == 0xC0 || m == 0xC1) {
+            L.sofHeightPos = p + 5;
+            L.height = (s[1] << 8) | s[2];
+            L.width = (s[3] << 8) | s[4];
+            L.comps = s[5];
+            for (int c = 0; c < L.comps; ++c) {
+                hmax = std::max(hmax, s[7 + c * 3] >> 4);
+                vmax = std::max(vmax, s[7 + c * 3] & 15);
+            }
+        } else if ((m >= 0xC2 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC)) {
+            return false;   // progressive / lossless / arithmetic
+        } else if (m == 0xDD) {
+            L.restartInterval = (s[0] << 8) | s[1];
+        } else if (m == 0xDA) {
+            if (s[0] != L.comps || L.height == 0) return false;
+            L.entropyBegin = p + 2 + len;
+            break;
+        }
+        p += 2 + len;
+    }
+    if (!L.entropyBegin || L.restartInterval <= 0) return false;
+    L.mcuW = 8 * hmax; L.mcuH = 8 * vmax;
+
+    L.segBegin.push_back(L.entropyBegin);
+    for (size_t i = L.entropyBegin; i + 1 < size; ++i) {
+        if (d[i] != 0xFF) continue;
+        unsigned char b = d[i + 1];
+        if (b == 0x00 || b == 0xFF) { continue; }
+        if (b >= 0xD0 && b <= 0xD7) {
+            L.segEnd.push_back(i);
+            L.segBegin.push_back(i + 2);
+            ++i;
+            continue;
+        }
+        L.segEnd.push_back(i);  // EOI or any other marker ends the scan
+        break;
+    }
+    if (L.segEnd.size() != L.segBegin.size()) L.segEnd.push_back(size);
+
+    long mcusPerRow = (L.width + L.mcuW - 1) / L.mcuW;
+    long mcuRows = (L.height + L.mcuH - 1) / L.mcuH;
+    long expected = (mcusPerRow * mcuRows + L.restartInterval - 1) / L.restartInterval;
+    return (long)L.segBegin.size() == expected;
+}
+
+// Builds a standalone JPEG holding MCU rows [row0, row1) of the original.
+inline std::vector<unsigned char> buildJpegBand(const unsigned char* d, const JpegLayout& L, int row0, int row1) {
+    long mcusPerRow = (L.width + L.mcuW - 1) / L.mcuW;
+    size_t s0 = (size_t)(row0 * mcusPerRow / L.restartInterval);
+    size_t s1 = std::min(L.segBegin.size(), (size_t)((row1 * mcusPerRow + L.restartInterval - 1) / L.restartInterval));
+    int bandH = std::min(L.height, row1 * L.mcuH) - row0 * L.mcuH;
+
+    std::vector<unsigned char> out(d, d + L.entropyBegin);
+    out[L.sofHeightPos] = (unsigned char)(bandH >> 8);
+    out[L.sofHeightPos + 1] = (unsigned char)(bandH & 0xFF);
+    for (size_t s = s0; s < s1; ++s) {
+        if (s > s0) { out.push_back(0xFF); out.push_back((unsigned char)(0xD0 + ((s - s0 - 1) & 7))); }
+        out.insert(out.end(), d + L.segBegin[s], d + L.segEnd[s]);
+    }
+    out.push_back(0xFF); out.push_back(0xD9);
+    return out;
+}
+
+inline unsigned char* decodeJpegParallel(const unsigned char* data, const JpegLayout& L,
+                                         int reqComp, bool flipY, unsigned threads) {
+    long mcusPerRow = (L.width + L.mcuW - 1) / L.mcuW;
+    int mcuRows = (L.height + L.mcuH - 1) / L.mcuH;
+    // Band edges must land on restart boundaries: row * mcusPerRow % interval == 0.
+    long g = mcusPerRow, r = L.restartInterval;
+    while (r) { long t = g % r; g = r; r = t; }
+    int step = (int)(L.restartInterval / g);
+    int units = mcuRows / step;
+    int bands = (int)std::min<long>(threads, units);
+    if (bands < 2) return nullptr;
+
+    int outComp = reqComp ? reqComp : L.comps;
+    size_t rowBytes = (size_t)L.width * outComp;
+    unsigned char* out = (unsigned char*)stagingAlloc(rowBytes * L.height);
+    if (!out) return nullptr;
+
+    std::vector<int> rowStart(bands + 1);
+    for (int b = 0; b <= bands; ++b) rowStart[b] = (b == bands) ? mcuRows : (int)((long)units * b / bands) * step;
+
+    std::vector<char> ok(bands, 0);
+    auto decodeBand = [&](int b) {
+        stbi_set_flip_vertically_on_load_thread(0);
+        int decodeFrom = std::max(0, rowStart[b] - step);
+        int decodeTo = std::min(mcuRows, rowStart[b + 1] + step);
+        std::vector<unsigned char> band = buildJpegBand(data, L, decodeFrom, decodeTo);
+        int bw, bh, bn;
+        unsigned char* px = stbi_load_from_memory(band.data(), (int)band.size(), &bw, &bh, &bn, outComp);
+        if (!px) return;
+        int y0 = rowStart[b] * L.mcuH;
+        int y1 = std::min(L.height, rowStart[b + 1] * L.mcuH);
+        int skip = (rowStart[b] - decodeFrom) * L.mcuH;
+        for (int y = y0; y < y1; ++y) {
+            int dst = flipY ? (L.height - 1 - y) : y;
+            std::memcpy(out + (size_t)dst * rowBytes, px + (size_t)(y - y0 + skip) * rowBytes, rowBytes);
+        }
+        stbi_image_free(px);
+        ok[b] = 1;
+    };
+    std::vector<std::thread> pool;
+    for (int b = 1; b < bands; ++b) pool.emplace_back(decodeBand, b);
+    decodeBand(0);
+    for (auto& t : pool) t.join();
+    for (char o : ok) if (!o) { stagingFree(out); return nullptr; }
+    return out;
+}
+
+// Drop-in for stbi_load_from_memory; the pixels come from the staging pool
+// (free them with stbi_image_free).
+// flipY replaces the global stbi_set_flip_vertically_on_load state.
+inline unsigned char* decodeImage(const unsigned char* data, size_t size, int* w, int* h, int* n,
+                                  int reqComp, bool flipY) {
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    JpegLayout L;
+    if (threads > 1 && parseJpegLayout(data, size, L) && (long)L.width * L.height >= kParallelDecodeMinPixels) {
+        if (unsigned char* px = decodeJpegParallel(data, L, reqComp, flipY, threads)) {
+            *w = L.width; *h = L.height; *n = L.comps;
+            return px;
+        }
+    }
+    stbi_set_flip_vertically_on_load_thread(flipY ? 1 : 0);
+    return stbi_load_from_memory(data, (int)size, w, h, n, reqComp);
+}
+
+inline unsigned char* decodeImageFile(const std::string& path, int* w, int* h, int* n, int reqComp, bool flipY) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return nullptr;
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    return decodeImage(bytes.data(), bytes.size(), w, h, n, reqComp, flipY);
+}
@@ -9,7 +9,41 @@
 #include <string>
 #include <vector>
 #include <cmath>
-#include <algorithm> // Απαραίτητο για το std::replace
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include <climits>
+
+#include "alloc_counter.h"
+#include "arena.h"
+#include "asset_manager.h"
+#include "asset_pack.h"
+#include "broadphase.h"
+#include "bvh.h"
+#include "frame_pacer.h"
+#include "frame_readback.h"
+#include "frustum.h"
+#include "gl_memory.h"
+#include "gl_upload_thread.h"
+#include "gltf_loader.h"
+#include "hud.h"
+#include "image_decode.h"
+#include "mem_tracker.h"
+#include "mesh_format.h"
+#include "mesh_tangents.h"
+#include "multi_view.h"
+#include "nbody.h"
+#include "obj_loader.h"
+#include "particles.h"
+#include "ply_loader.h"
+#include "scene_format.h"
+#include "scene_params.h"
+#include "texture_format.h"
+#include "texture_streamer.h"
+#include "worker_pool.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -22,32 +56,129 @@ static bool  gPaused = false;
 static float gSimTime = 0.0f;
 
 // ---------------- Scene Params ----------------
-static const int   kNumCubes = 6;
-static const float kPlanetOrbitR = 3.0f; 
-static const float kPlanetOrbitW = 0.5f; 
-static const float kCubeOrbitR = 2.0f;   
-static const float kCubeOrbitW = 1.0f;   
-static const float kCubeScale  = 0.35f;
-static const float kPlanetScale = 0.2f;  
-
-static void processInput(GLFWwindow* window, float dt) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
+static SceneParams gScene;                // layout for the window; batch jobs carry their own
+
+// ---------------- Batch Rendering ----------------
+static std::string gBatchPath;            // --batch JOBS: render every job to a file and exit
+
+// ---------------- Texture Streaming ----------------
+static bool   gStreamTextures = true;
+static bool   gSRGBTextures = false;
+static size_t gTexBudgetBytes = 64u << 20;
+static const size_t kTexUploadBytesPerFrame = 8u << 20;
+static const size_t kAssetUploadBytesPerFrame = 16u << 20;
+static bool   gUploadThread = false;      // --upload-thread: GL uploads on a shared context
+
+// ---------------- HUD + Render Stats ----------------
+static bool gShowHud = true;
+
+struct RenderStats { int drawCalls = 0; long triangles = 0; int visible = 0; int culled = 0; int viewVisible = 0; };
+static RenderStats gRenderStats;
+
+// ---------------- Views ----------------
+// View 0 is the orbit camera in the window; views 1..gFollowViews follow one
+// cube each and are drawn as thumbnails along the bottom edge (see multi_view.h).
+static int gFollowViews = 0;              // --views N; V toggles
+static int gLastFollowViews = kMaxViews - 1;
+static const int kThumbW = 240, kThumbH = 180;
+
+// ---------------- N-Body ----------------
+// --nbody N: N satellites moving under their mutual gravity and the sun's
+// (nbody.h) instead of scripted orbits, drawn as one instanced cube batch.
+static size_t gNBodyCount = 0;
+static NBodyIntegrator gNBodyIntegrator = NBodyIntegrator::Leapfrog;   // --integrator euler|leapfrog|rk4
+static bool gNBodyDeterministic = false;                               // --deterministic
+static const float kNBodyInnerR = 1.0f, kNBodyOuterR = 4.0f, kNBodyDiscMass = 2.0f;
+static const float kNBodyStep = 1.0f / 120.0f;     // fixed, so leapfrog stays symplectic and runs replay exactly
+static const int kNBodyMaxStepsPerFrame = 4;       // past this the sim slows down rather than spiral behind
+
+// ---------------- Contacts ----------------
+// --contacts (C toggles): every frame, which bodies are touching or passing
+// close (broadphase.h); with --nbody, satellites in contact are drawn red.
+static bool gContacts = false;
+static const float kSceneContactMargin = 0.1f;     // scene bodies whose surfaces are closer than this
+
+// ---------------- Picking ----------------
+// Left click picks the body under the cursor (bvh.h). Scene bodies and N-body
+// satellites each keep a BVH, refit every frame and rebuilt once refitting has
+// let it degrade; --no-pick skips that upkeep. The HUD follows the pick: its
+// nearest neighbour and whether anything stands between it and the sun.
+static bool gPicking = true;
+static bool gPickPending = false;
+static double gPickX = 0.0, gPickY = 0.0;         // window coordinates of the click
+
+// ---------------- Particles ----------------
+// --particles N: N debris particles thrown off the emissive planet, falling
+// back or escaping under its pull; stepped and drawn on the GPU (particles.h).
+static size_t gParticleCount = 0;
+
+// ---------------- Memory Report ----------------
+static std::string gMemReportPath;              // --mem-report: JSON written at exit
+static const char* kMemReportKeyPath = "mem_report.json";
+
+static void writeMemReport(const std::string& path) {
+    std::ofstream f(path);
+    if (!f) { std::cerr << "Cannot write " << path << "\n"; return; }
+    memWriteJSON(f);
+    std::cout << "Memory report written to " << path << "\n";
+}
+
+// ---------------- Input + Frame Pacing ----------------
+// Input is event driven: the key callback flips toggles on press and tracks
+// which camera keys are held, so nothing polls glfwGetKey. When nothing moves
+// (paused, no keys held, nothing loading) the loop sleeps in
+// glfwWaitEventsTimeout instead of redrawing an identical frame.
+static bool   gIdleWait = true;           // --always-render turns this off
+static double gTargetFps = 0.0;           // --fps N: paced without vsync; 0 = vsync
+static const double kIdleWaitSeconds = 0.5;
+static bool   gRedraw = true;             // something outside the sim changed the image
+static bool   gCamKeys[4] = {};           // left, right, up, down
 
+static void keyCallback(GLFWwindow* window, int key, int, int action, int) {
+    if (action == GLFW_REPEAT) return;
+    bool down = (action == GLFW_PRESS);
+    switch (key) {
+        case GLFW_KEY_LEFT:  gCamKeys[0] = down; break;
+        case GLFW_KEY_RIGHT: gCamKeys[1] = down; break;
+        case GLFW_KEY_UP:    gCamKeys[2] = down; break;
+        case GLFW_KEY_DOWN:  gCamKeys[3] = down; break;
+        case GLFW_KEY_ESCAPE: if (down) glfwSetWindowShouldClose(window, true); break;
+        case GLFW_KEY_P: if (down) gPaused = !gPaused; break;
+        case GLFW_KEY_H: if (down) gShowHud = !gShowHud; break;
+        case GLFW_KEY_C: if (down) gContacts = !gContacts; break;
+        case GLFW_KEY_M: if (down) writeMemReport(kMemReportKeyPath); break;
+        case GLFW_KEY_V:
+            if (!down) break;
+            if (gFollowViews) { gLastFollowViews = gFollowViews; gFollowViews = 0; }
+            else gFollowViews = gLastFollowViews;
+            break;
+        default: return;
+    }
+    gRedraw = true;
+}
+
+static void mouseButtonCallback(GLFWwindow* window, int button, int action, int) {
+    if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS || !gPicking) return;
+    glfwGetCursorPos(window, &gPickX, &gPickY);
+    gPickPending = true;
+    gRedraw = true;
+}
+
+static void refreshCallback(GLFWwindow*) { gRedraw = true; }
+static void framebufferSizeCallback(GLFWwindow*, int w, int h) { glViewport(0, 0, w, h); gRedraw = true; }
+
+static bool cameraMoving() { return gCamKeys[0] || gCamKeys[1] || gCamKeys[2] || gCamKeys[3]; }
+
+static void updateCamera(float dt) {
     const float camSpeed = 1.6f;
     const float step = camSpeed * dt;
-    if (glfwGetKey(window, GLFW_KEY_LEFT)  == GLFW_PRESS) gYaw   -= step;
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) gYaw   += step;
-    if (glfwGetKey(window, GLFW_KEY_UP)    == GLFW_PRESS) gPitch += step;
-    if (glfwGetKey(window, GLFW_KEY_DOWN)  == GLFW_PRESS) gPitch -= step;
+    if (gCamKeys[0]) gYaw   -= step;
+    if (gCamKeys[1]) gYaw   += step;
+    if (gCamKeys[2]) gPitch += step;
+    if (gCamKeys[3]) gPitch -= step;
 
     if (gPitch >  1.4f) gPitch =  1.4f;
     if (gPitch < -1.4f) gPitch = -1.4f;
-
-    static bool pWasDown = false;
-    bool pDown = (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS);
-    if (pDown && !pWasDown) gPaused = !gPaused;
-    pWasDown = pDown;
 }
 
 static GLuint compileShader(GLenum type, const char* src) {
@@ -57,216 +188,1164 @@ static GLuint compileShader(GLenum type, const char* src) {
     return s;
 }
 
-static GLuint makeProgram(const char* vsSrc, const char* fsSrc) {
+// `feedbackVaryings`: vertex outputs to capture with transform feedback, interleaved in that order.
+static GLuint makeProgram(const char* vsSrc, const char* fsSrc, const char* gsSrc = nullptr,
+                          const char* const* feedbackVaryings = nullptr, int feedbackCount = 0) {
     GLuint vs = compileShader(GL_VERTEX_SHADER, vsSrc);
     GLuint fs = compileShader(GL_FRAGMENT_SHADER, fsSrc);
+    GLuint gs = gsSrc ? compileShader(GL_GEOMETRY_SHADER, gsSrc) : 0;
     GLuint prog = glCreateProgram();
     glAttachShader(prog, vs);
     glAttachShader(prog, fs);
+    if (gs) glAttachShader(prog, gs);
+    if (feedbackCount) glTransformFeedbackVaryings(prog, feedbackCount, feedbackVaryings, GL_INTERLEAVED_ATTRIBS);
     glLinkProgram(prog);
     glDeleteShader(vs);
     glDeleteShader(fs);
+    if (gs) glDeleteShader(gs);
     return prog;
 }
 
-static GLuint loadTexture2D(const char* path) {
-    stbi_set_flip_vertically_on_load(true);
-    int w, h, n;
-    unsigned char* data = stbi_load(path, &w, &h, &n, 0);
-    if (!data) return 0;
-    GLenum format = (n == 4) ? GL_RGBA : GL_RGB;
+// ---------------- Asset Paths ----------------
+// Relative asset paths are tried against the cwd first, then against the repo
+// root next to the executable (project/app -> ..), so the app runs from anywhere.
+static std::string exeDir() {
+    char buf[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    if (n <= 0) return ".";
+    buf[n] = 0;
+    std::string p(buf);
+    size_t slash = p.find_last_of('/');
+    return slash == std::string::npos ? "." : p.substr(0, slash);
+}
+
+static std::string resolveAssetPath(const std::string& rel) {
+    if (!rel.empty() && rel[0] == '/') return rel;
+    static const std::string dir = exeDir();
+    const std::string candidates[] = { rel, dir + "/../" + rel, dir + "/" + rel };
+    for (const auto& c : candidates)
+        if (access(c.c_str(), R_OK) == 0) return c;
+    return rel;
+}
+
+static AssetPack gPack;
+
+// Pack entry when assets.pak has it, otherwise the loose file.
+static std::string loadTextAsset(const std::string& path) {
+    if (AssetSpan s = gPack.find(path)) return std::string((const char*)s.data, s.size);
+    std::ifstream f(resolveAssetPath(path), std::ios::binary);
+    if (!f) { std::cerr << "Missing asset " << path << "\n"; return std::string(); }
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+// Name of the tools/assetc output for a source asset, e.g. planet.obj -> planet.mesh.
+static std::string compiledName(const std::string& path, const char* ext) {
+    size_t dot = path.find_last_of('.');
+    return (dot == std::string::npos ? path : path.substr(0, dot)) + ext;
+}
+
+static bool hasGLExtension(const char* name) {
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for (GLint i = 0; i < n; ++i)
+        if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) return true;
+    return false;
+}
+
+// Decoded images arrive as tightly packed RGBA8 rows, top row first (the shaders flip V),
+// so they upload as-is: no flip pass, no 3-channel rows fighting GL_UNPACK_ALIGNMENT.
+static GLenum textureInternalFormat() { return gSRGBTextures ? GL_SRGB8_ALPHA8 : GL_RGBA8; }
+
+static GLuint uploadTexture2D(const unsigned char* rgba, int w, int h) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    trackedTexImage2D(GL_TEXTURE_2D, tex, 0, textureInternalFormat(), w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    trackedGenerateMipmap(GL_TEXTURE_2D, tex);
+    return tex;
+}
+
+// Uploads a precompiled mip chain; BC1 goes straight to the driver when S3TC is exposed.
+static GLuint uploadCompiledTexture(const TexView& t) {
+    static const bool s3tc = hasGLExtension("GL_EXT_texture_compression_s3tc");
     GLuint tex;
     glGenTextures(1, &tex);
     glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+    for (uint32_t level = 0; level < t.mipCount; ++level) {
+        const TexMipEntry& m = t.mips[level];
+        const unsigned char* bytes = t.base + m.offset;
+        if (t.format == kTexBC1 && s3tc) {
+            trackedCompressedTexImage2D(GL_TEXTURE_2D, tex, level,
+                                        gSRGBTextures ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                        m.width, m.height, (GLsizei)m.size, bytes);
+        } else if (t.format == kTexBC1) {
+            std::vector<unsigned char> rgba = decodeBC1(bytes, m.width, m.height);
+            trackedTexImage2D(GL_TEXTURE_2D, tex, level, textureInternalFormat(), m.width, m.height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        } else {
+            trackedTexImage2D(GL_TEXTURE_2D, tex, level, textureInternalFormat(), m.width, m.height, GL_RGBA, GL_UNSIGNED_BYTE, bytes);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)t.mipCount - 1);
     return tex;
 }
 
-struct MeshGL { GLuint VAO = 0; GLuint VBO = 0; GLsizei vertexCount = 0; };
+// CPU half of a texture load: the compiled mip chain from the pack, or decoded RGBA8.
+struct TexturePayload {
+    bool ok = false;
+    TexView compiled;
+    bool isCompiled = false;
+    std::unique_ptr<unsigned char, void (*)(void*)> pixels{ nullptr, stbi_image_free };   // staging-pool memory
+    int w = 0, h = 0;
+    size_t uploadBytes() const {
+        if (!isCompiled) return (size_t)w * h * 4;
+        size_t n = 0;
+        for (uint32_t i = 0; i < compiled.mipCount; ++i) n += compiled.mips[i].size;
+        return n;
+    }
+};
 
-static int fixIndex(int idx, int n) {
-    if (idx > 0) return idx - 1;
-    if (idx < 0) return n + idx;
-    return -1;
+static TexturePayload loadTexturePayload(const std::string& path) {
+    MemTagScope tag(kMemTextures);
+    TexturePayload p;
+    if (AssetSpan s = gPack.find(compiledName(path, ".tex"))) {
+        if (parseTextureBlob(s.data, s.size, p.compiled)) { p.ok = p.isCompiled = true; return p; }
+    }
+
+    StagingPoolStats before = stagingPool().stats();
+    int n;
+    unsigned char* data = nullptr;
+    if (AssetSpan s = gPack.find(path))
+        data = decodeImage(s.data, s.size, &p.w, &p.h, &n, 4, false);
+    else
+        data = decodeImageFile(resolveAssetPath(path), &p.w, &p.h, &n, 4, false);
+    if (!data) { std::cerr << "Failed to load texture " << path << "\n"; return p; }
+    p.pixels.reset(data);
+    p.ok = true;
+
+    StagingPoolStats after = stagingPool().stats();
+    std::cout << path << ": " << (after.allocs - before.allocs) << " staging allocs, "
+              << (after.misses - before.misses) << " from malloc\n";
+    return p;
 }
 
-static bool loadOBJ_to_interleaved(const std::string& path, std::vector<float>& out) {
-    std::ifstream f(path);
-    if (!f) return false;
-    std::vector<glm::vec3> V;
-    std::vector<glm::vec2> VT;
-    std::vector<glm::vec3> VN;
-    std::string line;
-    while (std::getline(f, line)) {
-        std::istringstream iss(line);
-        std::string tag; iss >> tag;
-        if (tag == "v") { glm::vec3 p; iss >> p.x >> p.y >> p.z; V.push_back(p); }
-        else if (tag == "vt") { glm::vec2 uv; iss >> uv.x >> uv.y; VT.push_back(uv); }
-        else if (tag == "vn") { glm::vec3 n; iss >> n.x >> n.y >> n.z; VN.push_back(n); }
-        else if (tag == "f") {
-            std::vector<std::string> tokens; std::string t; while(iss >> t) tokens.push_back(t);
-            for(size_t i=1; i+1 < tokens.size(); ++i) {
-                int indices[3] = {0, (int)i, (int)i+1};
-                for(int idx : indices) {
-                    std::string segment = tokens[idx];
-                    std::replace(segment.begin(), segment.end(), '/', ' ');
-                    std::istringstream viss(segment);
-                    int v_idx = -1, vt_idx = -1, vn_idx = -1;
-                    viss >> v_idx >> vt_idx >> vn_idx;
-                    
-                    glm::vec3 p = V[fixIndex(v_idx, V.size())];
-                    out.push_back(p.x); out.push_back(p.y); out.push_back(p.z);
-                    
-                    if (vn_idx != -1 && !VN.empty()) {
-                        glm::vec3 n = VN[fixIndex(vn_idx, VN.size())];
-                        out.push_back(n.x); out.push_back(n.y); out.push_back(n.z);
-                    } else { out.push_back(0); out.push_back(1); out.push_back(0); }
-                    
-                    if (vt_idx != -1 && !VT.empty()) {
-                        glm::vec2 uv = VT[fixIndex(vt_idx, VT.size())];
-                        out.push_back(uv.x); out.push_back(uv.y);
-                    } else { out.push_back(0); out.push_back(0); }
-                }
-            }
-        }
+static GLuint uploadTexturePayload(const TexturePayload& p) {
+    if (p.isCompiled) return uploadCompiledTexture(p.compiled);
+    return uploadTexture2D(p.pixels.get(), p.w, p.h);
+}
+
+struct MeshGL {
+    GLuint VAO = 0; GLuint VBO = 0; GLuint EBO = 0; GLsizei vertexCount = 0; GLsizei indexCount = 0; float radius = 0.0f;
+    GLenum indexType = GL_UNSIGNED_INT;
+    uint32_t floatsPerVertex = kMeshFloatsWithTangents;
+    GLuint sideVBO = 0;     // set: a .glb drawn in place, attributes where `glb` says
+    GlbLayout glb;
+};
+
+// Bounding-sphere radius around the model origin, for culling.
+static float meshRadius(const float* interleaved, size_t vertexCount, size_t stride) {
+    float r2 = 0.0f;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* p = interleaved + i * stride;
+        r2 = std::max(r2, p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
     }
-    return true;
+    return std::sqrt(r2);
 }
 
-static bool createMeshFromOBJ(const std::string& objPath, MeshGL& mesh) {
-    std::vector<float> data;
-    if (!loadOBJ_to_interleaved(objPath, data)) return false;
-    mesh.vertexCount = (GLsizei)(data.size() / 8);
-    glGenVertexArrays(1, &mesh.VAO); glGenBuffers(1, &mesh.VBO);
-    glBindVertexArray(mesh.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+// pos, normal, uv at locations 0..2, and the tangent at 3 when the vertices have one;
+// without, shaders read location 3 as the (0,0,0,1) default.
+static void setupInterleavedAttribs(uint32_t floatsPerVertex) {
+    const GLsizei stride = (GLsizei)(floatsPerVertex * sizeof(float));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
+    if (floatsPerVertex < kMeshFloatsWithTangents) return;
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)(8 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+}
+
+// Registers a texture with the streamer, preferring the compiled mip chain in the pack.
+static int addStreamedTexture(TextureStreamer& streamer, const std::string& path) {
+    TexView compiled;
+    if (AssetSpan s = gPack.find(compiledName(path, ".tex")))
+        if (parseTextureBlob(s.data, s.size, compiled)) return streamer.addCompiled(compiled);
+    if (AssetSpan s = gPack.find(path)) return streamer.addImage(path, s);
+    return streamer.addImage(resolveAssetPath(path), AssetSpan());
+}
+
+// Scratch for load-time parsing, one per loader thread; rewound after every load.
+static Arena& loadArena() { static thread_local Arena arena(1u << 20, kMemLoader); return arena; }
+
+static bool loadOBJ_to_interleaved(const std::string& path, std::vector<float>& out) {
+    AllocCounts before = allocCounts();
+    bool ok;
+    if (AssetSpan s = gPack.find(path)) {
+        ok = loadOBJ_from_memory((const char*)s.data, s.size, out, &loadArena());
+    } else {
+        std::ifstream f(resolveAssetPath(path), std::ios::binary);
+        if (!f) return false;
+        std::string text((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        ok = loadOBJ_from_memory(text.data(), text.size(), out, &loadArena());
+    }
+    if (kTrackAllocs) {
+        AllocCounts d = allocCounts() - before;
+        std::cout << path << ": " << d.count << " heap allocs (" << d.bytes / 1024 << " KB), scratch peak "
+                  << loadArena().peakBytes() / 1024 << " KB\n";
+    }
+    return ok;
+}
+
+static bool hasExtension(const std::string& path, const char* ext) {
+    const size_t n = std::strlen(ext);
+    if (path.size() < n) return false;
+    for (size_t i = 0; i < n; ++i)
+        if (std::tolower((unsigned char)path[path.size() - n + i]) != ext[i]) return false;
     return true;
 }
 
-int main() {
+// CPU half of a mesh load: the indexed .mesh that tools/assetc put in the pack
+// (zero-copy view); a loose .glb drawn in place when its layout allows
+// (gltf_loader.h); otherwise the .obj, .ply or .glb expanded into interleaved
+// triangles with tangents.
+// Packs from before tangents hold 8-float vertices; those still load, unmapped.
+struct MeshPayload {
+    bool ok = false;
+    MeshView compiled;
+    MappedFile file;        // keeps `glb`'s bytes alive until the upload
+    GlbDirectMesh glb;
+    std::vector<float> interleaved;
+    uint32_t floatsPerVertex() const { return compiled.vertices ? compiled.floatsPerVertex : kMeshFloatsWithTangents; }
+    size_t uploadBytes() const {
+        if (compiled.vertices) return ((size_t)compiled.vertexCount * compiled.floatsPerVertex + compiled.indexCount) * 4;
+        if (glb.vertexData) return glb.vertexBytes + (size_t)glb.indexCount * glb.indexSize + glb.side.size() * sizeof(float);
+        return interleaved.size() * sizeof(float);
+    }
+};
+
+static MeshPayload loadMeshPayload(const std::string& path) {
+    MemTagScope tag(kMemLoader);
+    MeshPayload p;
+    AssetSpan blob = gPack.find(compiledName(path, ".mesh"));
+    if (blob && parseMeshBlob(blob.data, blob.size, p.compiled) &&
+        (p.compiled.floatsPerVertex == 8 || p.compiled.floatsPerVertex == kMeshFloatsWithTangents)) {
+        p.ok = true;
+        return p;
+    }
+    p.compiled = MeshView();
+    if (hasExtension(path, ".glb") || hasExtension(path, ".ply")) {
+        AssetSpan s = gPack.find(path);
+        if (!s && p.file.open(resolveAssetPath(path))) s = p.file.span();
+        if (s && hasExtension(path, ".glb")) {
+            if (parseGlbDirect(s.data, s.size, p.glb)) { p.ok = true; return p; }
+            p.glb = GlbDirectMesh();
+            p.ok = loadGLB_from_memory(s.data, s.size, p.interleaved);
+        } else if (s) {
+            p.ok = loadPLY_from_memory((const char*)s.data, s.size, p.interleaved);
+        }
+        p.file.close();
+    } else {
+        p.ok = loadOBJ_to_interleaved(path, p.interleaved);
+    }
+    if (p.ok) p.interleaved = appendTangents(p.interleaved);
+    if (!p.ok) std::cerr << "Failed to load mesh " << path << "\n";
+    return p;
+}
+
+// GL half of a mesh load. Only creates buffers, so it can run on the shared-context
+// upload thread; the VAO (not shared between contexts) comes from createMeshVAO.
+// Both buffers go through GL_ARRAY_BUFFER: the index binding is VAO state.
+static MeshGL uploadMeshBuffers(const MeshPayload& p) {
+    MeshGL mesh;
+    mesh.floatsPerVertex = p.floatsPerVertex();
+    glGenBuffers(1, &mesh.VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    if (p.compiled.vertices) {
+        const MeshView& m = p.compiled;
+        mesh.vertexCount = (GLsizei)m.vertexCount;
+        mesh.indexCount = (GLsizei)m.indexCount;
+        mesh.radius = meshRadius(m.vertices, m.vertexCount, m.floatsPerVertex);
+        trackedBufferData(GL_ARRAY_BUFFER, mesh.VBO, (size_t)m.vertexCount * m.floatsPerVertex * sizeof(float), m.vertices, GL_STATIC_DRAW);
+        glGenBuffers(1, &mesh.EBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.EBO);
+        trackedBufferData(GL_ARRAY_BUFFER, mesh.EBO, (size_t)m.indexCount * sizeof(uint32_t), m.indices, GL_STATIC_DRAW);
+    } else if (p.glb.vertexData) {
+        // Straight from the mapped file: only uvs (and tangents) went through a conversion.
+        const GlbDirectMesh& g = p.glb;
+        mesh.glb = g.layout;
+        mesh.vertexCount = (GLsizei)g.vertexCount;
+        mesh.indexCount = (GLsizei)g.indexCount;
+        mesh.indexType = g.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        mesh.radius = meshRadius((const float*)(g.vertexData + g.layout.positionOffset), g.vertexCount, g.layout.positionStride / sizeof(float));
+        trackedBufferData(GL_ARRAY_BUFFER, mesh.VBO, g.vertexBytes, g.vertexData, GL_STATIC_DRAW);
+        glGenBuffers(1, &mesh.sideVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.sideVBO);
+        trackedBufferData(GL_ARRAY_BUFFER, mesh.sideVBO, g.side.size() * sizeof(float), g.side.data(), GL_STATIC_DRAW);
+        if (g.indexCount) {
+            glGenBuffers(1, &mesh.EBO);
+            glBindBuffer(GL_ARRAY_BUFFER, mesh.EBO);
+            trackedBufferData(GL_ARRAY_BUFFER, mesh.EBO, (size_t)g.indexCount * g.indexSize, g.indexData, GL_STATIC_DRAW);
+        }
+    } else {
+        mesh.vertexCount = (GLsizei)(p.interleaved.size() / mesh.floatsPerVertex);
+        mesh.radius = meshRadius(p.interleaved.data(), mesh.vertexCount, mesh.floatsPerVertex);
+        trackedBufferData(GL_ARRAY_BUFFER, mesh.VBO, p.interleaved.size() * sizeof(float), p.interleaved.data(), GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return mesh;
+}
+
+// Render thread.
+static void createMeshVAO(MeshGL& mesh) {
+    glGenVertexArrays(1, &mesh.VAO);
+    glBindVertexArray(mesh.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    if (mesh.sideVBO) {
+        const GlbLayout& l = mesh.glb;
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (GLsizei)l.positionStride, (void*)(size_t)l.positionOffset);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, (GLsizei)l.normalStride, (void*)(size_t)l.normalOffset);
+        glEnableVertexAttribArray(1);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.sideVBO);
+        const GLsizei stride = (GLsizei)(l.sideFloats * sizeof(float));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glEnableVertexAttribArray(2);
+        if (l.sideFloats == 6) {
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)(2 * sizeof(float)));
+            glEnableVertexAttribArray(3);
+        }
+    } else {
+        setupInterleavedAttribs(mesh.floatsPerVertex);
+    }
+    if (mesh.EBO) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+}
+
+struct ProgramPayload {
+    bool ok = false;
+    std::string vs, fs, gs;      // gs empty: no geometry stage
+    size_t uploadBytes() const { return vs.size() + fs.size() + gs.size(); }
+};
+
+static ProgramPayload loadProgramPayload(const std::string& vsPath, const std::string& fsPath, const std::string& gsPath = "") {
+    ProgramPayload p;
+    p.vs = loadTextAsset(vsPath);
+    p.fs = loadTextAsset(fsPath);
+    if (!gsPath.empty()) p.gs = loadTextAsset(gsPath);
+    p.ok = !p.vs.empty() && !p.fs.empty() && (gsPath.empty() || !p.gs.empty());
+    return p;
+}
+
+// ---------------- Scene ----------------
+// The scene is a SceneDesc (scene_format.h): --scene loads one, otherwise it is
+// built from gScene's layout. Meshes named "builtin:cube" use the cube VAO;
+// unlit materials draw with the planet program in a flat colour, lit ones with
+// the cube program and their texture.
+static std::string gScenePath;            // --scene FILE (.scene text, or its compiled .scn in the pack)
+static std::string gSceneSource;          // text the loaded SceneDesc points into
+
+// The planet and its ring of cubes, as described by `sp`. Always the same
+// mesh/material tables, so one set of GL assets serves every layout.
+static SceneDesc makeOrbitScene(const SceneParams& sp) {
+    SceneDesc d;
+    d.meshes = { { "planet", "assets/objects/planet.obj" }, { "cube", kBuiltinCube } };
+    SceneMaterial sun, crate;
+    sun.name = "sun";
+    sun.color[0] = 1.0f; sun.color[1] = 0.9f; sun.color[2] = 0.5f;
+    sun.flags = kMaterialUnlit;
+    crate.name = "crate";
+    crate.texture = "assets/textures/container.jpg";
+    d.materials = { sun, crate };
+    d.ownedBodies.resize(1 + std::max(0, sp.numCubes));
+    SceneBody& planet = d.ownedBodies[0];
+    planet.orbitRadius = sp.planetOrbitR; planet.orbitSpeed = sp.planetOrbitW; planet.scale = sp.planetScale;
+    for (int i = 0; i < sp.numCubes; ++i) {
+        SceneBody& b = d.ownedBodies[1 + i];
+        float off = (2.0f * 3.14159f * i) / sp.numCubes;
+        b.parent = 0; b.mesh = 1; b.material = 1;
+        b.orbitRadius = sp.cubeOrbitR; b.orbitSpeed = sp.cubeOrbitW; b.phase = off; b.height = sin(off) * 0.5f;
+        b.scale = sp.cubeScale; b.spin = 1.0f + i * 0.5f;
+    }
+    d.adoptOwnedBodies();
+    return d;
+}
+
+// The compiled .scn from the pack when there is one, else the text.
+static bool loadScene(const std::string& path, SceneDesc& out, std::string& err) {
+    if (AssetSpan s = gPack.find(compiledName(path, ".scn")))
+        if (parseSceneBlob(s.data, s.size, out)) return true;
+    gSceneSource = loadTextAsset(path);
+    if (gSceneSource.empty()) { err = "cannot read " + path; return false; }
+    return parseSceneText(gSceneSource, out, err);
+}
+
+// GL side of a SceneDesc's meshes and materials, index-aligned with them.
+struct SceneMeshGL { GLuint VAO = 0; GLsizei vertexCount = 0, indexCount = 0; GLenum indexType = GL_UNSIGNED_INT; float radius = 0.0f; };
+struct SceneMaterialGL { GLuint tex = 0; glm::vec3 color{ 1.0f }; bool unlit = false; };
+
+// Load handles for every mesh and texture a scene names; shared paths load once.
+struct SceneAssets {
+    std::vector<AssetHandle<MeshGL>> meshes;    // invalid for the builtin cube
+    std::vector<AssetHandle<GLuint>> textures;  // per material; invalid when streamed or untextured
+    std::vector<int> streamed;                  // per material streamer id, or -1
+};
+
+// What the scene draws with this frame. The tables are refreshed in place from
+// the asset handles every frame, so steady-state frames don't allocate.
+struct SceneGL {
+    const SceneDesc* scene = nullptr;
+    std::vector<SceneMeshGL> meshes;
+    std::vector<SceneMaterialGL> materials;
+    GLuint litProg = 0, unlitProg = 0;
+};
+
+static SceneAssets submitSceneAssets(const SceneDesc& sd, AssetManager& assets, TextureStreamer* streamer, GLuint placeholderTex) {
+    SceneAssets sa;
+    std::unordered_map<std::string_view, AssetHandle<MeshGL>> meshByPath;
+    for (const SceneMesh& m : sd.meshes) {
+        if (m.path == kBuiltinCube) { sa.meshes.emplace_back(); continue; }
+        AssetHandle<MeshGL>& h = meshByPath[m.path];
+        if (!h.valid()) {
+            std::string path(m.path);
+            h = assets.submit<MeshGL>(std::string(m.name), MeshGL(),
+                [path] { return loadMeshPayload(path); },
+                [](const MeshPayload& p) { return uploadMeshBuffers(p); },
+                [](MeshGL& mesh) { createMeshVAO(mesh); });
+        }
+        sa.meshes.push_back(h);
+    }
+    std::unordered_map<std::string_view, AssetHandle<GLuint>> texByPath;
+    std::unordered_map<std::string_view, int> streamedByPath;
+    for (const SceneMaterial& m : sd.materials) {
+        sa.textures.emplace_back();
+        sa.streamed.push_back(-1);
+        if (m.texture.empty() || (m.flags & kMaterialUnlit)) continue;
+        std::string path(m.texture);
+        if (streamer) {
+            auto it = streamedByPath.find(m.texture);
+            sa.streamed.back() = it != streamedByPath.end() ? it->second
+                                                            : (streamedByPath[m.texture] = addStreamedTexture(*streamer, path));
+            continue;
+        }
+        AssetHandle<GLuint>& h = texByPath[m.texture];
+        if (!h.valid())
+            h = assets.submit<GLuint>(path, placeholderTex,
+                [path] { return loadTexturePayload(path); },
+                [](const TexturePayload& p) { return uploadTexturePayload(p); });
+        sa.textures.back() = h;
+    }
+    return sa;
+}
+
+// Render thread, once per frame: placeholders until each asset is ready.
+static void refreshSceneGL(SceneGL& gl, const SceneDesc& sd, const SceneAssets& sa, const TextureStreamer* streamer,
+                           GLuint cubeVAO, GLuint placeholderTex) {
+    gl.meshes.resize(sd.meshes.size());
+    for (size_t i = 0; i < sd.meshes.size(); ++i) {
+        SceneMeshGL& m = gl.meshes[i];
+        if (!sa.meshes[i].valid()) { m.VAO = cubeVAO; m.vertexCount = 36; m.indexCount = 0; m.radius = 0.866f; continue; }
+        const MeshGL& mesh = sa.meshes[i].get();
+        m.VAO = mesh.VAO; m.vertexCount = mesh.vertexCount; m.indexCount = mesh.indexCount; m.indexType = mesh.indexType; m.radius = mesh.radius;
+    }
+    gl.materials.resize(sd.materials.size());
+    for (size_t i = 0; i < sd.materials.size(); ++i) {
+        SceneMaterialGL& m = gl.materials[i];
+        const SceneMaterial& src = sd.materials[i];
+        m.unlit = (src.flags & kMaterialUnlit) != 0;
+        m.color = glm::vec3(src.color[0], src.color[1], src.color[2]);
+        m.tex = placeholderTex;
+        if (sa.streamed[i] >= 0 && streamer) m.tex = streamer->texture(sa.streamed[i]);
+        else if (sa.textures[i].valid()) m.tex = sa.textures[i].get();
+    }
+    gl.scene = &sd;
+}
+
+// Transforms and bounds of every body at time t; parents come before children,
+// so one pass suffices. Returns the light: the first unlit body, or the origin.
+static glm::vec3 buildSceneObjects(const SceneGL& gl, float t, ViewInstance* inst, ViewBounds* bounds) {
+    const SceneDesc& sd = *gl.scene;
+    glm::vec3 light(0.0f);
+    bool haveLight = false;
+    for (size_t i = 0; i < sd.bodyCount; ++i) {
+        const SceneBody& b = sd.bodies[i];
+        glm::vec3 center = b.parent == kSceneNoParent ? glm::vec3(0.0f) : bounds[b.parent].center;
+        float a = t * b.orbitSpeed + b.phase;
+        glm::vec3 pos = center + glm::vec3(cos(a) * b.orbitRadius, b.height, sin(a) * b.orbitRadius);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
+        if (b.spin != 0.0f) model = glm::rotate(model, t * b.spin, glm::vec3(0.5, 1, 0));
+        model = glm::scale(model, glm::vec3(b.scale));
+        inst[i] = makeViewInstance(model);
+        bounds[i] = { pos, gl.meshes[b.mesh].radius * b.scale };
+        if (!haveLight && gl.materials[b.material].unlit) { light = pos; haveLight = true; }
+    }
+    return light;
+}
+
+// Draws the bodies whose view-0 bit is set, seen through `cam`, into the bound
+// framebuffer. Program, material and VAO are only rebound when they change.
+static void drawSceneView(const SceneGL& gl, const Camera& cam, const glm::vec3& lightPos, const ViewInstance* inst) {
+    const SceneDesc& sd = *gl.scene;
+    GLuint boundProg = 0;
+    GLint modelLoc = -1;
+    int boundMaterial = -1, boundMesh = -1;
+    for (size_t i = 0; i < sd.bodyCount; ++i) {
+        if (!(inst[i].viewMask & 1u)) { gRenderStats.culled++; continue; }
+        const SceneBody& b = sd.bodies[i];
+        const SceneMeshGL& mesh = gl.meshes[b.mesh];
+        const SceneMaterialGL& mat = gl.materials[b.material];
+        GLuint prog = mat.unlit ? gl.unlitProg : gl.litProg;
+        if (!prog || !mesh.VAO) continue;   // still loading
+        gRenderStats.visible++;
+        if (prog != boundProg) {
+            glUseProgram(prog);
+            glUniformMatrix4fv(glGetUniformLocation(prog, "view"), 1, GL_FALSE, glm::value_ptr(cam.view));
+            glUniformMatrix4fv(glGetUniformLocation(prog, "projection"), 1, GL_FALSE, glm::value_ptr(cam.proj));
+            if (!mat.unlit) glUniform3fv(glGetUniformLocation(prog, "lightPos"), 1, glm::value_ptr(lightPos));
+            modelLoc = glGetUniformLocation(prog, "model");
+            boundProg = prog;
+            boundMaterial = -1;
+        }
+        if (b.material != boundMaterial) {
+            if (mat.unlit) glUniform3fv(glGetUniformLocation(prog, "color"), 1, glm::value_ptr(mat.color));
+            else { glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, mat.tex); }
+            boundMaterial = b.material;
+        }
+        if (b.mesh != boundMesh) { glBindVertexArray(mesh.VAO); boundMesh = b.mesh; }
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, inst[i].model);
+        if (mesh.indexCount) glDrawElements(GL_TRIANGLES, mesh.indexCount, mesh.indexType, 0);
+        else glDrawArrays(GL_TRIANGLES, 0, mesh.vertexCount);
+        gRenderStats.drawCalls++;
+        gRenderStats.triangles += (mesh.indexCount ? mesh.indexCount : mesh.vertexCount) / 3;
+    }
+}
+
+// ---------------- N-Body Rendering ----------------
+// Every satellite is an instance of the cube VAO: position plus a speed tint
+// (-1 for one in contact, -2 for the picked one), written by the worker pool
+// straight into the mapped instance buffer.
+struct NBodyGL { GLuint program = 0, instanceVBO = 0; GLsizeiptr instanceBytes = 0; };
+
+// Cube edge length: big enough to see a few hundred, small enough not to merge at a million.
+static float nbodyCubeScale(size_t n) { return std::min(0.35f, std::max(0.004f, 0.6f / std::cbrt((float)n))); }
+
+static void drawNBody(NBodyGL& gl, const NBodySystem& sys, const uint8_t* touching, uint32_t picked, GLuint cubeVAO,
+                      const Camera& cam, const glm::vec3& lightPos) {
+    const size_t n = sys.size();
+    if (!gl.program || !n) return;
+    if (!gl.instanceVBO) glGenBuffers(1, &gl.instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, gl.instanceVBO);
+    const GLsizeiptr bytes = (GLsizeiptr)(n * 4 * sizeof(float));
+    if (bytes > gl.instanceBytes) {
+        trackedBufferData(GL_ARRAY_BUFFER, gl.instanceVBO, bytes, nullptr, GL_STREAM_DRAW);
+        gl.instanceBytes = bytes;
+    }
+    float* dst = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!dst) return;
+    const float invRefSpeed = 1.0f / std::sqrt(sys.params.G * sys.params.centralMass / kNBodyInnerR);
+    workerPool().parallelFor(n, 16384, [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; ++i) {
+            float* d = dst + 4 * i;
+            d[0] = sys.x[i]; d[1] = sys.y[i]; d[2] = sys.z[i];
+            d[3] = touching && touching[i] ? -1.0f
+                 : std::sqrt(sys.vx[i] * sys.vx[i] + sys.vy[i] * sys.vy[i] + sys.vz[i] * sys.vz[i]) * invRefSpeed;
+        }
+    });
+    if (picked < n) dst[4 * picked + 3] = -2.0f;
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    glUseProgram(gl.program);
+    glUniformMatrix4fv(glGetUniformLocation(gl.program, "viewProj"), 1, GL_FALSE, glm::value_ptr(cam.viewProj));
+    glUniform3fv(glGetUniformLocation(gl.program, "lightPos"), 1, glm::value_ptr(lightPos));
+    glUniform1f(glGetUniformLocation(gl.program, "scale"), nbodyCubeScale(n));
+    glBindVertexArray(cubeVAO);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glVertexAttribDivisor(4, 1);
+    glEnableVertexAttribArray(4);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)n);
+    gRenderStats.drawCalls++;
+    gRenderStats.triangles += 12L * (long)n;
+}
+
+// ---------------- Contact Detection ----------------
+// With --nbody the grid holds the satellites (bounding spheres of their cubes,
+// one radius of margin, so near passes count) and the sun queries it; otherwise
+// it holds every scene body, and pairs with an unlit body are planet contacts.
+// Scene body centres and radii as the arrays broadphase.h and bvh.h take, in the frame arena.
+struct BoundsSoA { float *x, *y, *z, *r; };
+
+static BoundsSoA boundsSoA(const ViewBounds* bounds, int count) {
+    BoundsSoA s{ frameArena().allocArray<float>(count), frameArena().allocArray<float>(count),
+                 frameArena().allocArray<float>(count), frameArena().allocArray<float>(count) };
+    for (int i = 0; i < count; ++i) { s.x[i] = bounds[i].center.x; s.y[i] = bounds[i].center.y; s.z[i] = bounds[i].center.z; s.r[i] = bounds[i].radius; }
+    return s;
+}
+
+// The sun: the first unlit body, as buildSceneObjects() picks the light.
+static uint32_t sceneLightBody(const SceneGL& gl) {
+    const SceneDesc& sd = *gl.scene;
+    for (size_t i = 0; i < sd.bodyCount; ++i)
+        if (gl.materials[sd.bodies[i].material].unlit) return (uint32_t)i;
+    return kBvhNone;
+}
+
+struct ContactState {
+    SpatialHashGrid grid;
+    std::vector<ContactPair> pairs;
+    std::vector<uint32_t> planet;     // satellites touching the sun
+    std::vector<uint8_t> touching;    // per satellite, for the tint
+    size_t planetContacts = 0;
+};
+
+static void findContacts(ContactState& cs, const SceneGL& gl, const BoundsSoA& soa, int objectCount, const NBodySystem* nbody) {
+    const SceneDesc& sd = *gl.scene;
+    WorkerPool& pool = workerPool();
+    cs.planet.clear();
+    if (nbody) {
+        const size_t n = nbody->size();
+        const float radius = 0.866f * nbodyCubeScale(n);
+        cs.grid.margin = radius;
+        cs.grid.build(pool, nbody->x.data(), nbody->y.data(), nbody->z.data(), nullptr, radius, n);
+        cs.grid.findPairs(pool, cs.pairs);
+        for (int i = 0; i < objectCount; ++i)
+            if (gl.materials[sd.bodies[i].material].unlit) cs.grid.querySphere(soa.x[i], soa.y[i], soa.z[i], soa.r[i], cs.planet);
+        cs.planetContacts = cs.planet.size();
+        cs.touching.resize(n);
+        pool.parallelFor(n, 65536, [&](size_t b, size_t e, unsigned) { memset(&cs.touching[b], 0, e - b); });
+        for (const ContactPair& p : cs.pairs) cs.touching[p.a] = cs.touching[p.b] = 1;
+        for (uint32_t i : cs.planet) cs.touching[i] = 1;
+        return;
+    }
+    cs.grid.margin = kSceneContactMargin;
+    cs.grid.build(pool, soa.x, soa.y, soa.z, soa.r, 0.0f, (size_t)objectCount);
+    cs.grid.findPairs(pool, cs.pairs);
+    cs.planetContacts = 0;
+    for (const ContactPair& p : cs.pairs)
+        if (gl.materials[sd.bodies[p.a].material].unlit || gl.materials[sd.bodies[p.b].material].unlit) cs.planetContacts++;
+}
+
+// ---------------- Pick Queries ----------------
+struct PickState {
+    InstanceBVH scene, satellites;
+    uint32_t picked = kBvhNone;       // scene body or satellite index
+    bool pickedSatellite = false;
+    double rayUs = 0.0;               // the click's ray cast
+    // Follow-up queries on the pick, redone every frame as it moves.
+    uint32_t nearest = kBvhNone;
+    float nearestDist = 0.0f;
+    bool sunBlocked = false;
+    double followUs = 0.0;
+};
+
+// Refit, or build when the object count changed or refits have worn the tree down.
+static void updateBvh(InstanceBVH& bvh, const float* x, const float* y, const float* z, const float* r, float uniformR, size_t n) {
+    if (bvh.size() != n || bvh.needsRebuild()) bvh.build(workerPool(), x, y, z, r, uniformR, n);
+    else bvh.refit(workerPool(), x, y, z, r, uniformR);
+}
+
+static void updatePicking(PickState& ps, const SceneGL& gl, const BoundsSoA& soa, int objectCount, const NBodySystem* nbody,
+                          const Camera& cam, GLFWwindow* window, int fbW, int fbH) {
+    using Clock = std::chrono::steady_clock;
+    updateBvh(ps.scene, soa.x, soa.y, soa.z, soa.r, 0.0f, (size_t)objectCount);
+    if (nbody) updateBvh(ps.satellites, nbody->x.data(), nbody->y.data(), nbody->z.data(), nullptr,
+                         0.866f * nbodyCubeScale(nbody->size()), nbody->size());
+    const uint32_t light = sceneLightBody(gl);
+
+    if (gPickPending) {
+        gPickPending = false;
+        // Cursor to a ray from the near plane (t = 0) to the far plane (t = 1).
+        int winW, winH;
+        glfwGetWindowSize(window, &winW, &winH);
+        float nx = 2.0f * (float)(gPickX * fbW / std::max(1, winW)) / fbW - 1.0f;
+        float ny = 1.0f - 2.0f * (float)(gPickY * fbH / std::max(1, winH)) / fbH;
+        glm::mat4 inv = glm::inverse(cam.viewProj);
+        glm::vec4 nearH = inv * glm::vec4(nx, ny, -1.0f, 1.0f), farH = inv * glm::vec4(nx, ny, 1.0f, 1.0f);
+        glm::vec3 o = glm::vec3(nearH) / nearH.w, d = glm::vec3(farH) / farH.w - o;
+        auto t0 = Clock::now();
+        BvhHit body = ps.scene.raycast(o.x, o.y, o.z, d.x, d.y, d.z, 1.0f);
+        BvhHit sat = nbody ? ps.satellites.raycast(o.x, o.y, o.z, d.x, d.y, d.z, body.t) : BvhHit();
+        ps.rayUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        ps.pickedSatellite = sat.object != kBvhNone;
+        ps.picked = ps.pickedSatellite ? sat.object : body.object;
+    }
+    if (ps.picked == kBvhNone) return;
+    if (ps.pickedSatellite ? (!nbody || ps.picked >= nbody->size()) : ps.picked >= (uint32_t)objectCount) { ps.picked = kBvhNone; return; }
+
+    auto t0 = Clock::now();
+    float px, py, pz;
+    if (ps.pickedSatellite) { px = nbody->x[ps.picked]; py = nbody->y[ps.picked]; pz = nbody->z[ps.picked]; }
+    else { px = soa.x[ps.picked]; py = soa.y[ps.picked]; pz = soa.z[ps.picked]; }
+    const InstanceBVH& own = ps.pickedSatellite ? ps.satellites : ps.scene;
+    BvhHit closest = own.nearest(px, py, pz, 1e30f, ps.picked);
+    ps.nearest = closest.object;
+    ps.nearestDist = closest.t;
+    ps.sunBlocked = false;
+    const bool pickedSun = !ps.pickedSatellite && ps.picked == light;
+    if (light != kBvhNone && !pickedSun) {
+        const float lx = soa.x[light], ly = soa.y[light], lz = soa.z[light];
+        ps.sunBlocked = ps.scene.occluded(px, py, pz, lx, ly, lz, light, ps.pickedSatellite ? kBvhNone : ps.picked) ||
+                        (nbody && ps.satellites.occluded(px, py, pz, lx, ly, lz, ps.pickedSatellite ? ps.picked : kBvhNone));
+    }
+    ps.followUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+// ---------------- Batch Rendering ----------------
+// Renders every job offscreen with the context and assets already warm. Reads
+// go through a pair of PBOs (one frame of latency) and files are written on
+// ImageWriter's thread, so the render loop only ever waits on a full queue.
+// With a --scene loaded (`fixedScene`) jobs only pick time, camera and size;
+// otherwise each job's layout keys build its own orbit scene.
+static int runBatch(const std::vector<SceneParams>& jobs, SceneGL& gl, const SceneDesc* fixedScene) {
+    OffscreenTarget target(textureInternalFormat());
+    PixelReadback readback;
+    ImageWriter writer;
+    auto toWriter = [&writer](ReadbackImage&& img) { writer.push(std::move(img)); };
+
+    const double start = glfwGetTime();
+    for (const SceneParams& job : jobs) {
+        frameArena().reset();
+        if (!target.bind(job.width, job.height)) { std::cerr << "No " << job.width << "x" << job.height << " framebuffer for " << job.output << "\n"; continue; }
+        glClearColor(0.05f, 0.05f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        SceneDesc jobScene;
+        if (!fixedScene) jobScene = makeOrbitScene(job);
+        gl.scene = fixedScene ? fixedScene : &jobScene;
+        const int objectCount = (int)gl.scene->bodyCount;
+        ViewInstance* inst = frameArena().allocArray<ViewInstance>(objectCount);
+        ViewBounds* bounds = frameArena().allocArray<ViewBounds>(objectCount);
+        glm::vec3 lightPos = buildSceneObjects(gl, job.time, inst, bounds);
+        Camera cam = Camera::orbit(job.yaw, job.pitch, job.camRadius, (float)job.width / job.height, (float)job.height);
+        cullViews(inst, bounds, objectCount, &cam, 1);
+        drawSceneView(gl, cam, lightPos, inst);
+
+        ReadbackImage img;
+        img.path = job.output;
+        img.w = job.width; img.h = job.height;
+        img.rgba = writer.recycledBuffer();
+        readback.read(std::move(img), toWriter);
+    }
+    readback.flush(toWriter);
+    writer.finish();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl.scene = nullptr;
+
+    double secs = glfwGetTime() - start;
+    std::cout << "Batch: " << writer.written() << "/" << jobs.size() << " images in " << secs << " s ("
+              << (secs > 0.0 ? writer.written() / secs : 0.0) << " images/s)\n";
+    // Counts what reached disk, so a dropped readback fails the batch too.
+    return writer.written() != (int)jobs.size() ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--no-tex-stream") gStreamTextures = false;
+        else if (a == "--srgb") gSRGBTextures = true;
+        else if (a == "--no-hud") gShowHud = false;
+        else if (a == "--upload-thread") gUploadThread = true;
+        else if (a == "--always-render") gIdleWait = false;
+        else if (a == "--fps" && i + 1 < argc) gTargetFps = atof(argv[++i]);
+        else if (a == "--views" && i + 1 < argc) gFollowViews = std::max(0, std::min(atoi(argv[++i]), kMaxViews - 1));
+        else if (a == "--batch" && i + 1 < argc) gBatchPath = argv[++i];
+        else if (a == "--scene" && i + 1 < argc) gScenePath = argv[++i];
+        else if (a == "--nbody" && i + 1 < argc) gNBodyCount = (size_t)std::max(0LL, atoll(argv[++i]));
+        else if (a == "--deterministic") gNBodyDeterministic = true;
+        else if (a == "--contacts") gContacts = true;
+        else if (a == "--no-pick") gPicking = false;
+        else if (a == "--particles" && i + 1 < argc)
+            gParticleCount = std::min((size_t)std::max(0LL, atoll(argv[++i])), ParticleSystem::kMaxCount);
+        else if (a == "--integrator" && i + 1 < argc) {
+            if (!nbodyParseIntegrator(argv[++i], gNBodyIntegrator)) std::cerr << "Unknown --integrator '" << argv[i] << "' (euler, leapfrog, rk4)\n";
+        }
+        else if (a == "--tex-budget" && i + 1 < argc) gTexBudgetBytes = (size_t)atof(argv[++i]) * (1u << 20);
+        else if (a == "--mem-report" && i + 1 < argc) gMemReportPath = argv[++i];
+        else if (a == "--mem-budget" && i + 1 < argc) {
+            if (!memParseBudgets(argv[++i])) std::cerr << "Bad --mem-budget '" << argv[i] << "' (e.g. textures=256,gpu_textures=512)\n";
+        }
+    }
+
+    std::vector<SceneParams> batchJobs;
+    if (!gBatchPath.empty()) {
+        std::string err;
+        if (!loadSceneJobs(gBatchPath, gScene, batchJobs, err)) { std::cerr << err << "\n"; return 1; }
+        gStreamTextures = false;   // every image needs the full texture, not whatever has streamed in so far
+    }
+
     if (!glfwInit()) return 1;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (gSRGBTextures) glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
+    if (!gBatchPath.empty()) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
     GLFWwindow* window = glfwCreateWindow(1000, 800, "Graphics Assignment 2025", nullptr, nullptr);
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    glfwSetWindowRefreshCallback(window, refreshCallback);
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    glfwSwapInterval(gTargetFps > 0.0 ? 0 : 1);
     glEnable(GL_DEPTH_TEST);
-
-    const float cubeVerts[] = {
-        -0.5f,-0.5f,-0.5f,  0,0,-1, 0,0,  0.5f,-0.5f,-0.5f,  0,0,-1, 1,0,  0.5f, 0.5f,-0.5f,  0,0,-1, 1,1,
-         0.5f, 0.5f,-0.5f,  0,0,-1, 1,1, -0.5f, 0.5f,-0.5f,  0,0,-1, 0,1, -0.5f,-0.5f,-0.5f,  0,0,-1, 0,0,
-        -0.5f,-0.5f, 0.5f,  0,0, 1, 0,0,  0.5f,-0.5f, 0.5f,  0,0, 1, 1,0,  0.5f, 0.5f, 0.5f,  0,0, 1, 1,1,
-         0.5f, 0.5f, 0.5f,  0,0, 1, 1,1, -0.5f, 0.5f, 0.5f,  0,0, 1, 0,1, -0.5f,-0.5f, 0.5f,  0,0, 1, 0,0,
-        -0.5f, 0.5f, 0.5f, -1,0,0, 1,0, -0.5f, 0.5f,-0.5f, -1,0,0, 1,1, -0.5f,-0.5f,-0.5f, -1,0,0, 0,1,
-        -0.5f,-0.5f,-0.5f, -1,0,0, 0,1, -0.5f,-0.5f, 0.5f, -1,0,0, 0,0, -0.5f, 0.5f, 0.5f, -1,0,0, 1,0,
-         0.5f, 0.5f, 0.5f,  1,0,0, 1,0,  0.5f, 0.5f,-0.5f,  1,0,0, 1,1,  0.5f,-0.5f,-0.5f,  1,0,0, 0,1,
-         0.5f,-0.5f,-0.5f,  1,0,0, 0,1,  0.5f,-0.5f, 0.5f,  1,0,0, 0,0,  0.5f, 0.5f, 0.5f,  1,0,0, 1,0,
-        -0.5f,-0.5f,-0.5f,  0,-1,0, 0,1,  0.5f,-0.5f,-0.5f,  0,-1,0, 1,1,  0.5f,-0.5f, 0.5f,  0,-1,0, 1,0,
-         0.5f,-0.5f, 0.5f,  0,-1,0, 1,0, -0.5f,-0.5f, 0.5f,  0,-1,0, 0,0, -0.5f,-0.5f,-0.5f,  0,-1,0, 0,1,
-        -0.5f, 0.5f,-0.5f,  0, 1,0, 0,1,  0.5f, 0.5f,-0.5f,  0, 1,0, 1,1,  0.5f, 0.5f, 0.5f,  0, 1,0, 1,0,
-         0.5f, 0.5f, 0.5f,  0, 1,0, 1,0, -0.5f, 0.5f, 0.5f,  0, 1,0, 0,0, -0.5f, 0.5f,-0.5f,  0, 1,0, 0,1
-    };
+    if (gSRGBTextures) glEnable(GL_FRAMEBUFFER_SRGB);
 
     GLuint cubeVAO, cubeVBO;
     glGenVertexArrays(1, &cubeVAO); glGenBuffers(1, &cubeVBO);
     glBindVertexArray(cubeVAO);
     glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVerts), cubeVerts, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    const std::vector<float> cubeVertices = appendTangents(std::vector<float>(kBuiltinCubeVertices, kBuiltinCubeVertices + 36 * 8));
+    trackedBufferData(GL_ARRAY_BUFFER, cubeVBO, cubeVertices.size() * sizeof(float), cubeVertices.data(), GL_STATIC_DRAW);
+    setupInterleavedAttribs(kMeshFloatsWithTangents);
+
+    // assets.pak (built by tools/assetc or tools/assetpack) replaces the loose files when present.
+    if (gPack.open(resolveAssetPath("assets.pak")))
+        std::cout << "Using assets.pak (" << gPack.count() << " entries)\n";
+
+    // Everything below the HUD loads in the background; until an asset's GL half
+    // has run the scene uses its placeholder (no mesh, grey texture, no program
+    // = object skipped), so the first frame doesn't wait on asset size.
+    const double loadStart = glfwGetTime();
+    std::unique_ptr<GLUploadThread> uploader;
+    if (gUploadThread) {
+        uploader = GLUploadThread::create(window);
+        if (!uploader) std::cerr << "No shared GL context; uploading on the render thread\n";
+    }
+    unsigned hw = std::thread::hardware_concurrency();
+    // Owned by pointer so every exit path can join its workers, then the upload
+    // thread (which destroys its hidden window), before glfwTerminate().
+    std::unique_ptr<AssetManager> assetManager(new AssetManager(hw > 1 ? hw - 1 : 1, kAssetUploadBytesPerFrame));
+    AssetManager& assets = *assetManager;
+    assets.setUploadThread(uploader.get());
+    const unsigned char grey[4] = { 128, 128, 128, 255 };
+    const GLuint greyTex = uploadTexture2D(grey, 1, 1);
+
+    // GLSL lives in assets/shaders so tools/assetc can validate it offline.
+    auto loadProgram = [&](const std::string& stem, bool geometry) {
+        return assets.submit<GLuint>(stem, 0,
+            [stem, geometry] { return loadProgramPayload(stem + ".vert", stem + ".frag", geometry ? stem + ".geom" : ""); },
+            [](const ProgramPayload& p) { return makeProgram(p.vs.c_str(), p.fs.c_str(), p.gs.empty() ? nullptr : p.gs.c_str()); });
+    };
+    AssetHandle<GLuint> cubeProgAsset = loadProgram("assets/shaders/cube", false);
+    AssetHandle<GLuint> planetProgAsset = loadProgram("assets/shaders/planet", false);
+    AssetHandle<GLuint> viewsProgAsset = loadProgram("assets/shaders/views", true);
+
+    SceneDesc sceneDesc;
+    if (!gScenePath.empty()) {
+        std::string err;
+        double t0 = glfwGetTime();
+        if (!loadScene(gScenePath, sceneDesc, err)) {
+            std::cerr << gScenePath << ": " << err << "\n";
+            assetManager.reset(); uploader.reset();
+            glfwTerminate(); return 1;
+        }
+        std::cout << gScenePath << ": " << sceneDesc.bodyCount << " bodies, " << sceneDesc.meshes.size() << " meshes, "
+                  << sceneDesc.materials.size() << " materials in " << (glfwGetTime() - t0) * 1000.0 << " ms\n";
+    } else if (gNBodyCount) {
+        SceneParams sun = gScene;   // just the sun, fixed at the origin where the simulation puts its mass
+        sun.numCubes = 0;
+        sun.planetOrbitR = 0.0f;
+        sceneDesc = makeOrbitScene(sun);
+    } else {
+        sceneDesc = makeOrbitScene(gScene);
+    }
+
+    std::unique_ptr<TextureStreamer> texStreamer;
+    if (gStreamTextures) {
+        MemTagScope tag(kMemTextures);
+        texStreamer.reset(new TextureStreamer(gTexBudgetBytes, kTexUploadBytesPerFrame,
+                                              hasGLExtension("GL_EXT_texture_compression_s3tc"), gSRGBTextures));
+    }
+    SceneAssets sceneAssets = submitSceneAssets(sceneDesc, assets, texStreamer.get(), greyTex);
+    SceneGL sceneGL;
 
-    MeshGL planetMesh;
-    createMeshFromOBJ("assets/objects/planet.obj", planetMesh);
-    GLuint cubeTex = loadTexture2D("assets/textures/container.jpg");
-
-    const char* cubeVS = R"(#version 330 core
-        layout (location = 0) in vec3 aPos; layout (location = 1) in vec3 aNormal; layout (location = 2) in vec2 aUV;
-        out vec3 FragPos; out vec3 Normal; out vec2 TexCoord;
-        uniform mat4 model, view, projection;
-        void main() {
-            FragPos = vec3(model * vec4(aPos, 1.0));
-            Normal = mat3(transpose(inverse(model))) * aNormal;
-            TexCoord = aUV;
-            gl_Position = projection * view * vec4(FragPos, 1.0);
-        })";
-
-    const char* cubeFS = R"(#version 330 core
-        out vec4 FragColor; in vec3 FragPos; in vec3 Normal; in vec2 TexCoord;
-        uniform sampler2D tex0; uniform vec3 lightPos;
-        void main() {
-            vec3 albedo = texture(tex0, TexCoord).rgb;
-            vec3 norm = normalize(Normal);
-            vec3 lightDir = normalize(lightPos - FragPos);
-            float diff = max(dot(norm, lightDir), 0.0);
-            FragColor = vec4((0.2 + diff) * albedo, 1.0);
-        })";
-
-    const char* planetVS = R"(#version 330 core
-        layout (location = 0) in vec3 aPos;
-        uniform mat4 model, view, projection;
-        void main() { gl_Position = projection * view * model * vec4(aPos, 1.0); })";
-
-    const char* planetFS = R"(#version 330 core
-        out vec4 FragColor;
-        void main() { FragColor = vec4(1.0, 0.9, 0.5, 1.0); })";
-
-    GLuint cubeProg = makeProgram(cubeVS, cubeFS);
-    GLuint planetProg = makeProgram(planetVS, planetFS);
+    if (!gBatchPath.empty()) {
+        while (!assets.progress().finished())
+            if (!assets.drainUploads()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::cout << "Batch: assets ready after " << (glfwGetTime() - loadStart) * 1000.0 << " ms, "
+                  << batchJobs.size() << " jobs\n";
+        refreshSceneGL(sceneGL, sceneDesc, sceneAssets, nullptr, cubeVAO, greyTex);
+        sceneGL.litProg = cubeProgAsset.get(); sceneGL.unlitProg = planetProgAsset.get();
+        int rc = runBatch(batchJobs, sceneGL, gScenePath.empty() ? nullptr : &sceneDesc);
+        if (!gMemReportPath.empty()) writeMemReport(gMemReportPath);
+        texStreamer.reset();
+        assetManager.reset(); uploader.reset();
+        glfwTerminate();
+        return rc;
+    }
+
+    NBodySystem nbody;
+    NBodyGL nbodyGL;
+    AssetHandle<GLuint> nbodyProgAsset;
+    float nbodyBacklog = 0.0f;   // sim time not yet stepped
+    ContactState contacts;
+    PickState picking;
+    if (gNBodyCount) {
+        MemTagScope tag(kMemScene);
+        nbody.params.integrator = gNBodyIntegrator;
+        nbody.params.deterministic = gNBodyDeterministic;
+        nbody.seedDisc(gNBodyCount, kNBodyInnerR, kNBodyOuterR, kNBodyDiscMass);
+        nbodyProgAsset = loadProgram("assets/shaders/nbody", false);
+    }
+    ParticleSystem particles;
+    AssetHandle<GLuint> particleUpdateAsset, particleDrawAsset;
+    if (gParticleCount) {
+        const std::string stem = "assets/shaders/particles_update";
+        particleUpdateAsset = assets.submit<GLuint>(stem, 0,
+            [stem] { return loadProgramPayload(stem + ".vert", stem + ".frag"); },
+            [](const ProgramPayload& p) { return makeProgram(p.vs.c_str(), p.fs.c_str(), nullptr, kParticleVaryings, 2); });
+        particleDrawAsset = loadProgram("assets/shaders/particles", false);
+    }
 
+    // The HUD is tiny and shows load progress, so it is the one thing built up front.
+    Hud hud;
+    hud.init(makeProgram(loadTextAsset("assets/shaders/hud.vert").c_str(), loadTextAsset("assets/shaders/hud.frag").c_str()));
+    bool firstFrame = true, allLoaded = false;
+    LayeredViews layeredViews;
+
+    FramePacer pacer(gTargetFps);
+    float lastTime = (float)glfwGetTime();
+    MemTagScope sceneTag(kMemScene);
     while (!glfwWindowShouldClose(window)) {
-        static float lastTime = 0.0f;
+        bool busy = !gPaused || cameraMoving() || gRedraw || !assets.progress().finished() ||
+                    (texStreamer && texStreamer->stats().pendingLevels > 0);
+        if (gIdleWait && !busy) {
+            glfwWaitEventsTimeout(kIdleWaitSeconds);
+            lastTime = (float)glfwGetTime();   // time spent idle isn't frame time
+            pacer.reset();
+            continue;
+        }
         float currTime = (float)glfwGetTime();
         float dt = currTime - lastTime; lastTime = currTime;
-        processInput(window, dt);
+        frameArena().reset();
+        AllocCounts frameStart = allocCounts();
+        updateCamera(dt);
         if (!gPaused) gSimTime += dt;
+        if (gNBodyCount && !gPaused) {
+            nbodyBacklog += dt;
+            int steps = 0;
+            for (; nbodyBacklog >= kNBodyStep && steps < kNBodyMaxStepsPerFrame; ++steps) {
+                nbody.step(kNBodyStep, workerPool());
+                nbodyBacklog -= kNBodyStep;
+            }
+            if (steps == kNBodyMaxStepsPerFrame) nbodyBacklog = std::min(nbodyBacklog, kNBodyStep);
+        }
+        hud.recordFrame(dt * 1000.0f);
+        hud.setEnabled(gShowHud);
+        gRenderStats = RenderStats();
+        assets.drainUploads();
+        AssetLoadProgress loading = assets.progress();
+        if (!allLoaded && loading.finished()) {
+            allLoaded = true;
+            std::cout << "All " << loading.total << " assets ready after " << (glfwGetTime() - loadStart) * 1000.0 << " ms"
+                      << (loading.failed ? " (some failed)" : "") << "\n";
+        }
+        if (texStreamer) texStreamer->update(frameResource());
+        refreshSceneGL(sceneGL, sceneDesc, sceneAssets, texStreamer.get(), cubeVAO, greyTex);
+        sceneGL.litProg = cubeProgAsset.get(); sceneGL.unlitProg = planetProgAsset.get();
 
         glClearColor(0.05f, 0.05f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        int fbW, fbH;
+        glfwGetFramebufferSize(window, &fbW, &fbH);
+        if (fbW <= 0 || fbH <= 0) { fbW = 1000; fbH = 800; }
+
+        // Per-object work, once per frame: transforms and bounds for every object.
+        const int objectCount = (int)sceneDesc.bodyCount;
+        ViewInstance* inst = frameArena().allocArray<ViewInstance>(objectCount);
+        ViewBounds* bounds = frameArena().allocArray<ViewBounds>(objectCount);
+        glm::vec3 lightPos = buildSceneObjects(sceneGL, gSimTime, inst, bounds);
+
+        // Camera array: the orbit camera, then one follow-cam per shown body (after the first).
+        bool thumbnails = gFollowViews > 0 && viewsProgAsset.ready() &&
+                          (layeredViews.ready() || layeredViews.init(viewsProgAsset.get(), kThumbW, kThumbH, textureInternalFormat()));
+        const int viewCount = 1 + (thumbnails ? std::min(gFollowViews, objectCount - 1) : 0);
+        Camera cams[kMaxViews];
+        cams[0] = Camera::orbit(gYaw, gPitch, gCamRadius, (float)fbW / fbH, (float)fbH);
+        for (int v = 1; v < viewCount; ++v) {
+            uint32_t parent = sceneDesc.bodies[v].parent;
+            glm::vec3 center = parent == kSceneNoParent ? glm::vec3(0.0f) : bounds[parent].center;
+            cams[v] = Camera::follow(bounds[v].center, center, (float)kThumbW / kThumbH, (float)kThumbH);
+        }
+        gRenderStats.viewVisible = cullViews(inst, bounds, objectCount, cams, viewCount);
+        const Camera& cam = cams[0];
+
+        // Texture LOD is shared too: one request per visible body, at the largest size any view shows it.
+        if (texStreamer) {
+            for (int i = 0; i < objectCount; ++i) {
+                int texId = sceneAssets.streamed[sceneDesc.bodies[i].material];
+                if (texId < 0) continue;
+                for (int v = 0; v < viewCount; ++v) {
+                    if (!(inst[i].viewMask & (1u << v))) continue;
+                    float dist = std::max(0.1f, glm::length(bounds[i].center - cams[v].pos));
+                    texStreamer->requestCoverage(texId, 2.0f * bounds[i].radius * cams[v].pixelsPerUnitAtOne / dist);
+                }
+            }
+        }
+
+        // Spatial queries over this frame's positions: contacts, then picking.
+        if (gContacts || gPicking) {
+            BoundsSoA soa = boundsSoA(bounds, objectCount);
+            if (gContacts) findContacts(contacts, sceneGL, soa, objectCount, gNBodyCount ? &nbody : nullptr);
+            if (gPicking) updatePicking(picking, sceneGL, soa, objectCount, gNBodyCount ? &nbody : nullptr, cam, window, fbW, fbH);
+        }
+
+        drawSceneView(sceneGL, cam, lightPos, inst);
+        if (gNBodyCount) {
+            nbodyGL.program = nbodyProgAsset.get();
+            drawNBody(nbodyGL, nbody, gContacts ? contacts.touching.data() : nullptr,
+                      gPicking && picking.pickedSatellite ? picking.picked : kBvhNone, cubeVAO, cam, lightPos);
+        }
+        if (gParticleCount && !particles.ready() && particleUpdateAsset.ready() && particleDrawAsset.ready())
+            particles.init(particleUpdateAsset.get(), particleDrawAsset.get(), gParticleCount);
+        const uint32_t sun = particles.ready() ? sceneLightBody(sceneGL) : kBvhNone;
+        if (sun < (uint32_t)objectCount) {
+            particles.update(gPaused ? 0.0f : dt, bounds[sun].radius);
+            particles.draw(cam.viewProj, bounds[sun].center, cam.pixelsPerUnitAtOne, bounds[sun].radius);
+        }
+
+        // Every thumbnail in one layered pass: one instanced draw per mesh, whatever the view count.
+        if (viewCount > 1) {
+            int rects[kMaxViews - 1][4];
+            const int gap = 8;
+            int tw = std::max(16, std::min(kThumbW, (fbW - gap) / (viewCount - 1) - gap));
+            int th = tw * kThumbH / kThumbW;
+            for (int v = 1; v < viewCount; ++v) {
+                int* r = rects[v - 1];
+                r[0] = fbW - v * (tw + gap); r[1] = gap; r[2] = tw; r[3] = th;
+            }
+            layeredViews.begin(inst, objectCount, cams, viewCount);
+            GLuint viewsProg = layeredViews.program();
+            glUniform3fv(glGetUniformLocation(viewsProg, "lightPos"), 1, glm::value_ptr(lightPos));
+            glUniform1i(glGetUniformLocation(viewsProg, "tex0"), 0);
+            glActiveTexture(GL_TEXTURE0);
+            GLint flatColorLoc = glGetUniformLocation(viewsProg, "flatColor");
+            // One instanced draw per run of bodies sharing mesh and material.
+            for (int first = 0; first < objectCount;) {
+                const SceneBody& b = sceneDesc.bodies[first];
+                int end = first + 1;
+                while (end < objectCount && sceneDesc.bodies[end].mesh == b.mesh && sceneDesc.bodies[end].material == b.material) ++end;
+                const SceneMeshGL& mesh = sceneGL.meshes[b.mesh];
+                const SceneMaterialGL& mat = sceneGL.materials[b.material];
+                if (mesh.VAO) {
+                    if (mat.unlit) glUniform4f(flatColorLoc, mat.color.x, mat.color.y, mat.color.z, 1.0f);
+                    else { glUniform4f(flatColorLoc, 0.0f, 0.0f, 0.0f, 0.0f); glBindTexture(GL_TEXTURE_2D, mat.tex); }
+                    layeredViews.draw(mesh.VAO, mesh.vertexCount, mesh.indexCount, mesh.indexType, first, end - first);
+                    gRenderStats.drawCalls++;
+                }
+                first = end;
+            }
+            layeredViews.end(fbW, fbH, rects, viewCount - 1);
+        }
 
-        glm::vec3 planetPos(cos(gSimTime * kPlanetOrbitW) * kPlanetOrbitR, 0, sin(gSimTime * kPlanetOrbitW) * kPlanetOrbitR);
-        glm::vec3 camPos(gCamRadius * cos(gPitch) * sin(gYaw), gCamRadius * sin(gPitch), gCamRadius * cos(gPitch) * cos(gYaw));
-        glm::mat4 view = glm::lookAt(camPos, glm::vec3(0,0,0), glm::vec3(0,1,0));
-        glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1000.0f/800.0f, 0.1f, 100.0f);
-
-        glUseProgram(planetProg);
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), planetPos);
-        model = glm::scale(model, glm::vec3(kPlanetScale));
-        glUniformMatrix4fv(glGetUniformLocation(planetProg, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(glGetUniformLocation(planetProg, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(planetProg, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
-        glBindVertexArray(planetMesh.VAO); glDrawArrays(GL_TRIANGLES, 0, planetMesh.vertexCount);
-
-        glUseProgram(cubeProg);
-        glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, cubeTex);
-        glUniform3fv(glGetUniformLocation(cubeProg, "lightPos"), 1, glm::value_ptr(planetPos));
-        glUniformMatrix4fv(glGetUniformLocation(cubeProg, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(cubeProg, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
-
-        glBindVertexArray(cubeVAO);
-        for(int i=0; i<kNumCubes; ++i) {
-            float off = (2.0f * 3.14159f * i) / kNumCubes;
-            glm::vec3 cPos = planetPos + glm::vec3(cos(gSimTime * kCubeOrbitW + off) * kCubeOrbitR, sin(off)*0.5f, sin(gSimTime * kCubeOrbitW + off) * kCubeOrbitR);
-            model = glm::translate(glm::mat4(1.0f), cPos);
-            model = glm::rotate(model, gSimTime * (1.0f + i * 0.5f), glm::vec3(0.5, 1, 0));
-            model = glm::scale(model, glm::vec3(kCubeScale));
-            glUniformMatrix4fv(glGetUniformLocation(cubeProg, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        if (hud.enabled()) {
+            hud.begin(fbW, fbH);
+            char line[128];
+            const uint32_t white = hudColor(235, 235, 235), dim = hudColor(160, 170, 190);
+            float avgMs = hud.averageFrameMs();
+            snprintf(line, sizeof(line), "FPS %.0f  %.2f MS", avgMs > 0.0f ? 1000.0f / avgMs : 0.0f, avgMs);
+            hud.text(10, 10, line, white);
+            hud.frameGraph(10, 30, 240, 50, 1000.0f / 20.0f);
+            snprintf(line, sizeof(line), "DRAWS %d  TRIS %ld  CULLED %d/%d", gRenderStats.drawCalls, gRenderStats.triangles,
+                     gRenderStats.culled, gRenderStats.culled + gRenderStats.visible);
+            hud.text(10, 88, line, white);
+            if (viewCount > 1) {
+                snprintf(line, sizeof(line), "VIEWS %d  VISIBLE %d/%d  (V TOGGLES)", viewCount, gRenderStats.viewVisible, objectCount * viewCount);
+                hud.text(10, 106, line, white);
+            }
+            snprintf(line, sizeof(line), "MEM CPU %.1f MB  GPU %.1f MB", memCpuCurrent() / 1048576.0, memGpuCurrent() / 1048576.0);
+            float y = viewCount > 1 ? 124 : 106;
+            hud.text(10, y, line, white);
+            y += 18;
+            if (gNBodyCount) {
+                const NBodyStats& ns = nbody.stats();
+                snprintf(line, sizeof(line), "NBODY %zu %s%s  TREE %.1f MS  FORCE %.1f MS  STEP %.1f MS", nbody.size(),
+                         nbodyIntegratorName(nbody.params.integrator), nbody.params.deterministic ? " DET" : "",
+                         ns.sortMs + ns.buildMs, ns.forceMs, ns.sortMs + ns.buildMs + ns.forceMs + ns.integrateMs);
+                hud.text(10, y, line, white);
+                y += 18;
+            }
+            if (gContacts) {
+                const BroadphaseStats& bs = contacts.grid.stats();
+                snprintf(line, sizeof(line), "CONTACTS %zu  PLANET %zu  GRID %.1f MS  PAIRS %.1f MS  (C TOGGLES)",
+                         contacts.pairs.size(), contacts.planetContacts, bs.buildMs, bs.pairsMs);
+                hud.text(10, y, line, white);
+                y += 18;
+            }
+            if (gPicking) {
+                const BvhStats& bs = gNBodyCount ? picking.satellites.stats() : picking.scene.stats();
+                if (picking.picked == kBvhNone)
+                    snprintf(line, sizeof(line), "BVH REFIT %.2f MS  BUILD %.1f MS  (CLICK PICKS)", bs.refitMs, bs.buildMs);
+                else {
+                    char nearest[32] = "NONE";
+                    if (picking.nearest != kBvhNone) snprintf(nearest, sizeof(nearest), "%.3f", picking.nearestDist);
+                    snprintf(line, sizeof(line), "PICK %s %u  NEAREST %s  %s  RAY %.1f US  QUERIES %.1f US",
+                             picking.pickedSatellite ? "SAT" : "BODY", picking.picked, nearest,
+                             picking.sunBlocked ? "IN SHADOW" : "SUNLIT", picking.rayUs, picking.followUs);
+                }
+                hud.text(10, y, line, white);
+                y += 18;
+            }
+            if (particles.ready()) {
+                const ParticleStats& ps = particles.stats();
+                snprintf(line, sizeof(line), "PARTICLES %zu  UPDATE %.2f MS  DRAW %.2f MS  %.1f MB", ps.count, ps.updateMs,
+                         ps.drawMs, ps.bytes / 1048576.0);
+                hud.text(10, y, line, white);
+                y += 18;
+            }
+            if (texStreamer) {
+                const TextureStreamStats& st = texStreamer->stats();
+                snprintf(line, sizeof(line), "TEX %.2f/%.0f MB  PENDING %d", st.residentBytes / 1048576.0, st.budgetBytes / 1048576.0, st.pendingLevels);
+                hud.text(10, y, line, white);
+                y += 18;
+            }
+            if (!loading.finished()) {
+                snprintf(line, sizeof(line), "LOADING %d/%d", loading.done, loading.total);
+                hud.text(10, y, line, hudColor(255, 210, 90));
+                hud.rect(10, y + 18, 240, 6, hudColor(0, 0, 0, 140));
+                hud.rect(10, y + 18, 240.0f * loading.done / std::max(1, loading.total), 6, hudColor(255, 210, 90));
+                y += 30;
+            }
+            snprintf(line, sizeof(line), "HUD CPU %.3f MS  GPU %.3f MS  (H HIDES)", hud.cpuMs(), hud.gpuMs());
+            hud.text(10, y, line, dim);
+            hud.draw();
+        }
+        glfwSwapBuffers(window);
+        gRedraw = false;
+        pacer.wait();
+        glfwPollEvents();
+        if (firstFrame) {
+            firstFrame = false;
+            std::cout << "First frame after " << (glfwGetTime() - loadStart) * 1000.0 << " ms\n";
+        }
+
+        static float lastReport = 0.0f;
+        if (kTrackAllocs && currTime - lastReport > 1.0f) {
+            AllocCounts d = allocCounts() - frameStart;
+            std::cout << "frame: " << d.count << " heap allocs, " << frameArena().bytesUsed() << " B frame arena\n";
+        }
+        int overBudget = memCheckBudgets();
+        if (currTime - lastReport > 1.0f) {
+            lastReport = currTime;
+            char title[256];
+            int len = snprintf(title, sizeof(title), "Graphics Assignment 2025 | mem cpu %.1f MB gpu %.1f MB%s",
+                               memCpuCurrent() / 1048576.0, memGpuCurrent() / 1048576.0, overBudget ? " OVER BUDGET" : "");
+            if (texStreamer) {
+                const TextureStreamStats& st = texStreamer->stats();
+                snprintf(title + len, sizeof(title) - len, " | tex %.2f/%.0f MB resident, %d pending, stream %.1f ms avg %.1f ms max",
+                         st.residentBytes / 1048576.0, st.budgetBytes / 1048576.0, st.pendingLevels, st.avgLatencyMs, st.maxLatencyMs);
+            }
+            glfwSetWindowTitle(window, title);
         }
-        glfwSwapBuffers(window); glfwPollEvents();
     }
+    if (!gMemReportPath.empty()) writeMemReport(gMemReportPath);
+    hud.shutdown();
+    layeredViews.shutdown();
+    particles.shutdown();
+    if (nbodyGL.instanceVBO) trackedDeleteBuffers(1, &nbodyGL.instanceVBO);
+    texStreamer.reset();
+    assetManager.reset(); uploader.reset();
+    StagingPoolStats pool = stagingPool().stats();
+    std::cout << "staging pool: " << pool.allocs << " allocs, " << pool.hits << " reused, "
+              << pool.misses << " from malloc, peak " << pool.peakLiveBytes / 1024 << " KB\n";
     glfwTerminate(); return 0;
 }
\ No newline at end of file
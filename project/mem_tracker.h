@@ -0,0 +1,119 @@
+#pragma once
+// ---------------- Memory Tracking ----------------
+// Current/peak bytes per category, for CPU and GPU memory.
+//   CPU: allocators we own report directly (staging pool, arenas, the mmap'd
+//        pack). With -DTRACK_ALLOCS every operator new is also attributed to
+//        the calling thread's MemTagScope (see alloc_counter.h).
+//   GPU: glBufferData / glTexImage2D / glGenerateMipmap go through gl_memory.h.
+// Budgets are checked by memCheckBudgets() on the render thread, which prints a
+// warning whenever a category crosses its budget (once per crossing).
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+
+enum MemCategory {
+    kMemOther = 0,      // untagged CPU heap
+    kMemLoader,         // asset pack, parse scratch, mesh data
+    kMemTextures,       // decode staging, streamer copies
+    kMemScene,          // per-frame and scene state
+    kMemGpuBuffers,
+    kMemGpuTextures,
+    kMemCategoryCount
+};
+
+inline const char* memCategoryName(int c) {
+    static const char* names[kMemCategoryCount] = { "other", "loader", "textures", "scene", "gpu_buffers", "gpu_textures" };
+    return (c >= 0 && c < kMemCategoryCount) ? names[c] : "?";
+}
+
+struct MemTracker {
+    std::atomic<int64_t> current[kMemCategoryCount] = {};
+    std::atomic<int64_t> peak[kMemCategoryCount] = {};
+    std::atomic<int64_t> budget[kMemCategoryCount] = {};   // 0 = none
+    bool overBudget[kMemCategoryCount] = {};                // render thread only
+
+    void add(int c, int64_t bytes) {
+        int64_t now = current[c].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        int64_t p = peak[c].load(std::memory_order_relaxed);
+        while (now > p && !peak[c].compare_exchange_weak(p, now, std::memory_order_relaxed)) {}
+    }
+    void sub(int c, int64_t bytes) { current[c].fetch_sub(bytes, std::memory_order_relaxed); }
+};
+
+// Constant-initialized, so it is safe to use from operator new during static init.
+inline MemTracker& memTracker() { static MemTracker t; return t; }
+inline void memTrackAlloc(int c, size_t bytes) { memTracker().add(c, (int64_t)bytes); }
+inline void memTrackFree(int c, size_t bytes) { memTracker().sub(c, (int64_t)bytes); }
+inline int64_t memCurrent(int c) { return memTracker().current[c].load(std::memory_order_relaxed); }
+inline int64_t memPeak(int c) { return memTracker().peak[c].load(std::memory_order_relaxed); }
+inline void memSetBudget(int c, size_t bytes) { memTracker().budget[c].store((int64_t)bytes); }
+
+inline int64_t memCpuCurrent() { int64_t n = 0; for (int c = 0; c < kMemGpuBuffers; ++c) n += memCurrent(c); return n; }
+inline int64_t memGpuCurrent() { return memCurrent(kMemGpuBuffers) + memCurrent(kMemGpuTextures); }
+
+// Heap allocations on this thread are charged to `tag` while a scope is alive.
+inline int& memCurrentTag() { static thread_local int tag = kMemOther; return tag; }
+
+class MemTagScope {
+public:
+    explicit MemTagScope(int tag) : prev_(memCurrentTag()) { memCurrentTag() = tag; }
+    ~MemTagScope() { memCurrentTag() = prev_; }
+    MemTagScope(const MemTagScope&) = delete;
+    MemTagScope& operator=(const MemTagScope&) = delete;
+private:
+    int prev_;
+};
+
+// Returns the number of categories currently over budget.
+inline int memCheckBudgets() {
+    MemTracker& t = memTracker();
+    int over = 0;
+    for (int c = 0; c < kMemCategoryCount; ++c) {
+        int64_t budget = t.budget[c].load(std::memory_order_relaxed);
+        bool isOver = budget > 0 && t.current[c].load(std::memory_order_relaxed) > budget;
+        if (isOver && !t.overBudget[c])
+            std::fprintf(stderr, "warning: %s memory %.1f MB over its %.1f MB budget\n", memCategoryName(c),
+                         memCurrent(c) / 1048576.0, budget / 1048576.0);
+        t.overBudget[c] = isOver;
+        over += isOver;
+    }
+    return over;
+}
+
+// Parses "--mem-budget" values like "textures=256,gpu_textures=512" (MB).
+inline bool memParseBudgets(const char* spec) {
+    const char* s = spec;
+    while (*s) {
+        const char* eq = s;
+        while (*eq && *eq != '=') ++eq;
+        if (!*eq) return false;
+        int cat = -1;
+        for (int c = 0; c < kMemCategoryCount; ++c) {
+            const char* n = memCategoryName(c);
+            size_t len = (size_t)(eq - s);
+            if (std::strlen(n) == len && std::strncmp(n, s, len) == 0) cat = c;
+        }
+        if (cat < 0) return false;
+        char* end;
+        double mb = std::strtod(eq + 1, &end);
+        if (end == eq + 1) return false;
+        memSetBudget(cat, (size_t)(mb * 1048576.0));
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return true;
+}
+
+inline void memWriteJSON(std::ostream& os) {
+    MemTracker& t = memTracker();
+    os << "{\n  \"categories\": {\n";
+    for (int c = 0; c < kMemCategoryCount; ++c) {
+        os << "    \"" << memCategoryName(c) << "\": { \"current\": " << t.current[c].load()
+           << ", \"peak\": " << t.peak[c].load() << ", \"budget\": " << t.budget[c].load() << " }"
+           << (c + 1 < kMemCategoryCount ? ",\n" : "\n");
+    }
+    os << "  },\n  \"cpu_current\": " << memCpuCurrent() << ",\n  \"gpu_current\": " << memGpuCurrent() << "\n}\n";
+}
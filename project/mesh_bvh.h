@@ -0,0 +1,480 @@
+#pragma once
+// ---------------- Mesh BVH ----------------
+// Triangle BVH for CPU ray tracing (see path_tracer.h), 4-wide.
+//   build()  binned SAH over the triangles' boxes, top down, into a binary
+//            tree: the same scheme as InstanceBVH (bvh.h), with the top built
+//            serially and the subtrees below on the pool. The binary tree is
+//            then collapsed into 4-wide nodes by repeatedly opening the
+//            largest inner child until a node has four children.
+// A node stores its children's boxes as SoA, so one SSE slab test checks all
+// four; a leaf is a single Tri4 pack of up to four triangles (first vertex and
+// two edges, SoA) intersected together with Moller-Trumbore. Single rays go
+// through the wide nodes, which keeps the SIMD lanes full for incoherent
+// bounce rays as well as camera rays. Queries don't allocate and may run from
+// any number of threads at once.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "worker_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MESH_BVH_SSE 1
+#else
+#define MESH_BVH_SSE 0
+#endif
+
+static const uint32_t kMeshNone = 0xffffffffu;
+
+struct MeshHit {
+    uint32_t tri = kMeshNone;   // index into build()'s triangles; kMeshNone: no hit
+    float t = 0.0f, u = 0.0f, v = 0.0f;   // distance in units of dir, barycentrics of vertices 1 and 2
+};
+
+struct MeshBvhStats {
+    double buildMs = 0.0;
+    size_t triangles = 0, nodes = 0, leaves = 0;   // nodes and leaves of the 4-wide tree
+    int depth = 0;                                  // of the binary tree
+    float sahCost = 0.0f;                           // of the binary tree, relative to the root's area
+};
+
+class MeshBVH {
+public:
+    // `tris` holds 9 floats per triangle: three xyz vertices.
+    void build(WorkerPool& pool, const float* tris, size_t n) {
+        auto t0 = Clock::now();
+        prims_.resize(n);
+        pool.parallelFor(n, 16384, [&](size_t b, size_t e, unsigned) {
+            for (size_t i = b; i < e; ++i) {
+                const float* v = tris + 9 * i;
+                Prim& p = prims_[i];
+                for (int a = 0; a < 3; ++a) {
+                    p.lo[a] = std::min(v[a], std::min(v[3 + a], v[6 + a]));
+                    p.hi[a] = std::max(v[a], std::max(v[3 + a], v[6 + a]));
+                }
+                p.id = (uint32_t)i;
+                p.pad = 0.0f;
+            }
+        });
+        nodes_.clear();
+        tasks_.clear();
+        nodes_.push_back(Node2());
+        int depth = 0;
+        if (n) {
+            const size_t taskSize = pool.size() > 1 ? std::max<size_t>(4096, n / (pool.size() * 8)) : n + 1;
+            buildNode(nodes_, 0, 0, (uint32_t)n, 0, taskSize, depth);
+            if (taskNodes_.size() < tasks_.size()) taskNodes_.resize(tasks_.size());
+            std::vector<int> taskDepth(tasks_.size(), 0);
+            pool.parallelFor(tasks_.size(), 1, [&](size_t b, size_t e, unsigned) {
+                for (size_t t = b; t < e; ++t) {
+                    std::vector<Node2>& sub = taskNodes_[t];
+                    sub.assign(1, Node2());
+                    buildNode(sub, 0, tasks_[t].begin, tasks_[t].end, tasks_[t].depth, 0, taskDepth[t]);
+                }
+            });
+            for (size_t t = 0; t < tasks_.size(); ++t) {
+                const std::vector<Node2>& sub = taskNodes_[t];
+                const uint32_t base = (uint32_t)nodes_.size() - 1;
+                for (size_t k = 0; k < sub.size(); ++k) {
+                    Node2 nd = sub[k];
+                    if (!nd.count) nd.first += base;
+                    if (k == 0) nodes_[tasks_[t].node] = nd;
+                    else nodes_.push_back(nd);
+                }
+                depth = std::max(depth, taskDepth[t]);
+            }
+        }
+        stats_.sahCost = binarySahCost();
+        collapse(tris);
+        stats_.triangles = n;
+        stats_.depth = depth;
+        stats_.nodes = wide_.size();
+        stats_.leaves = packs_.size();
+        stats_.buildMs = ms(t0, Clock::now());
+    }
+
+    size_t size() const { return prims_.size(); }
+
+    // Closest triangle hit by origin + t * dir with 0 < t < tMax; both sides count.
+    MeshHit intersect(const float o[3], const float d[3], float tMax = 1e30f) const {
+        MeshHit hit;
+        hit.t = tMax;
+        traverse(o, d, hit, false);
+        return hit;
+    }
+
+    // Whether any triangle lies on the ray with 0 < t < tMax (shadow rays).
+    bool occluded(const float o[3], const float d[3], float tMax) const {
+        MeshHit hit;
+        hit.t = tMax;
+        return traverse(o, d, hit, true);
+    }
+
+    const MeshBvhStats& stats() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static double ms(Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); }
+
+    // Binary build tree, as in bvh.h.
+    struct Node2 {
+        float lo[3]; uint32_t first;   // leaf: first primitive slot; inner: left child, right child at first + 1
+        float hi[3]; uint32_t count;   // primitives in a leaf, 0 for an inner node
+    };
+    struct alignas(16) Prim { float lo[3]; uint32_t id; float hi[3]; float pad; };
+    struct Task { uint32_t node, begin, end; int depth; };
+
+    // 4-wide traversal tree. child[k] is a node index, or kLeaf | pack index.
+    struct alignas(16) Node4 {
+        float lox[4], loy[4], loz[4], hix[4], hiy[4], hiz[4];
+        uint32_t child[4];
+        uint32_t count, pad[3];        // children in use, packed first
+    };
+    struct alignas(16) Tri4 {
+        float v0x[4], v0y[4], v0z[4], e1x[4], e1y[4], e1z[4], e2x[4], e2y[4], e2z[4];
+        uint32_t id[4];                // kMeshNone in unused lanes (zero edges, never hit)
+    };
+
+    static const uint32_t kLeaf = 0x80000000u;
+    static const int kBins = 16, kMaxLeaf = 4;
+    // Past kMaxDepth ranges are only halved, so the binary tree stays under kMaxDepth + 32
+    // levels; each wide level leaves at most three siblings on the stack.
+    static const int kMaxDepth = 60, kStackSize = 3 * (kMaxDepth + 32) + 4;
+    static constexpr float kTraversalCost = 1.0f;   // relative to one triangle test
+
+    static float area(const float lo[3], const float hi[3]) {
+        float dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+        return dx < 0.0f ? 0.0f : 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+
+    struct alignas(16) Bin { float lo[4], hi[4]; uint32_t count; };
+
+    // Box around [begin, end) and the box around their centres.
+    void primBounds(uint32_t begin, uint32_t end, float lo[3], float hi[3], float clo[3], float chi[3]) const {
+#if MESH_BVH_SSE
+        __m128 vlo = _mm_set1_ps(1e30f), vhi = _mm_set1_ps(-1e30f), vclo = vlo, vchi = vhi;
+        const __m128 half = _mm_set1_ps(0.5f);
+        for (uint32_t s = begin; s < end; ++s) {
+            const __m128 plo = _mm_load_ps(prims_[s].lo), phi = _mm_load_ps(prims_[s].hi);   // lane 3 is ignored
+            const __m128 c = _mm_mul_ps(_mm_add_ps(plo, phi), half);
+            vlo = _mm_min_ps(vlo, plo); vhi = _mm_max_ps(vhi, phi);
+            vclo = _mm_min_ps(vclo, c); vchi = _mm_max_ps(vchi, c);
+        }
+        alignas(16) float out[4][4];
+        _mm_store_ps(out[0], vlo); _mm_store_ps(out[1], vhi); _mm_store_ps(out[2], vclo); _mm_store_ps(out[3], vchi);
+        for (int a = 0; a < 3; ++a) { lo[a] = out[0][a]; hi[a] = out[1][a]; clo[a] = out[2][a]; chi[a] = out[3][a]; }
+#else
+        for (int a = 0; a < 3; ++a) { lo[a] = clo[a] = 1e30f; hi[a] = chi[a] = -1e30f; }
+        for (uint32_t s = begin; s < end; ++s) {
+            const Prim& p = prims_[s];
+            for (int a = 0; a < 3; ++a) {
+                const float c = (p.lo[a] + p.hi[a]) * 0.5f;
+                lo[a] = std::min(lo[a], p.lo[a]); hi[a] = std::max(hi[a], p.hi[a]);
+                clo[a] = std::min(clo[a], c); chi[a] = std::max(chi[a], c);
+            }
+        }
+#endif
+    }
+
+    static int binOf(const Prim& p, int axis, const float clo[3], const float scale[3]) {
+        return std::min(kBins - 1, (int)(((p.lo[axis] + p.hi[axis]) * 0.5f - clo[axis]) * scale[axis]));
+    }
+
+    // Counts and boxes of [begin, end) binned by centre along all three axes in one pass.
+    void binPrims(uint32_t begin, uint32_t end, const float clo[3], const float scale[3], Bin bins[3][kBins]) const {
+        for (int a = 0; a < 3; ++a)
+            for (int b = 0; b < kBins; ++b) {
+                Bin& bin = bins[a][b];
+                for (int k = 0; k < 4; ++k) { bin.lo[k] = 1e30f; bin.hi[k] = -1e30f; }
+                bin.count = 0;
+            }
+        for (uint32_t s = begin; s < end; ++s) {
+            const Prim& p = prims_[s];
+#if MESH_BVH_SSE
+            const __m128 plo = _mm_load_ps(p.lo), phi = _mm_load_ps(p.hi);
+            for (int a = 0; a < 3; ++a) {
+                Bin& bin = bins[a][binOf(p, a, clo, scale)];
+                _mm_store_ps(bin.lo, _mm_min_ps(_mm_load_ps(bin.lo), plo));
+                _mm_store_ps(bin.hi, _mm_max_ps(_mm_load_ps(bin.hi), phi));
+                bin.count++;
+            }
+#else
+            for (int a = 0; a < 3; ++a) {
+                Bin& bin = bins[a][binOf(p, a, clo, scale)];
+                for (int k = 0; k < 3; ++k) { bin.lo[k] = std::min(bin.lo[k], p.lo[k]); bin.hi[k] = std::max(bin.hi[k], p.hi[k]); }
+                bin.count++;
+            }
+#endif
+        }
+    }
+
+    // Fills nodes[self] for primitives [begin, end) and recurses. With taskSize > 0
+    // (the serial top), ranges no bigger than that become tasks instead.
+    void buildNode(std::vector<Node2>& nodes, uint32_t self, uint32_t begin, uint32_t end, int depth, size_t taskSize, int& maxDepth) {
+        maxDepth = std::max(maxDepth, depth);
+        const uint32_t count = end - begin;
+        if (taskSize && count <= taskSize) { tasks_.push_back({ self, begin, end, depth }); return; }
+        float lo[3], hi[3], clo[3], chi[3];
+        primBounds(begin, end, lo, hi, clo, chi);
+        Node2& nd = nodes[self];
+        for (int a = 0; a < 3; ++a) { nd.lo[a] = lo[a]; nd.hi[a] = hi[a]; }
+        nd.first = begin; nd.count = count;
+        // A leaf is one Tri4 pack, so anything that fits is as cheap as it gets.
+        if (count <= (uint32_t)kMaxLeaf) return;
+
+        float scale[3];
+        for (int a = 0; a < 3; ++a) scale[a] = chi[a] > clo[a] ? kBins / (chi[a] - clo[a]) : 0.0f;
+        Bin bins[3][kBins];
+        binPrims(begin, end, clo, scale, bins);
+        float bestCost = 1e30f;
+        int bestAxis = -1, bestSplit = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (scale[axis] == 0.0f) continue;
+            const Bin* bin = bins[axis];
+            float rightArea[kBins];
+            uint32_t rightCount[kBins];
+            float rlo[3] = { 1e30f, 1e30f, 1e30f }, rhi[3] = { -1e30f, -1e30f, -1e30f };
+            uint32_t rc = 0;
+            for (int b = kBins - 1; b > 0; --b) {
+                rc += bin[b].count;
+                for (int a = 0; a < 3; ++a) { rlo[a] = std::min(rlo[a], bin[b].lo[a]); rhi[a] = std::max(rhi[a], bin[b].hi[a]); }
+                rightArea[b] = area(rlo, rhi); rightCount[b] = rc;
+            }
+            float llo[3] = { 1e30f, 1e30f, 1e30f }, lhi[3] = { -1e30f, -1e30f, -1e30f };
+            uint32_t lc = 0;
+            for (int b = 0; b < kBins - 1; ++b) {
+                lc += bin[b].count;
+                for (int a = 0; a < 3; ++a) { llo[a] = std::min(llo[a], bin[b].lo[a]); lhi[a] = std::max(lhi[a], bin[b].hi[a]); }
+                if (!lc || !rightCount[b + 1]) continue;
+                float cost = area(llo, lhi) * lc + rightArea[b + 1] * rightCount[b + 1];
+                if (cost < bestCost) { bestCost = cost; bestAxis = axis; bestSplit = b + 1; }
+            }
+        }
+
+        uint32_t mid;
+        if (bestAxis < 0 || depth >= kMaxDepth) {
+            // Every centroid in one spot (or too deep to keep binning): halve to bound leaf size.
+            mid = begin + count / 2;
+        } else {
+            const int axis = bestAxis, split = bestSplit;
+            mid = (uint32_t)(std::partition(prims_.begin() + begin, prims_.begin() + end, [&](const Prim& p) {
+                return binOf(p, axis, clo, scale) < split;
+            }) - prims_.begin());
+        }
+        const uint32_t left = (uint32_t)nodes.size();
+        nodes.resize(nodes.size() + 2);   // may move `nd`
+        nodes[self].first = left;
+        nodes[self].count = 0;
+        buildNode(nodes, left, begin, mid, depth + 1, taskSize, maxDepth);
+        buildNode(nodes, left + 1, mid, end, depth + 1, taskSize, maxDepth);
+    }
+
+    float binarySahCost() const {
+        const float rootArea = area(nodes_[0].lo, nodes_[0].hi);
+        if (prims_.empty() || rootArea <= 0.0f) return 0.0f;
+        double cost = 0.0;
+        for (const Node2& nd : nodes_) cost += area(nd.lo, nd.hi) * (nd.count ? (float)nd.count : kTraversalCost);
+        return (float)(cost / rootArea);
+    }
+
+    // Binary tree -> 4-wide nodes and Tri4 leaf packs, depth first so siblings stay close.
+    void collapse(const float* tris) {
+        wide_.clear();
+        packs_.clear();
+        wide_.reserve(nodes_.size() / 3 + 1);
+        packs_.reserve(nodes_.size() / 2 + 1);
+        wide_.push_back(Node4());
+        if (prims_.empty()) { wide_[0].count = 0; return; }
+        if (nodes_[0].count) {   // a single leaf: one child under the root
+            Node4& root = wide_[0];
+            setChild(root, 0, nodes_[0], kLeaf | emitPack(nodes_[0], tris));
+            root.count = 1;
+            return;
+        }
+        collapseNode(0, 0, tris);
+    }
+
+    void collapseNode(uint32_t wideIndex, uint32_t binary, const float* tris) {
+        uint32_t kids[4] = { nodes_[binary].first, nodes_[binary].first + 1, 0, 0 };
+        int count = 2;
+        while (count < 4) {
+            // Open the inner child with the biggest box.
+            int best = -1;
+            float bestArea = -1.0f;
+            for (int k = 0; k < count; ++k) {
+                const Node2& c = nodes_[kids[k]];
+                if (c.count) continue;
+                float a = area(c.lo, c.hi);
+                if (a > bestArea) { bestArea = a; best = k; }
+            }
+            if (best < 0) break;
+            const uint32_t opened = kids[best];
+            kids[best] = nodes_[opened].first;
+            kids[count++] = nodes_[opened].first + 1;
+        }
+        uint32_t ref[4];
+        for (int k = 0; k < count; ++k) {
+            const Node2& c = nodes_[kids[k]];
+            if (c.count) ref[k] = kLeaf | emitPack(c, tris);
+            else { ref[k] = (uint32_t)wide_.size(); wide_.push_back(Node4()); collapseNode(ref[k], kids[k], tris); }
+        }
+        Node4& w = wide_[wideIndex];   // after the recursion: push_back may have moved it
+        for (int k = 0; k < count; ++k) setChild(w, k, nodes_[kids[k]], ref[k]);
+        for (int k = count; k < 4; ++k) setChild(w, k, Node2{ { 0, 0, 0 }, 0, { 0, 0, 0 }, 0 }, kMeshNone);
+        w.count = (uint32_t)count;
+    }
+
+    static void setChild(Node4& w, int k, const Node2& c, uint32_t ref) {
+        w.lox[k] = c.lo[0]; w.loy[k] = c.lo[1]; w.loz[k] = c.lo[2];
+        w.hix[k] = c.hi[0]; w.hiy[k] = c.hi[1]; w.hiz[k] = c.hi[2];
+        w.child[k] = ref;
+    }
+
+    uint32_t emitPack(const Node2& leaf, const float* tris) {
+        Tri4 p = {};
+        for (int k = 0; k < 4; ++k) {
+            if ((uint32_t)k >= leaf.count) { p.id[k] = kMeshNone; continue; }
+            const uint32_t id = prims_[leaf.first + k].id;
+            const float* v = tris + 9 * (size_t)id;
+            p.v0x[k] = v[0]; p.v0y[k] = v[1]; p.v0z[k] = v[2];
+            p.e1x[k] = v[3] - v[0]; p.e1y[k] = v[4] - v[1]; p.e1z[k] = v[5] - v[2];
+            p.e2x[k] = v[6] - v[0]; p.e2y[k] = v[7] - v[1]; p.e2z[k] = v[8] - v[2];
+            p.id[k] = id;
+        }
+        packs_.push_back(p);
+        return (uint32_t)packs_.size() - 1;
+    }
+
+    struct Entry { uint32_t ref; float t; };   // t: where the ray enters the child
+
+    // Pushes the children of `w` the ray enters before hit.t, nearest on top.
+    void pushChildren(const Node4& w, const float o[3], const float inv[3], float tMax, Entry* stack, int& sp) const {
+        Entry found[4];
+        int n = 0;
+#if MESH_BVH_SSE
+        const __m128 ox = _mm_set1_ps(o[0]), oy = _mm_set1_ps(o[1]), oz = _mm_set1_ps(o[2]);
+        const __m128 ix = _mm_set1_ps(inv[0]), iy = _mm_set1_ps(inv[1]), iz = _mm_set1_ps(inv[2]);
+        const __m128 ax = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(w.lox), ox), ix), bx = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(w.hix), ox), ix);
+        const __m128 ay = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(w.loy), oy), iy), by = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(w.hiy), oy), iy);
+        const __m128 az = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(w.loz), oz), iz), bz = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(w.hiz), oz), iz);
+        const __m128 t0 = _mm_max_ps(_mm_max_ps(_mm_min_ps(ax, bx), _mm_min_ps(ay, by)), _mm_max_ps(_mm_min_ps(az, bz), _mm_setzero_ps()));
+        const __m128 t1 = _mm_min_ps(_mm_min_ps(_mm_max_ps(ax, bx), _mm_max_ps(ay, by)), _mm_min_ps(_mm_max_ps(az, bz), _mm_set1_ps(tMax)));
+        const int mask = _mm_movemask_ps(_mm_cmple_ps(t0, t1)) & ((1 << w.count) - 1);
+        alignas(16) float tEntry[4];
+        _mm_store_ps(tEntry, t0);
+        for (int k = 0; k < 4; ++k)
+            if (mask & (1 << k)) found[n++] = { w.child[k], tEntry[k] };
+#else
+        const float* lo[3] = { w.lox, w.loy, w.loz };
+        const float* hi[3] = { w.hix, w.hiy, w.hiz };
+        for (uint32_t k = 0; k < w.count; ++k) {
+            float t0 = 0.0f, t1 = tMax;
+            for (int a = 0; a < 3; ++a) {
+                float ta = (lo[a][k] - o[a]) * inv[a], tb = (hi[a][k] - o[a]) * inv[a];
+                if (ta > tb) std::swap(ta, tb);
+                t0 = std::max(t0, ta);
+                t1 = std::min(t1, tb);
+            }
+            if (t0 <= t1) found[n++] = { w.child[k], t0 };
+        }
+#endif
+        // Farthest first, so the nearest is popped next.
+        for (int i = 1; i < n; ++i)
+            for (int j = i; j > 0 && found[j - 1].t < found[j].t; --j) std::swap(found[j - 1], found[j]);
+        for (int i = 0; i < n; ++i) stack[sp++] = found[i];
+    }
+
+    // Moller-Trumbore against the four triangles of a pack; updates `hit`
+    // with the nearest one before hit.t. Returns whether any was hit.
+    bool intersectPack(const Tri4& p, const float o[3], const float d[3], MeshHit& hit) const {
+#if MESH_BVH_SSE
+        const __m128 dx = _mm_set1_ps(d[0]), dy = _mm_set1_ps(d[1]), dz = _mm_set1_ps(d[2]);
+        const __m128 e1x = _mm_load_ps(p.e1x), e1y = _mm_load_ps(p.e1y), e1z = _mm_load_ps(p.e1z);
+        const __m128 e2x = _mm_load_ps(p.e2x), e2y = _mm_load_ps(p.e2y), e2z = _mm_load_ps(p.e2z);
+        // pvec = d x e2
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        const __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+        const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        const __m128 sx = _mm_sub_ps(_mm_set1_ps(o[0]), _mm_load_ps(p.v0x));
+        const __m128 sy = _mm_sub_ps(_mm_set1_ps(o[1]), _mm_load_ps(p.v0y));
+        const __m128 sz = _mm_sub_ps(_mm_set1_ps(o[2]), _mm_load_ps(p.v0z));
+        const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+        // qvec = s x e1
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+        const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 ok = _mm_cmpgt_ps(absDet, _mm_set1_ps(1e-20f));
+        ok = _mm_and_ps(ok, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero)));
+        ok = _mm_and_ps(ok, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+        ok = _mm_and_ps(ok, _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, _mm_set1_ps(hit.t))));
+        int mask = _mm_movemask_ps(ok);
+        if (!mask) return false;
+        alignas(16) float ts[4], us[4], vs[4];
+        _mm_store_ps(ts, t); _mm_store_ps(us, u); _mm_store_ps(vs, v);
+        for (int k = 0; k < 4; ++k)
+            if ((mask & (1 << k)) && ts[k] < hit.t) { hit.t = ts[k]; hit.u = us[k]; hit.v = vs[k]; hit.tri = p.id[k]; }
+        return true;
+#else
+        bool any = false;
+        for (int k = 0; k < 4; ++k) {
+            if (p.id[k] == kMeshNone) continue;
+            const float e1[3] = { p.e1x[k], p.e1y[k], p.e1z[k] }, e2[3] = { p.e2x[k], p.e2y[k], p.e2z[k] };
+            const float pv[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+            const float det = e1[0] * pv[0] + e1[1] * pv[1] + e1[2] * pv[2];
+            if (std::fabs(det) <= 1e-20f) continue;
+            const float invDet = 1.0f / det;
+            const float s[3] = { o[0] - p.v0x[k], o[1] - p.v0y[k], o[2] - p.v0z[k] };
+            const float u = (s[0] * pv[0] + s[1] * pv[1] + s[2] * pv[2]) * invDet;
+            if (u < 0.0f || u > 1.0f) continue;
+            const float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+            const float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * invDet;
+            if (v < 0.0f || u + v > 1.0f) continue;
+            const float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+            if (t <= 0.0f || t >= hit.t) continue;
+            hit.t = t; hit.u = u; hit.v = v; hit.tri = p.id[k];
+            any = true;
+        }
+        return any;
+#endif
+    }
+
+    bool traverse(const float o[3], const float d[3], MeshHit& hit, bool anyHit) const {
+        if (prims_.empty()) return false;
+        // Tiny components are nudged off zero so the slabs never compute 0 * inf.
+        float inv[3];
+        for (int a = 0; a < 3; ++a) inv[a] = 1.0f / (std::fabs(d[a]) > 1e-20f ? d[a] : std::copysign(1e-20f, d[a]));
+        Entry stack[kStackSize];
+        int sp = 0;
+        bool any = false;
+        pushChildren(wide_[0], o, inv, hit.t, stack, sp);
+        while (sp) {
+            const Entry top = stack[--sp];
+            if (top.t > hit.t) continue;   // a hit since it was pushed is nearer
+            if (top.ref & kLeaf) {
+                if (intersectPack(packs_[top.ref & ~kLeaf], o, d, hit)) {
+                    any = true;
+                    if (anyHit) return true;
+                }
+                continue;
+            }
+            pushChildren(wide_[top.ref], o, inv, hit.t, stack, sp);
+        }
+        return any;
+    }
+
+    std::vector<Prim> prims_;                    // in leaf order
+    std::vector<Node2> nodes_;                   // binary build tree
+    std::vector<Task> tasks_;
+    std::vector<std::vector<Node2>> taskNodes_;
+    std::vector<Node4> wide_;
+    std::vector<Tri4> packs_;
+    MeshBvhStats stats_;
+};
@@ -0,0 +1,43 @@
+#pragma once
+// ---------------- Clustered Mesh ----------------
+// .clu layout: ClusterFileHeader | ClusterEntry[clusterCount] | blobs
+// One mesh split into spatial clusters, each blob a complete .mesh (mesh_format.h)
+// starting on a kClusterAlign boundary, so a mapped file hands every cluster
+// out zero-copy through parseMeshBlob. Written by `assetc ingest` for meshes
+// too large to load whole; a cluster is the unit a LOD streamer pages in.
+#include <cstdint>
+#include <cstring>
+#include "mesh_format.h"
+
+static const uint32_t kClusterVersion = 1;
+static const uint64_t kClusterAlign = 64;
+
+struct ClusterFileHeader {
+    char     magic[4];      // "GCLU"
+    uint32_t version;
+    uint32_t clusterCount;
+    uint32_t floatsPerVertex;
+    uint64_t triangleCount;
+    float    boundsMin[3], boundsMax[3];
+};
+
+struct ClusterEntry {
+    float    boundsMin[3], boundsMax[3];
+    uint64_t offset;        // absolute file offset of the .mesh blob, kClusterAlign aligned
+    uint64_t size;
+    uint32_t triangleCount;
+    uint32_t vertexCount;
+};
+
+// Validates the header and entry table; blobs are checked when parsed.
+inline bool parseClusterFile(const unsigned char* data, size_t size, ClusterFileHeader& header, const ClusterEntry*& entries) {
+    if (size < sizeof(ClusterFileHeader)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, "GCLU", 4) != 0 || header.version != kClusterVersion) return false;
+    const size_t tableEnd = sizeof(header) + (size_t)header.clusterCount * sizeof(ClusterEntry);
+    if (tableEnd > size) return false;
+    entries = (const ClusterEntry*)(data + sizeof(header));
+    for (uint32_t i = 0; i < header.clusterCount; ++i)
+        if (entries[i].offset < tableEnd || entries[i].offset + entries[i].size > size) return false;
+    return true;
+}
@@ -0,0 +1,124 @@
+#pragma once
+// ---------------- Binary Indexed Mesh ----------------
+// .mesh layout: MeshFileHeader | float vertices[vertexCount * floatsPerVertex] | uint32 indices[indexCount]
+// Written by tools/assetc, read zero-copy out of the asset pack by project/app.
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static const uint32_t kMeshVersion = 1;
+
+// Scene meshes with this path are the builtin cube: a unit cube around the origin as 36 interleaved
+// pos(3) normal(3) uv(2) vertices, for the app's cube VAO and for tools that
+// need the same geometry on the CPU.
+static const char* const kBuiltinCube = "builtin:cube";
+static const float kBuiltinCubeVertices[36 * 8] = {
+    -0.5f,-0.5f,-0.5f,  0,0,-1, 0,0,  0.5f,-0.5f,-0.5f,  0,0,-1, 1,0,  0.5f, 0.5f,-0.5f,  0,0,-1, 1,1,
+     0.5f, 0.5f,-0.5f,  0,0,-1, 1,1, -0.5f, 0.5f,-0.5f,  0,0,-1, 0,1, -0.5f,-0.5f,-0.5f,  0,0,-1, 0,0,
+    -0.5f,-0.5f, 0.5f,  0,0, 1, 0,0,  0.5f,-0.5f, 0.5f,  0,0, 1, 1,0,  0.5f, 0.5f, 0.5f,  0,0, 1, 1,1,
+     0.5f, 0.5f, 0.5f,  0,0, 1, 1,1, -0.5f, 0.5f, 0.5f,  0,0, 1, 0,1, -0.5f,-0.5f, 0.5f,  0,0, 1, 0,0,
+    -0.5f, 0.5f, 0.5f, -1,0,0, 1,0, -0.5f, 0.5f,-0.5f, -1,0,0, 1,1, -0.5f,-0.5f,-0.5f, -1,0,0, 0,1,
+    -0.5f,-0.5f,-0.5f, -1,0,0, 0,1, -0.5f,-0.5f, 0.5f, -1,0,0, 0,0, -0.5f, 0.5f, 0.5f, -1,0,0, 1,0,
+     0.5f, 0.5f, 0.5f,  1,0,0, 1,0,  0.5f, 0.5f,-0.5f,  1,0,0, 1,1,  0.5f,-0.5f,-0.5f,  1,0,0, 0,1,
+     0.5f,-0.5f,-0.5f,  1,0,0, 0,1,  0.5f,-0.5f, 0.5f,  1,0,0, 0,0,  0.5f, 0.5f, 0.5f,  1,0,0, 1,0,
+    -0.5f,-0.5f,-0.5f,  0,-1,0, 0,1,  0.5f,-0.5f,-0.5f,  0,-1,0, 1,1,  0.5f,-0.5f, 0.5f,  0,-1,0, 1,0,
+     0.5f,-0.5f, 0.5f,  0,-1,0, 1,0, -0.5f,-0.5f, 0.5f,  0,-1,0, 0,0, -0.5f,-0.5f,-0.5f,  0,-1,0, 0,1,
+    -0.5f, 0.5f,-0.5f,  0, 1,0, 0,1,  0.5f, 0.5f,-0.5f,  0, 1,0, 1,1,  0.5f, 0.5f, 0.5f,  0, 1,0, 1,0,
+     0.5f, 0.5f, 0.5f,  0, 1,0, 1,0, -0.5f, 0.5f, 0.5f,  0, 1,0, 0,0, -0.5f, 0.5f,-0.5f,  0, 1,0, 0,1
+};
+
+struct MeshFileHeader {
+    char     magic[4];      // "GMSH"
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t floatsPerVertex;
+    uint32_t reserved[3];
+};
+
+struct IndexedMesh {
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    uint32_t floatsPerVertex = 8;
+    uint32_t vertexCount() const { return (uint32_t)(vertices.size() / floatsPerVertex); }
+};
+
+struct MeshView {
+    const float* vertices = nullptr;
+    const uint32_t* indices = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t floatsPerVertex = 0;
+};
+
+// Welds bit-identical interleaved vertices into a shared vertex list + index buffer.
+inline IndexedMesh buildIndexedMesh(const std::vector<float>& interleaved, uint32_t floatsPerVertex = 8) {
+    struct Key {
+        const float* v; uint32_t n;
+        bool operator==(const Key& o) const { return std::memcmp(v, o.v, n * sizeof(float)) == 0; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            uint64_t h = 1469598103934665603ull;
+            const unsigned char* b = (const unsigned char*)k.v;
+            for (size_t i = 0; i < k.n * sizeof(float); ++i) { h ^= b[i]; h *= 1099511628211ull; }
+            return (size_t)h;
+        }
+    };
+
+    IndexedMesh mesh;
+    mesh.floatsPerVertex = floatsPerVertex;
+    size_t count = interleaved.size() / floatsPerVertex;
+    std::unordered_map<Key, uint32_t, KeyHash> seen;
+    seen.reserve(count);
+    mesh.indices.reserve(count);
+    std::vector<uint32_t> firstUse;
+    for (size_t i = 0; i < count; ++i) {
+        Key k{ &interleaved[i * floatsPerVertex], floatsPerVertex };
+        auto it = seen.find(k);
+        if (it != seen.end()) { mesh.indices.push_back(it->second); continue; }
+        uint32_t id = (uint32_t)firstUse.size();
+        seen.emplace(k, id);
+        firstUse.push_back((uint32_t)i);
+        mesh.indices.push_back(id);
+    }
+    mesh.vertices.resize(firstUse.size() * floatsPerVertex);
+    for (size_t v = 0; v < firstUse.size(); ++v)
+        std::memcpy(&mesh.vertices[v * floatsPerVertex], &interleaved[firstUse[v] * floatsPerVertex],
+                    floatsPerVertex * sizeof(float));
+    return mesh;
+}
+
+inline std::vector<char> serializeMesh(const IndexedMesh& mesh) {
+    MeshFileHeader h = {};
+    std::memcpy(h.magic, "GMSH", 4);
+    h.version = kMeshVersion;
+    h.vertexCount = mesh.vertexCount();
+    h.indexCount = (uint32_t)mesh.indices.size();
+    h.floatsPerVertex = mesh.floatsPerVertex;
+    size_t vbytes = mesh.vertices.size() * sizeof(float);
+    size_t ibytes = mesh.indices.size() * sizeof(uint32_t);
+    std::vector<char> out(sizeof(h) + vbytes + ibytes);
+    std::memcpy(out.data(), &h, sizeof(h));
+    std::memcpy(out.data() + sizeof(h), mesh.vertices.data(), vbytes);
+    std::memcpy(out.data() + sizeof(h) + vbytes, mesh.indices.data(), ibytes);
+    return out;
+}
+
+inline bool parseMeshBlob(const unsigned char* data, size_t size, MeshView& view) {
+    if (size < sizeof(MeshFileHeader)) return false;
+    MeshFileHeader h;
+    std::memcpy(&h, data, sizeof(h));
+    if (std::memcmp(h.magic, "GMSH", 4) != 0 || h.version != kMeshVersion || h.floatsPerVertex == 0) return false;
+    size_t vbytes = (size_t)h.vertexCount * h.floatsPerVertex * sizeof(float);
+    size_t ibytes = (size_t)h.indexCount * sizeof(uint32_t);
+    if (sizeof(h) + vbytes + ibytes > size) return false;
+    view.vertices = (const float*)(data + sizeof(h));
+    view.indices = (const uint32_t*)(data + sizeof(h) + vbytes);
+    view.vertexCount = h.vertexCount;
+    view.indexCount = h.indexCount;
+    view.floatsPerVertex = h.floatsPerVertex;
+    return true;
+}
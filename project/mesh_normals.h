@@ -0,0 +1,175 @@
+#pragma once
+// ---------------- Smooth Normals ----------------
+// Normals for interleaved pos(3) normal(3) uv(2) triangles whose source had
+// none (OBJ faces without vn). Each corner gets the angle-weighted average of
+// the faces around its vertex (Thürmer and Wüthrich), but only of those within
+// a crease angle of its own face, so a cube keeps flat sides and a sphere comes
+// out smooth. Triangles are unindexed, so the caller says which source
+// position each corner came from; corners sharing a position share a vertex.
+//
+// Work is split over threads in bands, without atomics:
+//   - each band of triangles counts its corners per vertex, over just the
+//     vertex range it touches (OBJ files keep faces near their vertices), and
+//     works out its faces' normals and corner angles,
+//   - a reduction turns the counts into one corner list per vertex, plus each
+//     band's write cursor into it, so the bands fill the lists in corner order,
+//   - bands of vertices then average, cluster and write their corners' normals;
+//     every corner belongs to exactly one vertex, so no two bands write it.
+// Threads are spawned per call, as image_decode.h does for a one-off decode.
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+static const float kSmoothNormalCreaseDegrees = 60.0f;
+// Meshes below this many corners are done faster on one thread than the split costs.
+static const size_t kParallelMeshMinCorners = 1u << 16;
+
+// Runs fn(band) for every band in [0, bands), one thread each; the caller takes band 0.
+template <class Fn>
+inline void runMeshBands(unsigned bands, const Fn& fn) {
+    std::vector<std::thread> threads;
+    for (unsigned b = 1; b < bands; ++b) threads.emplace_back(fn, b);
+    fn(0u);
+    for (std::thread& t : threads) t.join();
+}
+
+// acos to within 7e-5 rad (Abramowitz and Stegun 4.4.45): plenty for a weight, far cheaper than std::acos.
+inline float fastAcos(float x) {
+    float a = std::fabs(std::min(1.0f, std::max(-1.0f, x)));
+    float r = std::sqrt(1.0f - a) * (1.5707288f + a * (-0.2121144f + a * (0.0742610f - 0.0187293f * a)));
+    return x < 0.0f ? 3.14159265f - r : r;
+}
+
+// Corners grouped by vertex: list[first[v] .. first[v + 1]) are vertex v's
+// corners, in corner order. cornerVertex[c] < vertexCount is corner c's vertex.
+inline void buildVertexCornerLists(unsigned bands, const uint32_t* cornerVertex, size_t triCount, size_t vertexCount,
+                                   std::vector<uint32_t>& first, std::vector<uint32_t>& list) {
+    const size_t corners = triCount * 3;
+
+    // Counts per band, over the band's own vertex range.
+    struct TriBand { size_t c0 = 0, c1 = 0; uint32_t vmin = 0, vmax = 0; std::vector<uint32_t> cursor; };
+    std::vector<TriBand> triBands(bands);
+    runMeshBands(bands, [&](unsigned b) {
+        TriBand& B = triBands[b];
+        B.c0 = triCount * b / bands * 3;
+        B.c1 = triCount * (b + 1) / bands * 3;
+        if (B.c0 == B.c1) return;
+        uint32_t lo = UINT32_MAX, hi = 0;
+        for (size_t c = B.c0; c < B.c1; ++c) { lo = std::min(lo, cornerVertex[c]); hi = std::max(hi, cornerVertex[c]); }
+        B.vmin = lo; B.vmax = hi;
+        B.cursor.assign((size_t)hi - lo + 1, 0);
+        for (size_t c = B.c0; c < B.c1; ++c) ++B.cursor[cornerVertex[c] - lo];
+    });
+
+    // Reduction: each vertex's total, and each band's count becomes its offset within the vertex's list.
+    first.assign(vertexCount + 1, 0);
+    runMeshBands(bands, [&](unsigned b) {
+        const size_t v0 = vertexCount * b / bands, v1 = vertexCount * (b + 1) / bands;
+        for (size_t v = v0; v < v1; ++v) {
+            uint32_t sum = 0;
+            for (TriBand& B : triBands) {
+                if (B.cursor.empty() || v < B.vmin || v > B.vmax) continue;
+                uint32_t& n = B.cursor[v - B.vmin];
+                const uint32_t count = n;
+                n = sum;
+                sum += count;
+            }
+            first[v] = sum;
+        }
+    });
+    uint32_t run = 0;
+    for (size_t v = 0; v < vertexCount; ++v) { uint32_t n = first[v]; first[v] = run; run += n; }
+    first[vertexCount] = run;
+
+    // Fill: corners of each vertex, in corner order.
+    list.resize(corners);
+    runMeshBands(bands, [&](unsigned b) {
+        TriBand& B = triBands[b];
+        for (size_t c = B.c0; c < B.c1; ++c) {
+            const uint32_t v = cornerVertex[c];
+            list[first[v] + B.cursor[v - B.vmin]++] = (uint32_t)c;
+        }
+        std::vector<uint32_t>().swap(B.cursor);
+    });
+}
+
+// Fills the normal of every corner of `verts` (stride 8 floats) that is exactly
+// (0,0,0), the loaders' mark for "none given"; other corners keep theirs but
+// still shape their neighbours'. cornerPos[c] < posCount is corner c's vertex.
+// 0 threads = one per hardware thread.
+inline void generateSmoothNormals(float* verts, size_t triCount, const uint32_t* cornerPos, size_t posCount,
+                                  float creaseDegrees = kSmoothNormalCreaseDegrees, unsigned threads = 0) {
+    const size_t corners = triCount * 3;
+    if (!corners || !posCount) return;
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned bands = corners < kParallelMeshMinCorners ? 1u : (unsigned)std::min<size_t>(threads, triCount);
+    const float cosCrease = std::cos(creaseDegrees * 3.14159265f / 180.0f);
+    auto position = [verts](size_t c) { const float* p = verts + c * 8; return glm::vec3(p[0], p[1], p[2]); };
+    auto isMissing = [verts](size_t c) {
+        const float* n = verts + c * 8 + 3;
+        return n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f;
+    };
+
+    // Per triangle, once: unit normal (zero if degenerate) and the angle at each corner.
+    std::vector<glm::vec3> faceN(triCount);
+    std::vector<float> angle(corners);
+    runMeshBands(bands, [&](unsigned b) {
+        for (size_t t = triCount * b / bands, t1 = triCount * (b + 1) / bands; t < t1; ++t) {
+            const glm::vec3 p0 = position(t * 3), p1 = position(t * 3 + 1), p2 = position(t * 3 + 2);
+            const glm::vec3 e01 = p1 - p0, e02 = p2 - p0, e12 = p2 - p1;
+            const glm::vec3 n = glm::cross(e01, e02);
+            const float len = glm::length(n);
+            faceN[t] = len > 0.0f ? n / len : glm::vec3(0.0f);
+            const float l01 = glm::dot(e01, e01), l02 = glm::dot(e02, e02), l12 = glm::dot(e12, e12);
+            angle[t * 3] = fastAcos(glm::dot(e01, e02) / std::sqrt(l01 * l02));
+            angle[t * 3 + 1] = fastAcos(-glm::dot(e01, e12) / std::sqrt(l01 * l12));
+            angle[t * 3 + 2] = fastAcos(glm::dot(e02, e12) / std::sqrt(l02 * l12));
+        }
+    });
+
+    std::vector<uint32_t> first, list;
+    buildVertexCornerLists(bands, cornerPos, triCount, posCount, first, list);
+
+    // Per vertex: its corners' faces, grouped greedily into clusters whose first
+    // face is within the crease angle; each missing corner gets its cluster's
+    // angle-weighted sum.
+    runMeshBands(bands, [&](unsigned b) {
+        const size_t v0 = posCount * b / bands, v1 = posCount * (b + 1) / bands;
+        std::vector<glm::vec3> seed, sum;
+        std::vector<uint32_t> cluster;
+        for (size_t v = v0; v < v1; ++v) {
+            const uint32_t* cs = list.data() + first[v];
+            const size_t k = first[v + 1] - first[v];
+            bool any = false;
+            for (size_t i = 0; i < k && !any; ++i) any = isMissing(cs[i]);
+            if (!any) continue;
+            cluster.resize(k);
+            seed.clear(); sum.clear();
+            glm::vec3 all(0.0f);
+            for (size_t i = 0; i < k; ++i) {
+                const glm::vec3& n = faceN[cs[i] / 3];
+                if (n.x == 0.0f && n.y == 0.0f && n.z == 0.0f) { cluster[i] = UINT32_MAX; continue; }
+                uint32_t j = 0;
+                while (j < seed.size() && glm::dot(seed[j], n) < cosCrease) ++j;
+                if (j == seed.size()) { seed.push_back(n); sum.push_back(glm::vec3(0.0f)); }
+                const float w = angle[cs[i]];
+                sum[j] += n * w;
+                all += n * w;
+                cluster[i] = j;
+            }
+            for (size_t i = 0; i < k; ++i) {
+                if (!isMissing(cs[i])) continue;
+                // Degenerate faces take the plain vertex average; a vertex of nothing but those, +y.
+                glm::vec3 n = cluster[i] == UINT32_MAX ? all : sum[cluster[i]];
+                const float len = glm::length(n);
+                n = len > 0.0f ? n / len : cluster[i] == UINT32_MAX ? glm::vec3(0.0f, 1.0f, 0.0f) : faceN[cs[i] / 3];
+                float* dst = verts + (size_t)cs[i] * 8 + 3;
+                dst[0] = n.x; dst[1] = n.y; dst[2] = n.z;
+            }
+        }
+    });
+}
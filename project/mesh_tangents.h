@@ -0,0 +1,233 @@
+#pragma once
+// ---------------- Tangent Space ----------------
+// Per-corner tangents for normal mapping, following the rules of Morten
+// Mikkelsen's MikkTSpace (mikktspace.c), so maps baked by tools that use it
+// (Blender, xNormal, Substance) decode without seams:
+//   - vertices are welded when position, normal and uv are all bit-identical,
+//   - each triangle gets its texture-space s and t directions and whether its
+//     uv mapping preserves orientation; triangles with no uv area, or no
+//     position area, are "degenerate" and borrow their neighbours' result,
+//   - around each vertex, triangles are grouped across shared edges when their
+//     orientation matches, and a group's tangent is the angle-weighted average
+//     of its triangles' s directions projected into the vertex normal's plane,
+//     summed in triangle order as the reference does.
+// The output is (tangent.xyz, w): bitangent = w * cross(normal, tangent),
+// with w = -1 where the uv mapping is mirrored.
+// One deliberate difference: a triangle with no uv area takes its orientation
+// from its first good edge neighbour, where the reference takes that of
+// whichever group reaches it first, an order dependency that would serialise
+// the grouping. It only matters for such triangles between mirrored halves.
+//
+// Triangles are worked on in batches, one thread each (mesh_normals.h), and
+// vertices in bands: every vertex's groups depend only on its own triangles.
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "mesh_format.h"
+#include "mesh_normals.h"
+
+// pos(3) normal(3) uv(2) tangent(4): the layout generateTangents() feeds, and attribute location 3.
+static const uint32_t kMeshFloatsWithTangents = 12;
+
+namespace mikk {
+
+enum : uint8_t { kDegenerate = 1, kOrientPreserving = 2, kGroupWithAny = 4 };
+
+struct TriInfo {
+    glm::vec3 os{ 0.0f }, ot{ 0.0f };   // unit s and t directions (sign folded in), zero when undefined
+    float magS = 0.0f, magT = 0.0f;
+    int32_t neighbor[3] = { -1, -1, -1 };   // across edge i -> i+1
+    uint8_t flags = kGroupWithAny;
+};
+
+inline bool notZero(float f) { return std::fabs(f) > FLT_MIN; }
+inline bool notZero(const glm::vec3& v) { return notZero(v.x) || notZero(v.y) || notZero(v.z); }
+inline glm::vec3 normalize(const glm::vec3& v) { return v * (1.0f / std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z)); }
+inline glm::vec3 project(const glm::vec3& v, const glm::vec3& n) { return v - n * glm::dot(n, v); }
+
+} // namespace mikk
+
+// Tangents of an indexed triangle mesh whose vertices start with pos(3) normal(3)
+// uv(2) and are `stride` floats apart; writes 4 floats per corner (indices
+// order). Vertices must already be welded, as buildIndexedMesh() leaves them.
+// 0 threads = one per hardware thread.
+inline void generateTangents(const float* verts, size_t stride, size_t vertexCount, const uint32_t* indices, size_t triCount,
+                             float* tangents, unsigned threads = 0) {
+    using namespace mikk;
+    const size_t corners = triCount * 3;
+    if (!corners || !vertexCount) return;
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned bands = corners < kParallelMeshMinCorners ? 1u : (unsigned)std::min<size_t>(threads, triCount);
+    auto position = [&](uint32_t v) { const float* p = verts + v * stride; return glm::vec3(p[0], p[1], p[2]); };
+    auto normal = [&](uint32_t v) { const float* p = verts + v * stride + 3; return glm::vec3(p[0], p[1], p[2]); };
+    auto uv = [&](uint32_t v) { const float* p = verts + v * stride + 6; return glm::vec2(p[0], p[1]); };
+
+    // Per triangle: s/t directions, magnitudes and orientation (the reference's InitTriInfo).
+    std::vector<TriInfo> tri(triCount);
+    runMeshBands(bands, [&](unsigned b) {
+        for (size_t f = triCount * b / bands, f1 = triCount * (b + 1) / bands; f < f1; ++f) {
+            TriInfo& T = tri[f];
+            const uint32_t* i = indices + f * 3;
+            const glm::vec3 v1 = position(i[0]), v2 = position(i[1]), v3 = position(i[2]);
+            if (v1 == v2 || v1 == v3 || v2 == v3) { T.flags = kDegenerate; continue; }
+            const glm::vec2 t1 = uv(i[0]), t2 = uv(i[1]), t3 = uv(i[2]);
+            const float t21x = t2.x - t1.x, t21y = t2.y - t1.y, t31x = t3.x - t1.x, t31y = t3.y - t1.y;
+            const glm::vec3 d1 = v2 - v1, d2 = v3 - v1;
+            const float signedAreaSTx2 = t21x * t31y - t21y * t31x;
+            const glm::vec3 os = d1 * t31y - d2 * t21y;
+            const glm::vec3 ot = d1 * -t31x + d2 * t21x;
+            if (signedAreaSTx2 > 0.0f) T.flags |= kOrientPreserving;
+            if (notZero(signedAreaSTx2)) {
+                const float absArea = std::fabs(signedAreaSTx2);
+                const float lenOs = glm::length(os), lenOt = glm::length(ot);
+                const float sign = (T.flags & kOrientPreserving) ? 1.0f : -1.0f;
+                if (notZero(lenOs)) T.os = os * (sign / lenOs);
+                if (notZero(lenOt)) T.ot = ot * (sign / lenOt);
+                T.magS = lenOs / absArea;
+                T.magT = lenOt / absArea;
+                if (notZero(T.magS) && notZero(T.magT)) T.flags &= (uint8_t)~kGroupWithAny;
+            }
+        }
+    });
+
+    std::vector<uint32_t> first, list;
+    buildVertexCornerLists(bands, indices, triCount, vertexCount, first, list);
+
+    // Neighbours: the triangle across each edge a -> b is the first other one running b -> a.
+    runMeshBands(bands, [&](unsigned b) {
+        for (size_t f = triCount * b / bands, f1 = triCount * (b + 1) / bands; f < f1; ++f) {
+            if (tri[f].flags & kDegenerate) continue;
+            for (int e = 0; e < 3; ++e) {
+                const uint32_t va = indices[f * 3 + e], vb = indices[f * 3 + (e + 1) % 3];
+                for (uint32_t k = first[vb]; k < first[vb + 1]; ++k) {
+                    const uint32_t c = list[k], g = c / 3;
+                    if (g == f || (tri[g].flags & kDegenerate)) continue;
+                    if (indices[g * 3 + (c % 3 + 1) % 3] == va) { tri[f].neighbor[e] = (int32_t)g; break; }
+                }
+            }
+        }
+    });
+
+    // Orientation of triangles without uv area: their first good neighbour's.
+    std::vector<uint8_t> orient(triCount);
+    runMeshBands(bands, [&](unsigned b) {
+        for (size_t f = triCount * b / bands, f1 = triCount * (b + 1) / bands; f < f1; ++f) {
+            const TriInfo& T = tri[f];
+            orient[f] = (T.flags & kOrientPreserving) != 0;
+            if (!(T.flags & kGroupWithAny) || (T.flags & kDegenerate)) continue;
+            for (int e = 0; e < 3; ++e) {
+                const int32_t g = T.neighbor[e];
+                if (g >= 0 && !(tri[g].flags & kGroupWithAny)) { orient[f] = (tri[g].flags & kOrientPreserving) != 0; break; }
+            }
+        }
+    });
+
+    // Per vertex: groups of its triangles, then each group's tangent space.
+    runMeshBands(bands, [&](unsigned b) {
+        const size_t v0 = vertexCount * b / bands, v1 = vertexCount * (b + 1) / bands;
+        std::vector<int32_t> group, stack;
+        std::vector<uint32_t> members;
+        std::vector<glm::vec3> os, ot, weighted;
+        for (size_t v = v0; v < v1; ++v) {
+            const uint32_t* cs = list.data() + first[v];
+            const uint32_t k = first[v + 1] - first[v];
+            if (!k) continue;
+            const glm::vec3 n = normal((uint32_t)v);
+            // Slot of triangle f in this vertex's corner list (f's corner at v).
+            auto slotOf = [&](uint32_t f) { uint32_t s = 0; while (s < k && cs[s] / 3 != f) ++s; return s; };
+            group.assign(k, -1);
+            os.resize(k); ot.resize(k); weighted.resize(k);
+            int groups = 0;
+            for (uint32_t s = 0; s < k; ++s) {
+                const uint32_t f0 = cs[s] / 3;
+                if (group[s] >= 0 || (tri[f0].flags & kDegenerate)) continue;
+                // Grow the group across the two edges at v, as the reference's AssignRecur does.
+                const int id = groups++;
+                const uint8_t groupOrient = orient[f0];
+                members.clear();
+                stack.assign(1, (int32_t)f0);
+                while (!stack.empty()) {
+                    const uint32_t f = (uint32_t)stack.back();
+                    stack.pop_back();
+                    const uint32_t slot = slotOf(f);
+                    if (slot == k || group[slot] >= 0 || orient[f] != groupOrient) continue;
+                    group[slot] = id;
+                    members.push_back(slot);
+                    const uint32_t i = cs[slot] % 3;
+                    if (tri[f].neighbor[(i + 2) % 3] >= 0) stack.push_back(tri[f].neighbor[(i + 2) % 3]);
+                    if (tri[f].neighbor[i] >= 0) stack.push_back(tri[f].neighbor[i]);
+                }
+                std::sort(members.begin(), members.end());   // slots ascend with triangle index
+                // Each member's projected s and t, and its share of the reference's
+                // EvalTspace sum: s weighted by the corner's angle in the normal's plane.
+                glm::vec3 groupSum(0.0f);
+                for (uint32_t m : members) {
+                    const uint32_t c = cs[m], f = c / 3, i = c % 3;
+                    const TriInfo& T = tri[f];
+                    os[m] = project(T.os, n); if (notZero(os[m])) os[m] = mikk::normalize(os[m]);
+                    ot[m] = project(T.ot, n); if (notZero(ot[m])) ot[m] = mikk::normalize(ot[m]);
+                    weighted[m] = glm::vec3(0.0f);
+                    if (T.flags & kGroupWithAny) continue;
+                    glm::vec3 e1 = project(position(indices[f * 3 + (i + 2) % 3]) - position(indices[c]), n);
+                    glm::vec3 e2 = project(position(indices[f * 3 + (i + 1) % 3]) - position(indices[c]), n);
+                    if (notZero(e1)) e1 = mikk::normalize(e1);
+                    if (notZero(e2)) e2 = mikk::normalize(e2);
+                    weighted[m] = os[m] * std::acos(std::min(1.0f, std::max(-1.0f, glm::dot(e1, e2))));
+                    groupSum += weighted[m];
+                }
+                // Sub-groups: each triangle averages with the group's triangles whose
+                // s and t both lie within the reference's default 180 degrees of its
+                // own, which leaves out only exactly opposed ones, so nearly every
+                // sub-group is the whole group and shares its sum. Sums run in
+                // triangle order either way, as the reference's do.
+                for (uint32_t m : members) {
+                    auto joins = [&](uint32_t o) {
+                        return o == m || ((tri[cs[m] / 3].flags | tri[cs[o] / 3].flags) & kGroupWithAny) ||
+                               (glm::dot(os[m], os[o]) > -1.0f && glm::dot(ot[m], ot[o]) > -1.0f);
+                    };
+                    glm::vec3 sum = groupSum;
+                    if (!std::all_of(members.begin(), members.end(), joins)) {
+                        sum = glm::vec3(0.0f);
+                        for (uint32_t o : members) if (joins(o)) sum += weighted[o];
+                    }
+                    if (notZero(sum)) sum = mikk::normalize(sum);
+                    float* out = tangents + (size_t)cs[m] * 4;
+                    out[0] = sum.x; out[1] = sum.y; out[2] = sum.z;
+                    out[3] = groupOrient ? 1.0f : -1.0f;
+                }
+            }
+            // Degenerate triangles take the vertex's first good corner's result.
+            for (uint32_t s = 0; s < k; ++s) {
+                if (!(tri[cs[s] / 3].flags & kDegenerate)) continue;
+                uint32_t good = 0;
+                while (good < k && (tri[cs[good] / 3].flags & kDegenerate)) ++good;
+                float* out = tangents + (size_t)cs[s] * 4;
+                if (good < k) std::memcpy(out, tangents + (size_t)cs[good] * 4, 4 * sizeof(float));
+                else { out[0] = 1.0f; out[1] = 0.0f; out[2] = 0.0f; out[3] = 1.0f; }
+            }
+        }
+    });
+}
+
+// Interleaved pos(3) normal(3) uv(2) triangles -> the same triangles with each
+// corner's tangent(4) appended (kMeshFloatsWithTangents floats per corner).
+inline std::vector<float> appendTangents(const std::vector<float>& interleaved, unsigned threads = 0) {
+    const IndexedMesh welded = buildIndexedMesh(interleaved, 8);
+    const size_t corners = welded.indices.size();
+    std::vector<float> tangents(corners * 4);
+    generateTangents(welded.vertices.data(), 8, welded.vertexCount(), welded.indices.data(), corners / 3, tangents.data(), threads);
+    std::vector<float> out(corners * kMeshFloatsWithTangents);
+    for (size_t c = 0; c < corners; ++c) {
+        float* dst = out.data() + c * kMeshFloatsWithTangents;
+        std::memcpy(dst, interleaved.data() + c * 8, 8 * sizeof(float));
+        std::memcpy(dst + 8, tangents.data() + c * 4, 4 * sizeof(float));
+    }
+    return out;
+}
@@ -0,0 +1,199 @@
+#pragma once
+// ---------------- Multi-View Rendering ----------------
+// A frame is rendered from several cameras: view 0 is the overview (the window),
+// views 1.. are follow-cams shown as thumbnails. Per-object work happens once per
+// frame, not once per view:
+//   - transforms and bounding spheres are built once into a ViewInstance list,
+//   - cullViews() tests each sphere against every camera and stores the result
+//     as a bit mask (bit v = visible in view v),
+//   - the instance list is uploaded once, and LayeredViews draws every thumbnail
+//     with one instanced draw per mesh: a geometry shader copies each triangle
+//     into the texture-array layer of every view whose bit is set (gl_Layer).
+// GL 3.3 has no viewport arrays (gl_ViewportIndex is 4.1), so all thumbnails
+// share one size and are blitted into their window rectangles afterwards.
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "frustum.h"
+#include "gl_memory.h"
+
+static const int kMaxViews = 8;                 // overview + 7 layers; must match views.geom
+
+struct Camera {
+    glm::vec3 pos{ 0.0f };
+    glm::mat4 view{ 1.0f }, proj{ 1.0f }, viewProj{ 1.0f };
+    Frustum frustum;
+    float pixelsPerUnitAtOne = 0.0f;            // screen size of a 1-unit object at distance 1
+
+    static Camera lookAt(const glm::vec3& eye, const glm::vec3& target, float fovDeg, float aspect, float heightPx) {
+        Camera c;
+        c.pos = eye;
+        c.view = glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+        c.proj = glm::perspective(glm::radians(fovDeg), aspect, 0.1f, 100.0f);
+        c.viewProj = c.proj * c.view;
+        c.frustum = Frustum::fromMatrix(c.viewProj);
+        c.pixelsPerUnitAtOne = heightPx / (2.0f * std::tan(glm::radians(fovDeg) * 0.5f));
+        return c;
+    }
+
+    // Orbits the origin; yaw/pitch in radians.
+    static Camera orbit(float yaw, float pitch, float radius, float aspect, float heightPx) {
+        glm::vec3 eye(radius * std::cos(pitch) * std::sin(yaw), radius * std::sin(pitch), radius * std::cos(pitch) * std::cos(yaw));
+        return lookAt(eye, glm::vec3(0.0f), 45.0f, aspect, heightPx);
+    }
+
+    // Sits just outside `target`'s orbit around `center`, looking back at the center.
+    static Camera follow(const glm::vec3& target, const glm::vec3& center, float aspect, float heightPx) {
+        glm::vec3 out = target - center;
+        float len = glm::length(out);
+        out = len > 1e-4f ? out / len : glm::vec3(0, 0, 1);
+        glm::vec3 eye = target + out * 1.2f + glm::vec3(0, 0.6f, 0);
+        return lookAt(eye, center, 60.0f, aspect, heightPx);
+    }
+};
+
+// One object as every view sees it. Laid out as the per-instance vertex stream.
+struct ViewInstance {
+    float model[16];
+    uint32_t viewMask;
+};
+
+struct ViewBounds { glm::vec3 center; float radius; };
+
+// Sets each instance's viewMask; returns how many (object, view) pairs are visible.
+inline int cullViews(ViewInstance* inst, const ViewBounds* bounds, int count, const Camera* cams, int viewCount) {
+    int visible = 0;
+    for (int i = 0; i < count; ++i) {
+        uint32_t mask = 0;
+        for (int v = 0; v < viewCount; ++v)
+            if (cams[v].frustum.sphereVisible(bounds[i].center, bounds[i].radius)) { mask |= 1u << v; ++visible; }
+        inst[i].viewMask = mask;
+    }
+    return visible;
+}
+
+inline ViewInstance makeViewInstance(const glm::mat4& model) {
+    ViewInstance v;
+    memcpy(v.model, glm::value_ptr(model), sizeof(v.model));
+    v.viewMask = 0;
+    return v;
+}
+
+// Renders views 1..n into layers 0..n-1 of a colour + depth texture array.
+class LayeredViews {
+public:
+    // `colorFormat` follows the window: GL_SRGB8_ALPHA8 when the app renders with GL_FRAMEBUFFER_SRGB.
+    bool init(GLuint program, int width, int height, GLenum colorFormat = GL_RGBA8) {
+        if (!program) return false;
+        program_ = program;
+        width_ = width; height_ = height;
+        glGenTextures(1, &color_);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, color_);
+        trackedTexImage3D(GL_TEXTURE_2D_ARRAY, color_, 0, (GLint)colorFormat, width, height, kMaxViews - 1, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glGenTextures(1, &depth_);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depth_);
+        trackedTexImage3D(GL_TEXTURE_2D_ARRAY, depth_, 0, GL_DEPTH_COMPONENT24, width, height, kMaxViews - 1,
+                          GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &fbo_);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color_, 0);   // layered attachments
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_, 0);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glGenFramebuffers(1, &readFbo_);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glGenBuffers(1, &instanceVBO_);
+        if (!complete) { shutdown(); return false; }
+        viewProjLoc_ = glGetUniformLocation(program_, "viewProj");
+        viewCountLoc_ = glGetUniformLocation(program_, "viewCount");
+        return true;
+    }
+
+    void shutdown() {
+        if (fbo_) glDeleteFramebuffers(1, &fbo_);
+        if (readFbo_) glDeleteFramebuffers(1, &readFbo_);
+        if (instanceVBO_) trackedDeleteBuffers(1, &instanceVBO_);
+        if (color_) trackedDeleteTextures(1, &color_);
+        if (depth_) trackedDeleteTextures(1, &depth_);
+        fbo_ = readFbo_ = instanceVBO_ = color_ = depth_ = 0;
+        program_ = 0;
+    }
+
+    bool ready() const { return fbo_ != 0; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    GLuint program() const { return program_; }
+
+    // Uploads the frame's instance list (shared by every mesh drawn this frame),
+    // binds the layered target and clears every layer. `cams[1..viewCount-1]` are the layers.
+    void begin(const ViewInstance* inst, int count, const Camera* cams, int viewCount) {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO_);
+        GLsizeiptr bytes = (GLsizeiptr)count * sizeof(ViewInstance);
+        if (bytes > instanceBytes_) {
+            trackedBufferData(GL_ARRAY_BUFFER, instanceVBO_, bytes, inst, GL_STREAM_DRAW);
+            instanceBytes_ = bytes;
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, instanceBytes_, nullptr, GL_STREAM_DRAW);   // orphan
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, inst);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+        glViewport(0, 0, width_, height_);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glUseProgram(program_);
+        float vp[16 * (kMaxViews - 1)];
+        int layers = std::min(viewCount, kMaxViews) - 1;
+        for (int v = 0; v < layers; ++v) memcpy(vp + 16 * v, glm::value_ptr(cams[v + 1].viewProj), 16 * sizeof(float));
+        glUniformMatrix4fv(viewProjLoc_, layers, GL_FALSE, vp);
+        glUniform1i(viewCountLoc_, layers);
+    }
+
+    // `vao` holds the mesh's own attributes (0..3); the instance stream (4..8) is
+    // pointed at instances [first, first + count) here, since GL 3.3 has no base instance.
+    void draw(GLuint vao, GLsizei vertexCount, GLsizei indexCount, GLenum indexType, int first, int count) {
+        if (!vao || count <= 0) return;
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO_);
+        const size_t base = (size_t)first * sizeof(ViewInstance);
+        for (int c = 0; c < 4; ++c) {
+            glVertexAttribPointer(4 + c, 4, GL_FLOAT, GL_FALSE, sizeof(ViewInstance), (void*)(base + c * 4 * sizeof(float)));
+            glVertexAttribDivisor(4 + c, 1);
+            glEnableVertexAttribArray(4 + c);
+        }
+        glVertexAttribIPointer(8, 1, GL_UNSIGNED_INT, sizeof(ViewInstance), (void*)(base + offsetof(ViewInstance, viewMask)));
+        glVertexAttribDivisor(8, 1);
+        glEnableVertexAttribArray(8);
+        if (indexCount) glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, count);
+        else glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, count);
+    }
+
+    // Back to the window, then copies layer i into rects[i] (x, y, w, h; GL window coordinates).
+    void end(int fbW, int fbH, const int (*rects)[4], int layers) {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo_);
+        for (int i = 0; i < layers; ++i) {
+            glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color_, 0, i);
+            const int* r = rects[i];
+            glBlitFramebuffer(0, 0, width_, height_, r[0], r[1], r[0] + r[2], r[1] + r[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, fbW, fbH);
+    }
+
+private:
+    GLuint program_ = 0, fbo_ = 0, readFbo_ = 0, color_ = 0, depth_ = 0, instanceVBO_ = 0;
+    GLint viewProjLoc_ = -1, viewCountLoc_ = -1;
+    GLsizeiptr instanceBytes_ = 0;
+    int width_ = 0, height_ = 0;
+};
@@ -0,0 +1,604 @@
+#pragma once
+// ---------------- N-Body Gravity ----------------
+// Satellites under their mutual gravity plus a fixed central mass at the origin
+// (the sun). Bodies are kept as structure-of-arrays, so the per-body loops are
+// plain float streams, and index i is body i for its whole life.
+//
+// Each step rebuilds a Barnes-Hut octree, O(n log n) instead of O(n^2):
+//   1. Morton codes (10 bits per axis) are radix sorted in parallel, and the
+//      positions and masses are gathered into that order, so every tree cell
+//      is a contiguous range of bodies.
+//   2. The tree is a flat depth-first node array with skip links (`next` is
+//      the node after a cell's subtree), so a walk is a loop over an array.
+//      Subtrees below kParallelLevels are built in parallel and spliced in.
+//   3. Forces are computed per group (the largest cells of at most groupSize
+//      bodies): the group walks the tree once, opening a cell when size >=
+//      theta * distance-to-group, and collects accepted cells and bodies into
+//      an interaction list. Each body in the group then sums over the list
+//      with a 4-wide SSE kernel, so the walk is paid once per group.
+// computeForcesDirect() is the O(n^2) reference, with the same kernel.
+//
+// step() advances by dt with one of three integrators, each a handful of SIMD
+// passes over the arrays: symplectic Euler and leapfrog (kick-drift-kick,
+// velocity Verlet) cost one force evaluation per step, RK4 four. Leapfrog is
+// the default: symplectic and time-reversible, so energy errors stay bounded
+// over long runs instead of drifting, as long as dt is fixed.
+//
+// Results never depend on the thread count: every sum runs in a fixed order
+// (interaction lists in tree order, SIMD lanes folded in a fixed pattern,
+// centres of mass child by child). With params.deterministic the force kernel
+// also swaps rsqrt, whose low bits differ between CPU vendors, for a correctly
+// rounded sqrt and divide, so a headless run gives the same bits on any IEEE
+// machine. Nothing in this header is contracted into FMAs (see the pragmas
+// below), since fused and unfused operations round differently.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NBODY_SSE 1
+#endif
+#include "radix_sort.h"
+#include "worker_pool.h"
+
+#if defined(__clang__)
+#pragma float_control(push)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+enum class NBodyIntegrator { SymplecticEuler, Leapfrog, RK4 };
+
+inline const char* nbodyIntegratorName(NBodyIntegrator i) {
+    switch (i) {
+        case NBodyIntegrator::SymplecticEuler: return "euler";
+        case NBodyIntegrator::Leapfrog: return "leapfrog";
+        case NBodyIntegrator::RK4: return "rk4";
+    }
+    return "?";
+}
+
+inline bool nbodyParseIntegrator(const std::string& name, NBodyIntegrator& out) {
+    for (NBodyIntegrator i : { NBodyIntegrator::SymplecticEuler, NBodyIntegrator::Leapfrog, NBodyIntegrator::RK4 })
+        if (name == nbodyIntegratorName(i)) { out = i; return true; }
+    return false;
+}
+
+struct NBodyParams {
+    float G = 1.0f;
+    float centralMass = 20.0f;     // fixed at the origin
+    float softening = 0.02f;       // Plummer softening length
+    float theta = 0.5f;            // opening angle; 0 opens every cell (exact, slow)
+    int   leafSize = 8;
+    int   groupSize = 128;          // bodies sharing one tree walk
+    NBodyIntegrator integrator = NBodyIntegrator::Leapfrog;
+    bool  deterministic = false;   // same bits on every machine (exact sqrt, no rsqrt)
+};
+
+struct NBodyStats {
+    double sortMs = 0.0, buildMs = 0.0, forceMs = 0.0, integrateMs = 0.0;
+    size_t nodes = 0, groups = 0;
+    int    forceEvals = 0;         // per step: 1, or 4 for RK4
+    double interactions = 0.0;     // body-cell and body-body pairs, summed over the step's force evaluations
+};
+
+// out += sum_k m_k * d_k / (|d_k|^2 + eps2)^1.5, with d_k = p_k - (x, y, z).
+// A body in its own list adds nothing (d = 0). Exact: 1/sqrt correctly rounded
+// in every lane (and in the tail), instead of rsqrt refined by a Newton step.
+template <bool Exact>
+inline void nbodyAccumulate(const float* lx, const float* ly, const float* lz, const float* lm, size_t n,
+                            float x, float y, float z, float eps2, float out[3]) {
+    size_t k = 0;
+    float sx = 0.0f, sy = 0.0f, sz = 0.0f;
+#if NBODY_SSE
+    const __m128 px = _mm_set1_ps(x), py = _mm_set1_ps(y), pz = _mm_set1_ps(z), e2 = _mm_set1_ps(eps2);
+    const __m128 half = _mm_set1_ps(0.5f), threeHalves = _mm_set1_ps(1.5f), one = _mm_set1_ps(1.0f);
+    __m128 ax = _mm_setzero_ps(), ay = _mm_setzero_ps(), az = _mm_setzero_ps();
+    for (; k + 4 <= n; k += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(lx + k), px);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(ly + k), py);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(lz + k), pz);
+        __m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_add_ps(_mm_mul_ps(dz, dz), e2));
+        __m128 inv;
+        if (Exact) {
+            inv = _mm_div_ps(one, _mm_sqrt_ps(r2));
+        } else {
+            inv = _mm_rsqrt_ps(r2);   // 12 bits; one Newton step brings it to ~22
+            inv = _mm_mul_ps(inv, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, r2), _mm_mul_ps(inv, inv))));
+        }
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(lm + k), _mm_mul_ps(inv, _mm_mul_ps(inv, inv)));
+        ax = _mm_add_ps(ax, _mm_mul_ps(dx, s));
+        ay = _mm_add_ps(ay, _mm_mul_ps(dy, s));
+        az = _mm_add_ps(az, _mm_mul_ps(dz, s));
+    }
+    alignas(16) float lanes[3][4];
+    _mm_store_ps(lanes[0], ax); _mm_store_ps(lanes[1], ay); _mm_store_ps(lanes[2], az);
+    sx = (lanes[0][0] + lanes[0][1]) + (lanes[0][2] + lanes[0][3]);
+    sy = (lanes[1][0] + lanes[1][1]) + (lanes[1][2] + lanes[1][3]);
+    sz = (lanes[2][0] + lanes[2][1]) + (lanes[2][2] + lanes[2][3]);
+#else
+    // Same four running sums and fold as the SSE path, so both round alike.
+    float lanes[3][4] = {};
+    for (; k + 4 <= n; k += 4)
+        for (int l = 0; l < 4; ++l) {
+            float dx = lx[k + l] - x, dy = ly[k + l] - y, dz = lz[k + l] - z;
+            float r2 = (dx * dx + dy * dy) + (dz * dz + eps2);
+            float inv = 1.0f / std::sqrt(r2);   // no rsqrt here, so always exact
+            float s = lm[k + l] * (inv * (inv * inv));
+            lanes[0][l] += dx * s; lanes[1][l] += dy * s; lanes[2][l] += dz * s;
+        }
+    sx = (lanes[0][0] + lanes[0][1]) + (lanes[0][2] + lanes[0][3]);
+    sy = (lanes[1][0] + lanes[1][1]) + (lanes[1][2] + lanes[1][3]);
+    sz = (lanes[2][0] + lanes[2][1]) + (lanes[2][2] + lanes[2][3]);
+#endif
+    for (; k < n; ++k) {
+        float dx = lx[k] - x, dy = ly[k] - y, dz = lz[k] - z;
+        float inv = 1.0f / std::sqrt(dx * dx + dy * dy + dz * dz + eps2);
+        float s = lm[k] * inv * inv * inv;
+        sx += dx * s; sy += dy * s; sz += dz * s;
+    }
+    out[0] += sx; out[1] += sy; out[2] += sz;
+}
+
+// dst = a + s * b over n floats; dst may alias a or b. The SIMD and scalar
+// paths round identically (one multiply, one add).
+inline void nbodyMulAdd(float* dst, const float* a, float s, const float* b, size_t n) {
+    size_t i = 0;
+#if NBODY_SSE
+    const __m128 vs = _mm_set1_ps(s);
+    for (; i + 4 <= n; i += 4) _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_mul_ps(vs, _mm_loadu_ps(b + i))));
+#endif
+    for (; i < n; ++i) dst[i] = a[i] + s * b[i];
+}
+
+class NBodySystem {
+public:
+    std::vector<float> x, y, z, vx, vy, vz, ax, ay, az, m;
+    NBodyParams params;
+
+    size_t size() const { return x.size(); }
+
+    void resize(size_t n) {
+        for (std::vector<float>* v : { &x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &m }) v->assign(n, 0.0f);
+        accelValid_ = false;
+    }
+
+    // Call after editing positions, masses or force params directly.
+    void invalidateForces() { accelValid_ = false; }
+
+    // n satellites in a thin disc between rInner and rOuter (even surface
+    // density) on circular orbits around the central mass, counter-clockwise
+    // seen from +y like the scripted orbits. Same seed, same disc.
+    void seedDisc(size_t n, float rInner, float rOuter, float totalMass, uint32_t seed = 1) {
+        resize(n);
+        uint32_t s = seed ? seed : 1;
+        auto rnd = [&s] {   // xorshift32 in [0, 1)
+            s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+            return (s >> 8) * (1.0f / 16777216.0f);
+        };
+        const float in2 = rInner * rInner, out2 = rOuter * rOuter;
+        for (size_t i = 0; i < n; ++i) {
+            float u = rnd();
+            float r = std::sqrt(in2 + (out2 - in2) * u);
+            float c, s2, len2;   // direction by rejection instead of cos/sin, whose last bits vary between libms
+            do { c = 2.0f * rnd() - 1.0f; s2 = 2.0f * rnd() - 1.0f; len2 = c * c + s2 * s2; } while (len2 > 1.0f || len2 < 1e-4f);
+            float invLen = 1.0f / std::sqrt(len2);
+            c *= invLen; s2 *= invLen;
+            float h = (rnd() + rnd() - 1.0f) * 0.02f * r;
+            float enclosed = params.centralMass + totalMass * u;
+            float v = std::sqrt(params.G * enclosed / r) * (1.0f + 0.02f * (rnd() - 0.5f));
+            x[i] = c * r; y[i] = h; z[i] = s2 * r;
+            vx[i] = -s2 * v; vy[i] = 0.0f; vz[i] = c * v;
+            m[i] = n ? totalMass / n : 0.0f;
+        }
+    }
+
+    // Barnes-Hut accelerations into ax/ay/az.
+    void computeForces(WorkerPool& pool) {
+        stats_ = NBodyStats();
+        evaluateForces(pool);
+    }
+
+    // O(n^2) accelerations for bodies [first, first + count); the reference and the baseline.
+    void computeForcesDirect(WorkerPool& pool, size_t first = 0, size_t count = SIZE_MAX) {
+        const size_t n = size();
+        if (first >= n) return;
+        count = std::min(count, n - first);
+        const float eps2 = params.softening * params.softening;
+        pool.parallelFor(count, 16, [&](size_t b, size_t e, unsigned) {
+            for (size_t i = first + b; i < first + e; ++i) {
+                float a[3] = { 0.0f, 0.0f, 0.0f };
+                if (params.deterministic) nbodyAccumulate<true>(x.data(), y.data(), z.data(), m.data(), n, x[i], y[i], z[i], eps2, a);
+                else nbodyAccumulate<false>(x.data(), y.data(), z.data(), m.data(), n, x[i], y[i], z[i], eps2, a);
+                storeAccel(i, x[i], y[i], z[i], a);
+            }
+        });
+    }
+
+    // Advances every body by dt with params.integrator. Leapfrog reuses the
+    // previous step's end-of-step forces, so keep dt fixed for it to stay symplectic.
+    void step(float dt, WorkerPool& pool) {
+        stats_ = NBodyStats();
+        if (!size()) return;
+        switch (params.integrator) {
+            case NBodyIntegrator::SymplecticEuler:   // kick with a(x), then drift with the new v
+                evaluateForces(pool);
+                integrate(pool, [&](size_t b, size_t e) {
+                    axpy3(vx, vy, vz, dt, ax, ay, az, b, e);
+                    axpy3(x, y, z, dt, vx, vy, vz, b, e);
+                });
+                accelValid_ = false;
+                break;
+            case NBodyIntegrator::Leapfrog:          // half kick, drift, a(x'), half kick
+                if (!accelValid_) evaluateForces(pool);
+                integrate(pool, [&](size_t b, size_t e) {
+                    axpy3(vx, vy, vz, 0.5f * dt, ax, ay, az, b, e);
+                    axpy3(x, y, z, dt, vx, vy, vz, b, e);
+                });
+                evaluateForces(pool);
+                integrate(pool, [&](size_t b, size_t e) { axpy3(vx, vy, vz, 0.5f * dt, ax, ay, az, b, e); });
+                accelValid_ = true;
+                break;
+            case NBodyIntegrator::RK4:
+                stepRK4(dt, pool);
+                accelValid_ = false;
+                break;
+        }
+    }
+
+    const NBodyStats& stats() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static double ms(Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); }
+
+    // Sort, build and tree forces, with their times added to this step's stats.
+    void evaluateForces(WorkerPool& pool) {
+        auto t0 = Clock::now();
+        sortBodies(pool);
+        auto t1 = Clock::now();
+        buildTree(pool);
+        auto t2 = Clock::now();
+        treeForces(pool);
+        auto t3 = Clock::now();
+        stats_.sortMs += ms(t0, t1);
+        stats_.buildMs += ms(t1, t2);
+        stats_.forceMs += ms(t2, t3);
+        stats_.forceEvals++;
+    }
+
+    // fn(begin, end) over body chunks on the pool, timed into integrateMs.
+    template <typename Fn>
+    void integrate(WorkerPool& pool, Fn&& fn) {
+        auto t0 = Clock::now();
+        pool.parallelFor(size(), 16384, [&](size_t b, size_t e, unsigned) { fn(b, e); });
+        stats_.integrateMs += ms(t0, Clock::now());
+    }
+
+    // (dx, dy, dz) += s * (sx, sy, sz) over [b, e).
+    static void axpy3(std::vector<float>& dx, std::vector<float>& dy, std::vector<float>& dz, float s,
+                      const std::vector<float>& sx, const std::vector<float>& sy, const std::vector<float>& sz, size_t b, size_t e) {
+        nbodyMulAdd(&dx[b], &dx[b], s, &sx[b], e - b);
+        nbodyMulAdd(&dy[b], &dy[b], s, &sy[b], e - b);
+        nbodyMulAdd(&dz[b], &dz[b], s, &sz[b], e - b);
+    }
+
+    // Classic RK4 on x'' = a(x). The stage slopes live in place: v holds the
+    // stage's dx/dt and a its dv/dt, x0/v0 the start of the step, and sumX/sumV
+    // the weighted slope sums (k1 + 2 k2 + 2 k3 + k4).
+    void stepRK4(float dt, WorkerPool& pool) {
+        const size_t n = size();
+        for (std::vector<float>* v : { &x0_, &y0_, &z0_, &vx0_, &vy0_, &vz0_, &sumX_, &sumY_, &sumZ_, &sumVx_, &sumVy_, &sumVz_ })
+            v->resize(n);
+        integrate(pool, [&](size_t b, size_t e) {
+            size_t bytes = (e - b) * sizeof(float);
+            memcpy(&x0_[b], &x[b], bytes);   memcpy(&y0_[b], &y[b], bytes);   memcpy(&z0_[b], &z[b], bytes);
+            memcpy(&vx0_[b], &vx[b], bytes); memcpy(&vy0_[b], &vy[b], bytes); memcpy(&vz0_[b], &vz[b], bytes);
+            memcpy(&sumX_[b], &vx[b], bytes); memcpy(&sumY_[b], &vy[b], bytes); memcpy(&sumZ_[b], &vz[b], bytes);
+        });
+        evaluateForces(pool);                                       // k1 = (v0, a(x0))
+        integrate(pool, [&](size_t b, size_t e) {
+            size_t bytes = (e - b) * sizeof(float);
+            memcpy(&sumVx_[b], &ax[b], bytes); memcpy(&sumVy_[b], &ay[b], bytes); memcpy(&sumVz_[b], &az[b], bytes);
+        });
+        const float stageStep[3] = { 0.5f * dt, 0.5f * dt, dt }, stageWeight[3] = { 2.0f, 2.0f, 1.0f };
+        for (int s = 0; s < 3; ++s) {                               // k2, k3, k4
+            const float h = stageStep[s], w = stageWeight[s];
+            integrate(pool, [&](size_t b, size_t e) {
+                const size_t c = e - b;
+                nbodyMulAdd(&x[b], &x0_[b], h, &vx[b], c); nbodyMulAdd(&y[b], &y0_[b], h, &vy[b], c); nbodyMulAdd(&z[b], &z0_[b], h, &vz[b], c);
+                nbodyMulAdd(&vx[b], &vx0_[b], h, &ax[b], c); nbodyMulAdd(&vy[b], &vy0_[b], h, &ay[b], c); nbodyMulAdd(&vz[b], &vz0_[b], h, &az[b], c);
+                nbodyMulAdd(&sumX_[b], &sumX_[b], w, &vx[b], c); nbodyMulAdd(&sumY_[b], &sumY_[b], w, &vy[b], c); nbodyMulAdd(&sumZ_[b], &sumZ_[b], w, &vz[b], c);
+            });
+            evaluateForces(pool);
+            integrate(pool, [&](size_t b, size_t e) { axpy3(sumVx_, sumVy_, sumVz_, w, ax, ay, az, b, e); });
+        }
+        const float sixth = dt / 6.0f;
+        integrate(pool, [&](size_t b, size_t e) {
+            const size_t c = e - b;
+            nbodyMulAdd(&x[b], &x0_[b], sixth, &sumX_[b], c); nbodyMulAdd(&y[b], &y0_[b], sixth, &sumY_[b], c); nbodyMulAdd(&z[b], &z0_[b], sixth, &sumZ_[b], c);
+            nbodyMulAdd(&vx[b], &vx0_[b], sixth, &sumVx_[b], c); nbodyMulAdd(&vy[b], &vy0_[b], sixth, &sumVy_[b], c); nbodyMulAdd(&vz[b], &vz0_[b], sixth, &sumVz_[b], c);
+        });
+    }
+
+    static const int kMortonBits = 10;        // per axis; the tree is at most this deep
+    static const int kParallelLevels = 3;     // top levels built serially, up to 8^3 subtree tasks
+    static const uint32_t kLeaf = 0x80000000u;
+
+    struct Node {
+        float cx, cy, cz, mass;               // centre of mass
+        float size;                           // cell edge length
+        uint32_t next;                        // first node after this subtree
+        uint32_t begin, count;                // body range in sorted order; count | kLeaf
+    };
+    struct Task { uint32_t begin, end; int level; };
+
+    struct InteractionList {
+        std::vector<float> x, y, z, m;
+        size_t n = 0;
+        void reserve(size_t cap) {
+            if (cap <= x.size()) return;
+            cap = std::max(cap, x.size() * 2);
+            x.resize(cap); y.resize(cap); z.resize(cap); m.resize(cap);
+        }
+        void push(float px, float py, float pz, float pm) {
+            reserve(n + 1);
+            x[n] = px; y[n] = py; z[n] = pz; m[n] = pm; ++n;
+        }
+        void append(const float* px, const float* py, const float* pz, const float* pm, size_t count) {
+            reserve(n + count);
+            memcpy(&x[n], px, count * sizeof(float)); memcpy(&y[n], py, count * sizeof(float));
+            memcpy(&z[n], pz, count * sizeof(float)); memcpy(&m[n], pm, count * sizeof(float));
+            n += count;
+        }
+    };
+
+    static uint32_t expandBits(uint32_t v) {   // 10 bits -> every third bit of 30
+        v &= 0x3ff;
+        v = (v | (v << 16)) & 0x030000ffu;
+        v = (v | (v << 8)) & 0x0300f00fu;
+        v = (v | (v << 4)) & 0x030c30c3u;
+        v = (v | (v << 2)) & 0x09249249u;
+        return v;
+    }
+
+    // Accelerations of body i at (px, py, pz) from the pairwise sum `a` plus the central mass.
+    void storeAccel(size_t i, float px, float py, float pz, const float a[3]) {
+        const float eps2 = params.softening * params.softening;
+        float inv = 1.0f / std::sqrt(px * px + py * py + pz * pz + eps2);
+        float c = params.centralMass * inv * inv * inv;
+        ax[i] = params.G * (a[0] - px * c);
+        ay[i] = params.G * (a[1] - py * c);
+        az[i] = params.G * (a[2] - pz * c);
+    }
+
+    // Bounds, Morton codes, the parallel radix sort (radix_sort.h) and the
+    // gather of positions and masses into sorted order.
+    void sortBodies(WorkerPool& pool) {
+        const size_t n = size();
+        const unsigned chunks = pool.size();
+        const size_t chunkSize = (n + chunks - 1) / chunks;
+        auto chunkRange = [&](size_t c, size_t& b, size_t& e) { b = std::min(n, c * chunkSize); e = std::min(n, b + chunkSize); };
+
+        chunkBounds_.assign(chunks * 6, 0.0f);
+        pool.parallelFor(chunks, 1, [&](size_t c0, size_t c1, unsigned) {
+            for (size_t c = c0; c < c1; ++c) {
+                size_t b, e;
+                chunkRange(c, b, e);
+                float lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+                for (size_t i = b; i < e; ++i) {
+                    lo[0] = std::min(lo[0], x[i]); hi[0] = std::max(hi[0], x[i]);
+                    lo[1] = std::min(lo[1], y[i]); hi[1] = std::max(hi[1], y[i]);
+                    lo[2] = std::min(lo[2], z[i]); hi[2] = std::max(hi[2], z[i]);
+                }
+                memcpy(&chunkBounds_[c * 6], lo, sizeof(lo));
+                memcpy(&chunkBounds_[c * 6 + 3], hi, sizeof(hi));
+            }
+        });
+        float lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+        for (unsigned c = 0; c < chunks; ++c)
+            for (int k = 0; k < 3; ++k) { lo[k] = std::min(lo[k], chunkBounds_[c * 6 + k]); hi[k] = std::max(hi[k], chunkBounds_[c * 6 + 3 + k]); }
+        rootSize_ = std::max({ hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2], 1e-6f }) * 1.0001f;
+
+        codes_.resize(n); order_.resize(n);
+        const float q = (1 << kMortonBits) / rootSize_;
+        pool.parallelFor(n, 16384, [&](size_t b, size_t e, unsigned) {
+            for (size_t i = b; i < e; ++i) {
+                uint32_t qx = std::min(1023u, (uint32_t)((x[i] - lo[0]) * q));
+                uint32_t qy = std::min(1023u, (uint32_t)((y[i] - lo[1]) * q));
+                uint32_t qz = std::min(1023u, (uint32_t)((z[i] - lo[2]) * q));
+                codes_[i] = (expandBits(qx) << 2) | (expandBits(qy) << 1) | expandBits(qz);
+                order_[i] = (uint32_t)i;
+            }
+        });
+
+        sorter_.sort(pool, codes_, order_, 3 * kMortonBits);
+
+        px_.resize(n); py_.resize(n); pz_.resize(n); pm_.resize(n);
+        pool.parallelFor(n, 16384, [&](size_t b, size_t e, unsigned) {
+            for (size_t i = b; i < e; ++i) {
+                uint32_t j = order_[i];
+                px_[i] = x[j]; py_[i] = y[j]; pz_[i] = z[j]; pm_[i] = m[j];
+            }
+        });
+    }
+
+    bool isLeafCell(uint32_t begin, uint32_t end, int level) const {
+        return end - begin <= (uint32_t)std::max(1, params.leafSize) || level == kMortonBits;
+    }
+
+    // Calls fn(begin, end) for each non-empty child cell of [begin, end) at `level`, in Morton order.
+    template <typename Fn>
+    void forEachChild(uint32_t begin, uint32_t end, int level, Fn&& fn) const {
+        const int shift = 3 * (kMortonBits - 1 - level);
+        const uint32_t base = codes_[begin] & ~((1u << (shift + 3)) - 1);
+        const uint32_t* codes = codes_.data();
+        for (uint32_t c = 0, b = begin; c < 8 && b < end; ++c) {
+            uint32_t e = (uint32_t)(std::lower_bound(codes + b, codes + end, base + ((c + 1) << shift)) - codes);
+            if (e > b) fn(b, e);
+            b = e;
+        }
+    }
+
+    // Centre of mass of a node from its bodies (leaf) or its children (`nodes[self + 1 .. next)`).
+    void finishNode(std::vector<Node>& nodes, uint32_t self, bool leaf) const {
+        Node& nd = nodes[self];
+        double mass = 0.0, cx = 0.0, cy = 0.0, cz = 0.0;
+        if (leaf) {
+            for (uint32_t i = nd.begin; i < nd.begin + (nd.count & ~kLeaf); ++i) {
+                mass += pm_[i]; cx += (double)pm_[i] * px_[i]; cy += (double)pm_[i] * py_[i]; cz += (double)pm_[i] * pz_[i];
+            }
+        } else {
+            for (uint32_t c = self + 1; c < nd.next; c = nodes[c].next) {
+                const Node& ch = nodes[c];
+                mass += ch.mass; cx += (double)ch.mass * ch.cx; cy += (double)ch.mass * ch.cy; cz += (double)ch.mass * ch.cz;
+            }
+        }
+        nd.mass = (float)mass;
+        if (mass > 0.0) { nd.cx = (float)(cx / mass); nd.cy = (float)(cy / mass); nd.cz = (float)(cz / mass); }
+        else { nd.cx = px_[nd.begin]; nd.cy = py_[nd.begin]; nd.cz = pz_[nd.begin]; }
+    }
+
+    uint32_t pushNode(std::vector<Node>& nodes, uint32_t begin, uint32_t end, int level) const {
+        Node nd;
+        nd.cx = nd.cy = nd.cz = nd.mass = 0.0f;
+        nd.size = rootSize_ / (float)(1u << level);
+        nd.next = 0;
+        nd.begin = begin; nd.count = end - begin;
+        nodes.push_back(nd);
+        return (uint32_t)nodes.size() - 1;
+    }
+
+    // Subtree of [begin, end) into `nodes`, indices relative to the start of `nodes`.
+    void buildSubtree(std::vector<Node>& nodes, uint32_t begin, uint32_t end, int level) const {
+        uint32_t self = pushNode(nodes, begin, end, level);
+        bool leaf = isLeafCell(begin, end, level);
+        if (leaf) nodes[self].count |= kLeaf;
+        else forEachChild(begin, end, level, [&](uint32_t b, uint32_t e) { buildSubtree(nodes, b, e, level + 1); });
+        nodes[self].next = (uint32_t)nodes.size();
+        finishNode(nodes, self, leaf);
+    }
+
+    void planTasks(uint32_t begin, uint32_t end, int level) {
+        if (level == kParallelLevels || isLeafCell(begin, end, level)) { tasks_.push_back({ begin, end, level }); return; }
+        forEachChild(begin, end, level, [&](uint32_t b, uint32_t e) { planTasks(b, e, level + 1); });
+    }
+
+    // Same recursion as planTasks(): top nodes in place, task subtrees spliced in with their links rebased.
+    void emitTop(uint32_t begin, uint32_t end, int level, size_t& task) {
+        if (level == kParallelLevels || isLeafCell(begin, end, level)) {
+            const std::vector<Node>& sub = taskNodes_[task++];
+            const uint32_t base = (uint32_t)nodes_.size();
+            for (Node nd : sub) { nd.next += base; nodes_.push_back(nd); }
+            return;
+        }
+        uint32_t self = pushNode(nodes_, begin, end, level);
+        forEachChild(begin, end, level, [&](uint32_t b, uint32_t e) { emitTop(b, e, level + 1, task); });
+        nodes_[self].next = (uint32_t)nodes_.size();
+        finishNode(nodes_, self, false);
+    }
+
+    void buildTree(WorkerPool& pool) {
+        const uint32_t n = (uint32_t)size();
+        tasks_.clear();
+        planTasks(0, n, 0);
+        if (taskNodes_.size() < tasks_.size()) taskNodes_.resize(tasks_.size());
+        pool.parallelFor(tasks_.size(), 1, [&](size_t b, size_t e, unsigned) {
+            for (size_t t = b; t < e; ++t) {
+                taskNodes_[t].clear();
+                buildSubtree(taskNodes_[t], tasks_[t].begin, tasks_[t].end, tasks_[t].level);
+            }
+        });
+        nodes_.clear();
+        size_t task = 0;
+        emitTop(0, n, 0, task);
+        groups_.clear();
+        const uint32_t groupSize = (uint32_t)std::max(1, params.groupSize);
+        for (uint32_t i = 0; i < nodes_.size();) {
+            const Node& nd = nodes_[i];
+            if ((nd.count & ~kLeaf) <= groupSize || (nd.count & kLeaf)) { groups_.push_back(i); i = nd.next; }
+            else ++i;
+        }
+        stats_.nodes = nodes_.size();
+        stats_.groups = groups_.size();
+    }
+
+    void treeForces(WorkerPool& pool) {
+        if (scratch_.size() < pool.size()) scratch_.resize(pool.size());
+        for (Scratch& s : scratch_) s.interactions = 0.0;
+        const float eps2 = params.softening * params.softening;
+        const float theta2 = params.theta * params.theta;
+        const Node* nodes = nodes_.data();
+        const uint32_t nodeCount = (uint32_t)nodes_.size();
+        pool.parallelFor(groups_.size(), 4, [&](size_t first, size_t last, unsigned worker) {
+            Scratch& s = scratch_[worker];
+            InteractionList& list = s.list;
+            for (size_t g = first; g < last; ++g) {
+                const Node& group = nodes[groups_[g]];
+                const uint32_t gb = group.begin, ge = group.begin + (group.count & ~kLeaf);
+                float lo[3] = { px_[gb], py_[gb], pz_[gb] }, hi[3] = { lo[0], lo[1], lo[2] };
+                for (uint32_t i = gb + 1; i < ge; ++i) {
+                    lo[0] = std::min(lo[0], px_[i]); hi[0] = std::max(hi[0], px_[i]);
+                    lo[1] = std::min(lo[1], py_[i]); hi[1] = std::max(hi[1], py_[i]);
+                    lo[2] = std::min(lo[2], pz_[i]); hi[2] = std::max(hi[2], pz_[i]);
+                }
+                const float gc[3] = { 0.5f * (lo[0] + hi[0]), 0.5f * (lo[1] + hi[1]), 0.5f * (lo[2] + hi[2]) };
+                const float gh[3] = { 0.5f * (hi[0] - lo[0]), 0.5f * (hi[1] - lo[1]), 0.5f * (hi[2] - lo[2]) };
+
+                list.n = 0;
+                for (uint32_t i = 0; i < nodeCount;) {
+                    const Node& nd = nodes[i];
+                    float dx = std::max(0.0f, std::fabs(nd.cx - gc[0]) - gh[0]);
+                    float dy = std::max(0.0f, std::fabs(nd.cy - gc[1]) - gh[1]);
+                    float dz = std::max(0.0f, std::fabs(nd.cz - gc[2]) - gh[2]);
+                    if (nd.size * nd.size < theta2 * (dx * dx + dy * dy + dz * dz)) {
+                        list.push(nd.cx, nd.cy, nd.cz, nd.mass);
+                        i = nd.next;
+                    } else if (nd.count & kLeaf) {
+                        uint32_t b = nd.begin, c = nd.count & ~kLeaf;
+                        list.append(&px_[b], &py_[b], &pz_[b], &pm_[b], c);
+                        i = nd.next;
+                    } else {
+                        ++i;   // open: the first child follows its parent
+                    }
+                }
+                for (uint32_t i = gb; i < ge; ++i) {
+                    float a[3] = { 0.0f, 0.0f, 0.0f };
+                    if (params.deterministic) nbodyAccumulate<true>(list.x.data(), list.y.data(), list.z.data(), list.m.data(), list.n, px_[i], py_[i], pz_[i], eps2, a);
+                    else nbodyAccumulate<false>(list.x.data(), list.y.data(), list.z.data(), list.m.data(), list.n, px_[i], py_[i], pz_[i], eps2, a);
+                    storeAccel(order_[i], px_[i], py_[i], pz_[i], a);
+                }
+                s.interactions += (double)list.n * (ge - gb);
+            }
+        });
+        for (const Scratch& s : scratch_) stats_.interactions += s.interactions;
+    }
+
+    struct Scratch { InteractionList list; double interactions = 0.0; };
+
+    float rootSize_ = 1.0f;
+    std::vector<float> chunkBounds_;
+    std::vector<uint32_t> codes_, order_;
+    RadixSorter sorter_;
+    std::vector<float> px_, py_, pz_, pm_;     // positions and masses in Morton order
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> groups_;            // nodes whose bodies share a walk
+    std::vector<Task> tasks_;
+    std::vector<std::vector<Node>> taskNodes_;
+    std::vector<Scratch> scratch_;
+    std::vector<float> x0_, y0_, z0_, vx0_, vy0_, vz0_, sumX_, sumY_, sumZ_, sumVx_, sumVy_, sumVz_;   // RK4 only
+    bool accelValid_ = false;                  // ax/ay/az match x/y/z (leapfrog's first kick)
+    NBodyStats stats_;
+};
+
+#if defined(__clang__)
+#pragma float_control(pop)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
@@ -0,0 +1,263 @@
+#pragma once
+// ---------------- Number Parsing ----------------
+// Bounded, allocation-free replacements for strtof/strtol on text that is not
+// NUL-terminated (a mapped file, a pack blob).
+// parseFloat() returns the same bits as strtof for every input: decimals with
+// up to 19 significant digits go through Clinger's exact fast path or the
+// Eisel-Lemire algorithm (Lemire, "Number Parsing at a Gigabyte per Second",
+// 2021) over a 128-bit table of powers of five; everything else (more
+// digits, hex floats, inf/nan, a truncated Eisel-Lemire product) is copied out
+// and handed to strtof. The C locale's '.' is assumed.
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace numparse {
+
+// 10^q, q in [-65, 38], as a normalized 128-bit significand (high word first),
+// truncated for q >= 0 and rounded up for q < 0. Outside that range a float
+// with at most 19 digits is 0 or infinity.
+static const int kPow5Min = -65, kPow5Max = 38;
+static const uint64_t kPow5[] = {
+    0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull, 0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull,   // 1e-65, 1e-64
+    0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull, 0x83a3eeeef9153e89ull, 0x1953cf68300424acull,   // 1e-63, 1e-62
+    0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull, 0xcdb02555653131b6ull, 0x3792f412cb06794dull,   // 1e-61, 1e-60
+    0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull, 0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull,   // 1e-59, 1e-58
+    0xc8de047564d20a8bull, 0xf245825a5a445275ull, 0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull,   // 1e-57, 1e-56
+    0x9ced737bb6c4183dull, 0x55464dd69685606bull, 0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull,   // 1e-55, 1e-54
+    0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull, 0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull,   // 1e-53, 1e-52
+    0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull, 0xef73d256a5c0f77cull, 0x963e66858f6d4440ull,   // 1e-51, 1e-50
+    0x95a8637627989aadull, 0xdde7001379a44aa8ull, 0xbb127c53b17ec159ull, 0x5560c018580d5d52ull,   // 1e-49, 1e-48
+    0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull, 0x9226712162ab070dull, 0xcab3961304ca70e8ull,   // 1e-47, 1e-46
+    0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull, 0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull,   // 1e-45, 1e-44
+    0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull, 0xb267ed1940f1c61cull, 0x55f038b237591ed3ull,   // 1e-43, 1e-42
+    0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull, 0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull,   // 1e-41, 1e-40
+    0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull, 0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull,   // 1e-39, 1e-38
+    0x881cea14545c7575ull, 0x7e50d64177da2e54ull, 0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull,   // 1e-37, 1e-36
+    0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull, 0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull,   // 1e-35, 1e-34
+    0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull, 0xcfb11ead453994baull, 0x67de18eda5814af2ull,   // 1e-33, 1e-32
+    0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull, 0xa2425ff75e14fc31ull, 0xa1258379a94d028dull,   // 1e-31, 1e-30
+    0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull, 0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull,   // 1e-29, 1e-28
+    0x9e74d1b791e07e48ull, 0x775ea264cf55347eull, 0xc612062576589ddaull, 0x95364afe032a819eull,   // 1e-27, 1e-26
+    0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull, 0x9abe14cd44753b52ull, 0xc4926a9672793543ull,   // 1e-25, 1e-24
+    0xc16d9a0095928a27ull, 0x75b7053c0f178294ull, 0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull,   // 1e-23, 1e-22
+    0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull, 0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull,   // 1e-21, 1e-20
+    0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull, 0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull,   // 1e-19, 1e-18
+    0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull, 0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull,   // 1e-17, 1e-16
+    0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull, 0xb424dc35095cd80full, 0x538484c19ef38c95ull,   // 1e-15, 1e-14
+    0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull, 0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull,   // 1e-13, 1e-12
+    0xafebff0bcb24aafeull, 0xf78f69a51539d749ull, 0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull,   // 1e-11, 1e-10
+    0x89705f4136b4a597ull, 0x31680a88f8953031ull, 0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull,   // 1e-9, 1e-8
+    0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull, 0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull,   // 1e-7, 1e-6
+    0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull, 0xd1b71758e219652bull, 0xd3c36113404ea4a9ull,   // 1e-5, 1e-4
+    0x83126e978d4fdf3bull, 0x645a1cac083126eaull, 0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull,   // 1e-3, 1e-2
+    0xccccccccccccccccull, 0xcccccccccccccccdull, 0x8000000000000000ull, 0x0000000000000000ull,   // 1e-1, 1e0
+    0xa000000000000000ull, 0x0000000000000000ull, 0xc800000000000000ull, 0x0000000000000000ull,   // 1e1, 1e2
+    0xfa00000000000000ull, 0x0000000000000000ull, 0x9c40000000000000ull, 0x0000000000000000ull,   // 1e3, 1e4
+    0xc350000000000000ull, 0x0000000000000000ull, 0xf424000000000000ull, 0x0000000000000000ull,   // 1e5, 1e6
+    0x9896800000000000ull, 0x0000000000000000ull, 0xbebc200000000000ull, 0x0000000000000000ull,   // 1e7, 1e8
+    0xee6b280000000000ull, 0x0000000000000000ull, 0x9502f90000000000ull, 0x0000000000000000ull,   // 1e9, 1e10
+    0xba43b74000000000ull, 0x0000000000000000ull, 0xe8d4a51000000000ull, 0x0000000000000000ull,   // 1e11, 1e12
+    0x9184e72a00000000ull, 0x0000000000000000ull, 0xb5e620f480000000ull, 0x0000000000000000ull,   // 1e13, 1e14
+    0xe35fa931a0000000ull, 0x0000000000000000ull, 0x8e1bc9bf04000000ull, 0x0000000000000000ull,   // 1e15, 1e16
+    0xb1a2bc2ec5000000ull, 0x0000000000000000ull, 0xde0b6b3a76400000ull, 0x0000000000000000ull,   // 1e17, 1e18
+    0x8ac7230489e80000ull, 0x0000000000000000ull, 0xad78ebc5ac620000ull, 0x0000000000000000ull,   // 1e19, 1e20
+    0xd8d726b7177a8000ull, 0x0000000000000000ull, 0x878678326eac9000ull, 0x0000000000000000ull,   // 1e21, 1e22
+    0xa968163f0a57b400ull, 0x0000000000000000ull, 0xd3c21bcecceda100ull, 0x0000000000000000ull,   // 1e23, 1e24
+    0x84595161401484a0ull, 0x0000000000000000ull, 0xa56fa5b99019a5c8ull, 0x0000000000000000ull,   // 1e25, 1e26
+    0xcecb8f27f4200f3aull, 0x0000000000000000ull, 0x813f3978f8940984ull, 0x4000000000000000ull,   // 1e27, 1e28
+    0xa18f07d736b90be5ull, 0x5000000000000000ull, 0xc9f2c9cd04674edeull, 0xa400000000000000ull,   // 1e29, 1e30
+    0xfc6f7c4045812296ull, 0x4d00000000000000ull, 0x9dc5ada82b70b59dull, 0xf020000000000000ull,   // 1e31, 1e32
+    0xc5371912364ce305ull, 0x6c28000000000000ull, 0xf684df56c3e01bc6ull, 0xc732000000000000ull,   // 1e33, 1e34
+    0x9a130b963a6c115cull, 0x3c7f400000000000ull, 0xc097ce7bc90715b3ull, 0x4b9f100000000000ull,   // 1e35, 1e36
+    0xf0bdc21abb48db20ull, 0x1e86d40000000000ull, 0x96769950b50d88f4ull, 0x1314448000000000ull,   // 1e37, 1e38
+};
+
+inline void mul64(uint64_t a, uint64_t b, uint64_t& hi, uint64_t& lo) {
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 r = (unsigned __int128)a * b;
+    hi = (uint64_t)(r >> 64); lo = (uint64_t)r;
+#else
+    const uint64_t aL = (uint32_t)a, aH = a >> 32, bL = (uint32_t)b, bH = b >> 32;
+    const uint64_t ll = aL * bL, lh = aL * bH, hl = aH * bL, hh = aH * bH;
+    const uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    lo = (mid << 32) | (uint32_t)ll;
+    hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+inline int leadingZeros(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(v);
+#else
+    int n = 0;
+    while (!(v & 0x8000000000000000ull)) { v <<= 1; ++n; }
+    return n;
+#endif
+}
+
+inline int trailingZeros(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(v);
+#else
+    int n = 0;
+    while (!(v & 1)) { v >>= 1; ++n; }
+    return n;
+#endif
+}
+
+// w * 10^q rounded to binary32, as its bits without the sign; false when the
+// truncated product can't decide the rounding. w != 0, q within the table.
+inline bool eiselLemire(uint64_t w, int q, uint32_t& bits) {
+    const int kMantissaBits = 23, kMinExponent = -127, kInfinitePower = 0xFF;
+    const int lz = leadingZeros(w);
+    w <<= lz;
+    const uint64_t* pow5 = &kPow5[2 * (q - kPow5Min)];
+    uint64_t hi, lo;
+    mul64(w, pow5[0], hi, lo);
+    // 23 bits plus 3 (implicit, round, half-way) are needed; widen only when the low ones might carry.
+    const uint64_t precisionMask = 0xFFFFFFFFFFFFFFFFull >> (kMantissaBits + 3);
+    if ((hi & precisionMask) == precisionMask) {
+        uint64_t hi2, lo2;
+        mul64(w, pow5[1], hi2, lo2);
+        lo += hi2;
+        if (hi2 > lo) ++hi;
+        if (lo == 0xFFFFFFFFFFFFFFFFull && (q < -27 || q > 55)) return false;
+    }
+    const int upperBit = (int)(hi >> 63);
+    const int shift = upperBit + 64 - kMantissaBits - 3;
+    uint64_t mantissa = hi >> shift;
+    int power2 = (((152170 + 65536) * q) >> 16) + 63 + upperBit - lz - kMinExponent;
+    if (power2 <= 0) {                                   // subnormal
+        if (-power2 + 1 >= 64) { bits = 0; return true; }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < (1ull << kMantissaBits) ? 0 : 1;
+        bits = (uint32_t)(((uint64_t)power2 << kMantissaBits) | (mantissa & ((1ull << kMantissaBits) - 1)));
+        return true;
+    }
+    // Exactly half-way between two floats: only possible for small q, round to even.
+    if (lo <= 1 && q >= -17 && q <= 10 && (mantissa & 3) == 1 && (mantissa << shift) == hi) mantissa &= ~1ull;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (2ull << kMantissaBits)) { mantissa = 1ull << kMantissaBits; ++power2; }
+    mantissa &= ~(1ull << kMantissaBits);
+    if (power2 >= kInfinitePower) { power2 = kInfinitePower; mantissa = 0; }
+    bits = (uint32_t)(((uint64_t)power2 << kMantissaBits) | mantissa);
+    return true;
+}
+
+inline bool isDigit(char c) { return (unsigned char)(c - '0') < 10; }
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f'; }
+
+// Appends the run of decimal digits at s to w (wrapping past 19 digits),
+// eight bytes per step: a SWAR compare finds where the run ends and one
+// multiply-shift sequence converts it.
+inline const char* readDigits(const char* s, const char* end, uint64_t& w) {
+    static const uint64_t kPow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+    while (end - s >= 8) {
+        uint64_t v;
+        std::memcpy(&v, s, 8);                                            // little-endian: s[0] is the low byte
+        const uint64_t d = v - 0x3030303030303030ull;
+        // High bit of every byte below '0' (borrow) or above '9'; bytes before the first are exact.
+        const uint64_t nonDigit = ((v + 0x4646464646464646ull) | d) & 0x8080808080808080ull;
+        const int n = nonDigit ? trailingZeros(nonDigit) >> 3 : 8;
+        if (n == 0) return s;
+        uint64_t x = d << (8 * (8 - n));                                  // digits to the top, zeros ahead of them
+        x = x * 10 + (x >> 8);
+        x = (((x & 0x000000FF000000FFull) * 0x000F424000000064ull) + (((x >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+        w = w * kPow10[n] + (uint32_t)x;
+        s += n;
+        if (n < 8) return s;
+    }
+    while (s < end && isDigit(*s)) w = w * 10 + (uint64_t)(*s++ - '0');
+    return s;
+}
+
+// The slow path: strtof on a NUL-terminated copy of the token at p.
+inline const char* strtofCopy(const char* p, const char* end, float& out) {
+    const char* e = p;
+    while (e < end && *e && !isSpace(*e)) ++e;
+    char stackToken[64];
+    std::string longToken;
+    char* token = stackToken;
+    const size_t len = (size_t)(e - p);
+    if (len < sizeof(stackToken)) { std::memcpy(stackToken, p, len); stackToken[len] = '\0'; }
+    else { longToken.assign(p, len); token = &longToken[0]; }
+    char* stop;
+    out = std::strtof(token, &stop);
+    return p + (stop - token);
+}
+
+} // namespace numparse
+
+// Parses the float starting exactly at p (no leading whitespace), reading no
+// further than end. Returns one past its last character, or p with out = 0
+// when there is no number, as strtof does.
+inline const char* parseFloat(const char* p, const char* end, float& out) {
+    using namespace numparse;
+    static const float kExact10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+    const char* s = p;
+    const bool negative = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+')) ++s;
+    const char* digits = s;
+    uint64_t w = 0;
+    s = readDigits(s, end, w);
+    const char* intEnd = s;
+    int64_t exponent = 0;
+    if (s < end && *s == '.') {
+        ++s;
+        const char* frac = s;
+        s = readDigits(s, end, w);
+        exponent = -(int64_t)(s - frac);
+    }
+    int64_t digitCount = (int64_t)(s - digits) - (intEnd != s ? 1 : 0);
+    if (digitCount == 0 || (intEnd - digits == 1 && *digits == '0' && s < end && (*s | 0x20) == 'x'))
+        return strtofCopy(p, end, out);                  // inf, nan, hex: not ours
+    if (s < end && (*s | 0x20) == 'e') {
+        const char* e = s + 1;
+        bool negExp = false;
+        if (e < end && (*e == '-' || *e == '+')) negExp = *e++ == '-';
+        if (e < end && isDigit(*e)) {
+            int64_t x = 0;
+            while (e < end && isDigit(*e)) { if (x < 0x10000) x = x * 10 + (*e - '0'); ++e; }
+            exponent += negExp ? -x : x;
+            s = e;
+        }
+    }
+    if (digitCount > 19) {
+        for (const char* z = digits; z < s && (*z == '0' || *z == '.'); ++z) digitCount -= *z == '0';
+        if (digitCount > 19) return strtofCopy(p, end, out);
+    }
+
+    uint32_t bits;
+    if (w == 0 || exponent < kPow5Min) {
+        bits = 0;
+    } else if (exponent > kPow5Max) {
+        bits = 0x7F800000u;
+    } else if (exponent >= -10 && exponent <= 10 && w <= (1ull << 24)) {
+        // Clinger: both operands are exact floats, so one IEEE operation rounds correctly.
+        const float f = exponent < 0 ? (float)w / kExact10[-exponent] : (float)w * kExact10[exponent];
+        std::memcpy(&bits, &f, sizeof(bits));
+    } else if (!eiselLemire(w, (int)exponent, bits)) {
+        return strtofCopy(p, end, out);
+    }
+    if (negative) bits |= 0x80000000u;
+    std::memcpy(&out, &bits, sizeof(out));
+    return s;
+}
+
+// Parses an optionally signed decimal integer at p, as strtol(p, &e, 10) does
+// without its leading whitespace skip. Returns p when there are no digits.
+inline const char* parseInt(const char* p, const char* end, long& out) {
+    const char* s = p;
+    const bool negative = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+')) ++s;
+    if (s == end || !numparse::isDigit(*s)) { out = 0; return p; }
+    uint64_t v = 0;
+    s = numparse::readDigits(s, end, v);
+    out = negative ? -(long)v : (long)v;
+    return s;
+}
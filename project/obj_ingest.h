@@ -0,0 +1,520 @@
+#pragma once
+// ---------------- Out-of-Core OBJ Ingest ----------------
+// Turns an OBJ far larger than memory (photogrammetry scans run to tens of GB)
+// into a clustered mesh (mesh_clusters.h) under a fixed memory cap, where
+// loadOBJ_from_memory() holds the text, the v/vt/vn pools and the expanded
+// triangles all at once. The file is mapped and read front to back twice,
+// each window of it dropped again once parsed:
+//   1. v/vt/vn lines are appended to pool files on disk and positions grow
+//      the bounds. Positions per cell of a grid over the bounds are then
+//      counted from the pool file, and the grid is cut k-d style into
+//      clusters of about `clusterTriangles / 2` vertices (meshes have about
+//      two triangles per vertex) or single cells.
+//   2. f lines are triangulated, their corners read back through a small
+//      block cache over the pools (faces reference vertices written near
+//      them, so it nearly always hits), and each triangle goes to the cluster
+//      holding its centroid. Cluster buffers over their share of the cap are
+//      welded and spilled to a chunk file as .mesh blobs, largest first.
+// Then one cluster at a time: its chunks and the rest of its buffer are
+// merged, get smooth normals where the file gave none and tangents, and are
+// welded and written out. Seams between clusters are not shared, so
+// generated normals and tangents are smooth within a cluster only.
+// The cap covers everything allocated here plus the mapped window not yet
+// released; beyond that, file and pool pages are only page cache.
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mesh_clusters.h"
+#include "mesh_format.h"
+#include "mesh_normals.h"
+#include "mesh_tangents.h"
+#include "obj_loader.h"
+
+struct ObjIngestOptions {
+    size_t memoryCap = (size_t)1 << 30;     // bytes
+    uint32_t clusterTriangles = 1u << 16;   // target; clamped so one cluster's merge fits the cap
+    std::string tempDir;                    // pool and chunk files; empty = next to the output
+};
+
+struct ObjIngestStats {
+    uint64_t fileBytes = 0, positions = 0, uvs = 0, normals = 0, triangles = 0;
+    uint64_t clusters = 0, chunks = 0, spilledBytes = 0, cacheMisses = 0, oversizeClusters = 0;
+    uint32_t grid = 0, clusterTriangles = 0;
+    double pass1Ms = 0.0, pass2Ms = 0.0, mergeMs = 0.0;
+};
+
+namespace ingest {
+
+// Parsing one cluster's triangles back costs about this much, all told:
+// corners, tangent pass, welds and the serialized blob.
+static const size_t kMergeBytesPerTriangle = 1024;
+static const size_t kIoBufferBytes = (size_t)1 << 20;
+
+inline double nowMs() { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+enum class LineKind { V, VT, VN, F, Other };
+
+// Classifies an OBJ line and moves s past its keyword.
+inline LineKind lineKind(char*& s) {
+    while (*s == ' ' || *s == '\t') ++s;
+    if (s[0] == 'v' && (s[1] == ' ' || s[1] == '\t')) { s += 2; return LineKind::V; }
+    if (s[0] == 'v' && s[1] == 't' && (s[2] == ' ' || s[2] == '\t')) { s += 3; return LineKind::VT; }
+    if (s[0] == 'v' && s[1] == 'n' && (s[2] == ' ' || s[2] == '\t')) { s += 3; return LineKind::VN; }
+    if (s[0] == 'f' && (s[1] == ' ' || s[1] == '\t')) { s += 2; return LineKind::F; }
+    return LineKind::Other;
+}
+
+// The OBJ, mapped read-only and walked line by line; windows behind the
+// cursor are released, so however large the file, few of its pages stay resident.
+class MappedText {
+public:
+    ~MappedText() { close(); }
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+        size_ = (size_t)st.st_size;
+        void* p = size_ ? mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base_ = (const char*)p;
+        if (base_) madvise((void*)base_, size_, MADV_SEQUENTIAL);
+        return true;
+    }
+    void close() { if (base_) munmap((void*)base_, size_); base_ = nullptr; size_ = 0; }
+    size_t size() const { return size_; }
+
+    // fn(char* line) gets every line NUL-terminated; returning false stops the
+    // walk. Parsed text is released every `window` bytes.
+    template <class Fn>
+    bool forEachLine(size_t window, const Fn& fn) {
+        const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        char stackLine[512];
+        std::string longLine;
+        const char* cur = base_;
+        const char* end = base_ + size_;
+        size_t released = 0;
+        bool ok = true;
+        while (cur < end && ok) {
+            const char* eol = (const char*)memchr(cur, '\n', end - cur);
+            if (!eol) eol = end;
+            const size_t len = (size_t)(eol - cur);
+            char* line = stackLine;
+            if (len >= sizeof(stackLine)) { longLine.assign(cur, len); line = &longLine[0]; }
+            else { std::memcpy(stackLine, cur, len); stackLine[len] = '\0'; }
+            cur = eol + 1;
+            ok = fn(line);
+            const size_t done = (size_t)(std::min(cur, end) - base_) / page * page;
+            if (done - released >= window) { madvise((void*)(base_ + released), done - released, MADV_DONTNEED); released = done; }
+        }
+        if (base_ && size_ > released) madvise((void*)(base_ + released), size_ - released, MADV_DONTNEED);
+        return ok;
+    }
+
+private:
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Append-only scratch file, read back with pread once flushed; removed on destruction.
+class SpillFile {
+public:
+    ~SpillFile() { if (f_) { std::fclose(f_); std::remove(path_.c_str()); } }
+    bool open(const std::string& path) {
+        path_ = path;
+        f_ = std::fopen(path.c_str(), "w+b");
+        if (!f_) return false;
+        buffer_.resize(kIoBufferBytes);
+        std::setvbuf(f_, buffer_.data(), _IOFBF, buffer_.size());
+        return true;
+    }
+    bool append(const void* data, size_t bytes) { size_ += bytes; return std::fwrite(data, 1, bytes, f_) == bytes; }
+    bool flush() { return std::fflush(f_) == 0; }
+    bool read(uint64_t offset, void* out, size_t bytes) const { return pread(fileno(f_), out, bytes, (off_t)offset) == (ssize_t)bytes; }
+    uint64_t size() const { return size_; }
+
+private:
+    std::FILE* f_ = nullptr;
+    std::string path_;
+    std::vector<char> buffer_;
+    uint64_t size_ = 0;
+};
+
+// Fixed-size least-recently-used cache of blocks of a pool file of `floats`-wide elements.
+class PoolCache {
+public:
+    static const size_t kBlockElements = 16384;
+
+    void init(const SpillFile* file, uint32_t floats, uint64_t count, size_t budgetBytes) {
+        file_ = file; floats_ = floats; count_ = count;
+        const size_t blockBytes = kBlockElements * floats * sizeof(float);
+        const size_t blocks = std::max<size_t>(1, (size_t)((count + kBlockElements - 1) / kBlockElements));
+        const size_t slots = std::min(blocks, std::max<size_t>(4, budgetBytes / blockBytes));
+        data_.assign(slots * kBlockElements * floats, 0.0f);
+        block_.assign(slots, UINT64_MAX);
+        lastUse_.assign(slots, 0);
+        where_.reserve(slots * 2);
+    }
+
+    // Element i, valid until the next get().
+    const float* get(uint64_t i) {
+        const uint64_t block = i / kBlockElements;
+        if (block != hotBlock_) {
+            auto it = where_.find(block);
+            hotSlot_ = it != where_.end() ? it->second : load(block);
+            hotBlock_ = block;
+        }
+        lastUse_[hotSlot_] = ++tick_;
+        return data_.data() + ((size_t)hotSlot_ * kBlockElements + (size_t)(i % kBlockElements)) * floats_;
+    }
+
+    uint64_t misses() const { return misses_; }
+
+private:
+    uint32_t load(uint64_t block) {
+        ++misses_;
+        uint32_t slot = 0;
+        for (uint32_t s = 1; s < block_.size(); ++s) if (lastUse_[s] < lastUse_[slot]) slot = s;
+        if (block_[slot] != UINT64_MAX) where_.erase(block_[slot]);
+        const uint64_t first = block * kBlockElements;
+        const size_t n = (size_t)std::min<uint64_t>(kBlockElements, count_ - first);
+        file_->read(first * floats_ * sizeof(float), data_.data() + (size_t)slot * kBlockElements * floats_, n * floats_ * sizeof(float));
+        block_[slot] = block;
+        where_[block] = slot;
+        return slot;
+    }
+
+    const SpillFile* file_ = nullptr;
+    uint32_t floats_ = 0;
+    uint64_t count_ = 0, tick_ = 0, misses_ = 0, hotBlock_ = UINT64_MAX;
+    uint32_t hotSlot_ = 0;
+    std::vector<float> data_;
+    std::vector<uint64_t> block_, lastUse_;
+    std::unordered_map<uint64_t, uint32_t> where_;
+};
+
+// Grid over the bounds; cell ids run x fastest.
+struct ClusterGrid {
+    uint32_t n = 0;
+    glm::vec3 lo{ 0.0f }, scale{ 0.0f };
+    std::vector<uint32_t> cells;   // counts, then cluster ids
+
+    void init(uint32_t size, const glm::vec3& bmin, const glm::vec3& bmax) {
+        n = size; lo = bmin;
+        const glm::vec3 extent = bmax - bmin;
+        for (int a = 0; a < 3; ++a) scale[a] = extent[a] > 0.0f ? (float)n / extent[a] : 0.0f;
+        cells.assign((size_t)n * n * n, 0);
+    }
+    size_t cellOf(const glm::vec3& p) const {
+        size_t c[3];
+        for (int a = 0; a < 3; ++a) c[a] = (size_t)std::min<float>((float)(n - 1), std::max(0.0f, (p[a] - lo[a]) * scale[a]));
+        return (c[2] * n + c[1]) * n + c[0];
+    }
+
+    // Cuts the box [lo, hi) of cells at its median along the longest axis until
+    // a box holds at most `target` points or is one cell; each box becomes a
+    // cluster, its id written over the counts. Returns the cluster count.
+    uint32_t cut(uint64_t target) {
+        uint32_t clusters = 0;
+        const uint32_t all[3] = { 0, 0, 0 }, full[3] = { n, n, n };
+        uint64_t total = 0;
+        for (uint32_t c : cells) total += c;
+        cutBox(all, full, total, target, clusters);
+        return clusters;
+    }
+
+private:
+    void cutBox(const uint32_t lo3[3], const uint32_t hi3[3], uint64_t count, uint64_t target, uint32_t& clusters) {
+        int axis = -1;
+        for (int a = 0; a < 3; ++a)
+            if (hi3[a] - lo3[a] > 1 && (axis < 0 || hi3[a] - lo3[a] > hi3[axis] - lo3[axis])) axis = a;
+        if (count <= target || axis < 0) {
+            const uint32_t id = clusters++;
+            for (uint32_t z = lo3[2]; z < hi3[2]; ++z)
+                for (uint32_t y = lo3[1]; y < hi3[1]; ++y)
+                    for (uint32_t x = lo3[0]; x < hi3[0]; ++x) cells[((size_t)z * n + y) * n + x] = id;
+            return;
+        }
+        std::vector<uint64_t> slab(hi3[axis] - lo3[axis], 0);
+        for (uint32_t z = lo3[2]; z < hi3[2]; ++z)
+            for (uint32_t y = lo3[1]; y < hi3[1]; ++y)
+                for (uint32_t x = lo3[0]; x < hi3[0]; ++x) {
+                    const uint32_t k[3] = { x, y, z };
+                    slab[k[axis] - lo3[axis]] += cells[((size_t)z * n + y) * n + x];
+                }
+        // First slab past half the points, kept inside so both halves are non-empty boxes.
+        uint64_t below = 0;
+        uint32_t split = lo3[axis] + 1;
+        for (uint32_t k = 0; k + 1 < slab.size(); ++k) {
+            if (below + slab[k] > count / 2 && k > 0) break;
+            below += slab[k];
+            split = lo3[axis] + k + 1;
+        }
+        uint32_t midHi[3] = { hi3[0], hi3[1], hi3[2] }, midLo[3] = { lo3[0], lo3[1], lo3[2] };
+        midHi[axis] = split; midLo[axis] = split;
+        cutBox(lo3, midHi, below, target, clusters);
+        cutBox(midLo, hi3, count - below, target, clusters);
+    }
+};
+
+struct Chunk { uint32_t cluster; uint64_t offset, size; };
+
+} // namespace ingest
+
+// Streams `objPath` into the clustered mesh `outPath`. Vertices come out as
+// pos(3) normal(3) uv(2) tangent(4), as assetc's .mesh files do.
+inline bool ingestOBJ(const std::string& objPath, const std::string& outPath, const ObjIngestOptions& options,
+                      ObjIngestStats& stats, std::string& err) {
+    using namespace ingest;
+    stats = ObjIngestStats();
+    const size_t cap = std::max<size_t>(options.memoryCap, (size_t)16 << 20);
+    std::string tmp = options.tempDir;
+    if (tmp.empty()) { const size_t slash = outPath.find_last_of('/'); tmp = slash == std::string::npos ? "." : outPath.substr(0, slash); }
+    const std::string tmpBase = tmp + "/" + outPath.substr(outPath.find_last_of('/') + 1);
+
+    MappedText text;
+    if (!text.open(objPath)) { err = "cannot map " + objPath; return false; }
+    stats.fileBytes = text.size();
+
+    // Pass 1: pools to disk, bounds.
+    double t0 = nowMs();
+    SpillFile positions, uvs, normals;
+    if (!positions.open(tmpBase + ".v.tmp") || !uvs.open(tmpBase + ".vt.tmp") || !normals.open(tmpBase + ".vn.tmp")) {
+        err = "cannot create spill files in " + tmp; return false;
+    }
+    glm::vec3 bmin(FLT_MAX), bmax(-FLT_MAX);
+    bool wrote = true;
+    const size_t window = std::min<size_t>((size_t)64 << 20, std::max<size_t>(kIoBufferBytes, cap / 16));
+    text.forEachLine(window, [&](char* s) {
+        float f[3];
+        switch (lineKind(s)) {
+            case LineKind::V:
+                parseObjFloats(s, s + std::strlen(s), f, 3);
+                for (int a = 0; a < 3; ++a) { bmin[a] = std::min(bmin[a], f[a]); bmax[a] = std::max(bmax[a], f[a]); }
+                wrote &= positions.append(f, sizeof(float) * 3);
+                ++stats.positions;
+                break;
+            case LineKind::VT:
+                parseObjFloats(s, s + std::strlen(s), f, 2);
+                wrote &= uvs.append(f, sizeof(float) * 2);
+                ++stats.uvs;
+                break;
+            case LineKind::VN:
+                parseObjFloats(s, s + std::strlen(s), f, 3);
+                wrote &= normals.append(f, sizeof(float) * 3);
+                ++stats.normals;
+                break;
+            default: break;
+        }
+        return wrote;
+    });
+    if (!wrote || !positions.flush() || !uvs.flush() || !normals.flush()) { err = "cannot write spill files in " + tmp; return false; }
+    if (!stats.positions) { err = "no vertices"; return false; }
+    if (stats.positions > INT32_MAX || stats.uvs > INT32_MAX || stats.normals > INT32_MAX) { err = "more than 2^31 vertices"; return false; }
+
+    // Clusters: the grid is the largest power of two up to 128 per axis that
+    // fits a sixteenth of the cap, counted from the position pool.
+    uint32_t gridSize = 128;
+    while (gridSize > 1 && (size_t)gridSize * gridSize * gridSize * sizeof(uint32_t) > cap / 16) gridSize /= 2;
+    stats.grid = gridSize;
+    stats.clusterTriangles = (uint32_t)std::max<size_t>(256, std::min<size_t>(options.clusterTriangles, cap / 2 / kMergeBytesPerTriangle));
+    ClusterGrid grid;
+    grid.init(gridSize, bmin, bmax);
+    {
+        std::vector<float> block(kIoBufferBytes / sizeof(float) / 3 * 3);
+        for (uint64_t read = 0; read < stats.positions;) {
+            const size_t n = (size_t)std::min<uint64_t>(block.size() / 3, stats.positions - read);
+            positions.read(read * 3 * sizeof(float), block.data(), n * 3 * sizeof(float));
+            for (size_t i = 0; i < n; ++i) ++grid.cells[grid.cellOf(glm::vec3(block[i * 3], block[i * 3 + 1], block[i * 3 + 2]))];
+            read += n;
+        }
+    }
+    const uint32_t clusterCount = grid.cut(stats.clusterTriangles / 2);
+    stats.pass1Ms = nowMs() - t0;
+
+    // Pass 2: faces into cluster buffers, spilled as welded chunks.
+    t0 = nowMs();
+    const size_t cacheBudget = cap / 4, bufferBudget = cap / 4;
+    PoolCache posCache, uvCache, normalCache;
+    posCache.init(&positions, 3, stats.positions, cacheBudget / 3);
+    uvCache.init(&uvs, 2, stats.uvs, cacheBudget / 3);
+    normalCache.init(&normals, 3, stats.normals, cacheBudget / 3);
+    SpillFile chunkFile;
+    if (!chunkFile.open(tmpBase + ".chunks.tmp")) { err = "cannot create spill files in " + tmp; return false; }
+    std::vector<std::vector<float>> buffers(clusterCount);
+    std::vector<Chunk> chunks;
+    size_t bufferBytes = 0;
+    auto spill = [&](uint32_t c) {
+        std::vector<float>& buf = buffers[c];
+        const std::vector<char> blob = serializeMesh(buildIndexedMesh(buf, 8));
+        chunks.push_back(Chunk{ c, chunkFile.size(), blob.size() });
+        bufferBytes -= buf.capacity() * sizeof(float);
+        std::vector<float>().swap(buf);
+        stats.spilledBytes += blob.size();
+        return chunkFile.append(blob.data(), blob.size());
+    };
+    std::vector<uint32_t> largest;
+    int nv = 0, nvt = 0, nvn = 0;
+    std::vector<ObjCorner> corners;
+    uint64_t lineNo = 0;
+    bool ok = text.forEachLine(window, [&](char* s) {
+        ++lineNo;
+        switch (lineKind(s)) {
+            case LineKind::V: ++nv; return true;
+            case LineKind::VT: ++nvt; return true;
+            case LineKind::VN: ++nvn; return true;
+            case LineKind::F: break;
+            default: return true;
+        }
+        corners.clear();
+        const char* end = s + std::strlen(s);
+        for (const char* p = s;;) {
+            while (*p == ' ' || *p == '\t' || *p == '\r') ++p;
+            ObjCorner c;
+            if (!*p || !parseObjCorner(p, end, c)) break;
+            corners.push_back(c);
+        }
+        for (size_t i = 1; i + 1 < corners.size(); ++i) {
+            const ObjCorner tri[3] = { corners[0], corners[i], corners[i + 1] };
+            float v[24];
+            for (int k = 0; k < 3; ++k) {
+                float* dst = v + k * 8;
+                const int vi = fixIndex(tri[k].v, nv);
+                if (vi < 0 || vi >= nv) { err = "bad vertex index on line " + std::to_string(lineNo); return false; }
+                std::memcpy(dst, posCache.get((uint64_t)vi), 3 * sizeof(float));
+                const int ni = tri[k].vn ? fixIndex(tri[k].vn, nvn) : -1;
+                if (ni >= 0 && ni < nvn) std::memcpy(dst + 3, normalCache.get((uint64_t)ni), 3 * sizeof(float));
+                else dst[3] = dst[4] = dst[5] = 0.0f;
+                const int ti = tri[k].vt ? fixIndex(tri[k].vt, nvt) : -1;
+                if (ti >= 0 && ti < nvt) std::memcpy(dst + 6, uvCache.get((uint64_t)ti), 2 * sizeof(float));
+                else dst[6] = dst[7] = 0.0f;
+            }
+            const glm::vec3 centroid = (glm::vec3(v[0], v[1], v[2]) + glm::vec3(v[8], v[9], v[10]) + glm::vec3(v[16], v[17], v[18])) / 3.0f;
+            const uint32_t c = grid.cells[grid.cellOf(centroid)];
+            std::vector<float>& buf = buffers[c];
+            const size_t before = buf.capacity();
+            buf.insert(buf.end(), v, v + 24);
+            bufferBytes += (buf.capacity() - before) * sizeof(float);
+            ++stats.triangles;
+            if (bufferBytes <= bufferBudget) continue;
+            largest.clear();
+            for (uint32_t b = 0; b < clusterCount; ++b) if (!buffers[b].empty()) largest.push_back(b);
+            std::sort(largest.begin(), largest.end(), [&](uint32_t a, uint32_t b) { return buffers[a].capacity() > buffers[b].capacity(); });
+            for (uint32_t b : largest) {
+                if (bufferBytes <= bufferBudget / 2) break;
+                if (!spill(b)) { err = "cannot write spill files in " + tmp; return false; }
+            }
+        }
+        return true;
+    });
+    text.close();
+    stats.cacheMisses = posCache.misses() + uvCache.misses() + normalCache.misses();
+    if (!ok) return false;
+    if (!chunkFile.flush()) { err = "cannot write spill files in " + tmp; return false; }
+    if (!stats.triangles) { err = "no triangles"; return false; }
+    posCache = PoolCache(); uvCache = PoolCache(); normalCache = PoolCache();
+    std::vector<uint32_t>().swap(grid.cells);
+    stats.chunks = chunks.size();
+    stats.pass2Ms = nowMs() - t0;
+
+    // Merge: each cluster's chunks in file order, then its buffer.
+    t0 = nowMs();
+    std::stable_sort(chunks.begin(), chunks.end(), [](const Chunk& a, const Chunk& b) { return a.cluster < b.cluster; });
+    std::vector<uint32_t> present;
+    {
+        std::vector<uint8_t> has(clusterCount, 0);
+        for (const Chunk& ch : chunks) has[ch.cluster] = 1;
+        for (uint32_t c = 0; c < clusterCount; ++c) if (has[c] || !buffers[c].empty()) present.push_back(c);
+    }
+    std::FILE* out = std::fopen(outPath.c_str(), "wb");
+    if (!out) { err = "cannot write " + outPath; return false; }
+    ClusterFileHeader header = {};
+    std::memcpy(header.magic, "GCLU", 4);
+    header.version = kClusterVersion;
+    header.clusterCount = (uint32_t)present.size();
+    header.floatsPerVertex = kMeshFloatsWithTangents;
+    header.triangleCount = stats.triangles;
+    for (int a = 0; a < 3; ++a) { header.boundsMin[a] = bmin[a]; header.boundsMax[a] = bmax[a]; }
+    std::vector<ClusterEntry> entries(present.size());
+    uint64_t offset = sizeof(header) + entries.size() * sizeof(ClusterEntry);
+    bool written = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+                   std::fwrite(entries.data(), sizeof(ClusterEntry), entries.size(), out) == entries.size();
+    std::vector<unsigned char> blob;
+    std::vector<float> merged;
+    std::vector<uint32_t> cornerPos;
+    size_t chunk = 0;
+    for (size_t e = 0; e < present.size() && written; ++e) {
+        const uint32_t c = present[e];
+        merged.clear();
+        for (; chunk < chunks.size() && chunks[chunk].cluster == c; ++chunk) {
+            blob.resize(chunks[chunk].size);
+            MeshView view;
+            if (!chunkFile.read(chunks[chunk].offset, blob.data(), blob.size()) || !parseMeshBlob(blob.data(), blob.size(), view)) {
+                std::fclose(out); err = "cannot read back spill file"; return false;
+            }
+            for (uint32_t i = 0; i < view.indexCount; ++i)
+                merged.insert(merged.end(), view.vertices + (size_t)view.indices[i] * 8, view.vertices + (size_t)view.indices[i] * 8 + 8);
+        }
+        merged.insert(merged.end(), buffers[c].begin(), buffers[c].end());
+        std::vector<float>().swap(buffers[c]);
+        const size_t corners = merged.size() / 8;
+        if (corners / 3 * kMergeBytesPerTriangle > cap / 2) ++stats.oversizeClusters;
+
+        // Normals the file didn't give: corners at bit-identical positions share a vertex.
+        bool missing = false;
+        for (size_t i = 0; i < corners && !missing; ++i) missing = merged[i * 8 + 3] == 0.0f && merged[i * 8 + 4] == 0.0f && merged[i * 8 + 5] == 0.0f;
+        if (missing) {
+            struct PosHash {
+                size_t operator()(const glm::vec3& p) const {
+                    uint32_t b[3];
+                    std::memcpy(b, &p, sizeof(b));
+                    return (size_t)((b[0] * 73856093u) ^ (b[1] * 19349663u) ^ (b[2] * 83492791u));
+                }
+            };
+            std::unordered_map<glm::vec3, uint32_t, PosHash> ids;
+            cornerPos.resize(corners);
+            for (size_t i = 0; i < corners; ++i)
+                cornerPos[i] = ids.emplace(glm::vec3(merged[i * 8], merged[i * 8 + 1], merged[i * 8 + 2]), (uint32_t)ids.size()).first->second;
+            generateSmoothNormals(merged.data(), corners / 3, cornerPos.data(), ids.size());
+        }
+
+        ClusterEntry& entry = entries[e];
+        for (int a = 0; a < 3; ++a) { entry.boundsMin[a] = FLT_MAX; entry.boundsMax[a] = -FLT_MAX; }
+        for (size_t i = 0; i < corners; ++i)
+            for (int a = 0; a < 3; ++a) {
+                entry.boundsMin[a] = std::min(entry.boundsMin[a], merged[i * 8 + a]);
+                entry.boundsMax[a] = std::max(entry.boundsMax[a], merged[i * 8 + a]);
+            }
+        const IndexedMesh mesh = buildIndexedMesh(appendTangents(merged), kMeshFloatsWithTangents);
+        const std::vector<char> bytes = serializeMesh(mesh);
+        static const char zeros[kClusterAlign] = {};
+        const uint64_t aligned = (offset + kClusterAlign - 1) & ~(kClusterAlign - 1);
+        written = std::fwrite(zeros, 1, aligned - offset, out) == aligned - offset &&
+                  std::fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+        entry.offset = aligned;
+        entry.size = bytes.size();
+        entry.triangleCount = (uint32_t)(corners / 3);
+        entry.vertexCount = mesh.vertexCount();
+        offset = aligned + bytes.size();
+    }
+    written = written && std::fseek(out, (long)sizeof(header), SEEK_SET) == 0 &&
+              std::fwrite(entries.data(), sizeof(ClusterEntry), entries.size(), out) == entries.size();
+    written = std::fclose(out) == 0 && written;
+    if (!written) { std::remove(outPath.c_str()); err = "cannot write " + outPath; return false; }
+    stats.clusters = present.size();
+    stats.mergeMs = nowMs() - t0;
+    return true;
+}
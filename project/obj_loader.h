@@ -0,0 +1,137 @@
+#pragma once
+// ---------------- OBJ Loader ----------------
+// Expands OBJ faces into interleaved pos(3) normal(3) uv(2) triangles.
+// Shared by project/app and tools/assetc.
+// Parses in place, without copying lines out: numbers are read straight from
+// the buffer by number_parse.h (SWAR digit runs, Eisel-Lemire floats that are
+// bit-exact with strtof), and the v/vt/vn pools plus the per-face corner list
+// live in a scratch Arena, so a load makes no per-line or per-face heap allocations.
+// Corners without a vn get smooth normals with a crease angle (mesh_normals.h)
+// once the whole file is read.
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory_resource>
+#include <vector>
+#include "arena.h"
+#include "mesh_normals.h"
+#include "number_parse.h"
+
+inline int fixIndex(int idx, int n) {
+    if (idx > 0) return idx - 1;
+    if (idx < 0) return n + idx;
+    return -1;
+}
+
+struct ObjCorner { int v = 0, vt = 0, vn = 0; };   // raw OBJ indices, 0 = absent
+
+// "v", "v/vt", "v//vn" or "v/vt/vn"; advances s past the token, reading no further than end.
+inline bool parseObjCorner(const char*& s, const char* end, ObjCorner& c) {
+    long v;
+    c = ObjCorner();
+    const char* e = parseInt(s, end, v);
+    if (e == s) return false;
+    c.v = (int)v;
+    s = e;
+    if (s == end || *s != '/') return true;
+    ++s;
+    if (s < end && *s != '/') { s = parseInt(s, end, v); c.vt = (int)v; }
+    if (s == end || *s != '/') return true;
+    ++s;
+    s = parseInt(s, end, v); c.vn = (int)v;
+    return true;
+}
+
+// n floats separated by blanks, as repeated strtof calls would read them;
+// missing ones are 0. Returns where the last one ended.
+inline const char* parseObjFloats(const char* s, const char* end, float* f, int n) {
+    for (int k = 0; k < n; ++k) {
+        while (s < end && (*s == ' ' || *s == '\t' || *s == '\r')) ++s;
+        s = parseFloat(s, end, f[k]);
+    }
+    return s;
+}
+
+inline bool loadOBJ_from_memory(const char* text, size_t size, std::vector<float>& out, Arena* scratch = nullptr) {
+    Arena localArena;
+    Arena& arena = scratch ? *scratch : localArena;
+    Arena::Marker scratchStart = arena.mark();
+    bool ok = true;
+    const size_t outStart = out.size();
+    bool missingNormals = false;
+    {
+        ArenaResource res(arena);
+        std::pmr::vector<glm::vec3> V(&res);
+        std::pmr::vector<glm::vec2> VT(&res);
+        std::pmr::vector<glm::vec3> VN(&res);
+        std::pmr::vector<ObjCorner> corners(&res);
+        std::pmr::vector<uint32_t> cornerPos(&res);   // position index of every corner written, for missing normals
+
+        const char* cur = text;
+        const char* end = text + size;
+        while (cur < end && ok) {
+            const char* s = cur;
+            while (s < end && (*s == ' ' || *s == '\t')) ++s;
+            const char c0 = s < end ? s[0] : '\n', c1 = end - s > 1 ? s[1] : '\n', c2 = end - s > 2 ? s[2] : '\n';
+            if (c0 == 'v' && (c1 == ' ' || c1 == '\t')) {
+                float f[3];
+                s = parseObjFloats(s + 2, end, f, 3);
+                V.push_back(glm::vec3(f[0], f[1], f[2]));
+            } else if (c0 == 'v' && c1 == 't' && (c2 == ' ' || c2 == '\t')) {
+                float f[2];
+                s = parseObjFloats(s + 3, end, f, 2);
+                VT.push_back(glm::vec2(f[0], f[1]));
+            } else if (c0 == 'v' && c1 == 'n' && (c2 == ' ' || c2 == '\t')) {
+                float f[3];
+                s = parseObjFloats(s + 3, end, f, 3);
+                VN.push_back(glm::vec3(f[0], f[1], f[2]));
+            } else if (c0 == 'f' && (c1 == ' ' || c1 == '\t')) {
+                corners.clear();
+                s += 2;
+                for (;;) {
+                    while (s < end && (*s == ' ' || *s == '\t' || *s == '\r')) ++s;
+                    ObjCorner c;
+                    if (s == end || *s == '\n' || !parseObjCorner(s, end, c)) break;
+                    corners.push_back(c);
+                }
+                for (size_t i = 1; i + 1 < corners.size() && ok; ++i) {
+                    const ObjCorner tri[3] = { corners[0], corners[i], corners[i + 1] };
+                    float v[24];
+                    for (int k = 0; k < 3; ++k) {
+                        const ObjCorner& c = tri[k];
+                        float* dst = v + 8 * k;
+                        int vi = fixIndex(c.v, (int)V.size());
+                        if (vi < 0 || vi >= (int)V.size()) { ok = false; break; }
+                        glm::vec3 p = V[vi];
+                        dst[0] = p.x; dst[1] = p.y; dst[2] = p.z;
+                        cornerPos.push_back((uint32_t)vi);
+
+                        int ni = c.vn ? fixIndex(c.vn, (int)VN.size()) : -1;
+                        if (ni >= 0 && ni < (int)VN.size()) {
+                            glm::vec3 n = VN[ni];
+                            dst[3] = n.x; dst[4] = n.y; dst[5] = n.z;
+                        } else { dst[3] = dst[4] = dst[5] = 0.0f; missingNormals = true; }
+
+                        int ti = c.vt ? fixIndex(c.vt, (int)VT.size()) : -1;
+                        if (ti >= 0 && ti < (int)VT.size()) {
+                            glm::vec2 uv = VT[ti];
+                            dst[6] = uv.x; dst[7] = uv.y;
+                        } else { dst[6] = dst[7] = 0.0f; }
+                    }
+                    if (ok) out.insert(out.end(), v, v + 24);
+                }
+            }
+            // Parsed lines usually stop right at their newline.
+            if (s < end && *s != '\n') {
+                const char* eol = (const char*)memchr(s, '\n', (size_t)(end - s));
+                s = eol ? eol : end;
+            }
+            cur = s + 1;
+        }
+        if (ok && missingNormals)
+            generateSmoothNormals(out.data() + outStart, cornerPos.size() / 3, cornerPos.data(), V.size());
+    }
+    arena.rewind(scratchStart);
+    return ok;
+}
@@ -0,0 +1,146 @@
+#pragma once
+// ---------------- GPU Particles ----------------
+// Debris thrown off the emissive planet, simulated entirely on the GPU with GL
+// 3.3 transform feedback. Particles live in fixed slots of two buffers; each
+// frame one point per slot is drawn with the rasterizer off, the update shader
+// (assets/shaders/particles_update.vert) reads the slot from one buffer and
+// transform feedback writes it to the other, then the two swap. A slot whose
+// particle died respawns in that same pass, so emission is a shader decision
+// too and the CPU never touches a particle after init. Positions are kept
+// relative to the planet, which moves on a scripted orbit.
+// Drawing reads the current buffer as GL_POINTS: soft point sprites sized by
+// distance and added into the frame, so their order doesn't matter.
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "gl_memory.h"
+#include "gpu_timer.h"
+
+// What the update shader captures, in this order (GL_INTERLEAVED_ATTRIBS).
+static const char* const kParticleVaryings[] = { "outPosAge", "outVelLife" };
+
+struct ParticleStats { size_t count = 0, bytes = 0; float updateMs = 0.0f, drawMs = 0.0f; };
+
+class ParticleSystem {
+public:
+    static const size_t kMaxCount = 4u << 20;
+    static constexpr float kMaxStep = 1.0f / 30.0f;      // a hitch slows the cloud down rather than fling it through the planet
+    static constexpr float kEscapeSpeed = 1.2f;          // sets the planet's pull: launches go up to 0.95 of it
+
+    // `updateProgram` must have been linked with kParticleVaryings as its feedback varyings.
+    bool init(GLuint updateProgram, GLuint drawProgram, size_t count) {
+        if (!updateProgram || !drawProgram || !count) return false;
+        updateProgram_ = updateProgram; drawProgram_ = drawProgram;
+        stats_.count = std::min(count, kMaxCount);
+        stats_.bytes = 2 * stats_.count * sizeof(Particle);
+        glGenBuffers(2, vbo_);
+        glGenVertexArrays(2, vao_);
+        for (int i = 0; i < 2; ++i) {
+            // Both programs read locations 0 and 1, so one VAO per buffer serves the update and the draw.
+            glBindVertexArray(vao_[i]);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo_[i]);
+            trackedBufferData(GL_ARRAY_BUFFER, vbo_[i], (GLsizeiptr)(stats_.count * sizeof(Particle)), nullptr, GL_DYNAMIC_COPY);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, posAge));
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, velLife));
+            glEnableVertexAttribArray(1);
+        }
+        glBindVertexArray(0);
+        updateTimer_.init();
+        drawTimer_.init();
+
+        radiusLoc_ = glGetUniformLocation(updateProgram_, "radius");
+        dtLoc_ = glGetUniformLocation(updateProgram_, "dt");
+        gmLoc_ = glGetUniformLocation(updateProgram_, "gm");
+        seedLoc_ = glGetUniformLocation(updateProgram_, "seed");
+        resetLoc_ = glGetUniformLocation(updateProgram_, "reset");
+        viewProjLoc_ = glGetUniformLocation(drawProgram_, "viewProj");
+        centerLoc_ = glGetUniformLocation(drawProgram_, "center");
+        pixelsPerUnitLoc_ = glGetUniformLocation(drawProgram_, "pixelsPerUnit");
+        sizeLoc_ = glGetUniformLocation(drawProgram_, "size");
+        intensityLoc_ = glGetUniformLocation(drawProgram_, "intensity");
+        reset_ = true;
+        return true;
+    }
+
+    void shutdown() {
+        if (vbo_[0]) trackedDeleteBuffers(2, vbo_);
+        if (vao_[0]) glDeleteVertexArrays(2, vao_);
+        updateTimer_.shutdown();
+        drawTimer_.shutdown();
+        vbo_[0] = vbo_[1] = vao_[0] = vao_[1] = 0;
+        updateProgram_ = drawProgram_ = 0;
+    }
+
+    bool ready() const { return vbo_[0] != 0; }
+    const ParticleStats& stats() const { return stats_; }
+
+    // One step of every slot around a planet of `radius`. dt = 0 (paused)
+    // skips the step, except the first, which spawns every slot at a random
+    // point of its life so the cloud starts out already formed.
+    void update(float dt, float radius) {
+        if (!ready() || (dt <= 0.0f && !reset_)) return;
+        updateTimer_.begin();
+        glUseProgram(updateProgram_);
+        glUniform1f(radiusLoc_, radius);
+        glUniform1f(dtLoc_, std::min(dt, kMaxStep));
+        glUniform1f(gmLoc_, 0.5f * kEscapeSpeed * kEscapeSpeed * radius);
+        glUniform1ui(seedLoc_, ++frame_ * 0x9E3779B9u);
+        glUniform1i(resetLoc_, reset_ ? 1 : 0);
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(vao_[current_]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo_[current_ ^ 1]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)stats_.count);
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        updateTimer_.end();
+        current_ ^= 1;
+        reset_ = false;
+    }
+
+    // Additive, depth tested but not written, after the opaque scene, around the
+    // planet at `center`. Its `radius` scales the sprites; sprites and brightness shrink as the
+    // count grows so a million particles still reads as a glow, not a white disc.
+    void draw(const glm::mat4& viewProj, const glm::vec3& center, float pixelsPerUnitAtOne, float radius) {
+        if (!ready() || reset_) return;
+        const float density = std::min(1.0f, 10000.0f / (float)stats_.count);
+        stats_.updateMs = updateTimer_.read();   // finished a frame or more ago
+        stats_.drawMs = drawTimer_.read();
+        drawTimer_.begin();
+        glUseProgram(drawProgram_);
+        glUniformMatrix4fv(viewProjLoc_, 1, GL_FALSE, glm::value_ptr(viewProj));
+        glUniform3fv(centerLoc_, 1, glm::value_ptr(center));
+        glUniform1f(pixelsPerUnitLoc_, pixelsPerUnitAtOne);
+        glUniform1f(sizeLoc_, radius * 0.12f * std::max(0.25f, std::cbrt(density)));
+        glUniform1f(intensityLoc_, 0.8f * std::max(0.03f, std::sqrt(density)));
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glDepthMask(GL_FALSE);
+        glBindVertexArray(vao_[current_]);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)stats_.count);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+        drawTimer_.end();
+    }
+
+private:
+    struct Particle { float posAge[4], velLife[4]; };   // position + age, velocity + lifetime (s)
+
+    GLuint updateProgram_ = 0, drawProgram_ = 0, vbo_[2] = {}, vao_[2] = {};
+    GLint radiusLoc_ = -1, dtLoc_ = -1, gmLoc_ = -1, seedLoc_ = -1, resetLoc_ = -1;
+    GLint viewProjLoc_ = -1, centerLoc_ = -1, pixelsPerUnitLoc_ = -1, sizeLoc_ = -1, intensityLoc_ = -1;
+    GpuTimer updateTimer_, drawTimer_;
+    ParticleStats stats_;
+    uint32_t frame_ = 0;
+    int current_ = 0;
+    bool reset_ = true;
+};
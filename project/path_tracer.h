@@ -0,0 +1,338 @@
+#pragma once
+// ---------------- Path Tracer ----------------
+// Offline CPU reference renderer for the orbital scene: ground truth for the
+// rasterised lighting, and a rays/s benchmark. Unidirectional path tracing
+// over a MeshBVH (mesh_bvh.h) of the whole scene flattened to world space:
+//   - surfaces are Lambertian (material colour times texture, textures
+//     decoded from sRGB); unlit materials are area lights instead, so the
+//     planet lights the scene from its whole surface, not from its centre,
+//   - every diffuse hit samples a point on the lights by area and traces a
+//     shadow ray (next event estimation); since lights are only reached that
+//     way, bounce rays that land on a light add nothing,
+//   - bounce directions are cosine-weighted, Russian roulette after the third,
+//   - bounce rays that escape see a uniform `ambient` environment (the app's
+//     ambient term, as light), camera rays that escape see `background`.
+// The image is cut into 16x16 tiles handed out over the worker pool. Each
+// pixel seeds its own random stream, so the result doesn't depend on the
+// thread count. Output is linear radiance, written as Radiance .hdr.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "mesh_bvh.h"
+#include "worker_pool.h"
+
+struct PtTexture { int w = 0, h = 0; std::vector<float> rgb; };   // linear, top row first
+
+struct PtMaterial {
+    float albedo[3] = { 1.0f, 1.0f, 1.0f };
+    float emission[3] = { 0.0f, 0.0f, 0.0f };   // non-zero: an area light
+    int texture = -1;                           // into PtScene::textures, multiplies albedo
+    bool emissive() const { return emission[0] > 0.0f || emission[1] > 0.0f || emission[2] > 0.0f; }
+};
+
+inline float srgbToLinear(float c) { return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f); }
+
+struct PtScene {
+    std::vector<float> positions;      // 9 per triangle, world space
+    std::vector<float> normals;        // 9 per triangle, shading normals
+    std::vector<float> uvs;            // 6 per triangle
+    std::vector<uint32_t> material;    // per triangle
+    std::vector<PtMaterial> materials;
+    std::vector<PtTexture> textures;
+    // The app's clear colour, which it writes to a non-sRGB framebuffer as is.
+    float background[3] = { srgbToLinear(0.05f), srgbToLinear(0.05f), srgbToLinear(0.1f) };
+    float ambient[3] = { 0.2f, 0.2f, 0.2f };
+    MeshBVH bvh;
+    // Filled by finalize(): the emissive triangles and their running area.
+    std::vector<uint32_t> lights;
+    std::vector<float> lightCdf;
+    float lightArea = 0.0f;
+
+    size_t triangleCount() const { return material.size(); }
+
+    // Appends interleaved pos(3) normal(3) uv(2) triangles moved by the
+    // column-major `model`. Normals go through its upper 3x3 and are
+    // renormalised, which is right for the uniform scales scene bodies use.
+    void addMesh(const float* verts, size_t vertexCount, const float model[16], uint32_t mat) {
+        for (size_t i = 0; i + 2 < vertexCount; i += 3) {
+            for (size_t k = 0; k < 3; ++k) {
+                const float* v = verts + (i + k) * 8;
+                for (int r = 0; r < 3; ++r)
+                    positions.push_back(model[r] * v[0] + model[4 + r] * v[1] + model[8 + r] * v[2] + model[12 + r]);
+                float n[3];
+                for (int r = 0; r < 3; ++r) n[r] = model[r] * v[3] + model[4 + r] * v[4] + model[8 + r] * v[5];
+                float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                for (int r = 0; r < 3; ++r) normals.push_back(len > 0.0f ? n[r] / len : 0.0f);
+                uvs.push_back(v[6]); uvs.push_back(v[7]);
+            }
+            material.push_back(mat);
+        }
+    }
+
+    // Builds the BVH and the light list; call after the last addMesh().
+    void finalize(WorkerPool& pool) {
+        bvh.build(pool, positions.data(), triangleCount());
+        lights.clear();
+        lightCdf.clear();
+        lightArea = 0.0f;
+        for (size_t i = 0; i < triangleCount(); ++i) {
+            if (!materials[material[i]].emissive()) continue;
+            float n[3];
+            geometricNormal((uint32_t)i, n);
+            float a = 0.5f * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (a <= 0.0f) continue;
+            lightArea += a;
+            lights.push_back((uint32_t)i);
+            lightCdf.push_back(lightArea);
+        }
+    }
+
+    // Unnormalised (e1 x e2: length is twice the area).
+    void geometricNormal(uint32_t tri, float n[3]) const {
+        const float* p = &positions[9 * (size_t)tri];
+        const float e1[3] = { p[3] - p[0], p[4] - p[1], p[5] - p[2] }, e2[3] = { p[6] - p[0], p[7] - p[1], p[8] - p[2] };
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1]; n[1] = e1[2] * e2[0] - e1[0] * e2[2]; n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+};
+
+// A pinhole camera: ray directions are forward + sx * right + sy * up for
+// sx, sy in [-1, 1], with right and up already scaled by the field of view.
+struct PtCamera {
+    float eye[3], forward[3], right[3], up[3];
+
+    static PtCamera lookAt(const float eye[3], const float target[3], float fovYDeg, float aspect) {
+        PtCamera c;
+        float f[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] };
+        normalize(f);
+        float r[3] = { -f[2], 0.0f, f[0] };   // f x (0, 1, 0)
+        if (r[0] == 0.0f && r[2] == 0.0f) r[0] = 1.0f;
+        normalize(r);
+        const float u[3] = { r[1] * f[2] - r[2] * f[1], r[2] * f[0] - r[0] * f[2], r[0] * f[1] - r[1] * f[0] };
+        const float ty = std::tan(fovYDeg * 3.14159265f / 360.0f), tx = ty * aspect;
+        for (int a = 0; a < 3; ++a) { c.eye[a] = eye[a]; c.forward[a] = f[a]; c.right[a] = r[a] * tx; c.up[a] = u[a] * ty; }
+        return c;
+    }
+
+    static void normalize(float v[3]) {
+        float len = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (len > 0.0f) for (int a = 0; a < 3; ++a) v[a] /= len;
+    }
+};
+
+struct PtSettings {
+    int width = 640, height = 480;
+    int spp = 16;                  // samples per pixel
+    int maxBounces = 4;
+    uint32_t seed = 1;
+};
+
+struct PtStats {
+    double ms = 0.0;
+    uint64_t cameraRays = 0, bounceRays = 0, shadowRays = 0;
+    uint64_t rays() const { return cameraRays + bounceRays + shadowRays; }
+    double raysPerSecond() const { return ms > 0.0 ? rays() / (ms / 1000.0) : 0.0; }
+};
+
+// PCG32, seeded per pixel so every pixel's samples are the same on any number of threads.
+struct PtRng {
+    uint64_t state;
+    explicit PtRng(uint64_t seed) : state(0) {
+        // splitmix64 spreads neighbouring pixel indices apart
+        seed += 0x9e3779b97f4a7c15ull;
+        seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+        seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+        state = seed ^ (seed >> 31);
+        next();
+    }
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + 1442695040888963407ull;
+        uint32_t x = (uint32_t)(((old >> 18u) ^ old) >> 27u), rot = (uint32_t)(old >> 59u);
+        return (x >> rot) | (x << ((32u - rot) & 31u));
+    }
+    float uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }   // [0, 1)
+};
+
+class PathTracer {
+public:
+    // Renders `s.width` x `s.height` pixels of linear RGB (top row first) into `rgb`.
+    static void render(WorkerPool& pool, const PtScene& scene, const PtCamera& cam, const PtSettings& s,
+                       std::vector<float>& rgb, PtStats& stats) {
+        auto t0 = std::chrono::steady_clock::now();
+        rgb.assign((size_t)s.width * s.height * 3, 0.0f);
+        const int tilesX = (s.width + kTile - 1) / kTile, tilesY = (s.height + kTile - 1) / kTile;
+        std::atomic<uint64_t> cameraRays{ 0 }, bounceRays{ 0 }, shadowRays{ 0 };
+        pool.parallelFor((size_t)tilesX * tilesY, 1, [&](size_t b, size_t e, unsigned) {
+            Counts counts;
+            for (size_t tile = b; tile < e; ++tile) {
+                const int x0 = (int)(tile % tilesX) * kTile, y0 = (int)(tile / tilesX) * kTile;
+                for (int y = y0; y < std::min(y0 + kTile, s.height); ++y)
+                    for (int x = x0; x < std::min(x0 + kTile, s.width); ++x) {
+                        const size_t pixel = (size_t)y * s.width + x;
+                        PtRng rng(((uint64_t)s.seed << 40) ^ pixel);
+                        float sum[3] = { 0.0f, 0.0f, 0.0f };
+                        for (int i = 0; i < s.spp; ++i) {
+                            // Jittered position in the pixel, y up in camera space.
+                            const float sx = 2.0f * (x + rng.uniform()) / s.width - 1.0f;
+                            const float sy = 1.0f - 2.0f * (y + rng.uniform()) / s.height;
+                            float d[3];
+                            for (int a = 0; a < 3; ++a) d[a] = cam.forward[a] + sx * cam.right[a] + sy * cam.up[a];
+                            PtCamera::normalize(d);
+                            float L[3];
+                            radiance(scene, s, cam.eye, d, rng, counts, L);
+                            for (int a = 0; a < 3; ++a) sum[a] += L[a];
+                        }
+                        for (int a = 0; a < 3; ++a) rgb[pixel * 3 + a] = sum[a] / s.spp;
+                    }
+            }
+            cameraRays += counts.camera; bounceRays += counts.bounce; shadowRays += counts.shadow;
+        });
+        stats.cameraRays = cameraRays; stats.bounceRays = bounceRays; stats.shadowRays = shadowRays;
+        stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+private:
+    static const int kTile = 16;
+    static constexpr float kPi = 3.14159265f;
+    struct Counts { uint64_t camera = 0, bounce = 0, shadow = 0; };
+
+    static float dot(const float a[3], const float b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+    static void albedoAt(const PtScene& scene, const PtMaterial& m, uint32_t tri, float u, float v, float out[3]) {
+        for (int a = 0; a < 3; ++a) out[a] = m.albedo[a];
+        if (m.texture < 0) return;
+        const PtTexture& tex = scene.textures[m.texture];
+        if (!tex.w || !tex.h) return;
+        const float* uv = &scene.uvs[6 * (size_t)tri];
+        const float w = 1.0f - u - v;
+        float tu = w * uv[0] + u * uv[2] + v * uv[4], tv = w * uv[1] + u * uv[3] + v * uv[5];
+        tu -= std::floor(tu); tv -= std::floor(tv);
+        // Nearest texel, V flipped as the shaders do (images are stored top row first).
+        const int px = std::min(tex.w - 1, (int)(tu * tex.w)), py = std::min(tex.h - 1, (int)((1.0f - tv) * tex.h));
+        const float* t = &tex.rgb[((size_t)py * tex.w + px) * 3];
+        for (int a = 0; a < 3; ++a) out[a] *= t[a];
+    }
+
+    // Orthonormal basis around unit n (Duff et al. 2017).
+    static void basis(const float n[3], float t[3], float b[3]) {
+        const float sign = std::copysign(1.0f, n[2]);
+        const float a = -1.0f / (sign + n[2]), c = n[0] * n[1] * a;
+        t[0] = 1.0f + sign * n[0] * n[0] * a; t[1] = sign * c; t[2] = -sign * n[0];
+        b[0] = c; b[1] = sign + n[1] * n[1] * a; b[2] = -n[1];
+    }
+
+    // Radiance arriving back along the ray eye + t * dir (dir unit length).
+    static void radiance(const PtScene& scene, const PtSettings& s, const float eye[3], const float dir[3], PtRng& rng, Counts& counts, float L[3]) {
+        float o[3] = { eye[0], eye[1], eye[2] }, d[3] = { dir[0], dir[1], dir[2] };
+        float thr[3] = { 1.0f, 1.0f, 1.0f };
+        L[0] = L[1] = L[2] = 0.0f;
+        for (int bounce = 0;; ++bounce) {
+            (bounce ? counts.bounce : counts.camera)++;
+            const MeshHit hit = scene.bvh.intersect(o, d);
+            if (hit.tri == kMeshNone) {
+                const float* env = bounce ? scene.ambient : scene.background;
+                for (int a = 0; a < 3; ++a) L[a] += thr[a] * env[a];
+                return;
+            }
+            const PtMaterial& m = scene.materials[scene.material[hit.tri]];
+            if (m.emissive()) {
+                if (!bounce) for (int a = 0; a < 3; ++a) L[a] += m.emission[a];
+                return;   // later bounces already counted it through the light samples
+            }
+
+            // Both normals face the incoming ray; surfaces are two-sided.
+            float p[3], ng[3], ns[3];
+            for (int a = 0; a < 3; ++a) p[a] = o[a] + hit.t * d[a];
+            scene.geometricNormal(hit.tri, ng);
+            PtCamera::normalize(ng);
+            if (dot(ng, d) > 0.0f) for (int a = 0; a < 3; ++a) ng[a] = -ng[a];
+            const float* vn = &scene.normals[9 * (size_t)hit.tri];
+            const float w = 1.0f - hit.u - hit.v;
+            for (int a = 0; a < 3; ++a) ns[a] = w * vn[a] + hit.u * vn[3 + a] + hit.v * vn[6 + a];
+            PtCamera::normalize(ns);
+            if (dot(ns, ns) == 0.0f) for (int a = 0; a < 3; ++a) ns[a] = ng[a];
+            if (dot(ns, ng) < 0.0f) for (int a = 0; a < 3; ++a) ns[a] = -ns[a];
+            float albedo[3];
+            albedoAt(scene, m, hit.tri, hit.u, hit.v, albedo);
+
+            // Offset off the surface, scaled with distance from the origin for float precision.
+            const float eps = 1e-4f * std::max(1.0f, std::max(std::fabs(p[0]), std::max(std::fabs(p[1]), std::fabs(p[2]))));
+            float from[3];
+            for (int a = 0; a < 3; ++a) from[a] = p[a] + ng[a] * eps;
+
+            // Next event estimation: one point on the lights, chosen by area.
+            if (!scene.lights.empty()) {
+                const float pick = rng.uniform() * scene.lightArea;
+                const size_t li = std::min(scene.lights.size() - 1,
+                                           (size_t)(std::upper_bound(scene.lightCdf.begin(), scene.lightCdf.end(), pick) - scene.lightCdf.begin()));
+                const uint32_t lt = scene.lights[li];
+                float su = rng.uniform(), sv = rng.uniform();
+                if (su + sv > 1.0f) { su = 1.0f - su; sv = 1.0f - sv; }
+                const float* lp = &scene.positions[9 * (size_t)lt];
+                float q[3], wi[3], nl[3];
+                for (int a = 0; a < 3; ++a) q[a] = lp[a] + su * (lp[3 + a] - lp[a]) + sv * (lp[6 + a] - lp[a]);
+                for (int a = 0; a < 3; ++a) wi[a] = q[a] - from[a];
+                const float dist2 = dot(wi, wi), dist = std::sqrt(dist2);
+                scene.geometricNormal(lt, nl);
+                PtCamera::normalize(nl);
+                if (dist > 0.0f) {
+                    for (int a = 0; a < 3; ++a) wi[a] /= dist;
+                    const float cosS = dot(ns, wi), cosL = std::fabs(dot(nl, wi));
+                    if (cosS > 0.0f && cosL > 0.0f && dot(ng, wi) > 0.0f) {
+                        counts.shadow++;
+                        if (!scene.bvh.occluded(from, wi, dist * (1.0f - 1e-3f))) {
+                            const PtMaterial& lm = scene.materials[scene.material[lt]];
+                            const float g = cosS * cosL * scene.lightArea / (dist2 * kPi);   // BRDF's 1/pi folded in
+                            for (int a = 0; a < 3; ++a) L[a] += thr[a] * albedo[a] * lm.emission[a] * g;
+                        }
+                    }
+                }
+            }
+
+            if (bounce + 1 > s.maxBounces) return;
+            // Cosine-weighted bounce: the pdf cancels the BRDF's cos / pi, leaving albedo.
+            for (int a = 0; a < 3; ++a) thr[a] *= albedo[a];
+            if (bounce >= 2) {
+                const float keep = std::min(0.95f, std::max(thr[0], std::max(thr[1], thr[2])));
+                if (rng.uniform() >= keep) return;
+                for (int a = 0; a < 3; ++a) thr[a] /= keep;
+            }
+            const float r1 = rng.uniform(), r2 = rng.uniform();
+            const float rad = std::sqrt(r1), phi = 2.0f * kPi * r2;
+            const float lx = rad * std::cos(phi), ly = rad * std::sin(phi), lz = std::sqrt(std::max(0.0f, 1.0f - r1));
+            float t[3], b[3];
+            basis(ns, t, b);
+            for (int a = 0; a < 3; ++a) d[a] = lx * t[a] + ly * b[a] + lz * ns[a];
+            if (dot(d, ng) <= 0.0f) return;   // under the true surface: the shading normal bent it there
+            for (int a = 0; a < 3; ++a) o[a] = from[a];
+        }
+    }
+};
+
+// Radiance .hdr: RGBE pixels, flat (uncompressed) scanlines, top row first.
+inline bool writeRadianceHdr(const std::string& path, int w, int h, const std::vector<float>& rgb) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    fprintf(f, "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", h, w);
+    std::vector<unsigned char> row((size_t)w * 4);
+    bool ok = true;
+    for (int y = 0; y < h && ok; ++y) {
+        for (int x = 0; x < w; ++x) {
+            const float* c = &rgb[((size_t)y * w + x) * 3];
+            const float m = std::max(c[0], std::max(c[1], c[2]));
+            unsigned char* e = &row[(size_t)x * 4];
+            if (!(m > 1e-32f)) { e[0] = e[1] = e[2] = e[3] = 0; continue; }
+            int ex;
+            const float scale = std::frexp(m, &ex) * 256.0f / m;
+            for (int a = 0; a < 3; ++a) e[a] = (unsigned char)std::max(0.0f, c[a] * scale);
+            e[3] = (unsigned char)(ex + 128);
+        }
+        ok = fwrite(row.data(), 1, row.size(), f) == row.size();
+    }
+    return fclose(f) == 0 && ok;
+}
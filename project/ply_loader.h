@@ -0,0 +1,216 @@
+#pragma once
+// ---------------- PLY Loader ----------------
+// Expands binary PLY (little or big endian) faces into interleaved pos(3)
+// normal(3) uv(2) triangles, what loadOBJ_from_memory() produces, so the rest
+// of the mesh pipeline is shared. Vertex properties x y z, nx ny nz and s t
+// (or u v, texture_u texture_v) of any scalar type are read; faces are fanned
+// from a "vertex_indices" (or "vertex_index") list. Other elements and
+// properties are skipped. Without normals, vertices get smooth normals with a
+// crease angle (mesh_normals.h), as OBJ corners without vn do.
+// ASCII PLY is not supported: it is no faster to read than OBJ.
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "mesh_normals.h"
+
+namespace ply {
+
+enum Type : uint8_t { kNone, kInt8, kUint8, kInt16, kUint16, kInt32, kUint32, kFloat32, kFloat64 };
+
+inline Type parseType(const std::string& s) {
+    if (s == "char" || s == "int8") return kInt8;
+    if (s == "uchar" || s == "uint8") return kUint8;
+    if (s == "short" || s == "int16") return kInt16;
+    if (s == "ushort" || s == "uint16") return kUint16;
+    if (s == "int" || s == "int32") return kInt32;
+    if (s == "uint" || s == "uint32") return kUint32;
+    if (s == "float" || s == "float32") return kFloat32;
+    if (s == "double" || s == "float64") return kFloat64;
+    return kNone;
+}
+
+inline size_t typeBytes(Type t) {
+    static const uint8_t bytes[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+    return bytes[t];
+}
+
+struct Property { std::string name; Type type = kNone, countType = kNone; };   // countType set: a list
+struct Element { std::string name; uint64_t count = 0; std::vector<Property> props; };
+
+// Copies one scalar of `type` at p into b, swapping bytes for big endian.
+inline void loadScalar(const unsigned char* p, Type type, bool swap, unsigned char (&b)[8]) {
+    const size_t n = typeBytes(type);
+    if (swap) for (size_t i = 0; i < n; ++i) b[i] = p[n - 1 - i];
+    else std::memcpy(b, p, n);
+}
+
+// Reads one scalar of `type` at p as double.
+inline double readScalar(const unsigned char* p, Type type, bool swap) {
+    unsigned char b[8] = {};
+    loadScalar(p, type, swap, b);
+    switch (type) {
+        case kInt8: return (double)(int8_t)b[0];
+        case kUint8: return (double)b[0];
+        case kInt16: { int16_t v; std::memcpy(&v, b, 2); return v; }
+        case kUint16: { uint16_t v; std::memcpy(&v, b, 2); return v; }
+        case kInt32: { int32_t v; std::memcpy(&v, b, 4); return v; }
+        case kUint32: { uint32_t v; std::memcpy(&v, b, 4); return v; }
+        case kFloat32: { float v; std::memcpy(&v, b, 4); return v; }
+        case kFloat64: { double v; std::memcpy(&v, b, 8); return v; }
+        default: return 0.0;
+    }
+}
+
+inline bool isInteger(Type t) { return t != kNone && t != kFloat32 && t != kFloat64; }
+
+// Reads one integer scalar (list counts, vertex indices); parseHeader() has
+// already rejected float types there.
+inline int64_t readInteger(const unsigned char* p, Type type, bool swap) {
+    unsigned char b[8] = {};
+    loadScalar(p, type, swap, b);
+    switch (type) {
+        case kInt8: return (int8_t)b[0];
+        case kUint8: return b[0];
+        case kInt16: { int16_t v; std::memcpy(&v, b, 2); return v; }
+        case kUint16: { uint16_t v; std::memcpy(&v, b, 2); return v; }
+        case kInt32: { int32_t v; std::memcpy(&v, b, 4); return v; }
+        case kUint32: { uint32_t v; std::memcpy(&v, b, 4); return v; }
+        default: return -1;
+    }
+}
+
+inline bool isVertexIndexList(const Property& p) {
+    return p.countType != kNone && (p.name == "vertex_indices" || p.name == "vertex_index");
+}
+
+// Header up to and including "end_header\n"; returns the offset of the body, 0 on error.
+inline size_t parseHeader(const char* data, size_t size, std::vector<Element>& elements, bool& bigEndian) {
+    const char* cur = data;
+    const char* end = data + size;
+    bool magic = false, format = false;
+    while (cur < end) {
+        const char* eol = (const char*)memchr(cur, '\n', end - cur);
+        if (!eol) return 0;
+        std::string line(cur, eol);
+        cur = eol + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::vector<std::string> w;
+        for (size_t i = 0; i < line.size();) {
+            while (i < line.size() && line[i] == ' ') ++i;
+            size_t j = i;
+            while (j < line.size() && line[j] != ' ') ++j;
+            if (j > i) w.push_back(line.substr(i, j - i));
+            i = j;
+        }
+        if (!magic) { if (line != "ply") return 0; magic = true; continue; }
+        if (w.empty() || w[0] == "comment" || w[0] == "obj_info") continue;
+        if (w[0] == "format" && w.size() >= 2) {
+            if (w[1] == "binary_little_endian") bigEndian = false;
+            else if (w[1] == "binary_big_endian") bigEndian = true;
+            else return 0;
+            format = true;
+        } else if (w[0] == "element" && w.size() == 3) {
+            elements.push_back(Element{ w[1], std::strtoull(w[2].c_str(), nullptr, 10), {} });
+        } else if (w[0] == "property" && !elements.empty()) {
+            if (w.size() < 3) return 0;
+            Property p;
+            if (w.size() == 5 && w[1] == "list") { p.countType = parseType(w[2]); p.type = parseType(w[3]); p.name = w[4]; }
+            else if (w.size() == 3) { p.type = parseType(w[1]); p.name = w[2]; }
+            if (p.type == kNone || (w[1] == "list" && !isInteger(p.countType))) return 0;
+            if (isVertexIndexList(p) && !isInteger(p.type)) return 0;
+            elements.back().props.push_back(p);
+        } else if (w[0] == "end_header") {
+            return format ? (size_t)(cur - data) : 0;
+        }
+    }
+    return 0;
+}
+
+} // namespace ply
+
+inline bool loadPLY_from_memory(const char* data, size_t size, std::vector<float>& out) {
+    using namespace ply;
+    std::vector<Element> elements;
+    bool swap = false;
+    size_t at = parseHeader(data, size, elements, swap);
+    if (!at) return false;
+    const unsigned char* bytes = (const unsigned char*)data;
+    const size_t outStart = out.size();
+    std::vector<float> verts;          // pos(3) normal(3) uv(2) per PLY vertex
+    std::vector<uint32_t> cornerPos;
+    bool haveNormals = false, haveFaces = false;
+
+    for (const Element& el : elements) {
+        // Offsets of the wanted scalar properties, when every property is scalar.
+        const char* wanted[8][3] = { { "x" }, { "y" }, { "z" }, { "nx" }, { "ny" }, { "nz" },
+                                     { "s", "u", "texture_u" }, { "t", "v", "texture_v" } };
+        int slot[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+        bool scalar = true;
+        size_t stride = 0;
+        std::vector<size_t> offset(el.props.size());
+        for (size_t p = 0; p < el.props.size(); ++p) {
+            const Property& pr = el.props[p];
+            if (pr.countType != kNone) { scalar = false; continue; }
+            offset[p] = stride;
+            stride += typeBytes(pr.type);
+            for (int k = 0; k < 8; ++k)
+                for (const char* name : wanted[k])
+                    if (name && pr.name == name && slot[k] < 0) slot[k] = (int)p;
+        }
+        const bool isVertex = el.name == "vertex" && scalar && slot[0] >= 0 && slot[1] >= 0 && slot[2] >= 0;
+        if (isVertex && verts.empty()) {
+            if (el.count > UINT32_MAX || (size - at) / stride < el.count) return false;
+            haveNormals = slot[3] >= 0 && slot[4] >= 0 && slot[5] >= 0;
+            verts.assign((size_t)el.count * 8, 0.0f);
+            for (uint64_t v = 0; v < el.count; ++v, at += stride) {
+                float* dst = verts.data() + v * 8;
+                for (int k = 0; k < 8; ++k)
+                    if (slot[k] >= 0) dst[k] = (float)readScalar(bytes + at + offset[slot[k]], el.props[slot[k]].type, swap);
+            }
+            continue;
+        }
+        if (scalar) {   // nothing wanted, or a second vertex element: skip it whole
+            if (stride && (size - at) / stride < el.count) return false;
+            at += (size_t)el.count * stride;
+            continue;
+        }
+        // Elements with lists are walked property by property.
+        const bool isFace = el.name == "face" && !haveFaces;
+        haveFaces |= isFace;
+        const size_t vertexCount = verts.size() / 8;
+        for (uint64_t f = 0; f < el.count; ++f) {
+            for (const Property& pr : el.props) {
+                if (pr.countType == kNone) {
+                    if (size - at < typeBytes(pr.type)) return false;
+                    at += typeBytes(pr.type);
+                    continue;
+                }
+                if (size - at < typeBytes(pr.countType)) return false;
+                const int64_t count = readInteger(bytes + at, pr.countType, swap);
+                if (count < 0) return false;
+                const size_t n = (size_t)count;
+                at += typeBytes(pr.countType);
+                const size_t each = typeBytes(pr.type);
+                if ((size - at) / each < n) return false;
+                if (isFace && isVertexIndexList(pr)) {
+                    auto index = [&](size_t i) { return readInteger(bytes + at + i * each, pr.type, swap); };
+                    for (size_t i = 1; i + 1 < n; ++i) {
+                        const int64_t tri[3] = { index(0), index(i), index(i + 1) };
+                        for (int64_t v : tri) {
+                            if (v < 0 || (uint64_t)v >= vertexCount) return false;
+                            out.insert(out.end(), verts.begin() + v * 8, verts.begin() + v * 8 + 8);
+                            cornerPos.push_back((uint32_t)v);
+                        }
+                    }
+                }
+                at += n * each;
+            }
+        }
+    }
+    if (!haveNormals && out.size() > outStart) {
+        for (size_t i = outStart + 3; i < out.size(); i += 8) out[i] = out[i + 1] = out[i + 2] = 0.0f;
+        generateSmoothNormals(out.data() + outStart, cornerPos.size() / 3, cornerPos.data(), verts.size() / 8);
+    }
+    return out.size() > outStart;
+}
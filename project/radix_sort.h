@@ -0,0 +1,66 @@
+#pragma once
+// ---------------- Radix Sort ----------------
+// Parallel, stable LSD radix sort of 32-bit keys carrying 32-bit values, 11
+// bits per pass. Each pass splits the input into one chunk per pool thread,
+// counts digits per chunk, turns the counts into per-chunk output offsets
+// (digit-major, chunk-minor, which is what keeps it stable) and scatters.
+// The output never depends on the thread count. Scratch buffers live in the
+// sorter, so sorting every frame doesn't allocate once sizes settle.
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "worker_pool.h"
+
+class RadixSorter {
+public:
+    // Sorts keys[0, n) (and vals alongside) by their low `keyBits` bits.
+    void sort(WorkerPool& pool, std::vector<uint32_t>& keys, std::vector<uint32_t>& vals, int keyBits) {
+        const size_t n = keys.size();
+        keysTmp_.resize(n);
+        valsTmp_.resize(n);
+        const unsigned chunks = pool.size();
+        const size_t chunkSize = (n + chunks - 1) / chunks;
+        auto chunkRange = [&](size_t c, size_t& b, size_t& e) { b = std::min(n, c * chunkSize); e = std::min(n, b + chunkSize); };
+
+        uint32_t *in = keys.data(), *inVals = vals.data(), *out = keysTmp_.data(), *outVals = valsTmp_.data();
+        for (int shift = 0; shift < keyBits; shift += kDigitBits) {
+            histograms_.assign((size_t)chunks * kRadix, 0);
+            pool.parallelFor(chunks, 1, [&](size_t c0, size_t c1, unsigned) {
+                for (size_t c = c0; c < c1; ++c) {
+                    size_t b, e;
+                    chunkRange(c, b, e);
+                    uint32_t* h = &histograms_[c * kRadix];
+                    for (size_t i = b; i < e; ++i) h[(in[i] >> shift) & (kRadix - 1)]++;
+                }
+            });
+            uint32_t sum = 0;
+            for (int d = 0; d < kRadix; ++d)
+                for (unsigned c = 0; c < chunks; ++c) {
+                    uint32_t& h = histograms_[(size_t)c * kRadix + d];
+                    uint32_t count = h;
+                    h = sum;
+                    sum += count;
+                }
+            pool.parallelFor(chunks, 1, [&](size_t c0, size_t c1, unsigned) {
+                for (size_t c = c0; c < c1; ++c) {
+                    size_t b, e;
+                    chunkRange(c, b, e);
+                    uint32_t* h = &histograms_[c * kRadix];
+                    for (size_t i = b; i < e; ++i) {
+                        uint32_t pos = h[(in[i] >> shift) & (kRadix - 1)]++;
+                        out[pos] = in[i];
+                        outVals[pos] = inVals[i];
+                    }
+                }
+            });
+            std::swap(in, out);
+            std::swap(inVals, outVals);
+        }
+        if (in != keys.data()) { keys.swap(keysTmp_); vals.swap(valsTmp_); }
+    }
+
+private:
+    static const int kDigitBits = 11, kRadix = 1 << kDigitBits;
+    std::vector<uint32_t> keysTmp_, valsTmp_, histograms_;
+};
@@ -0,0 +1,289 @@
+#pragma once
+// ---------------- Scene Description ----------------
+// Bodies, orbits, meshes and materials of a scene, loaded at runtime instead of
+// compiled in. Two encodings of the same data:
+//
+// .scene (text, hand-written), one declaration per line, '#' comments:
+//   mesh planet assets/objects/planet.obj
+//   mesh cube builtin:cube
+//   material sun color=1,0.9,0.5 unlit
+//   material crate texture=assets/textures/container.jpg
+//   body planet mesh=planet material=sun orbit=3 speed=0.5 scale=0.2
+//   body - mesh=cube material=crate parent=planet orbit=2 speed=1 phase=1.05 height=0.43 scale=0.35 spin=1.5
+// A body orbits its parent (or the origin) in the XZ plane at `height` above it:
+// angle = time * speed + phase; it spins at `spin` rad/s. Name "-" = anonymous;
+// a parent must be declared before its children. Omitted keys: mesh/material 0,
+// scale 1, everything else 0.
+//
+// .scn (binary, written by tools/assetc) - SceneFileHeader | SceneMeshRecord[] |
+// SceneMaterialRecord[] | SceneBody[] | string bytes, read zero-copy out of the pack.
+//
+// Either way names and paths are string_views into the source bytes, and with
+// .scn the body array is used in place; the source must outlive the SceneDesc.
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+static const uint32_t kSceneVersion = 1;
+static const uint32_t kSceneNoParent = 0xffffffffu;
+static const uint32_t kMaterialUnlit = 1;
+
+struct SceneBody {
+    uint32_t parent = kSceneNoParent;   // index of an earlier body
+    uint16_t mesh = 0, material = 0;
+    float orbitRadius = 0.0f, orbitSpeed = 0.0f, phase = 0.0f, height = 0.0f;
+    float scale = 1.0f, spin = 0.0f;
+};
+static_assert(sizeof(SceneBody) == 32, "SceneBody is a file record");
+
+struct SceneMesh { std::string_view name, path; };
+
+struct SceneMaterial {
+    std::string_view name, texture;     // texture empty: flat colour
+    float color[3] = { 1.0f, 1.0f, 1.0f };
+    uint32_t flags = 0;
+};
+
+struct SceneDesc {
+    std::vector<SceneMesh> meshes;
+    std::vector<SceneMaterial> materials;
+    const SceneBody* bodies = nullptr;  // ownedBodies, or the .scn blob
+    size_t bodyCount = 0;
+    std::vector<SceneBody> ownedBodies;
+
+    SceneDesc() = default;
+    SceneDesc(SceneDesc&&) = default;   // moving a vector keeps its buffer, so `bodies` stays valid
+    SceneDesc& operator=(SceneDesc&&) = default;
+    SceneDesc(const SceneDesc&) = delete;
+
+    void adoptOwnedBodies() { bodies = ownedBodies.data(); bodyCount = ownedBodies.size(); }
+    int findMesh(std::string_view name) const {
+        for (size_t i = 0; i < meshes.size(); ++i) if (meshes[i].name == name) return (int)i;
+        return -1;
+    }
+};
+
+// ---- text ----
+
+namespace scene_detail {
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Next whitespace-separated token of `line`, advancing `pos`; empty at the end or at '#'.
+inline std::string_view nextToken(std::string_view line, size_t& pos) {
+    while (pos < line.size() && isSpace(line[pos])) ++pos;
+    if (pos >= line.size() || line[pos] == '#') return {};
+    size_t start = pos;
+    while (pos < line.size() && !isSpace(line[pos]) && line[pos] != '#') ++pos;
+    return line.substr(start, pos - start);
+}
+
+inline bool parseFloat(std::string_view s, float& out) {
+    auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+    return r.ec == std::errc() && r.ptr == s.data() + s.size();
+}
+
+// "r,g,b"
+inline bool parseColor(std::string_view s, float* rgb) {
+    for (int i = 0; i < 3; ++i) {
+        size_t comma = i < 2 ? s.find(',') : s.size();
+        if (comma == std::string_view::npos || !parseFloat(s.substr(0, comma), rgb[i])) return false;
+        s.remove_prefix(i < 2 ? comma + 1 : comma);
+    }
+    return true;
+}
+
+} // namespace scene_detail
+
+// Parses .scene text. `text` must outlive `out` (names are views into it).
+inline bool parseSceneText(std::string_view text, SceneDesc& out, std::string& err) {
+    using namespace scene_detail;
+    out = SceneDesc();
+    std::unordered_map<std::string_view, uint32_t> meshIds, materialIds, bodyIds;
+    struct LastRef { std::string_view name; uint32_t id; } lastRef[3] = {};   // mesh, material, parent
+    size_t lineNo = 0;
+    auto fail = [&](const std::string& msg) { err = "line " + std::to_string(lineNo) + ": " + msg; return false; };
+
+    // One body per line at most; reserving up front saves regrowing a large array.
+    size_t lines = 1;
+    for (const char* p = text.data(); (p = (const char*)memchr(p, '\n', text.data() + text.size() - p)); ++p) ++lines;
+    out.ownedBodies.reserve(lines);
+
+    size_t lineStart = 0;
+    while (lineStart < text.size()) {
+        const char* nl = (const char*)memchr(text.data() + lineStart, '\n', text.size() - lineStart);
+        size_t lineEnd = nl ? (size_t)(nl - text.data()) : text.size();
+        std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        ++lineNo;
+
+        size_t pos = 0;
+        std::string_view kind = nextToken(line, pos);
+        if (kind.empty()) continue;
+        std::string_view name = nextToken(line, pos);
+        if (name.empty()) return fail("missing name after '" + std::string(kind) + "'");
+
+        if (kind == "mesh") {
+            std::string_view path = nextToken(line, pos);
+            if (path.empty()) return fail("mesh '" + std::string(name) + "' has no path");
+            if (out.meshes.size() >= 0xffff) return fail("too many meshes");
+            meshIds[name] = (uint32_t)out.meshes.size();
+            lastRef[0] = {};
+            out.meshes.push_back({ name, path });
+            continue;
+        }
+
+        if (kind == "material") {
+            SceneMaterial m;
+            m.name = name;
+            for (std::string_view tok; !(tok = nextToken(line, pos)).empty();) {
+                if (tok == "unlit") { m.flags |= kMaterialUnlit; continue; }
+                size_t eq = tok.find('=');
+                std::string_view key = tok.substr(0, eq), val = eq == std::string_view::npos ? std::string_view() : tok.substr(eq + 1);
+                if (key == "texture" && !val.empty()) m.texture = val;
+                else if (key == "color" && parseColor(val, m.color)) {}
+                else return fail("bad material attribute '" + std::string(tok) + "'");
+            }
+            if (out.materials.size() >= 0xffff) return fail("too many materials");
+            materialIds[name] = (uint32_t)out.materials.size();
+            lastRef[1] = {};
+            out.materials.push_back(m);
+            continue;
+        }
+
+        if (kind != "body") return fail("unknown declaration '" + std::string(kind) + "'");
+        SceneBody b;
+        for (std::string_view tok; !(tok = nextToken(line, pos)).empty();) {
+            size_t eq = tok.find('=');
+            if (eq == std::string_view::npos) return fail("expected key=value, got '" + std::string(tok) + "'");
+            std::string_view key = tok.substr(0, eq), val = tok.substr(eq + 1);
+            float* f = key == "orbit" ? &b.orbitRadius : key == "speed" ? &b.orbitSpeed : key == "phase" ? &b.phase :
+                       key == "height" ? &b.height : key == "scale" ? &b.scale : key == "spin" ? &b.spin : nullptr;
+            if (f) {
+                if (!parseFloat(val, *f)) return fail("bad number '" + std::string(tok) + "'");
+                continue;
+            }
+            int slot = key == "mesh" ? 0 : key == "material" ? 1 : key == "parent" ? 2 : -1;
+            if (slot < 0) return fail("unknown body key '" + std::string(key) + "'");
+            // Runs of bodies usually share mesh, material and parent: check the last name before hashing.
+            LastRef& last = lastRef[slot];
+            if (val != last.name || last.name.empty()) {
+                auto& ids = slot == 0 ? meshIds : slot == 1 ? materialIds : bodyIds;
+                auto it = ids.find(val);
+                if (it == ids.end()) return fail("unknown " + std::string(key) + " '" + std::string(val) + "'");
+                last = { val, it->second };
+            }
+            if (slot == 0) b.mesh = (uint16_t)last.id;
+            else if (slot == 1) b.material = (uint16_t)last.id;
+            else b.parent = last.id;
+        }
+        if (out.meshes.empty() || out.materials.empty()) return fail("body declared before any mesh and material");
+        if (name != "-") { bodyIds[name] = (uint32_t)out.ownedBodies.size(); lastRef[2] = {}; }
+        out.ownedBodies.push_back(b);
+    }
+    out.adoptOwnedBodies();
+    return true;
+}
+
+// ---- binary ----
+
+struct SceneFileHeader {
+    char     magic[4];      // "GSCN"
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t materialCount;
+    uint64_t bodyCount;
+    uint32_t stringBytes;
+    uint32_t reserved;
+};
+
+struct SceneStringRef { uint32_t offset, size; };
+struct SceneMeshRecord { SceneStringRef name, path; };
+struct SceneMaterialRecord { SceneStringRef name, texture; float color[3]; uint32_t flags; };
+
+inline std::vector<char> serializeScene(const SceneDesc& s) {
+    std::string strings;
+    auto ref = [&strings](std::string_view v) {
+        SceneStringRef r{ (uint32_t)strings.size(), (uint32_t)v.size() };
+        strings.append(v.data(), v.size());
+        return r;
+    };
+    std::vector<SceneMeshRecord> meshes;
+    for (const SceneMesh& m : s.meshes) meshes.push_back({ ref(m.name), ref(m.path) });
+    std::vector<SceneMaterialRecord> materials;
+    for (const SceneMaterial& m : s.materials) {
+        SceneMaterialRecord r{ ref(m.name), ref(m.texture), { m.color[0], m.color[1], m.color[2] }, m.flags };
+        materials.push_back(r);
+    }
+
+    SceneFileHeader h = {};
+    std::memcpy(h.magic, "GSCN", 4);
+    h.version = kSceneVersion;
+    h.meshCount = (uint32_t)meshes.size();
+    h.materialCount = (uint32_t)materials.size();
+    h.bodyCount = s.bodyCount;
+    h.stringBytes = (uint32_t)strings.size();
+    size_t mbytes = meshes.size() * sizeof(SceneMeshRecord);
+    size_t tbytes = materials.size() * sizeof(SceneMaterialRecord);
+    size_t bbytes = s.bodyCount * sizeof(SceneBody);
+    std::vector<char> out(sizeof(h) + mbytes + tbytes + bbytes + strings.size());
+    char* p = out.data();
+    std::memcpy(p, &h, sizeof(h)); p += sizeof(h);
+    std::memcpy(p, meshes.data(), mbytes); p += mbytes;
+    std::memcpy(p, materials.data(), tbytes); p += tbytes;
+    if (bbytes) std::memcpy(p, s.bodies, bbytes);
+    p += bbytes;
+    std::memcpy(p, strings.data(), strings.size());
+    return out;
+}
+
+// Zero-copy: `out.bodies` points into `data`, names into its string block.
+// Checks sizes and every index, so a damaged file fails here rather than at draw time.
+inline bool parseSceneBlob(const unsigned char* data, size_t size, SceneDesc& out) {
+    out = SceneDesc();
+    if (size < sizeof(SceneFileHeader)) return false;
+    SceneFileHeader h;
+    std::memcpy(&h, data, sizeof(h));
+    if (std::memcmp(h.magic, "GSCN", 4) != 0 || h.version != kSceneVersion) return false;
+    size_t mbytes = (size_t)h.meshCount * sizeof(SceneMeshRecord);
+    size_t tbytes = (size_t)h.materialCount * sizeof(SceneMaterialRecord);
+    if (h.bodyCount > (size - sizeof(h)) / sizeof(SceneBody)) return false;
+    size_t bbytes = (size_t)h.bodyCount * sizeof(SceneBody);
+    if (sizeof(h) + mbytes + tbytes + bbytes + h.stringBytes > size) return false;
+
+    const unsigned char* p = data + sizeof(h);
+    const char* strings = (const char*)(p + mbytes + tbytes + bbytes);
+    bool ok = true;
+    auto view = [&](SceneStringRef r) {
+        if ((uint64_t)r.offset + r.size > h.stringBytes) { ok = false; return std::string_view(); }
+        return std::string_view(strings + r.offset, r.size);
+    };
+    for (uint32_t i = 0; i < h.meshCount; ++i) {
+        SceneMeshRecord r;
+        std::memcpy(&r, p + i * sizeof(r), sizeof(r));
+        out.meshes.push_back({ view(r.name), view(r.path) });
+    }
+    p += mbytes;
+    for (uint32_t i = 0; i < h.materialCount; ++i) {
+        SceneMaterialRecord r;
+        std::memcpy(&r, p + i * sizeof(r), sizeof(r));
+        SceneMaterial m;
+        m.name = view(r.name); m.texture = view(r.texture);
+        std::memcpy(m.color, r.color, sizeof(m.color));
+        m.flags = r.flags;
+        out.materials.push_back(m);
+    }
+    p += tbytes;
+    out.bodies = (const SceneBody*)p;   // the pack aligns entries, and every record above is a multiple of 4 bytes
+    out.bodyCount = (size_t)h.bodyCount;
+    for (size_t i = 0; i < out.bodyCount && ok; ++i) {
+        const SceneBody& b = out.bodies[i];
+        ok = b.mesh < h.meshCount && b.material < h.materialCount && (b.parent == kSceneNoParent || b.parent < i);
+    }
+    if (!ok) out = SceneDesc();
+    return ok;
+}
@@ -0,0 +1,108 @@
+#pragma once
+// ---------------- Scene Params ----------------
+// Everything that shapes one rendered image of the orbital scene: the layout
+// (cube count, orbits, scales), the moment in time and the camera. The
+// interactive app keeps one SceneParams for the layout; --batch reads a whole
+// job file of them and renders each to an image.
+//
+// Job files hold one job per line as key=value pairs; keys left out keep the
+// defaults, '#' starts a comment:
+//   out=frames/0001.ppm cubes=8 cube_orbit_r=2.5 yaw=0.3 pitch=0.2 time=1.5 size=640x480
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const int kMaxSceneCubes = 4096;
+
+struct SceneParams {
+    int   numCubes = 6;
+    float planetOrbitR = 3.0f;
+    float planetOrbitW = 0.5f;
+    float cubeOrbitR = 2.0f;
+    float cubeOrbitW = 1.0f;
+    float cubeScale = 0.35f;
+    float planetScale = 0.2f;
+    // Batch jobs only; the interactive app drives these from input and the clock.
+    float time = 0.0f;
+    float yaw = 0.0f, pitch = 0.0f, camRadius = 8.0f;
+    int   width = 640, height = 480;
+    std::string output;
+};
+
+// Parses one job line on top of `p`. Returns false (with `err` set) on an
+// unknown key or a bad value; blank and comment-only lines leave `p` alone.
+inline bool parseSceneJob(const std::string& line, SceneParams& p, std::string& err) {
+    size_t pos = 0;
+    while (pos < line.size()) {
+        while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r')) ++pos;
+        if (pos >= line.size() || line[pos] == '#') break;
+        size_t end = line.find_first_of(" \t\r#", pos);
+        if (end == std::string::npos) end = line.size();
+        std::string tok = line.substr(pos, end - pos);
+        pos = end;
+
+        size_t eq = tok.find('=');
+        if (eq == std::string::npos || eq == 0 || eq + 1 == tok.size()) { err = "expected key=value, got '" + tok + "'"; return false; }
+        std::string key = tok.substr(0, eq);
+        const char* val = tok.c_str() + eq + 1;
+        char* stop = nullptr;
+
+        if (key == "out") { p.output = val; continue; }
+        if (key == "size") {
+            long w = strtol(val, &stop, 10);
+            long h = (*stop == 'x') ? strtol(stop + 1, &stop, 10) : 0;
+            if (*stop || w <= 0 || h <= 0 || w > 16384 || h > 16384) { err = "bad size '" + std::string(val) + "' (e.g. 640x480)"; return false; }
+            p.width = (int)w; p.height = (int)h;
+            continue;
+        }
+        if (key == "cubes") {
+            long n = strtol(val, &stop, 10);
+            if (*stop || n < 0 || n > kMaxSceneCubes) { err = "bad cube count '" + std::string(val) + "'"; return false; }
+            p.numCubes = (int)n;
+            continue;
+        }
+        static const struct { const char* name; float SceneParams::*field; } kFloatKeys[] = {
+            { "planet_orbit_r", &SceneParams::planetOrbitR }, { "planet_orbit_w", &SceneParams::planetOrbitW },
+            { "cube_orbit_r", &SceneParams::cubeOrbitR },     { "cube_orbit_w", &SceneParams::cubeOrbitW },
+            { "cube_scale", &SceneParams::cubeScale },        { "planet_scale", &SceneParams::planetScale },
+            { "time", &SceneParams::time },                   { "yaw", &SceneParams::yaw },
+            { "pitch", &SceneParams::pitch },                 { "radius", &SceneParams::camRadius },
+        };
+        bool known = false;
+        for (const auto& k : kFloatKeys) {
+            if (key != k.name) continue;
+            float f = strtof(val, &stop);
+            if (*stop) { err = "bad number for " + key + ": '" + std::string(val) + "'"; return false; }
+            p.*k.field = f;
+            known = true;
+            break;
+        }
+        if (!known) { err = "unknown key '" + key + "'"; return false; }
+    }
+    return true;
+}
+
+// Every job in `path`, each starting from `defaults`. Jobs without out= are
+// numbered batch_00000.ppm, batch_00001.ppm, ... Stops at the first bad line.
+inline bool loadSceneJobs(const std::string& path, const SceneParams& defaults, std::vector<SceneParams>& jobs, std::string& err) {
+    std::ifstream f(path);
+    if (!f) { err = "cannot open " + path; return false; }
+    std::string line;
+    for (int lineNo = 1; std::getline(f, line); ++lineNo) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        SceneParams p = defaults;
+        std::string lineErr;
+        if (!parseSceneJob(line, p, lineErr)) { err = path + ":" + std::to_string(lineNo) + ": " + lineErr; return false; }
+        if (p.output.empty()) {
+            char name[32];
+            snprintf(name, sizeof(name), "batch_%05zu.ppm", jobs.size());
+            p.output = name;
+        }
+        jobs.push_back(std::move(p));
+    }
+    return true;
+}
@@ -0,0 +1,119 @@
+#pragma once
+// ---------------- Staging Pool ----------------
+// Recycles the large, short-lived CPU buffers image decoding goes through (stb's
+// scratch planes and the decoded pixels that are uploaded and dropped right after).
+// Blocks are 64-byte aligned and rounded to quarter-power-of-two size classes, so
+// a steady stream of similar textures stops hitting malloc after the first one.
+// Including this header routes stb_image's allocator here (STBI_MALLOC & co.).
+// Blocks held from the system (live or cached) count as "textures" memory.
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "mem_tracker.h"
+
+struct StagingPoolStats {
+    uint64_t allocs = 0;        // requests served
+    uint64_t hits = 0;          // served from a free list
+    uint64_t misses = 0;        // had to go to the system allocator
+    size_t liveBytes = 0;
+    size_t peakLiveBytes = 0;
+    size_t cachedBytes = 0;     // sitting in free lists
+};
+
+class StagingPool {
+public:
+    static constexpr size_t kAlign = 64;
+
+    explicit StagingPool(size_t maxCachedBytes = 256u << 20) : maxCached_(maxCachedBytes) {}
+
+    ~StagingPool() {
+        for (auto& bucket : free_) for (void* b : bucket.second) { memTrackFree(kMemTextures, bucket.first + kAlign); std::free(b); }
+    }
+
+    void* alloc(size_t n) {
+        size_t cap = sizeClass(n);
+        void* block = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.allocs++;
+            auto it = free_.find(cap);
+            if (it != free_.end() && !it->second.empty()) {
+                block = it->second.back();
+                it->second.pop_back();
+                stats_.hits++;
+                stats_.cachedBytes -= cap;
+            } else {
+                stats_.misses++;
+            }
+            stats_.liveBytes += cap;
+            if (stats_.liveBytes > stats_.peakLiveBytes) stats_.peakLiveBytes = stats_.liveBytes;
+        }
+        if (!block) {
+            block = std::aligned_alloc(kAlign, cap + kAlign);
+            if (!block) return nullptr;
+            memTrackAlloc(kMemTextures, cap + kAlign);
+        }
+        *(size_t*)block = cap;
+        return (char*)block + kAlign;
+    }
+
+    void release(void* p) {
+        if (!p) return;
+        void* block = (char*)p - kAlign;
+        size_t cap = *(size_t*)block;
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.liveBytes -= cap;
+        if (stats_.cachedBytes + cap <= maxCached_) {
+            free_[cap].push_back(block);
+            stats_.cachedBytes += cap;
+        } else {
+            memTrackFree(kMemTextures, cap + kAlign);
+            std::free(block);
+        }
+    }
+
+    void* realloc(void* p, size_t n) {
+        if (!p) return alloc(n);
+        size_t cap = *(size_t*)((char*)p - kAlign);
+        if (n <= cap) return p;
+        void* q = alloc(n);
+        if (q) std::memcpy(q, p, cap);
+        release(p);
+        return q;
+    }
+
+    StagingPoolStats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    // Rounds up to a multiple of a quarter of the enclosing power of two (<= 25% slack),
+    // keeping capacity + header a multiple of kAlign for aligned_alloc.
+    static size_t sizeClass(size_t n) {
+        if (n <= kAlign) return kAlign;
+        int shift = 63 - __builtin_clzll((unsigned long long)(n - 1));
+        size_t granule = std::max(kAlign, (size_t)1 << (shift - 2 > 0 ? shift - 2 : 0));
+        return (n + granule - 1) & ~(granule - 1);
+    }
+
+    std::mutex mutex_;
+    std::map<size_t, std::vector<void*>> free_;
+    size_t maxCached_;
+    StagingPoolStats stats_;
+};
+
+inline StagingPool& stagingPool() { static StagingPool pool; return pool; }
+inline void* stagingAlloc(size_t n) { return stagingPool().alloc(n); }
+inline void* stagingRealloc(void* p, size_t n) { return stagingPool().realloc(p, n); }
+inline void stagingFree(void* p) { stagingPool().release(p); }
+
+#ifndef STBI_MALLOC
+#define STBI_MALLOC(sz)       stagingAlloc(sz)
+#define STBI_REALLOC(p, sz)   stagingRealloc(p, sz)
+#define STBI_FREE(p)          stagingFree(p)
+#endif
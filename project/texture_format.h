@@ -0,0 +1,228 @@
+#pragma once
+// ---------------- Compiled Texture ----------------
+// .tex layout: TexFileHeader | TexMipEntry[mipCount] | mip payloads (level 0 first).
+// Opaque images are stored BC1 (DXT1), images with alpha as raw RGBA8.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+
+// v2: rows top-down as decoded; the vertical flip now lives in the shaders' UVs.
+static const uint32_t kTexVersion = 2;
+
+enum TexFormat : uint32_t { kTexRGBA8 = 0, kTexBC1 = 1 };
+
+struct TexFileHeader {
+    char     magic[4];      // "GTEX"
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t mipCount;
+    uint32_t reserved[2];
+};
+
+struct TexMipEntry {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;        // from the start of the blob
+    uint64_t size;
+};
+
+struct TexView {
+    uint32_t width = 0, height = 0, format = 0, mipCount = 0;
+    const TexMipEntry* mips = nullptr;
+    const unsigned char* base = nullptr;
+};
+
+inline size_t bc1Size(uint32_t w, uint32_t h) {
+    return (size_t)std::max(1u, (w + 3) / 4) * std::max(1u, (h + 3) / 4) * 8;
+}
+
+// 2x2 box filter; odd edges clamp.
+inline std::vector<unsigned char> downsampleRGBA(const unsigned char* src, uint32_t w, uint32_t h,
+                                                 uint32_t& outW, uint32_t& outH) {
+    outW = std::max(1u, w / 2); outH = std::max(1u, h / 2);
+    std::vector<unsigned char> dst((size_t)outW * outH * 4);
+    for (uint32_t y = 0; y < outH; ++y) {
+        uint32_t y0 = std::min(h - 1, y * 2), y1 = std::min(h - 1, y * 2 + 1);
+        for (uint32_t x = 0; x < outW; ++x) {
+            uint32_t x0 = std::min(w - 1, x * 2), x1 = std::min(w - 1, x * 2 + 1);
+            for (int c = 0; c < 4; ++c) {
+                unsigned s = src[((size_t)y0 * w + x0) * 4 + c] + src[((size_t)y0 * w + x1) * 4 + c]
+                           + src[((size_t)y1 * w + x0) * 4 + c] + src[((size_t)y1 * w + x1) * 4 + c];
+                dst[((size_t)y * outW + x) * 4 + c] = (unsigned char)((s + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+inline uint16_t packRGB565(const float c[3]) {
+    int r = std::min(31, std::max(0, (int)(c[0] * 31.0f / 255.0f + 0.5f)));
+    int g = std::min(63, std::max(0, (int)(c[1] * 63.0f / 255.0f + 0.5f)));
+    int b = std::min(31, std::max(0, (int)(c[2] * 31.0f / 255.0f + 0.5f)));
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void unpackRGB565(uint16_t v, int out[3]) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2); out[1] = (g << 2) | (g >> 4); out[2] = (b << 3) | (b >> 2);
+}
+
+// Endpoints from the extremes along the block's principal axis, indices by nearest palette entry.
+inline void encodeBC1Block(const unsigned char px[16][4], unsigned char out[8]) {
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) for (int c = 0; c < 3; ++c) mean[c] += px[i][c] / 16.0f;
+    float cov[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        float d[3] = { px[i][0] - mean[0], px[i][1] - mean[1], px[i][2] - mean[2] };
+        cov[0] += d[0]*d[0]; cov[1] += d[0]*d[1]; cov[2] += d[0]*d[2];
+        cov[3] += d[1]*d[1]; cov[4] += d[1]*d[2]; cov[5] += d[2]*d[2];
+    }
+    float axis[3] = {1, 1, 1};
+    for (int it = 0; it < 8; ++it) {
+        float a[3] = { cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2],
+                       cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2],
+                       cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2] };
+        float m = std::max(std::fabs(a[0]), std::max(std::fabs(a[1]), std::fabs(a[2])));
+        if (m < 1e-6f) break;
+        for (int c = 0; c < 3; ++c) axis[c] = a[c] / m;
+    }
+    float lo = 1e30f, hi = -1e30f;
+    for (int i = 0; i < 16; ++i) {
+        float t = (px[i][0]-mean[0])*axis[0] + (px[i][1]-mean[1])*axis[1] + (px[i][2]-mean[2])*axis[2];
+        lo = std::min(lo, t); hi = std::max(hi, t);
+    }
+    float axisLen2 = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+    float cHi[3], cLo[3];
+    for (int c = 0; c < 3; ++c) {
+        cHi[c] = mean[c] + axis[c] * hi / std::max(axisLen2, 1e-6f);
+        cLo[c] = mean[c] + axis[c] * lo / std::max(axisLen2, 1e-6f);
+    }
+    uint16_t c0 = packRGB565(cHi), c1 = packRGB565(cLo);
+    if (c0 < c1) std::swap(c0, c1);
+    uint32_t bits = 0;
+    if (c0 != c1) {
+        int e0[3], e1[3], pal[4][3];
+        unpackRGB565(c0, e0); unpackRGB565(c1, e1);
+        for (int c = 0; c < 3; ++c) {
+            pal[0][c] = e0[c]; pal[1][c] = e1[c];
+            pal[2][c] = (2 * e0[c] + e1[c]) / 3; pal[3][c] = (e0[c] + 2 * e1[c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestD = 1 << 30;
+            for (int k = 0; k < 4; ++k) {
+                int dr = px[i][0] - pal[k][0], dg = px[i][1] - pal[k][1], db = px[i][2] - pal[k][2];
+                int d = dr*dr + dg*dg + db*db;
+                if (d < bestD) { bestD = d; best = k; }
+            }
+            bits |= (uint32_t)best << (2 * i);
+        }
+    }
+    out[0] = (unsigned char)(c0 & 0xFF); out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xFF); out[3] = (unsigned char)(c1 >> 8);
+    for (int b = 0; b < 4; ++b) out[4 + b] = (unsigned char)(bits >> (8 * b));
+}
+
+inline std::vector<unsigned char> encodeBC1(const unsigned char* rgba, uint32_t w, uint32_t h) {
+    uint32_t bw = std::max(1u, (w + 3) / 4), bh = std::max(1u, (h + 3) / 4);
+    std::vector<unsigned char> out((size_t)bw * bh * 8);
+    unsigned char px[16][4];
+    for (uint32_t by = 0; by < bh; ++by)
+        for (uint32_t bx = 0; bx < bw; ++bx) {
+            for (int i = 0; i < 16; ++i) {
+                uint32_t x = std::min(w - 1, bx * 4 + (i & 3)), y = std::min(h - 1, by * 4 + (i >> 2));
+                std::memcpy(px[i], rgba + ((size_t)y * w + x) * 4, 4);
+            }
+            encodeBC1Block(px, &out[((size_t)by * bw + bx) * 8]);
+        }
+    return out;
+}
+
+// CPU fallback for drivers without GL_EXT_texture_compression_s3tc.
+inline std::vector<unsigned char> decodeBC1(const unsigned char* src, uint32_t w, uint32_t h) {
+    uint32_t bw = std::max(1u, (w + 3) / 4), bh = std::max(1u, (h + 3) / 4);
+    std::vector<unsigned char> out((size_t)w * h * 4);
+    for (uint32_t by = 0; by < bh; ++by)
+        for (uint32_t bx = 0; bx < bw; ++bx) {
+            const unsigned char* b = src + ((size_t)by * bw + bx) * 8;
+            uint16_t c0 = (uint16_t)(b[0] | (b[1] << 8)), c1 = (uint16_t)(b[2] | (b[3] << 8));
+            uint32_t bits = b[4] | (b[5] << 8) | (b[6] << 16) | ((uint32_t)b[7] << 24);
+            int e0[3], e1[3], pal[4][4];
+            unpackRGB565(c0, e0); unpackRGB565(c1, e1);
+            for (int c = 0; c < 3; ++c) {
+                pal[0][c] = e0[c]; pal[1][c] = e1[c];
+                if (c0 > c1) { pal[2][c] = (2*e0[c] + e1[c]) / 3; pal[3][c] = (e0[c] + 2*e1[c]) / 3; }
+                else         { pal[2][c] = (e0[c] + e1[c]) / 2;   pal[3][c] = 0; }
+            }
+            pal[0][3] = pal[1][3] = pal[2][3] = 255; pal[3][3] = (c0 > c1) ? 255 : 0;
+            for (int i = 0; i < 16; ++i) {
+                uint32_t x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+                if (x >= w || y >= h) continue;
+                const int* p = pal[(bits >> (2 * i)) & 3];
+                unsigned char* d = &out[((size_t)y * w + x) * 4];
+                d[0] = (unsigned char)p[0]; d[1] = (unsigned char)p[1]; d[2] = (unsigned char)p[2]; d[3] = (unsigned char)p[3];
+            }
+        }
+    return out;
+}
+
+// Builds the full mip chain from RGBA8 level 0 and serializes it.
+inline std::vector<char> serializeTexture(const unsigned char* rgba, uint32_t w, uint32_t h, TexFormat format) {
+    std::vector<std::vector<unsigned char>> levels;
+    std::vector<std::pair<uint32_t, uint32_t>> dims;
+    std::vector<unsigned char> cur(rgba, rgba + (size_t)w * h * 4);
+    uint32_t cw = w, ch = h;
+    for (;;) {
+        levels.push_back(format == kTexBC1 ? encodeBC1(cur.data(), cw, ch) : cur);
+        dims.emplace_back(cw, ch);
+        if (cw == 1 && ch == 1) break;
+        uint32_t nw, nh;
+        cur = downsampleRGBA(cur.data(), cw, ch, nw, nh);
+        cw = nw; ch = nh;
+    }
+
+    TexFileHeader hdr = {};
+    std::memcpy(hdr.magic, "GTEX", 4);
+    hdr.version = kTexVersion;
+    hdr.width = w; hdr.height = h;
+    hdr.format = format;
+    hdr.mipCount = (uint32_t)levels.size();
+
+    std::vector<TexMipEntry> table(levels.size());
+    uint64_t cursor = sizeof(hdr) + table.size() * sizeof(TexMipEntry);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        cursor = (cursor + 15) & ~(uint64_t)15;
+        table[i] = { dims[i].first, dims[i].second, cursor, (uint64_t)levels[i].size() };
+        cursor += levels[i].size();
+    }
+    std::vector<char> out(cursor, 0);
+    std::memcpy(out.data(), &hdr, sizeof(hdr));
+    std::memcpy(out.data() + sizeof(hdr), table.data(), table.size() * sizeof(TexMipEntry));
+    for (size_t i = 0; i < levels.size(); ++i)
+        std::memcpy(out.data() + table[i].offset, levels[i].data(), levels[i].size());
+    return out;
+}
+
+inline bool parseTextureBlob(const unsigned char* data, size_t size, TexView& view) {
+    if (size < sizeof(TexFileHeader)) return false;
+    TexFileHeader h;
+    std::memcpy(&h, data, sizeof(h));
+    if (std::memcmp(h.magic, "GTEX", 4) != 0 || h.version != kTexVersion || h.mipCount == 0) return false;
+    if (sizeof(h) + (size_t)h.mipCount * sizeof(TexMipEntry) > size) return false;
+    const TexMipEntry* mips = (const TexMipEntry*)(data + sizeof(h));
+    for (uint32_t i = 0; i < h.mipCount; ++i)
+        if (mips[i].offset + mips[i].size > size) return false;
+    view.width = h.width; view.height = h.height; view.format = h.format; view.mipCount = h.mipCount;
+    view.mips = mips; view.base = data;
+    return true;
+}
@@ -0,0 +1,360 @@
+#pragma once
+// ---------------- Texture Streaming ----------------
+// Each texture starts with only its small mip tail resident. Higher mips are
+// produced on a background thread (page-in of a compiled .tex, or a decode +
+// mip build of the source image shared by every level queued for it, with no
+// pixels kept afterwards) as screen coverage asks for them, uploaded on the
+// render thread within a per-frame byte budget, and exposed by lowering
+// GL_TEXTURE_BASE_LEVEL. When resident bytes exceed the VRAM budget
+// the top levels of the least useful textures are dropped again.
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "asset_pack.h"
+#include "gl_memory.h"
+#include "image_decode.h"
+#include "texture_format.h"
+
+struct TextureStreamStats {
+    size_t residentBytes = 0;
+    size_t budgetBytes = 0;
+    int pendingLevels = 0;
+    int uploadsLastFrame = 0;
+    int evictionsTotal = 0;
+    double avgLatencyMs = 0.0;     // request issued -> level visible
+    double maxLatencyMs = 0.0;
+};
+
+class TextureStreamer {
+public:
+    // Levels whose larger side is at most this many texels are loaded up front and never evicted.
+    static const uint32_t kTailSize = 64;
+
+    TextureStreamer(size_t budgetBytes, size_t uploadBytesPerFrame, bool s3tc, bool srgb = false)
+        : uploadBytesPerFrame_(uploadBytesPerFrame), s3tc_(s3tc), srgb_(srgb) {
+        stats_.budgetBytes = budgetBytes;
+        worker_ = std::thread([this] { workerLoop(); });
+    }
+
+    ~TextureStreamer() {
+        { std::lock_guard<std::mutex> lock(mutex_); quit_ = true; }
+        cv_.notify_all();
+        worker_.join();
+        for (auto& t : textures_) if (t->gl) trackedDeleteTextures(1, &t->gl);
+    }
+
+    // Compiled .tex: mip payloads stay in the mapped pack, nothing is copied until upload.
+    int addCompiled(const TexView& view) {
+        auto t = std::make_unique<Tex>();
+        t->compiled = view; t->hasCompiled = true;
+        t->format = view.format;
+        for (uint32_t i = 0; i < view.mipCount; ++i) t->levels.push_back(makeLevel(view.mips[i].width, view.mips[i].height));
+        return addTexture(std::move(t));
+    }
+
+    // Encoded JPEG/PNG either from the pack (encoded) or a loose file (path).
+    int addImage(const std::string& path, AssetSpan encoded) {
+        int w = 0, h = 0, n = 0;
+        bool ok = encoded ? stbi_info_from_memory(encoded.data, (int)encoded.size, &w, &h, &n)
+                          : stbi_info(path.c_str(), &w, &h, &n);
+        if (!ok) return -1;
+        auto t = std::make_unique<Tex>();
+        t->path = path; t->encoded = encoded;
+        t->format = kTexRGBA8;
+        uint32_t cw = (uint32_t)w, ch = (uint32_t)h;
+        for (;;) {
+            t->levels.push_back(makeLevel(cw, ch));
+            if (cw == 1 && ch == 1) break;
+            cw = std::max(1u, cw / 2); ch = std::max(1u, ch / 2);
+        }
+        return addTexture(std::move(t));
+    }
+
+    // Projected size in pixels of the largest surface using texture `id` this frame.
+    void requestCoverage(int id, float pixels) {
+        if (id < 0 || id >= (int)textures_.size()) return;
+        Tex& t = *textures_[id];
+        t.coverage = std::max(t.coverage, pixels);
+        t.lastUse = frame_;
+    }
+
+    GLuint texture(int id) const { return (id >= 0 && id < (int)textures_.size()) ? textures_[id]->gl : 0; }
+    const TextureStreamStats& stats() const { return stats_; }
+    void setBudget(size_t bytes) { stats_.budgetBytes = bytes; }
+
+    // Render thread, once per frame: upload finished levels, issue new requests, enforce the budget.
+    // Per-frame scratch comes from `frame` (the app passes its frame arena).
+    void update(std::pmr::memory_resource* frame = std::pmr::get_default_resource()) {
+        uploadFinished(frame);
+        for (auto& tp : textures_) {
+            Tex& t = *tp;
+            int last = (int)t.levels.size() - 1;
+            int wanted = last;
+            if (t.coverage > 0.0f) {
+                float texels = (float)std::max(t.levels[0].w, t.levels[0].h);
+                wanted = (int)std::floor(std::log2(std::max(1.0f, texels / t.coverage)));
+            }
+            wanted = std::min(std::max(wanted, t.clamp), std::min(last, t.tailStart));
+            for (int level = t.base - 1; level >= wanted; --level) {
+                Level& l = t.levels[level];
+                if (l.resident || l.inFlight) continue;
+                l.inFlight = true;
+                enqueue(tp.get(), level);
+            }
+            // Budget freed up: let a clamped texture grow again one level at a time.
+            if (t.clamp > 0 && stats_.residentBytes + t.levels[t.clamp - 1].gpuBytes <= stats_.budgetBytes) t.clamp--;
+            t.wanted = wanted;
+            t.coverage = 0.0f;
+        }
+        evictOverBudget();
+        ++frame_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Level {
+        uint32_t w = 0, h = 0;
+        size_t gpuBytes = 0;
+        bool resident = false;
+        bool inFlight = false;
+    };
+
+    struct Tex {
+        GLuint gl = 0;
+        uint32_t format = kTexRGBA8;
+        std::vector<Level> levels;
+        int base = 0;           // finest resident level == GL_TEXTURE_BASE_LEVEL
+        int tailStart = 0;      // first level of the pinned tail
+        int wanted = 0;
+        int clamp = 0;          // finest level the budget currently allows
+        float coverage = 0.0f;
+        uint64_t lastUse = 0;
+        // Sources, read by the worker only.
+        TexView compiled;
+        bool hasCompiled = false;
+        std::string path;
+        AssetSpan encoded;
+    };
+
+    struct Request { Tex* tex; int level; Clock::time_point issued; };
+
+    struct Result {
+        Tex* tex; int level;
+        const unsigned char* data = nullptr;    // points into the pack or into `owned`
+        size_t size = 0;
+        bool compressed = false;
+        std::vector<unsigned char> owned;
+        Clock::time_point issued;
+    };
+
+    Level makeLevel(uint32_t w, uint32_t h) const {
+        Level l; l.w = w; l.h = h;
+        l.gpuBytes = (size_t)w * h * 4;
+        return l;
+    }
+
+    int addTexture(std::unique_ptr<Tex> t) {
+        if (t->format == kTexBC1 && s3tc_)
+            for (auto& l : t->levels) l.gpuBytes = bc1Size(l.w, l.h);
+        int last = (int)t->levels.size() - 1;
+        t->tailStart = last;
+        while (t->tailStart > 0 && std::max(t->levels[t->tailStart - 1].w, t->levels[t->tailStart - 1].h) <= kTailSize)
+            t->tailStart--;
+
+        // Complete from the start: a grey 1x1 at the last level until the real tail arrives.
+        glGenTextures(1, &t->gl);
+        glBindTexture(GL_TEXTURE_2D, t->gl);
+        const unsigned char grey[4] = { 128, 128, 128, 255 };
+        trackedTexImage2D(GL_TEXTURE_2D, t->gl, last, GL_RGBA8, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, last);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        t->base = last;
+        t->wanted = last;
+
+        Tex* raw = t.get();
+        textures_.push_back(std::move(t));
+        for (int level = last; level >= raw->tailStart; --level) {
+            raw->levels[level].inFlight = true;
+            enqueue(raw, level);
+        }
+        return (int)textures_.size() - 1;
+    }
+
+    void enqueue(Tex* t, int level) {
+        { std::lock_guard<std::mutex> lock(mutex_); requests_.push_back({ t, level, Clock::now() }); }
+        stats_.pendingLevels++;
+        cv_.notify_one();
+    }
+
+    void workerLoop() {
+        MemTagScope tag(kMemTextures);
+        for (;;) {
+            std::vector<Request> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return quit_ || !requests_.empty(); });
+                if (quit_) return;
+                batch.push_back(requests_.front()); requests_.pop_front();
+                // One decode serves every level of the image that is queued, so
+                // nothing needs keeping between requests.
+                Tex* tex = batch[0].tex;
+                if (!tex->hasCompiled)
+                    for (auto it = requests_.begin(); it != requests_.end();) {
+                        if (it->tex == tex) { batch.push_back(*it); it = requests_.erase(it); }
+                        else ++it;
+                    }
+            }
+            std::vector<Result> done(batch.size());
+            for (size_t i = 0; i < batch.size(); ++i) {
+                done[i].tex = batch[i].tex; done[i].level = batch[i].level; done[i].issued = batch[i].issued;
+            }
+            if (batch[0].tex->hasCompiled) produceCompiled(*batch[0].tex, done[0]);
+            else produceDecoded(*batch[0].tex, done);
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (Result& res : done) results_.push_back(std::move(res));
+        }
+    }
+
+    void produceCompiled(Tex& t, Result& res) {
+        const TexMipEntry& m = t.compiled.mips[res.level];
+        const unsigned char* bytes = t.compiled.base + m.offset;
+        if (t.compiled.format == kTexBC1 && !s3tc_) {
+            res.owned = decodeBC1(bytes, m.width, m.height);
+            res.data = res.owned.data(); res.size = res.owned.size();
+            return;
+        }
+        // Touch every page so the mmap fault-in happens here, not on the render thread.
+        volatile unsigned char sink = 0;
+        for (size_t i = 0; i < m.size; i += 4096) sink = sink + bytes[i];
+        res.data = bytes; res.size = (size_t)m.size;
+        res.compressed = (t.compiled.format == kTexBC1);
+    }
+
+    // Decodes the source image and walks its mip chain down to the coarsest
+    // requested level, copying out the requested ones; only the level being
+    // downsampled is held besides the results.
+    void produceDecoded(Tex& t, std::vector<Result>& done) {
+        int coarsest = 0;
+        for (const Result& res : done) coarsest = std::max(coarsest, res.level);
+        int w, h, n;
+        unsigned char* px = t.encoded
+            ? decodeImage(t.encoded.data, t.encoded.size, &w, &h, &n, 4, false)
+            : decodeImageFile(t.path, &w, &h, &n, 4, false);
+        std::vector<unsigned char> cur;
+        if (px && (uint32_t)w == t.levels[0].w && (uint32_t)h == t.levels[0].h) cur.assign(px, px + (size_t)w * h * 4);
+        if (px) stbi_image_free(px);
+        uint32_t cw = t.levels[0].w, ch = t.levels[0].h;
+        for (int level = 0; level <= coarsest; ++level) {
+            if (level > 0 && !cur.empty()) {
+                uint32_t nw, nh;
+                cur = downsampleRGBA(cur.data(), cw, ch, nw, nh);
+                cw = nw; ch = nh;
+            }
+            for (Result& res : done) {
+                if (res.level != level) continue;
+                // Undecodable source: white at the level's size, so the upload stays in bounds.
+                const Level& l = t.levels[level];
+                if (cur.empty()) res.owned.assign((size_t)l.w * l.h * 4, (unsigned char)255);
+                else if (level == coarsest) res.owned = std::move(cur);
+                else res.owned = cur;
+                res.data = res.owned.data(); res.size = res.owned.size();
+            }
+        }
+    }
+
+    void uploadFinished(std::pmr::memory_resource* frame) {
+        std::pmr::vector<Result> ready(frame);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t bytes = 0;
+            // Always take at least one result so a huge level can't stall the queue.
+            while (!results_.empty() && (ready.empty() || bytes + results_.front().size <= uploadBytesPerFrame_)) {
+                bytes += results_.front().size;
+                ready.push_back(std::move(results_.front()));
+                results_.pop_front();
+            }
+        }
+        stats_.uploadsLastFrame = (int)ready.size();
+        for (Result& r : ready) {
+            Tex& t = *r.tex;
+            Level& l = t.levels[r.level];
+            stats_.pendingLevels--;
+            l.inFlight = false;
+            glBindTexture(GL_TEXTURE_2D, t.gl);
+            if (r.compressed)
+                trackedCompressedTexImage2D(GL_TEXTURE_2D, t.gl, r.level,
+                                            srgb_ ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                            l.w, l.h, (GLsizei)r.size, r.data);
+            else
+                trackedTexImage2D(GL_TEXTURE_2D, t.gl, r.level, srgb_ ? GL_SRGB8_ALPHA8 : GL_RGBA8, l.w, l.h, GL_RGBA, GL_UNSIGNED_BYTE, r.data);
+            if (!l.resident) stats_.residentBytes += l.gpuBytes;
+            l.resident = true;
+            int base = t.base;
+            while (base > 0 && t.levels[base - 1].resident) base--;
+            if (base != t.base) {
+                t.base = base;
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base);
+            }
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - r.issued).count();
+            stats_.avgLatencyMs = stats_.avgLatencyMs == 0.0 ? ms : stats_.avgLatencyMs * 0.9 + ms * 0.1;
+            stats_.maxLatencyMs = std::max(stats_.maxLatencyMs, ms);
+        }
+    }
+
+    // Drops the finest resident level of the least useful texture until under budget:
+    // over-resident textures first, then the least recently used.
+    void evictOverBudget() {
+        while (stats_.residentBytes > stats_.budgetBytes) {
+            Tex* victim = nullptr;
+            for (auto& tp : textures_) {
+                Tex& t = *tp;
+                if (t.base >= t.tailStart) continue;
+                if (!victim) { victim = &t; continue; }
+                bool over = t.base < t.wanted, vOver = victim->base < victim->wanted;
+                if (over != vOver) { if (over) victim = &t; continue; }
+                if (t.lastUse != victim->lastUse) { if (t.lastUse < victim->lastUse) victim = &t; continue; }
+                if (t.levels[t.base].gpuBytes > victim->levels[victim->base].gpuBytes) victim = &t;
+            }
+            if (!victim) break;
+            Tex& t = *victim;
+            int level = t.base;
+            glBindTexture(GL_TEXTURE_2D, t.gl);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+            // Redefining the level as empty lets the driver release its storage;
+            // it lies outside [BASE, MAX] so the texture stays complete.
+            trackedTexImage2D(GL_TEXTURE_2D, t.gl, level, GL_RGBA8, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            t.levels[level].resident = false;
+            stats_.residentBytes -= t.levels[level].gpuBytes;
+            stats_.evictionsTotal++;
+            t.base = level + 1;
+            if (t.wanted <= level) t.clamp = level + 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<Tex>> textures_;
+    size_t uploadBytesPerFrame_;
+    bool s3tc_;
+    bool srgb_;
+    uint64_t frame_ = 0;
+    TextureStreamStats stats_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Request> requests_;
+    std::deque<Result> results_;
+    bool quit_ = false;
+    std::thread worker_;
+};
@@ -0,0 +1,93 @@
+#pragma once
+// ---------------- Worker Pool ----------------
+// Persistent threads for data-parallel loops that run every frame, where
+// spawning threads per call (as image_decode.h does for a one-off decode)
+// would cost more than the work. parallelFor() hands out [begin, end) chunks
+// of `grain` items from an atomic cursor; the calling thread works too, and
+// the call returns once every chunk has run. One loop at a time: calls from
+// several threads at once are serialised.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+public:
+    // fn(begin, end, worker): worker is in [0, size()), stable for the call, for per-thread scratch.
+    using Fn = std::function<void(size_t, size_t, unsigned)>;
+
+    // 0 threads = one per hardware thread (counting the caller).
+    explicit WorkerPool(unsigned threads = 0) {
+        if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 1; i < threads; ++i) threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~WorkerPool() {
+        { std::lock_guard<std::mutex> lock(mutex_); quit_ = true; }
+        wake_.notify_all();
+        for (std::thread& t : threads_) t.join();
+    }
+
+    unsigned size() const { return (unsigned)threads_.size() + 1; }
+
+    void parallelFor(size_t count, size_t grain, const Fn& fn) {
+        if (!count) return;
+        grain = std::max<size_t>(1, grain);
+        if (threads_.empty() || count <= grain) { fn(0, count, 0); return; }
+        std::lock_guard<std::mutex> serial(callMutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            fn_ = &fn; count_ = count; grain_ = grain;
+            cursor_.store(0, std::memory_order_relaxed);
+            busy_ = (unsigned)threads_.size();
+            ++generation_;
+        }
+        wake_.notify_all();
+        runChunks(0);
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return busy_ == 0; });
+        fn_ = nullptr;
+    }
+
+private:
+    void runChunks(unsigned worker) {
+        for (;;) {
+            size_t begin = cursor_.fetch_add(grain_, std::memory_order_relaxed);
+            if (begin >= count_) return;
+            (*fn_)(begin, std::min(count_, begin + grain_), worker);
+        }
+    }
+
+    void workerLoop(unsigned worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return quit_ || generation_ != seen; });
+                if (quit_) return;
+                seen = generation_;
+            }
+            runChunks(worker);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0) done_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_, callMutex_;
+    std::condition_variable wake_, done_;
+    const Fn* fn_ = nullptr;
+    size_t count_ = 0, grain_ = 1;
+    std::atomic<size_t> cursor_{ 0 };
+    unsigned busy_ = 0;
+    uint64_t generation_ = 0;
+    bool quit_ = false;
+};
+
+// Shared by the per-frame simulation and spatial code; sized to the machine.
+inline WorkerPool& workerPool() { static WorkerPool pool; return pool; }
@@ -0,0 +1,365 @@
+// assetc: offline asset compiler for project/app.
+//   g++ -std=c++17 -O2 tools/assetc/main.cpp src/glad.c -Iinclude -Iproject -lglfw -ldl -lGL -pthread -o tools/assetc/assetc
+//   ./tools/assetc/assetc [-j N] [--cache DIR] [--pack OUT] [--no-validate] [inputs...]   (default input: assets)
+//   ./tools/assetc/assetc ingest [--mem-mb N] [--cluster-tris N] [--tmp DIR] in.obj out.clu
+// .obj/.glb/.ply -> .mesh (indexed, with tangents), .jpg/.png -> .tex (BC1 or RGBA8 + mips), .vert/.geom/.frag -> GL-validated source,
+// .scene -> .scn (binary scene description).
+// Inputs whose content hash matches the cache database are skipped; all outputs are bundled into one pack.
+// `ingest` streams one OBJ too large for memory into a clustered mesh instead (project/obj_ingest.h).
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+#include "asset_pack.h"
+#include "gltf_loader.h"
+#include "image_decode.h"
+#include "mesh_format.h"
+#include "mesh_tangents.h"
+#include "obj_ingest.h"
+#include "obj_loader.h"
+#include "ply_loader.h"
+#include "scene_format.h"
+#include "texture_format.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace fs = std::filesystem;
+
+// Bump when an output format or converter changes so every input rebuilds.
+static const uint64_t kAssetcVersion = 3;
+
+enum class JobKind { Mesh, Texture, Shader, Scene };
+
+struct Job {
+    JobKind kind;
+    std::string input;      // path as found on disk
+    std::string output;     // logical name inside the pack
+    uint64_t hash = 0;
+    bool dirty = false;
+    bool ok = false;
+    std::string error;
+};
+
+static bool readFile(const std::string& path, std::vector<char>& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static bool writeFile(const std::string& path, const std::vector<char>& data) {
+    fs::create_directories(fs::path(path).parent_path());
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(data.data(), data.size());
+    return (bool)f;
+}
+
+static bool classify(const fs::path& p, JobKind& kind, std::string& outExt) {
+    std::string ext = p.extension().string();
+    for (auto& c : ext) c = (char)tolower(c);
+    if (ext == ".obj" || ext == ".glb" || ext == ".ply") { kind = JobKind::Mesh; outExt = ".mesh"; return true; }
+    if (ext == ".jpg" || ext == ".jpeg" || ext == ".png") { kind = JobKind::Texture; outExt = ".tex"; return true; }
+    if (ext == ".vert" || ext == ".geom" || ext == ".frag") { kind = JobKind::Shader; outExt = ext; return true; }
+    if (ext == ".scene") { kind = JobKind::Scene; outExt = ".scn"; return true; }
+    return false;
+}
+
+static void addInput(const fs::path& p, std::vector<Job>& jobs) {
+    JobKind kind; std::string outExt;
+    if (!classify(p, kind, outExt)) return;
+    Job j;
+    j.kind = kind;
+    j.input = p.generic_string();
+    fs::path out = p; out.replace_extension(outExt);
+    j.output = out.lexically_normal().generic_string();
+    jobs.push_back(j);
+}
+
+static std::map<std::string, uint64_t> loadHashDb(const std::string& path) {
+    std::map<std::string, uint64_t> db;
+    std::ifstream f(path);
+    std::string name; uint64_t h;
+    while (f >> std::hex >> h >> name) db[name] = h;
+    return db;
+}
+
+static void saveHashDb(const std::string& path, const std::map<std::string, uint64_t>& db) {
+    std::ofstream f(path, std::ios::trunc);
+    for (const auto& e : db) f << std::hex << e.second << " " << e.first << "\n";
+}
+
+static bool compileMesh(const std::string& input, const std::vector<char>& src, std::vector<char>& out, std::string& err) {
+    std::string ext = fs::path(input).extension().string();
+    for (auto& c : ext) c = (char)tolower(c);
+    std::vector<float> interleaved;
+    bool ok;
+    if (ext == ".glb") ok = loadGLB_from_memory((const unsigned char*)src.data(), src.size(), interleaved);
+    else if (ext == ".ply") ok = loadPLY_from_memory(src.data(), src.size(), interleaved);
+    else ok = loadOBJ_from_memory(src.data(), src.size(), interleaved);
+    if (!ok || interleaved.empty()) { err = "no triangles"; return false; }
+    out = serializeMesh(buildIndexedMesh(appendTangents(interleaved), kMeshFloatsWithTangents));
+    return true;
+}
+
+static bool compileScene(const std::vector<char>& src, std::vector<char>& out, std::string& err) {
+    SceneDesc scene;
+    if (!parseSceneText(std::string_view(src.data(), src.size()), scene, err)) return false;
+    out = serializeScene(scene);
+    return true;
+}
+
+static bool compileTexture(const std::vector<char>& src, std::vector<char>& out, std::string& err) {
+    int w, h, n;
+    unsigned char* rgba = decodeImage((const unsigned char*)src.data(), src.size(), &w, &h, &n, 4, false);
+    if (!rgba) { err = stbi_failure_reason(); return false; }
+    bool opaque = (n < 4);
+    if (!opaque) {
+        opaque = true;
+        for (size_t i = 3; i < (size_t)w * h * 4; i += 4) if (rgba[i] != 255) { opaque = false; break; }
+    }
+    out = serializeTexture(rgba, (uint32_t)w, (uint32_t)h, opaque ? kTexBC1 : kTexRGBA8);
+    stbi_image_free(rgba);
+    return true;
+}
+
+// assets/shaders/cube.vert -> assets/shaders/cube: the stages of one program.
+static std::string shaderStem(const std::string& input) {
+    return fs::path(input).replace_extension().generic_string();
+}
+
+// Compiles the given shaders (and links each .vert/.frag pair, plus its .geom if any)
+// in a hidden GL 3.3 context.
+static bool validateShaders(std::vector<Job*>& shaders) {
+    if (shaders.empty()) return true;
+    if (!glfwInit()) return false;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(16, 16, "assetc", nullptr, nullptr);
+    if (!window) { glfwTerminate(); return false; }
+    glfwMakeContextCurrent(window);
+    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+
+    struct Stage { GLuint vs = 0, gs = 0, fs = 0; };
+    std::map<std::string, Stage> stems;
+    for (Job* j : shaders) {
+        std::vector<char> src;
+        readFile(j->input, src);
+        src.push_back(0);
+        std::string ext = fs::path(j->input).extension().string();
+        GLenum type = ext == ".vert" ? GL_VERTEX_SHADER : ext == ".geom" ? GL_GEOMETRY_SHADER : GL_FRAGMENT_SHADER;
+        GLuint s = glCreateShader(type);
+        const char* p = src.data();
+        glShaderSource(s, 1, &p, nullptr);
+        glCompileShader(s);
+        int ok = 0;
+        glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+        if (!ok) {
+            char log[1024];
+            glGetShaderInfoLog(s, 1024, nullptr, log);
+            j->ok = false; j->error = log;
+            glDeleteShader(s);
+            continue;
+        }
+        Stage& st = stems[shaderStem(j->input)];
+        (type == GL_VERTEX_SHADER ? st.vs : type == GL_GEOMETRY_SHADER ? st.gs : st.fs) = s;
+    }
+    for (auto& e : stems) {
+        GLuint vs = e.second.vs, gs = e.second.gs, fs_ = e.second.fs;
+        if (vs && fs_) {
+            GLuint prog = glCreateProgram();
+            glAttachShader(prog, vs); glAttachShader(prog, fs_);
+            if (gs) glAttachShader(prog, gs);
+            glLinkProgram(prog);
+            int ok = 0;
+            glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+            if (!ok) {
+                char log[1024];
+                glGetProgramInfoLog(prog, 1024, nullptr, log);
+                for (Job* j : shaders)
+                    if (shaderStem(j->input) == e.first) { j->ok = false; j->error = log; }
+            }
+            glDeleteProgram(prog);
+        }
+        if (vs) glDeleteShader(vs);
+        if (gs) glDeleteShader(gs);
+        if (fs_) glDeleteShader(fs_);
+    }
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return true;
+}
+
+// assetc ingest: one OBJ, streamed into a .clu under a memory cap.
+static int ingestMain(int argc, char** argv) {
+    ObjIngestOptions options;
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--mem-mb" && i + 1 < argc) options.memoryCap = (size_t)std::max(16, atoi(argv[++i])) << 20;
+        else if (a == "--cluster-tris" && i + 1 < argc) options.clusterTriangles = (uint32_t)std::max(256, atoi(argv[++i]));
+        else if (a == "--tmp" && i + 1 < argc) options.tempDir = argv[++i];
+        else paths.push_back(a);
+    }
+    if (paths.size() != 2) {
+        std::cout << "usage: assetc ingest [--mem-mb N] [--cluster-tris N] [--tmp DIR] in.obj out.clu\n";
+        return paths.empty() ? 0 : 1;
+    }
+    ObjIngestStats st;
+    std::string err;
+    if (!ingestOBJ(paths[0], paths[1], options, st, err)) { std::cerr << paths[0] << ": " << err << "\n"; return 1; }
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    std::cout << "assetc ingest: " << st.fileBytes / (1 << 20) << " MB, " << st.positions << " v, " << st.uvs << " vt, "
+              << st.normals << " vn, " << st.triangles << " triangles -> " << st.clusters << " clusters (grid " << st.grid
+              << ", <= ~" << st.clusterTriangles << " triangles)\n"
+              << "  pass 1 " << st.pass1Ms / 1000.0 << " s, pass 2 " << st.pass2Ms / 1000.0 << " s, merge " << st.mergeMs / 1000.0
+              << " s; " << st.chunks << " chunks (" << st.spilledBytes / (1 << 20) << " MB) spilled, " << st.cacheMisses
+              << " pool cache misses, peak RSS " << ru.ru_maxrss / 1024 << " MB of " << (options.memoryCap >> 20) << " MB cap\n";
+    if (st.oversizeClusters)
+        std::cerr << "assetc ingest: " << st.oversizeClusters << " cluster(s) over budget (dense single grid cells), peak may exceed the cap\n";
+    std::cout << "  -> " << paths[1] << "\n";
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "ingest") return ingestMain(argc, argv);
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string cacheDir = ".assetc";
+    std::string packPath = "assets.pak";
+    bool validate = true;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "-j" && i + 1 < argc) threads = std::max(1, atoi(argv[++i]));
+        else if (a == "--cache" && i + 1 < argc) cacheDir = argv[++i];
+        else if (a == "--pack" && i + 1 < argc) packPath = argv[++i];
+        else if (a == "--no-validate") validate = false;
+        else if (a == "-h" || a == "--help") {
+            std::cout << "usage: assetc [-j N] [--cache DIR] [--pack OUT] [--no-validate] [inputs...]\n"
+                         "       assetc ingest [--mem-mb N] [--cluster-tris N] [--tmp DIR] in.obj out.clu\n";
+            return 0;
+        }
+        else inputs.push_back(a);
+    }
+    if (inputs.empty()) inputs.push_back("assets");
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<Job> jobs;
+    for (const auto& in : inputs) {
+        if (fs::is_directory(in)) {
+            for (const auto& e : fs::recursive_directory_iterator(in))
+                if (e.is_regular_file()) addInput(e.path(), jobs);
+        } else if (fs::exists(in)) {
+            addInput(in, jobs);
+        } else {
+            std::cerr << "assetc: no such input " << in << "\n";
+            return 1;
+        }
+    }
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.output < b.output; });
+    // planet.obj and planet.glb (or container.jpg and .png) would both become one pack entry.
+    for (size_t i = 1; i < jobs.size(); ++i)
+        if (jobs[i].output == jobs[i - 1].output) {
+            std::cerr << "assetc: " << jobs[i - 1].input << " and " << jobs[i].input << " both compile to "
+                      << jobs[i].output << "; remove or rename one\n";
+            return 1;
+        }
+
+    const std::string dbPath = cacheDir + "/hashes.db";
+    std::map<std::string, uint64_t> db = loadHashDb(dbPath);
+
+    // Hash + convert in parallel; shaders only need hashing here.
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> built(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < jobs.size(); i = next++) {
+            Job& j = jobs[i];
+            std::vector<char> src;
+            if (!readFile(j.input, src)) { j.error = "cannot read"; continue; }
+            j.hash = fnv1a64(src.data(), src.size(), fnv1a64(&kAssetcVersion, sizeof(kAssetcVersion)));
+            std::string outPath = cacheDir + "/" + j.output;
+            auto it = db.find(j.output);
+            if (it != db.end() && it->second == j.hash && fs::exists(outPath)) { j.ok = true; continue; }
+            j.dirty = true;
+
+            std::vector<char> out;
+            bool ok = false;
+            switch (j.kind) {
+                case JobKind::Mesh:    ok = compileMesh(j.input, src, out, j.error); break;
+                case JobKind::Texture: ok = compileTexture(src, out, j.error); break;
+                case JobKind::Shader:  out = src; ok = true; break;
+                case JobKind::Scene:   ok = compileScene(src, out, j.error); break;
+            }
+            if (ok && !writeFile(outPath, out)) { ok = false; j.error = "cannot write " + outPath; }
+            j.ok = ok;
+            if (ok) ++built;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < std::min<size_t>(threads, jobs.size()); ++t) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+
+    if (validate) {
+        // A changed stage relinks its whole program, so the unchanged stages are checked too.
+        std::set<std::string> dirtyStems;
+        for (auto& j : jobs) if (j.kind == JobKind::Shader && j.dirty) dirtyStems.insert(shaderStem(j.input));
+        std::vector<Job*> shaders;
+        for (auto& j : jobs) if (j.kind == JobKind::Shader && j.ok && dirtyStems.count(shaderStem(j.input))) shaders.push_back(&j);
+        if (!validateShaders(shaders))
+            std::cerr << "assetc: no GL 3.3 context, shaders copied without validation\n";
+    }
+
+    int failed = 0;
+    bool changed = false;
+    for (auto& j : jobs) {
+        if (!j.ok) {
+            std::cerr << j.input << ": " << j.error << "\n";
+            db.erase(j.output);
+            ++failed;
+            continue;
+        }
+        if (j.dirty) { std::cout << "  " << j.input << " -> " << j.output << "\n"; changed = true; }
+        db[j.output] = j.hash;
+    }
+    // Inputs deleted since the last run: forget them and drop them from the pack.
+    std::set<std::string> outputs;
+    for (const auto& j : jobs) outputs.insert(j.output);
+    for (auto it = db.begin(); it != db.end();) {
+        if (outputs.count(it->first)) { ++it; continue; }
+        std::cout << "  removed " << it->first << "\n";
+        it = db.erase(it);
+        changed = true;
+    }
+    fs::create_directories(cacheDir);
+    saveHashDb(dbPath, db);
+    if (failed) { std::cerr << "assetc: " << failed << " input(s) failed\n"; return 1; }
+
+    if (changed || !fs::exists(packPath)) {
+        std::vector<std::pair<std::string, std::string>> files;
+        for (const auto& j : jobs) files.emplace_back(j.output, cacheDir + "/" + j.output);
+        std::string err;
+        if (!writeAssetPack(packPath, files, &err)) { std::cerr << "assetc: " << err << "\n"; return 1; }
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "assetc: " << jobs.size() << " inputs, " << built.load() << " rebuilt, "
+              << jobs.size() - built.load() << " up to date, " << secs << " s -> " << packPath << "\n";
+    return 0;
+}
@@ -0,0 +1,34 @@
+// assetpack: bundles loose assets into one aligned archive read by project/app.
+//   g++ -std=c++17 -O2 tools/assetpack/main.cpp -Iproject -o tools/assetpack/assetpack
+//   ./tools/assetpack/assetpack assets.pak assets/objects/planet.obj assets/textures/container.jpg
+// Entry names are the paths exactly as given, so run it from the repo root.
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: assetpack <out.pak> <file> [file...]\n";
+        return 1;
+    }
+    std::vector<std::pair<std::string, std::string>> files;
+    for (int i = 2; i < argc; ++i) files.emplace_back(argv[i], argv[i]);
+
+    std::string err;
+    if (!writeAssetPack(argv[1], files, &err)) {
+        std::cerr << "assetpack: " << err << "\n";
+        return 1;
+    }
+
+    AssetPack check;
+    if (!check.open(argv[1])) {
+        std::cerr << "assetpack: wrote " << argv[1] << " but it does not read back\n";
+        return 1;
+    }
+    for (const auto& f : files)
+        std::cout << f.first << "  " << check.find(f.first).size << " bytes\n";
+    std::cout << argv[1] << ": " << check.count() << " entries, " << check.sizeBytes() << " bytes\n";
+    return 0;
+}
@@ -0,0 +1,111 @@
+// broadphasebench: spatial hash broad phase in project/broadphase.h.
+//   g++ -std=c++17 -O2 tools/broadphasebench/main.cpp -Iproject -pthread -o tools/broadphasebench/broadphasebench
+//   ./tools/broadphasebench/broadphasebench [--objects N]... [--runs N] [--threads N] [--check N] [--mixed]
+// For each size (default 10k, 100k, 1M) it seeds the satellite disc the app's
+// --nbody mode uses, sized and spaced the way --contacts sees it, and times
+// the grid build, the pair search and the sun query. --mixed gives every
+// object a random radius and adds a few oversized ones. The result is checked
+// against brute force: every pair when there are at most --check objects
+// (default 20k), else the contact counts of a sample of objects.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "broadphase.h"
+#include "nbody.h"
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Objects { std::vector<float> x, y, z, r; };
+
+static bool touch(const Objects& o, float margin, size_t i, size_t j) {
+    float reach = o.r[i] + o.r[j] + margin;
+    return std::fabs(o.x[i] - o.x[j]) <= reach && std::fabs(o.y[i] - o.y[j]) <= reach && std::fabs(o.z[i] - o.z[j]) <= reach;
+}
+
+// Brute-force check of `pairs`: all of them, or the contact counts of `sample` objects.
+static bool check(const Objects& o, float margin, const std::vector<ContactPair>& pairs, size_t sample, WorkerPool& pool) {
+    const size_t n = o.x.size();
+    std::vector<uint32_t> found(n, 0), expected(n, 0);
+    for (const ContactPair& p : pairs) {
+        if (p.a >= p.b || p.b >= n) return false;
+        found[p.a]++; found[p.b]++;
+    }
+    const size_t step = sample >= n ? 1 : n / sample;
+    pool.parallelFor((n + step - 1) / step, 16, [&](size_t b, size_t e, unsigned) {
+        for (size_t k = b; k < e; ++k) {
+            size_t i = k * step;
+            for (size_t j = 0; j < n; ++j)
+                if (j != i && touch(o, margin, i, j)) expected[i]++;
+        }
+    });
+    for (size_t i = 0; i < n; i += step)
+        if (found[i] != expected[i]) return false;
+    return true;
+}
+
+static void bench(size_t n, int runs, bool mixed, size_t checkMax, WorkerPool& pool) {
+    NBodySystem sys;
+    sys.seedDisc(n, 1.0f, 4.0f, 2.0f);
+    const float scale = std::min(0.35f, std::max(0.004f, 0.6f / std::cbrt((float)n)));   // as the app draws them
+    const float radius = 0.866f * scale;
+    Objects o{ sys.x, sys.y, sys.z, std::vector<float>(n, radius) };
+    if (mixed) {
+        uint32_t s = 12345;
+        for (size_t i = 0; i < n; ++i) {
+            s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+            o.r[i] = radius * (0.25f + 1.5f * (s >> 8) * (1.0f / 16777216.0f));
+        }
+        for (size_t i = 0; i < std::min<size_t>(n, 4); ++i) o.r[i * (n / 4)] = 0.3f + 0.2f * i;
+    }
+
+    SpatialHashGrid grid;
+    grid.margin = radius;
+    std::vector<ContactPair> pairs;
+    std::vector<uint32_t> sun;
+    double bestMs = 1e30, buildMs = 0, pairsMs = 0, queryMs = 0;
+    for (int r = 0; r < runs; ++r) {
+        double t0 = nowMs();
+        grid.build(pool, o.x.data(), o.y.data(), o.z.data(), mixed ? o.r.data() : nullptr, radius, n);
+        grid.findPairs(pool, pairs);
+        double t1 = nowMs();
+        sun.clear();
+        grid.querySphere(0.0f, 0.0f, 0.0f, 0.2f, sun);
+        double t = nowMs() - t0;
+        if (t < bestMs) { bestMs = t; buildMs = grid.stats().buildMs; pairsMs = grid.stats().pairsMs; queryMs = nowMs() - t1; }
+    }
+    const BroadphaseStats& st = grid.stats();
+    bool ok = check(o, grid.margin, pairs, n <= checkMax ? n : 2000, pool);
+    printf("%8zu objects  %8.2f ms (build %6.2f  pairs %7.2f  sun query %5.3f)  %5.1f M objects/s  cell %.4f  %u buckets  %zu oversize\n"
+           "                  %8zu pairs  %zu touching the sun  brute force %s: %s\n",
+           n, bestMs, buildMs, pairsMs, queryMs, n / bestMs / 1000.0, st.cellSize, st.buckets, st.oversize,
+           pairs.size(), sun.size(), n <= checkMax ? "all pairs" : "2000 sampled", ok ? "match" : "MISMATCH");
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    int runs = 5;
+    unsigned threads = 0;
+    size_t checkMax = 20000;
+    bool mixed = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--objects" && i + 1 < argc) sizes.push_back((size_t)atoll(argv[++i]));
+        else if (a == "--runs" && i + 1 < argc) runs = std::max(1, atoi(argv[++i]));
+        else if (a == "--threads" && i + 1 < argc) threads = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (a == "--check" && i + 1 < argc) checkMax = (size_t)atoll(argv[++i]);
+        else if (a == "--mixed") mixed = true;
+    }
+    if (sizes.empty()) sizes = { 10000, 100000, 1000000 };
+
+    WorkerPool pool(threads);
+    printf("%u threads, %s radii\n", pool.size(), mixed ? "mixed" : "uniform");
+    for (size_t n : sizes) bench(n, runs, mixed, checkMax, pool);
+    return 0;
+}
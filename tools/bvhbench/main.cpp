@@ -0,0 +1,154 @@
+// bvhbench: build, refit and query times of the instance BVH in project/bvh.h.
+//   g++ -std=c++17 -O2 tools/bvhbench/main.cpp -Iproject -pthread -o tools/bvhbench/bvhbench
+//   ./tools/bvhbench/bvhbench [--objects N]... [--runs N] [--threads N] [--frames N] [--queries N]
+// For each size (default 10k, 100k, 1M) it seeds the app's --nbody satellite
+// disc, times a full build, then turns every satellite along its circular
+// orbit for --frames frames (default 120 at 1/60 s), refitting each frame, and
+// reports the refit time and how far the SAH cost has drifted from a fresh
+// build's. Then --queries (default 20000) each of picking rays from a camera
+// above the disc, line-of-sight checks between satellites and nearest-object
+// queries, in microseconds per query, with a brute-force check of a sample.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bvh.h"
+#include "nbody.h"
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Disc { std::vector<float> x, y, z, angle, radius, omega; };
+
+// Satellites on circular orbits in the x-z plane: the motion the app's refit sees.
+static void advance(Disc& d, float dt, WorkerPool& pool) {
+    pool.parallelFor(d.x.size(), 16384, [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; ++i) {
+            d.angle[i] += d.omega[i] * dt;
+            d.x[i] = d.radius[i] * std::cos(d.angle[i]);
+            d.z[i] = d.radius[i] * std::sin(d.angle[i]);
+        }
+    });
+}
+
+static BvhHit bruteRay(const Disc& d, float r, const float o[3], const float dir[3], float tMax, uint32_t ignore) {
+    BvhHit hit;
+    hit.t = tMax;
+    const float dd = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+    for (size_t i = 0; i < d.x.size(); ++i) {
+        if (i == ignore) continue;
+        float ox = o[0] - d.x[i], oy = o[1] - d.y[i], oz = o[2] - d.z[i];
+        float b = ox * dir[0] + oy * dir[1] + oz * dir[2], k = b / dd;
+        float fx = ox - k * dir[0], fy = oy - k * dir[1], fz = oz - k * dir[2];
+        float disc = r * r - (fx * fx + fy * fy + fz * fz);
+        if (disc < 0.0f) continue;
+        float root = std::sqrt(dd * disc);
+        if (-b + root < 0.0f) continue;
+        float t = std::max(0.0f, (-b - root) / dd);
+        if (t < hit.t) { hit.t = t; hit.object = (uint32_t)i; }
+    }
+    return hit;
+}
+
+static void bench(size_t n, int runs, int frames, int queries, WorkerPool& pool) {
+    NBodySystem sys;
+    sys.seedDisc(n, 1.0f, 4.0f, 2.0f);
+    const float scale = std::min(0.35f, std::max(0.004f, 0.6f / std::cbrt((float)n)));   // as the app draws them
+    const float radius = 0.866f * scale;
+    Disc d{ sys.x, sys.y, sys.z, std::vector<float>(n), std::vector<float>(n), std::vector<float>(n) };
+    for (size_t i = 0; i < n; ++i) {
+        d.radius[i] = std::sqrt(d.x[i] * d.x[i] + d.z[i] * d.z[i]);
+        d.angle[i] = std::atan2(d.z[i], d.x[i]);
+        d.omega[i] = std::sqrt(sys.params.G * sys.params.centralMass / (d.radius[i] * d.radius[i] * d.radius[i]));
+    }
+
+    InstanceBVH bvh;
+    double buildMs = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        bvh.build(pool, d.x.data(), d.y.data(), d.z.data(), nullptr, radius, n);
+        buildMs = std::min(buildMs, bvh.stats().buildMs);
+    }
+    const BvhStats built = bvh.stats();
+    double refitMs = 0.0, refitBest = 1e30;
+    int rebuildAt = -1;
+    for (int f = 0; f < frames; ++f) {
+        advance(d, 1.0f / 60.0f, pool);
+        bvh.refit(pool, d.x.data(), d.y.data(), d.z.data(), nullptr, radius);
+        refitMs += bvh.stats().refitMs;
+        refitBest = std::min(refitBest, bvh.stats().refitMs);
+        if (rebuildAt < 0 && bvh.needsRebuild()) rebuildAt = f + 1;
+    }
+    printf("%8zu objects  build %8.2f ms  refit %7.2f ms (best %6.2f)  %7zu nodes  depth %2d  SAH %.1f -> %.1f after %d frames",
+           n, buildMs, refitMs / std::max(1, frames), refitBest, built.nodes, built.depth, built.sahCost, bvh.stats().sahCost, frames);
+    if (rebuildAt > 0) printf(" (rebuild due at frame %d)", rebuildAt);
+    printf("\n");
+
+    // Picking rays from a camera above the disc through random points on it.
+    uint32_t s = 99;
+    auto rnd = [&s] { s ^= s << 13; s ^= s >> 17; s ^= s << 5; return (s >> 8) * (1.0f / 16777216.0f); };
+    const float eye[3] = { 0.0f, 6.0f, 10.0f };
+    std::vector<float> dirs(3 * queries);
+    for (int q = 0; q < queries; ++q) {
+        float a = 6.2831853f * rnd(), r = 1.0f + 3.0f * rnd();
+        dirs[3 * q] = r * std::cos(a) - eye[0]; dirs[3 * q + 1] = -eye[1]; dirs[3 * q + 2] = r * std::sin(a) - eye[2];
+    }
+    size_t hits = 0;
+    double t0 = nowMs();
+    for (int q = 0; q < queries; ++q) hits += bvh.raycast(eye[0], eye[1], eye[2], dirs[3 * q], dirs[3 * q + 1], dirs[3 * q + 2]).object != kBvhNone;
+    const double rayUs = (nowMs() - t0) * 1000.0 / queries;
+
+    size_t blocked = 0;
+    t0 = nowMs();
+    for (int q = 0; q < queries; ++q) {
+        uint32_t a = (uint32_t)(rnd() * n) % n, b = (uint32_t)(rnd() * n) % n;
+        blocked += bvh.occluded(d.x[a], d.y[a], d.z[a], d.x[b], d.y[b], d.z[b], a, b);
+    }
+    const double losUs = (nowMs() - t0) * 1000.0 / queries;
+
+    double nearestSum = 0.0;
+    t0 = nowMs();
+    for (int q = 0; q < queries; ++q) {
+        uint32_t a = (uint32_t)(rnd() * n) % n;
+        nearestSum += bvh.nearest(d.x[a], d.y[a], d.z[a], 1e30f, a).t;
+    }
+    const double nearestUs = (nowMs() - t0) * 1000.0 / queries;
+
+    // Brute force on a sample of the picking rays.
+    const int sample = std::min(queries, n <= 100000 ? 200 : 20);
+    int mismatches = 0;
+    t0 = nowMs();
+    for (int q = 0; q < sample; ++q) {
+        BvhHit ref = bruteRay(d, radius, eye, &dirs[3 * q], 1e30f, kBvhNone);
+        BvhHit got = bvh.raycast(eye[0], eye[1], eye[2], dirs[3 * q], dirs[3 * q + 1], dirs[3 * q + 2]);
+        if (got.object != ref.object && std::fabs(got.t - ref.t) > 1e-5f * std::max(1.0f, ref.t)) ++mismatches;
+    }
+    const double bruteUs = (nowMs() - t0) * 1000.0 / sample - rayUs;
+    printf("                  pick ray %6.2f us (%4.1f%% hit, brute force %9.1f us, %s)  line of sight %6.2f us (%4.1f%% blocked)  nearest %6.2f us (mean %.4f)\n",
+           rayUs, 100.0 * hits / queries, bruteUs, mismatches ? "MISMATCH" : "match", losUs, 100.0 * blocked / queries,
+           nearestUs, nearestSum / queries);
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    int runs = 3, frames = 120, queries = 20000;
+    unsigned threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--objects" && i + 1 < argc) sizes.push_back((size_t)atoll(argv[++i]));
+        else if (a == "--runs" && i + 1 < argc) runs = std::max(1, atoi(argv[++i]));
+        else if (a == "--threads" && i + 1 < argc) threads = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (a == "--frames" && i + 1 < argc) frames = std::max(0, atoi(argv[++i]));
+        else if (a == "--queries" && i + 1 < argc) queries = std::max(1, atoi(argv[++i]));
+    }
+    if (sizes.empty()) sizes = { 10000, 100000, 1000000 };
+
+    WorkerPool pool(threads);
+    printf("%u threads\n", pool.size());
+    for (size_t n : sizes) bench(n, runs, frames, queries, pool);
+    return 0;
+}
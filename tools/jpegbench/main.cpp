@@ -0,0 +1,335 @@
+// jpegbench: stbi_load vs the restart-interval parallel decoder in project/image_decode.h.
+//   g++ -std=c++17 -O2 tools/jpegbench/main.cpp -Iinclude -Iproject -pthread -o tools/jpegbench/jpegbench
+//   ./tools/jpegbench/jpegbench [--size N]... [--runs N] [files...]
+// With no files it benchmarks assets/textures/container.jpg plus synthetic 4096^2 and
+// 8192^2 baseline 4:2:0 JPEGs (one restart marker per MCU row) encoded in memory here.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "image_decode.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// ---------------- Test Image Encoder ----------------
+// Baseline 4:2:0 encoder with per-image optimal Huffman tables and a restart interval.
+
+static int gZigzag[64];
+
+static void buildZigzag() {
+    int k = 0;
+    for (int s = 0; s < 15; ++s) {
+        int hi = std::min(s, 7), lo = std::max(0, s - 7);
+        for (int a = hi; a >= lo; --a) {
+            int y = (s % 2 == 0) ? a : s - a;
+            int x = s - y;
+            gZigzag[k++] = y * 8 + x;
+        }
+    }
+}
+
+struct HuffTable {
+    unsigned char bits[17] = {};
+    std::vector<unsigned char> vals;
+    uint16_t code[256] = {};
+    unsigned char size[256] = {};
+};
+
+// JPEG Annex K.2: Huffman code lengths limited to 16 bits, no all-ones code.
+static void buildOptimalTable(const long freqIn[256], HuffTable& t) {
+    long freq[257]; int codesize[257], others[257];
+    for (int i = 0; i < 256; ++i) freq[i] = freqIn[i];
+    freq[256] = 1;
+    for (int i = 0; i < 257; ++i) { codesize[i] = 0; others[i] = -1; }
+    for (;;) {
+        int c1 = -1, c2 = -1; long v = 1L << 60;
+        for (int i = 0; i < 257; ++i) if (freq[i] && freq[i] <= v) { v = freq[i]; c1 = i; }
+        v = 1L << 60;
+        for (int i = 0; i < 257; ++i) if (freq[i] && freq[i] <= v && i != c1) { v = freq[i]; c2 = i; }
+        if (c2 < 0) break;
+        freq[c1] += freq[c2]; freq[c2] = 0;
+        codesize[c1]++;
+        while (others[c1] >= 0) { c1 = others[c1]; codesize[c1]++; }
+        others[c1] = c2;
+        codesize[c2]++;
+        while (others[c2] >= 0) { c2 = others[c2]; codesize[c2]++; }
+    }
+    int bits[33] = {};
+    for (int i = 0; i < 257; ++i) if (codesize[i]) bits[codesize[i]]++;
+    for (int i = 32; i > 16; --i)
+        while (bits[i] > 0) {
+            int j = i - 2;
+            while (bits[j] == 0) --j;
+            bits[i] -= 2; bits[i - 1]++; bits[j + 1] += 2; bits[j]--;
+        }
+    int i = 16;
+    while (bits[i] == 0) --i;
+    bits[i]--;
+    for (int l = 1; l <= 16; ++l) t.bits[l] = (unsigned char)bits[l];
+    for (int l = 1; l <= 32; ++l)
+        for (int s = 0; s < 256; ++s) if (codesize[s] == l) t.vals.push_back((unsigned char)s);
+    uint16_t code = 0; size_t k = 0;
+    for (int l = 1; l <= 16; ++l) {
+        for (int n = 0; n < t.bits[l]; ++n, ++k) { t.code[t.vals[k]] = code++; t.size[t.vals[k]] = (unsigned char)l; }
+        code <<= 1;
+    }
+}
+
+struct BitWriter {
+    std::vector<unsigned char>* out = nullptr;
+    uint32_t acc = 0; int n = 0;
+    void put(uint32_t code, int len) {
+        if (!out) return;
+        acc = (acc << len) | (code & ((1u << len) - 1)); n += len;
+        while (n >= 8) {
+            unsigned char b = (unsigned char)(acc >> (n - 8));
+            out->push_back(b);
+            if (b == 0xFF) out->push_back(0);
+            n -= 8;
+        }
+        acc &= (1u << n) - 1;
+    }
+    void flush() { if (n > 0) put((1u << (8 - n)) - 1, 8 - n); }
+};
+
+struct Encoder {
+    int q[2][64];
+    float dct[8][8];
+    long freq[4][256];          // DC luma, AC luma, DC chroma, AC chroma
+    HuffTable tables[4];
+    bool counting = true;
+    BitWriter bw;
+
+    explicit Encoder(int quality) {
+        static const int lum[64] = { 16,11,10,16,24,40,51,61, 12,12,14,19,26,58,60,55, 14,13,16,24,40,57,69,56,
+            14,17,22,29,51,87,80,62, 18,22,37,56,68,109,103,77, 24,35,55,64,81,104,113,92,
+            49,64,78,87,103,121,120,101, 72,92,95,98,112,100,103,99 };
+        static const int chr[64] = { 17,18,24,47,99,99,99,99, 18,21,26,66,99,99,99,99, 24,26,56,99,99,99,99,99,
+            47,66,99,99,99,99,99,99, 99,99,99,99,99,99,99,99, 99,99,99,99,99,99,99,99,
+            99,99,99,99,99,99,99,99, 99,99,99,99,99,99,99,99 };
+        int scale = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+        for (int i = 0; i < 64; ++i) {
+            q[0][i] = std::min(255, std::max(1, (lum[i] * scale + 50) / 100));
+            q[1][i] = std::min(255, std::max(1, (chr[i] * scale + 50) / 100));
+        }
+        for (int u = 0; u < 8; ++u)
+            for (int x = 0; x < 8; ++x)
+                dct[u][x] = 0.5f * (u == 0 ? (float)M_SQRT1_2 : 1.0f) * std::cos((2 * x + 1) * u * (float)M_PI / 16.0f);
+        std::memset(freq, 0, sizeof(freq));
+    }
+
+    void symbol(int table, int sym) {
+        if (counting) freq[table][sym]++;
+        else bw.put(tables[table].code[sym], tables[table].size[sym]);
+    }
+
+    void bits(int value, int size) { if (!counting && size) bw.put((uint32_t)value, size); }
+
+    void block(const float in[64], int qt, int& dcPred) {
+        float tmp[64], out[64];
+        for (int y = 0; y < 8; ++y)
+            for (int u = 0; u < 8; ++u) {
+                float s = 0; for (int x = 0; x < 8; ++x) s += dct[u][x] * in[y * 8 + x];
+                tmp[y * 8 + u] = s;
+            }
+        for (int v = 0; v < 8; ++v)
+            for (int u = 0; u < 8; ++u) {
+                float s = 0; for (int y = 0; y < 8; ++y) s += dct[v][y] * tmp[y * 8 + u];
+                out[v * 8 + u] = s;
+            }
+        int zz[64];
+        for (int k = 0; k < 64; ++k) zz[k] = (int)std::lround(out[gZigzag[k]] / q[qt][gZigzag[k]]);
+
+        int diff = zz[0] - dcPred; dcPred = zz[0];
+        int mag = std::abs(diff), size = 0; while (mag) { ++size; mag >>= 1; }
+        symbol(qt * 2, size);
+        bits(diff < 0 ? diff + (1 << size) - 1 : diff, size);
+        int run = 0;
+        for (int k = 1; k < 64; ++k) {
+            if (zz[k] == 0) { ++run; continue; }
+            while (run > 15) { symbol(qt * 2 + 1, 0xF0); run -= 16; }
+            int v = zz[k]; mag = std::abs(v); size = 0; while (mag) { ++size; mag >>= 1; }
+            symbol(qt * 2 + 1, (run << 4) | size);
+            bits(v < 0 ? v + (1 << size) - 1 : v, size);
+            run = 0;
+        }
+        if (run) symbol(qt * 2 + 1, 0x00);
+    }
+};
+
+static void putMarker(std::vector<unsigned char>& o, int m, int len) {
+    o.push_back(0xFF); o.push_back((unsigned char)m);
+    o.push_back((unsigned char)(len >> 8)); o.push_back((unsigned char)len);
+}
+
+static std::vector<unsigned char> encodeTestJpeg(const unsigned char* rgb, int w, int h, int quality, int restartMcus) {
+    Encoder enc(quality);
+    int mcusX = (w + 15) / 16, mcusY = (h + 15) / 16;
+    std::vector<unsigned char> out = { 0xFF, 0xD8 };
+    std::vector<unsigned char> entropy;
+
+    auto pixel = [&](int x, int y, float ycc[3]) {
+        const unsigned char* p = rgb + ((size_t)std::min(y, h - 1) * w + std::min(x, w - 1)) * 3;
+        ycc[0] = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2] - 128.0f;
+        ycc[1] = -0.168736f * p[0] - 0.331264f * p[1] + 0.5f * p[2];
+        ycc[2] = 0.5f * p[0] - 0.418688f * p[1] - 0.081312f * p[2];
+    };
+
+    for (int pass = 0; pass < 2; ++pass) {
+        enc.counting = (pass == 0);
+        enc.bw = BitWriter();
+        if (!enc.counting) {
+            for (int t = 0; t < 4; ++t) buildOptimalTable(enc.freq[t], enc.tables[t]);
+            enc.bw.out = &entropy;
+        }
+        int pred[3] = { 0, 0, 0 };
+        int rst = 0;
+        for (int my = 0; my < mcusY; ++my)
+            for (int mx = 0; mx < mcusX; ++mx) {
+                float Y[4][64], Cb[64] = {}, Cr[64] = {};
+                for (int y = 0; y < 16; ++y)
+                    for (int x = 0; x < 16; ++x) {
+                        float ycc[3];
+                        pixel(mx * 16 + x, my * 16 + y, ycc);
+                        Y[(y / 8) * 2 + x / 8][(y % 8) * 8 + x % 8] = ycc[0];
+                        Cb[(y / 2) * 8 + x / 2] += ycc[1] * 0.25f;
+                        Cr[(y / 2) * 8 + x / 2] += ycc[2] * 0.25f;
+                    }
+                for (int b = 0; b < 4; ++b) enc.block(Y[b], 0, pred[0]);
+                enc.block(Cb, 1, pred[1]);
+                enc.block(Cr, 1, pred[2]);
+                int done = my * mcusX + mx + 1;
+                if (restartMcus && done % restartMcus == 0 && done < mcusX * mcusY) {
+                    enc.bw.flush();
+                    if (!enc.counting) { entropy.push_back(0xFF); entropy.push_back((unsigned char)(0xD0 + (rst & 7))); }
+                    ++rst;
+                    pred[0] = pred[1] = pred[2] = 0;
+                }
+            }
+        enc.bw.flush();
+    }
+
+    putMarker(out, 0xDB, 2 + 2 * 65);
+    for (int t = 0; t < 2; ++t) { out.push_back((unsigned char)t); for (int k = 0; k < 64; ++k) out.push_back((unsigned char)enc.q[t][gZigzag[k]]); }
+    putMarker(out, 0xC0, 17);
+    out.push_back(8);
+    out.push_back((unsigned char)(h >> 8)); out.push_back((unsigned char)h);
+    out.push_back((unsigned char)(w >> 8)); out.push_back((unsigned char)w);
+    out.push_back(3);
+    const unsigned char comps[9] = { 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1 };
+    out.insert(out.end(), comps, comps + 9);
+    for (int t = 0; t < 4; ++t) {
+        const HuffTable& ht = enc.tables[t];
+        putMarker(out, 0xC4, 2 + 1 + 16 + (int)ht.vals.size());
+        out.push_back((unsigned char)(((t & 1) << 4) | (t >> 1)));
+        out.insert(out.end(), ht.bits + 1, ht.bits + 17);
+        out.insert(out.end(), ht.vals.begin(), ht.vals.end());
+    }
+    if (restartMcus) {
+        putMarker(out, 0xDD, 4);
+        out.push_back((unsigned char)(restartMcus >> 8)); out.push_back((unsigned char)restartMcus);
+    }
+    putMarker(out, 0xDA, 12);
+    const unsigned char scan[9] = { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63 };
+    out.insert(out.end(), scan, scan + 9);
+    out.push_back(0);
+    out.insert(out.end(), entropy.begin(), entropy.end());
+    out.push_back(0xFF); out.push_back(0xD9);
+    return out;
+}
+
+static std::vector<unsigned char> syntheticImage(int w, int h) {
+    std::vector<unsigned char> px((size_t)w * h * 3);
+    uint32_t seed = 12345;
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            float noise = (float)((seed >> 24) & 31) - 16.0f;
+            float base = 128.0f + 60.0f * std::sin(x * 0.011f) * std::cos(y * 0.017f);
+            bool edge = ((x / 97) + (y / 61)) % 5 == 0;
+            unsigned char* p = &px[((size_t)y * w + x) * 3];
+            p[0] = (unsigned char)std::min(255.0f, std::max(0.0f, base + noise + (edge ? 50.0f : 0.0f)));
+            p[1] = (unsigned char)std::min(255.0f, std::max(0.0f, 255.0f - base + noise));
+            p[2] = (unsigned char)std::min(255.0f, std::max(0.0f, 90.0f + 0.5f * noise + (x % 256) * 0.3f));
+        }
+    return px;
+}
+
+// ---------------- Benchmark ----------------
+
+static double bestOf(int runs, const std::function<void()>& fn) {
+    double best = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    }
+    return best;
+}
+
+static void bench(const std::string& name, const std::vector<unsigned char>& jpg, int runs) {
+    int w = 0, h = 0, n = 0;
+    JpegLayout layout;
+    bool splittable = parseJpegLayout(jpg.data(), jpg.size(), layout);
+
+    unsigned char* ref = nullptr;
+    double tStb = bestOf(runs, [&] {
+        stbi_image_free(ref);
+        stbi_set_flip_vertically_on_load_thread(0);
+        ref = stbi_load_from_memory(jpg.data(), (int)jpg.size(), &w, &h, &n, 4);
+    });
+    unsigned char* par = nullptr;
+    double tPar = bestOf(runs, [&] {
+        stbi_image_free(par);
+        par = decodeImage(jpg.data(), jpg.size(), &w, &h, &n, 4, false);
+    });
+    if (!ref || !par) { std::cerr << name << ": decode failed\n"; return; }
+
+    size_t diffPx = 0; int maxDiff = 0;
+    for (size_t i = 0; i < (size_t)w * h * 4; ++i) {
+        int d = std::abs((int)ref[i] - (int)par[i]);
+        if (d) { ++diffPx; maxDiff = std::max(maxDiff, d); }
+    }
+    double mp = (double)w * h / 1e6;
+    printf("%-28s %5dx%-5d %s  stbi %8.2f ms (%6.1f MP/s)  decodeImage %8.2f ms (%6.1f MP/s)  x%.2f  diff %zu ch (max %d)\n",
+           name.c_str(), w, h, splittable ? "rst" : "---", tStb, mp / tStb * 1e3, tPar, mp / tPar * 1e3,
+           tStb / tPar, diffPx, maxDiff);
+    stbi_image_free(ref);
+    stbi_image_free(par);
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> sizes;
+    std::vector<std::string> files;
+    int runs = 3;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--size" && i + 1 < argc) sizes.push_back(atoi(argv[++i]));
+        else if (a == "--runs" && i + 1 < argc) runs = std::max(1, atoi(argv[++i]));
+        else files.push_back(a);
+    }
+    if (files.empty() && sizes.empty()) { files.push_back("assets/textures/container.jpg"); sizes = { 4096, 8192 }; }
+
+    buildZigzag();
+    printf("threads: %u\n", std::max(1u, std::thread::hardware_concurrency()));
+    for (const auto& f : files) {
+        std::ifstream in(f, std::ios::binary);
+        if (!in) { std::cerr << "cannot open " << f << "\n"; continue; }
+        std::vector<unsigned char> jpg((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        bench(f, jpg, runs);
+    }
+    for (int s : sizes) {
+        std::vector<unsigned char> rgb = syntheticImage(s, s);
+        std::vector<unsigned char> jpg = encodeTestJpeg(rgb.data(), s, s, 85, (s + 15) / 16);
+        bench("synthetic-" + std::to_string(s) + ".jpg", jpg, runs);
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+// meshbench: the .glb and binary .ply loaders against the OBJ path on the same geometry.
+//   g++ -std=c++17 -O2 tools/meshbench/main.cpp -Iproject -pthread -o tools/meshbench/meshbench
+//   ./tools/meshbench/meshbench [--grid N]... [--runs N] [--numbers N] [files.obj...]
+// Each OBJ (default assets/objects/planet.obj, plus synthetic N x N-quad
+// terrains for --grid, default 512 and 1024) is welded and written out here
+// as an equivalent .glb (interleaved pos/normal, separate uv, 16- or 32-bit
+// indices) and binary little-endian .ply. Times loadOBJ_from_memory (what
+// loadOBJ_to_interleaved runs after reading the file), loadGLB_from_memory,
+// loadPLY_from_memory and parseGlbDirect, best of --runs, in ms and MB/s of
+// input, and checks every loader's triangles against the OBJ's.
+// First, --numbers (default 2M) random floats printed the ways OBJ exporters
+// print them are read with parseFloat and with strtof, timed, and compared bit
+// for bit.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gltf_loader.h"
+#include "mesh_format.h"
+#include "obj_loader.h"
+#include "ply_loader.h"
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------- Test Inputs ----------------
+
+// Rolling terrain with per-vertex normals and uvs, as an exporter would write it.
+static std::string gridObj(int n) {
+    std::string s;
+    char line[128];
+    auto h = [](float x, float z) { return 0.1f * std::sin(x * 6.0f) * std::cos(z * 4.0f); };
+    for (int j = 0; j <= n; ++j)
+        for (int i = 0; i <= n; ++i) {
+            const float x = (float)i / n, z = (float)j / n, e = 1e-3f;
+            const float dx = (h(x + e, z) - h(x - e, z)) / (2 * e), dz = (h(x, z + e) - h(x, z - e)) / (2 * e);
+            const float len = std::sqrt(dx * dx + 1 + dz * dz);
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x, h(x, z), z);                  s += line;
+            snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", -dx / len, 1 / len, -dz / len); s += line;
+            snprintf(line, sizeof(line), "vt %.6f %.6f\n", x, z);                               s += line;
+        }
+    for (int j = 0; j < n; ++j)
+        for (int i = 0; i < n; ++i) {
+            const int a = j * (n + 1) + i + 1, b = a + 1, c = a + n + 1, d = c + 1;
+            snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, c, c, c, b, b, b); s += line;
+            snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", b, b, b, c, c, c, d, d, d); s += line;
+        }
+    return s;
+}
+
+static void put(std::vector<unsigned char>& out, const void* p, size_t n) {
+    out.insert(out.end(), (const unsigned char*)p, (const unsigned char*)p + n);
+}
+
+static std::vector<unsigned char> writeGlb(const IndexedMesh& m) {
+    const uint32_t vc = m.vertexCount(), ic = (uint32_t)m.indices.size();
+    const bool shortIdx = vc <= 65535;
+    std::vector<unsigned char> bin;
+    float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+    for (uint32_t v = 0; v < vc; ++v) {
+        const float* f = &m.vertices[(size_t)v * 8];
+        put(bin, f, 6 * sizeof(float));
+        for (int k = 0; k < 3; ++k) { lo[k] = std::min(lo[k], f[k]); hi[k] = std::max(hi[k], f[k]); }
+    }
+    const size_t uvOffset = bin.size();
+    for (uint32_t v = 0; v < vc; ++v) {
+        const float uv[2] = { m.vertices[(size_t)v * 8 + 6], 1.0f - m.vertices[(size_t)v * 8 + 7] };
+        put(bin, uv, sizeof(uv));
+    }
+    const size_t idxOffset = bin.size();
+    for (uint32_t i : m.indices) {
+        if (shortIdx) { const uint16_t s = (uint16_t)i; put(bin, &s, 2); }
+        else put(bin, &i, 4);
+    }
+    while (bin.size() % 4) bin.push_back(0);
+
+    char json[2048];
+    snprintf(json, sizeof(json),
+        "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":%zu}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu,\"byteStride\":24},"
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+        "\"accessors\":[{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\","
+        "\"min\":[%g,%g,%g],\"max\":[%g,%g,%g]},"
+        "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\"},"
+        "{\"bufferView\":1,\"componentType\":5126,\"count\":%u,\"type\":\"VEC2\"},"
+        "{\"bufferView\":2,\"componentType\":%d,\"count\":%u,\"type\":\"SCALAR\"}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+        "\"nodes\":[{\"mesh\":0}],\"scenes\":[{\"nodes\":[0]}],\"scene\":0}",
+        bin.size(), uvOffset, uvOffset, idxOffset - uvOffset, idxOffset, (size_t)ic * (shortIdx ? 2 : 4),
+        vc, lo[0], lo[1], lo[2], hi[0], hi[1], hi[2], vc, vc, shortIdx ? 5123 : 5125, ic);
+    std::string js = json;
+    while (js.size() % 4) js += ' ';
+
+    std::vector<unsigned char> glb;
+    const uint32_t header[3] = { 0x46546C67u, 2u, (uint32_t)(12 + 8 + js.size() + 8 + bin.size()) };
+    const uint32_t jsonChunk[2] = { (uint32_t)js.size(), 0x4E4F534Au };
+    const uint32_t binChunk[2] = { (uint32_t)bin.size(), 0x004E4942u };
+    put(glb, header, sizeof(header));
+    put(glb, jsonChunk, sizeof(jsonChunk)); put(glb, js.data(), js.size());
+    put(glb, binChunk, sizeof(binChunk));   put(glb, bin.data(), bin.size());
+    return glb;
+}
+
+static std::vector<unsigned char> writePly(const IndexedMesh& m) {
+    const uint32_t vc = m.vertexCount(), tc = (uint32_t)(m.indices.size() / 3);
+    std::string header = "ply\nformat binary_little_endian 1.0\nelement vertex " + std::to_string(vc) +
+        "\nproperty float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\n"
+        "property float s\nproperty float t\nelement face " + std::to_string(tc) +
+        "\nproperty list uchar int vertex_indices\nend_header\n";
+    std::vector<unsigned char> ply;
+    put(ply, header.data(), header.size());
+    put(ply, m.vertices.data(), m.vertices.size() * sizeof(float));
+    for (uint32_t t = 0; t < tc; ++t) {
+        const unsigned char three = 3;
+        put(ply, &three, 1);
+        put(ply, &m.indices[(size_t)t * 3], 3 * sizeof(uint32_t));
+    }
+    return ply;
+}
+
+// ---------------- Bench ----------------
+
+static double bestOf(int runs, const std::function<void()>& fn) {
+    double best = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        const double t0 = nowMs();
+        fn();
+        best = std::min(best, nowMs() - t0);
+    }
+    return best;
+}
+
+static float maxDiff(const std::vector<float>& a, const std::vector<float>& b) {
+    if (a.size() != b.size()) return INFINITY;
+    float d = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) d = std::max(d, std::fabs(a[i] - b[i]));
+    return d;
+}
+
+static void report(const char* name, size_t bytes, double ms, float diff) {
+    printf("  %-22s %9.1f KB %9.2f ms %8.1f MB/s", name, bytes / 1024.0, ms, bytes / (1024.0 * 1024.0) / (ms / 1000.0));
+    if (diff >= 0.0f) printf("   max |d| vs obj %g", diff);
+    printf("\n");
+}
+
+static void benchNumbers(size_t count, int runs) {
+    std::mt19937 rng(1);
+    std::string text;
+    std::vector<size_t> starts;
+    char buf[64];
+    while (starts.size() < count) {
+        const uint32_t bits = rng();
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        if (!std::isfinite(f)) continue;
+        static const char* kFormats[] = { "%.6f", "%.9g", "%g", "%.4e" };
+        const float scaled = std::fabs(f) > 1e6f || std::fabs(f) < 1e-6f ? std::ldexp(f, -std::ilogb(f)) : f;
+        snprintf(buf, sizeof(buf), kFormats[starts.size() % 4], starts.size() % 4 == 0 ? scaled : f);
+        starts.push_back(text.size());
+        text += buf;
+        text += ' ';
+    }
+    std::vector<float> a(count), b(count);
+    const char* end = text.data() + text.size();
+    const double fast = bestOf(runs, [&] { for (size_t i = 0; i < count; ++i) parseFloat(text.data() + starts[i], end, a[i]); });
+    const double slow = bestOf(runs, [&] { for (size_t i = 0; i < count; ++i) b[i] = std::strtof(text.data() + starts[i], nullptr); });
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; ++i) mismatches += std::memcmp(&a[i], &b[i], sizeof(float)) != 0;
+    printf("numbers: %zu floats, %.1f MB\n", count, text.size() / (1024.0 * 1024.0));
+    printf("  %-22s %9.2f ns/float %8.1f MB/s\n", "parseFloat", fast * 1e6 / count, text.size() / (1024.0 * 1024.0) / (fast / 1000.0));
+    printf("  %-22s %9.2f ns/float %8.1f MB/s\n", "strtof", slow * 1e6 / count, text.size() / (1024.0 * 1024.0) / (slow / 1000.0));
+    printf("  bit mismatches: %zu\n", mismatches);
+}
+
+static void bench(const std::string& name, const std::string& obj, int runs) {
+    std::vector<float> ref;
+    if (!loadOBJ_from_memory(obj.data(), obj.size(), ref) || ref.empty()) { std::cerr << name << ": no triangles\n"; return; }
+    // Welding keeps corner order, so every loader below expands to the OBJ's triangles.
+    const IndexedMesh indexed = buildIndexedMesh(ref, 8);
+    const std::vector<unsigned char> glb = writeGlb(indexed), ply = writePly(indexed);
+    printf("%s: %zu triangles, %u vertices\n", name.c_str(), ref.size() / 24, indexed.vertexCount());
+
+    // The .glb's uvs round-trip through v' = 1 - v, so expect differences of an ulp there.
+    std::vector<float> out;
+    double ms = bestOf(runs, [&] { out.clear(); loadOBJ_from_memory(obj.data(), obj.size(), out); });
+    report("obj", obj.size(), ms, -1.0f);
+    ms = bestOf(runs, [&] { out.clear(); loadGLB_from_memory(glb.data(), glb.size(), out); });
+    report("glb", glb.size(), ms, maxDiff(ref, out));
+    ms = bestOf(runs, [&] { out.clear(); loadPLY_from_memory((const char*)ply.data(), ply.size(), out); });
+    report("ply", ply.size(), ms, maxDiff(ref, out));
+    GlbDirectMesh direct;
+    ms = bestOf(runs, [&] { direct = GlbDirectMesh(); parseGlbDirect(glb.data(), glb.size(), direct); });
+    report(direct.vertexData ? "glb direct" : "glb direct (rejected)", glb.size(), ms, -1.0f);
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> grids;
+    std::vector<std::string> files;
+    int runs = 5;
+    size_t numbers = 2000000;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--grid" && i + 1 < argc) grids.push_back(std::max(1, atoi(argv[++i])));
+        else if (a == "--runs" && i + 1 < argc) runs = std::max(1, atoi(argv[++i]));
+        else if (a == "--numbers" && i + 1 < argc) numbers = (size_t)std::max(0, atoi(argv[++i]));
+        else files.push_back(a);
+    }
+    if (files.empty() && grids.empty()) { files.push_back("assets/objects/planet.obj"); grids = { 512, 1024 }; }
+
+    if (numbers) benchNumbers(numbers, runs);
+    for (const auto& f : files) {
+        std::ifstream in(f, std::ios::binary);
+        if (!in) { std::cerr << "cannot open " << f << "\n"; continue; }
+        std::string obj((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        bench(f, obj, runs);
+    }
+    for (int n : grids) bench("grid-" + std::to_string(n) + ".obj", gridObj(n), runs);
+    return 0;
+}
@@ -0,0 +1,159 @@
+// nbodybench: Barnes-Hut vs direct O(n^2) gravity in project/nbody.h.
+//   g++ -std=c++17 -O2 tools/nbodybench/main.cpp -Iproject -pthread -o tools/nbodybench/nbodybench
+//   ./tools/nbodybench/nbodybench [--bodies N]... [--runs N] [--theta T] [--threads N] [--direct-max N]
+//                                 [--integrator euler|leapfrog|rk4] [--deterministic]
+//                                 [--drift-bodies N] [--drift-steps N]
+// For each size (default 10k, 100k, 1M) it seeds the same disc the app uses,
+// times full Barnes-Hut steps (sort, build, forces, integrate) and the direct
+// sum, and reports the tree's force error against the direct sum. Above
+// --direct-max bodies (default 100k) the direct time is measured on a sample of
+// bodies and scaled up, since a full 1M-body O(n^2) pass takes minutes.
+// Then every integrator runs --drift-steps fixed steps (default 500 at 1/120 s)
+// on a --drift-bodies disc (default 5000), reporting body-steps/s, the
+// integration kernels' own throughput, the relative energy drift, and a hash of
+// the final state: with --deterministic the hash is the same on every machine
+// and thread count.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "nbody.h"
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// RMS of |a_tree - a_direct| / |a_direct| over bodies [0, sample), pairwise forces only.
+static double treeError(NBodySystem& sys, WorkerPool& pool, size_t sample) {
+    float central = sys.params.centralMass;
+    sys.params.centralMass = 0.0f;
+    sys.computeForces(pool);
+    std::vector<float> tx(sys.ax.begin(), sys.ax.begin() + sample), ty(sys.ay.begin(), sys.ay.begin() + sample),
+                       tz(sys.az.begin(), sys.az.begin() + sample);
+    sys.computeForcesDirect(pool, 0, sample);
+    sys.params.centralMass = central;
+    double sum = 0.0;
+    for (size_t i = 0; i < sample; ++i) {
+        double dx = tx[i] - sys.ax[i], dy = ty[i] - sys.ay[i], dz = tz[i] - sys.az[i];
+        double ref = std::sqrt((double)sys.ax[i] * sys.ax[i] + (double)sys.ay[i] * sys.ay[i] + (double)sys.az[i] * sys.az[i]);
+        if (ref > 0.0) sum += (dx * dx + dy * dy + dz * dz) / (ref * ref);
+    }
+    return std::sqrt(sum / std::max<size_t>(1, sample));
+}
+
+// Total energy in double precision, with the pairwise potential summed directly.
+static double totalEnergy(const NBodySystem& sys) {
+    const NBodyParams& p = sys.params;
+    const double eps2 = (double)p.softening * p.softening;
+    double e = 0.0;
+    for (size_t i = 0; i < sys.size(); ++i) {
+        double xi = sys.x[i], yi = sys.y[i], zi = sys.z[i];
+        e += 0.5 * sys.m[i] * ((double)sys.vx[i] * sys.vx[i] + (double)sys.vy[i] * sys.vy[i] + (double)sys.vz[i] * sys.vz[i]);
+        e -= p.G * p.centralMass * sys.m[i] / std::sqrt(xi * xi + yi * yi + zi * zi + eps2);
+        for (size_t j = i + 1; j < sys.size(); ++j) {
+            double dx = sys.x[j] - xi, dy = sys.y[j] - yi, dz = sys.z[j] - zi;
+            e -= p.G * sys.m[i] * sys.m[j] / std::sqrt(dx * dx + dy * dy + dz * dz + eps2);
+        }
+    }
+    return e;
+}
+
+// FNV-1a over the bits of every position and velocity.
+static uint64_t stateHash(const NBodySystem& sys) {
+    uint64_t h = 1469598103934665603ull;
+    for (const std::vector<float>* v : { &sys.x, &sys.y, &sys.z, &sys.vx, &sys.vy, &sys.vz })
+        for (float f : *v) {
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            for (int k = 0; k < 4; ++k) { h ^= (bits >> (8 * k)) & 0xff; h *= 1099511628211ull; }
+        }
+    return h;
+}
+
+static void benchIntegrator(NBodyIntegrator integrator, size_t n, int steps, bool deterministic, float theta, WorkerPool& pool) {
+    NBodySystem sys;
+    sys.params.theta = theta;
+    sys.params.integrator = integrator;
+    sys.params.deterministic = deterministic;
+    sys.seedDisc(n, 1.0f, 4.0f, 2.0f);
+    const float dt = 1.0f / 120.0f;
+    double e0 = totalEnergy(sys), integrateMs = 0.0;
+    double t0 = nowMs();
+    for (int s = 0; s < steps; ++s) {
+        sys.step(dt, pool);
+        integrateMs += sys.stats().integrateMs;
+    }
+    double totalMs = nowMs() - t0;
+    double e1 = totalEnergy(sys);
+    printf("  %-9s %6.2f M body-steps/s  (integration kernels %7.1f M body-steps/s)  energy drift %+.2e  hash %016llx\n",
+           nbodyIntegratorName(integrator), (double)n * steps / totalMs / 1000.0,
+           integrateMs > 0.0 ? (double)n * steps / integrateMs / 1000.0 : 0.0, (e1 - e0) / std::fabs(e0), (unsigned long long)stateHash(sys));
+}
+
+static void bench(size_t n, int runs, float theta, size_t directMax, NBodyIntegrator integrator, bool deterministic, WorkerPool& pool) {
+    NBodySystem sys;
+    sys.params.theta = theta;
+    sys.params.integrator = integrator;
+    sys.params.deterministic = deterministic;
+    sys.seedDisc(n, 1.0f, 4.0f, 2.0f);
+
+    NBodyStats best;
+    double stepMs = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        double t0 = nowMs();
+        sys.step(0.002f, pool);
+        double t = nowMs() - t0;
+        if (t < stepMs) { stepMs = t; best = sys.stats(); }
+    }
+
+    size_t directCount = n <= directMax ? n : std::min<size_t>(n, 4096);
+    double t0 = nowMs();
+    sys.computeForcesDirect(pool, 0, directCount);
+    double directMs = (nowMs() - t0) * ((double)n / directCount);
+
+    double err = treeError(sys, pool, std::min<size_t>(n, 2048));
+    printf("%8zu bodies  BH step %8.2f ms (sort %6.2f  build %6.2f  force %8.2f  integrate %5.2f)  %7zu nodes %6zu groups  %5.0f interactions/body\n"
+           "                direct %10.1f ms%s  %7.1f x  |  %6.2f M body-steps/s BH  %7.3f G interactions/s direct  rms force err %.2e\n",
+           n, stepMs, best.sortMs, best.buildMs, best.forceMs, best.integrateMs, best.nodes, best.groups, best.interactions / n,
+           directMs, directCount < n ? " (sampled)" : "          ", directMs / stepMs,
+           n / stepMs / 1000.0, (double)n * n / directMs / 1e6, err);
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    int runs = 3;
+    unsigned threads = 0;
+    float theta = NBodyParams().theta;
+    size_t directMax = 100000, driftBodies = 5000;
+    int driftSteps = 500;
+    NBodyIntegrator integrator = NBodyParams().integrator;
+    bool deterministic = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--bodies" && i + 1 < argc) sizes.push_back((size_t)atoll(argv[++i]));
+        else if (a == "--runs" && i + 1 < argc) runs = std::max(1, atoi(argv[++i]));
+        else if (a == "--theta" && i + 1 < argc) theta = (float)atof(argv[++i]);
+        else if (a == "--threads" && i + 1 < argc) threads = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (a == "--direct-max" && i + 1 < argc) directMax = (size_t)atoll(argv[++i]);
+        else if (a == "--drift-bodies" && i + 1 < argc) driftBodies = (size_t)atoll(argv[++i]);
+        else if (a == "--drift-steps" && i + 1 < argc) driftSteps = std::max(1, atoi(argv[++i]));
+        else if (a == "--deterministic") deterministic = true;
+        else if (a == "--integrator" && i + 1 < argc) {
+            if (!nbodyParseIntegrator(argv[++i], integrator)) { fprintf(stderr, "unknown integrator '%s'\n", argv[i]); return 1; }
+        }
+    }
+    if (sizes.empty()) sizes = { 10000, 100000, 1000000 };
+
+    WorkerPool pool(threads);
+    printf("%u threads, theta %.2f, %s%s\n", pool.size(), theta, nbodyIntegratorName(integrator), deterministic ? ", deterministic" : "");
+    for (size_t n : sizes) bench(n, runs, theta, directMax, integrator, deterministic, pool);
+    printf("%zu bodies, %d steps of 1/120 s:\n", driftBodies, driftSteps);
+    for (NBodyIntegrator i : { NBodyIntegrator::SymplecticEuler, NBodyIntegrator::Leapfrog, NBodyIntegrator::RK4 })
+        benchIntegrator(i, driftBodies, driftSteps, deterministic, theta, pool);
+    return 0;
+}
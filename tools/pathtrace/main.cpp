@@ -0,0 +1,190 @@
+// pathtrace: offline CPU path-traced reference image of a scene (project/path_tracer.h).
+//   g++ -std=c++17 -O2 tools/pathtrace/main.cpp -Iinclude -Iproject -pthread -o tools/pathtrace/pathtrace
+//   ./tools/pathtrace/pathtrace [--scene FILE] [--job "time=1.5 yaw=0.3 size=640x480 ..."] [--out FILE]
+//                               [--spp N] [--bounces N] [--sun RADIANCE] [--ambient L] [--threads N] [--runs N]
+// Loads a .scene (default assets/scenes/orbits.scene), places its bodies at
+// `time` the way project/app does, flattens every mesh into one triangle BVH
+// and renders the view of a --batch job line (yaw, pitch, radius, time, size;
+// see scene_params.h). Unlit materials become area lights of their colour
+// times --sun (default 8: about the raster shading's brightness on the faces of
+// crates turned to the planet); --ambient (default 0.2) is the environment
+// bounce rays see, the raster shading's ambient term as light.
+// Writes linear radiance as .hdr, or an sRGB-encoded .ppm when --out ends in
+// .ppm (default out.hdr), and prints rays/s: best of --runs renders.
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gltf_loader.h"
+#include "image_decode.h"
+#include "mesh_bvh.h"
+#include "mesh_format.h"
+#include "obj_loader.h"
+#include "path_tracer.h"
+#include "ply_loader.h"
+#include "scene_format.h"
+#include "scene_params.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+static bool readFile(const std::string& path, std::vector<char>& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static bool loadTexture(const std::string& path, PtTexture& tex) {
+    int w, h, n;
+    unsigned char* px = decodeImageFile(path, &w, &h, &n, 4, false);
+    if (!px) return false;
+    tex.w = w; tex.h = h;
+    tex.rgb.resize((size_t)w * h * 3);
+    float lut[256];
+    for (int i = 0; i < 256; ++i) lut[i] = srgbToLinear(i / 255.0f);
+    for (size_t i = 0; i < (size_t)w * h; ++i)
+        for (int a = 0; a < 3; ++a) tex.rgb[i * 3 + a] = lut[px[i * 4 + a]];
+    stbi_image_free(px);
+    return true;
+}
+
+// .obj, .glb or .ply by extension, as project/app's mesh loads pick the loader.
+static bool loadMesh(const std::string& path, std::vector<float>& out) {
+    std::vector<char> src;
+    if (!readFile(path, src)) return false;
+    std::string ext = path.substr(std::min(path.size(), path.rfind('.')));
+    for (auto& c : ext) c = (char)tolower(c);
+    if (ext == ".glb") return loadGLB_from_memory((const unsigned char*)src.data(), src.size(), out);
+    if (ext == ".ply") return loadPLY_from_memory(src.data(), src.size(), out);
+    return loadOBJ_from_memory(src.data(), src.size(), out);
+}
+
+// Meshes, materials and bodies at time t, flattened into `pt`.
+static bool buildScene(const SceneDesc& sd, float t, float sun, PtScene& pt) {
+    std::vector<std::vector<float>> meshes(sd.meshes.size());
+    for (size_t i = 0; i < sd.meshes.size(); ++i) {
+        const std::string path(sd.meshes[i].path);
+        if (path == kBuiltinCube) { meshes[i].assign(kBuiltinCubeVertices, kBuiltinCubeVertices + 36 * 8); continue; }
+        if (!loadMesh(path, meshes[i]) || meshes[i].empty()) {
+            std::cerr << "cannot load mesh " << path << "\n";
+            return false;
+        }
+    }
+    pt.materials.resize(sd.materials.size());
+    for (size_t i = 0; i < sd.materials.size(); ++i) {
+        const SceneMaterial& m = sd.materials[i];
+        PtMaterial& pm = pt.materials[i];
+        for (int a = 0; a < 3; ++a) pm.albedo[a] = m.color[a];
+        if (m.flags & kMaterialUnlit) {
+            for (int a = 0; a < 3; ++a) { pm.emission[a] = m.color[a] * sun; pm.albedo[a] = 0.0f; }
+        } else if (!m.texture.empty()) {
+            PtTexture tex;
+            if (loadTexture(std::string(m.texture), tex)) { pm.texture = (int)pt.textures.size(); pt.textures.push_back(std::move(tex)); }
+            else std::cerr << "cannot load texture " << m.texture << ", using the material colour\n";
+        }
+    }
+    // Placed as buildSceneObjects() in project/main.cpp does: parents before children.
+    std::vector<glm::vec3> centers(sd.bodyCount);
+    for (size_t i = 0; i < sd.bodyCount; ++i) {
+        const SceneBody& b = sd.bodies[i];
+        glm::vec3 center = b.parent == kSceneNoParent ? glm::vec3(0.0f) : centers[b.parent];
+        float a = t * b.orbitSpeed + b.phase;
+        glm::vec3 pos = center + glm::vec3(cos(a) * b.orbitRadius, b.height, sin(a) * b.orbitRadius);
+        centers[i] = pos;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
+        if (b.spin != 0.0f) model = glm::rotate(model, t * b.spin, glm::vec3(0.5, 1, 0));
+        model = glm::scale(model, glm::vec3(b.scale));
+        if (b.mesh >= meshes.size() || b.material >= pt.materials.size()) { std::cerr << "body " << i << " names a missing mesh or material\n"; return false; }
+        const std::vector<float>& m = meshes[b.mesh];
+        pt.addMesh(m.data(), m.size() / 8, glm::value_ptr(model), b.material);
+    }
+    return true;
+}
+
+static bool writePpm(const std::string& path, int w, int h, const std::vector<float>& rgb) {
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    f << "P6\n" << w << " " << h << "\n255\n";
+    std::vector<unsigned char> px(rgb.size());
+    for (size_t i = 0; i < rgb.size(); ++i) {
+        float c = std::min(1.0f, std::max(0.0f, rgb[i]));
+        c = c <= 0.0031308f ? 12.92f * c : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        px[i] = (unsigned char)(c * 255.0f + 0.5f);
+    }
+    f.write((const char*)px.data(), px.size());
+    return (bool)f;
+}
+
+int main(int argc, char** argv) {
+    std::string scenePath = "assets/scenes/orbits.scene", job, out = "out.hdr";
+    PtSettings settings;
+    float sun = 8.0f, ambient = 0.2f;
+    int runs = 1;
+    unsigned threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--scene" && i + 1 < argc) scenePath = argv[++i];
+        else if (a == "--job" && i + 1 < argc) job = argv[++i];
+        else if (a == "--out" && i + 1 < argc) out = argv[++i];
+        else if (a == "--spp" && i + 1 < argc) settings.spp = std::max(1, atoi(argv[++i]));
+        else if (a == "--bounces" && i + 1 < argc) settings.maxBounces = std::max(0, atoi(argv[++i]));
+        else if (a == "--sun" && i + 1 < argc) sun = (float)atof(argv[++i]);
+        else if (a == "--ambient" && i + 1 < argc) ambient = (float)atof(argv[++i]);
+        else if (a == "--threads" && i + 1 < argc) threads = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (a == "--runs" && i + 1 < argc) runs = std::max(1, atoi(argv[++i]));
+        else { std::cerr << "unknown argument " << a << "\n"; return 1; }
+    }
+
+    SceneParams view;
+    std::string err;
+    if (!parseSceneJob(job, view, err)) { std::cerr << "--job: " << err << "\n"; return 1; }
+    settings.width = view.width; settings.height = view.height;
+
+    std::vector<char> text;
+    SceneDesc sd;
+    if (!readFile(scenePath, text)) { std::cerr << "cannot read " << scenePath << "\n"; return 1; }
+    if (!parseSceneText(std::string_view(text.data(), text.size()), sd, err)) { std::cerr << scenePath << ": " << err << "\n"; return 1; }
+
+    WorkerPool pool(threads);
+    PtScene scene;
+    for (int a = 0; a < 3; ++a) scene.ambient[a] = ambient;
+    if (!buildScene(sd, view.time, sun, scene)) return 1;
+    scene.finalize(pool);
+    const MeshBvhStats& bs = scene.bvh.stats();
+    printf("%zu triangles, %zu lights  BVH %.2f ms: %zu 4-wide nodes, %zu leaves, depth %d, SAH %.1f\n",
+           bs.triangles, scene.lights.size(), bs.buildMs, bs.nodes, bs.leaves, bs.depth, bs.sahCost);
+
+    // Camera::orbit from project/multi_view.h: 45 degree vertical field of view.
+    const float eye[3] = { view.camRadius * std::cos(view.pitch) * std::sin(view.yaw), view.camRadius * std::sin(view.pitch),
+                           view.camRadius * std::cos(view.pitch) * std::cos(view.yaw) };
+    const float target[3] = { 0.0f, 0.0f, 0.0f };
+    const PtCamera cam = PtCamera::lookAt(eye, target, 45.0f, (float)view.width / view.height);
+
+    std::vector<float> rgb;
+    PtStats best;
+    for (int r = 0; r < runs; ++r) {
+        PtStats st;
+        PathTracer::render(pool, scene, cam, settings, rgb, st);
+        if (r == 0 || st.ms < best.ms) best = st;
+    }
+    printf("%dx%d, %d spp, %d bounces on %u threads: %.1f ms, %.2f M rays (camera %.2f, bounce %.2f, shadow %.2f), %.2f M rays/s\n",
+           settings.width, settings.height, settings.spp, settings.maxBounces, pool.size(), best.ms, best.rays() / 1e6,
+           best.cameraRays / 1e6, best.bounceRays / 1e6, best.shadowRays / 1e6, best.raysPerSecond() / 1e6);
+
+    const bool ppm = out.size() >= 4 && out.compare(out.size() - 4, 4, ".ppm") == 0;
+    if (!(ppm ? writePpm(out, settings.width, settings.height, rgb) : writeRadianceHdr(out, settings.width, settings.height, rgb))) {
+        std::cerr << "cannot write " << out << "\n";
+        return 1;
+    }
+    printf("wrote %s\n", out.c_str());
+    return 0;
+}
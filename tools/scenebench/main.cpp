@@ -0,0 +1,90 @@
+// scenebench: load time of the scene description formats in project/scene_format.h.
+//   g++ -std=c++17 -O2 tools/scenebench/main.cpp -Iproject -o tools/scenebench/scenebench
+//   ./tools/scenebench/scenebench [--bodies N]... [--runs N] [files.scene...]
+// With no arguments it generates 10k, 100k and 1M-body scenes in memory (one
+// named star per 1000 bodies, the rest anonymous satellites referring to them)
+// and times .scene text parsing, .scn serialization and .scn loading.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "scene_format.h"
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string generateScene(size_t bodies) {
+    std::string s;
+    s.reserve(bodies * 100);
+    s += "mesh planet assets/objects/planet.obj\nmesh cube builtin:cube\n";
+    s += "material sun color=1,0.9,0.5 unlit\nmaterial crate texture=assets/textures/container.jpg\n";
+    char line[256];
+    unsigned rng = 12345;
+    auto frand = [&rng]() { rng = rng * 1664525u + 1013904223u; return (rng >> 8) * (1.0f / 16777216.0f); };
+    size_t star = 0;
+    for (size_t i = 0; i < bodies; ++i) {
+        if (i % 1000 == 0) {
+            star = i / 1000;
+            snprintf(line, sizeof(line), "body s%zu mesh=planet material=sun orbit=%.4f speed=%.4f phase=%.4f scale=0.2\n",
+                     star, 5.0f + 50.0f * frand(), 0.1f * frand(), 6.2832f * frand());
+        } else {
+            snprintf(line, sizeof(line), "body - mesh=cube material=crate parent=s%zu orbit=%.4f speed=%.4f phase=%.4f height=%.4f scale=0.35 spin=%.3f\n",
+                     star, 0.5f + 4.0f * frand(), 0.2f + frand(), 6.2832f * frand(), frand() - 0.5f, 3.0f * frand());
+        }
+        s += line;
+    }
+    return s;
+}
+
+static void bench(const std::string& label, const std::string& text, int runs) {
+    double parseMs = 1e30, writeMs = 1e30, loadMs = 1e30;
+    SceneDesc scene;
+    std::vector<char> blob;
+    for (int r = 0; r < runs; ++r) {
+        std::string err;
+        double t0 = nowMs();
+        if (!parseSceneText(text, scene, err)) { std::cerr << label << ": " << err << "\n"; return; }
+        double t1 = nowMs();
+        blob = serializeScene(scene);
+        double t2 = nowMs();
+        SceneDesc loaded;
+        if (!parseSceneBlob((const unsigned char*)blob.data(), blob.size(), loaded) || loaded.bodyCount != scene.bodyCount) {
+            std::cerr << label << ": .scn round trip failed\n"; return;
+        }
+        double t3 = nowMs();
+        parseMs = std::min(parseMs, t1 - t0);
+        writeMs = std::min(writeMs, t2 - t1);
+        loadMs = std::min(loadMs, t3 - t2);
+    }
+    printf("%-16s %9zu bodies  text %7.1f MB  parse %8.2f ms (%6.0f MB/s, %5.1f ns/body)  .scn %6.1f MB  write %7.2f ms  load %7.3f ms\n",
+           label.c_str(), scene.bodyCount, text.size() / 1048576.0, parseMs, text.size() / 1048576.0 / (parseMs / 1000.0),
+           parseMs * 1e6 / std::max<size_t>(1, scene.bodyCount), blob.size() / 1048576.0, writeMs, loadMs);
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    std::vector<std::string> files;
+    int runs = 3;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--bodies" && i + 1 < argc) sizes.push_back((size_t)atoll(argv[++i]));
+        else if (a == "--runs" && i + 1 < argc) runs = std::max(1, atoi(argv[++i]));
+        else files.push_back(a);
+    }
+    if (files.empty() && sizes.empty()) sizes = { 10000, 100000, 1000000 };
+
+    for (const auto& f : files) {
+        std::ifstream in(f, std::ios::binary);
+        if (!in) { std::cerr << "cannot open " << f << "\n"; continue; }
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        bench(f, text, runs);
+    }
+    for (size_t n : sizes) bench("generated-" + std::to_string(n), generateScene(n), runs);
+    return 0;
+}